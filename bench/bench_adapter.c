@@ -0,0 +1,247 @@
+/****************************************************************************
+ * Copyright (C) 2017 by Paula Perez Rubio                                  *
+ *                                                                          *
+ * This file is part of FastqPuri.                                      *
+ *                                                                          *
+ *   FastqPuri is free software: you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as                *
+ *   published by the Free Software Foundation, either version 3 of the     *
+ *   License, or (at your option) any later version.                        *
+ *                                                                          *
+ *   FastqPuri is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *   GNU General Public License for more details.                           *
+ *                                                                          *
+ *   You should have received a copy of the GNU General Public License      *
+ *   along with FastqPuri.                                              *
+ *   If not, see <http://www.gnu.org/licenses/>.                            *
+ ****************************************************************************/
+
+/**
+ * @file bench_adapter.c
+ * @author Paula Perez <paulaperezrubio@gmail.com>
+ * @date 17.10.2026
+ * @brief microbenchmark of the seed kernels of the adapter search
+ *
+ * Runs trim_adapter (HAMMING, with an adapter index) over random reads of
+ * 50, 100, 150 and 300 bp, half of them with an Illumina adapter (and
+ * substitutions) at a random position, once with every seed kernel of
+ * seed_windows supported by the cpu: scalar, AVX2 and AVX512. The kernels
+ * must trim the reads in exactly the same way, otherwise the program
+ * fails. Reads with fewer than AD_MINSIMD windows (50 bp) are always
+ * tested by the scalar kernel.
+ *
+ * Usage: bench_adapter [-n NREADS] [-r REPEATS]
+ *
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include "defines.h"
+#include "fa_read.h"
+#include "adapters.h"
+#include "trim.h"
+#include "struct_trimFilter.h"
+
+uint64_t alloc_mem = 0;  /**< global variable. Memory allocated in the heap.*/
+Iparam_trimFilter par_TF;  /**< global variable: parameters used by trim.c */
+
+static const char BASES[4] = {'A', 'C', 'G', 'T'};
+
+static const char *ADAPTERS[] = {
+  "AGATCGGAAGAGCACACGTCTGAACTCCAGTCAC",
+  "AGATCGGAAGAGCGTCGTGTAGGGAAAGAGTGT",
+  "ACACTCTTTCCCTACACGACGCTCTTCCGATCT",
+  "CTGTCTCTTATACACATCTCCGAGCCCACGAGAC"};
+
+static const int NADAPTERS = sizeof(ADAPTERS)/sizeof(ADAPTERS[0]);
+
+static const int LENGTHS[] = {50, 100, 150, 300};
+
+static const struct {
+  int kernel;
+  const char *name;
+} KERNELS[] = {
+  {AD_KERNEL_SCALAR, "scalar"},
+  {AD_KERNEL_AVX2, "avx2"},
+  {AD_KERNEL_AVX512, "avx512"}};
+
+/**
+ * @brief outcome of trim_adapter for one read
+ * */
+typedef struct _bench_trim {
+  int ret;  /**< return value of trim_adapter */
+  int L;  /**< read length after trimming */
+  int t_start;  /**< first position kept */
+  int t_end;  /**< last position kept */
+} Bench_trim;
+
+/**
+ * @brief monotonic time in seconds
+ * */
+static double now() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + 1e-9*ts.tv_nsec;
+}
+
+/**
+ * @brief writes the adapters to a fasta file and packs them
+ * */
+static Ad_seq *bench_adapters() {
+  int i;
+  char fastafile[] = "bench_adapter.fa";
+  FILE *f = fopen(fastafile, "w");
+  if (f == NULL) {
+    perror("Could not open bench_adapter.fa");
+    exit(EXIT_FAILURE);
+  }
+  for (i = 0; i < NADAPTERS; i++) {
+    fprintf(f, ">adapter_%d\n%s\n", i, ADAPTERS[i]);
+  }
+  fclose(f);
+  Fa_data *ptr_fa = malloc(sizeof(Fa_data));
+  read_fasta(fastafile, ptr_fa);
+  unlink(fastafile);
+  Ad_seq *adap_list = pack_adapter(ptr_fa);
+  free_fasta(ptr_fa);
+  return adap_list;
+}
+
+/**
+ * @brief random reads of length L, the odd ones with an adapter (and 2%
+ *        substitutions) starting at a random position
+ * */
+static void bench_reads(Fq_read *seqs, char *buffer, int nreads, int L) {
+  int i, j;
+  for (i = 0; i < nreads; i++) {
+    // lines terminated by '\0', as get_fqread leaves them
+    char *line2 = buffer + (uint64_t)i*(2*L + 6);
+    char *line4 = line2 + L + 1;
+    char *line1 = line4 + L + 1;
+    char *line3 = line1 + 2;
+    for (j = 0; j < L; j++) {
+      line2[j] = BASES[rand() & 3];
+      line4[j] = (rand() % 10) ? 'I' : '#';
+    }
+    if (i & 1) {
+      const char *ad = ADAPTERS[rand() % NADAPTERS];
+      int pos = rand() % L;
+      for (j = pos; j < L && ad[j - pos]; j++) {
+        line2[j] = (rand() % 50) ? ad[j - pos] : BASES[rand() & 3];
+      }
+    }
+    line2[L] = '\0';
+    line4[L] = '\0';
+    strcpy(line1, "@");
+    strcpy(line3, "+");
+    memset(seqs + i, 0, sizeof(Fq_read));
+    seqs[i].line1 = line1;
+    seqs[i].L1 = 1;
+    seqs[i].line2 = line2;
+    seqs[i].line3 = line3;
+    seqs[i].L3 = 1;
+    seqs[i].line4 = line4;
+    seqs[i].L = L;
+  }
+}
+
+/**
+ * @brief bench_adapter main function
+ * */
+int main(int argc, char *argv[]) {
+  int nreads = 100000, repeats = 5;
+  int option, i, l, k, r;
+  while ((option = getopt(argc, argv, "n:r:")) != -1) {
+    switch (option) {
+      case 'n': nreads = atoi(optarg); break;
+      case 'r': repeats = atoi(optarg); break;
+      default:
+        fprintf(stderr, "Usage: %s [-n NREADS] [-r REPEATS]\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+  }
+  if (nreads <= 0 || repeats <= 0) {
+    fprintf(stderr, "Invalid number of reads or repeats.\n");
+    exit(EXIT_FAILURE);
+  }
+  par_TF.ad.mismatches = 2;
+  par_TF.ad.threshold = 15;
+  par_TF.ad.mode = HAMMING;
+  par_TF.ad.Nad = NADAPTERS;
+  par_TF.zeroQ = 33;
+  par_TF.minL = 25;
+
+  srand(1);
+  init_alLUTs();
+  Ad_seq *adap_list = bench_adapters();
+  Ad_index *ptr_idx = index_adapter(adap_list, NADAPTERS,
+                                    par_TF.ad.mismatches);
+  Fq_read *orig = malloc(nreads*sizeof(Fq_read));
+  Fq_read *seqs = malloc(nreads*sizeof(Fq_read));
+  char *buffer = malloc((uint64_t)nreads*(2*READ_MAXLEN + 6));
+  Bench_trim *ref = malloc(nreads*sizeof(Bench_trim));
+  int *rets = malloc(nreads*sizeof(int));
+  if (orig == NULL || seqs == NULL || buffer == NULL || ref == NULL ||
+      rets == NULL) {
+    fprintf(stderr, "Could not allocate the reads.\n");
+    exit(EXIT_FAILURE);
+  }
+
+  int nbad = 0;
+  printf("%d reads (half with adapters), %d repeats\n", nreads, repeats);
+  printf("%-8s %-8s %12s %10s %8s\n", "length", "kernel", "ns/read",
+         "speedup", "adapter");
+  for (l = 0; l < (int)(sizeof(LENGTHS)/sizeof(LENGTHS[0])); l++) {
+    bench_reads(orig, buffer, nreads, LENGTHS[l]);
+    double tscalar = 0;
+    for (k = 0; k < (int)(sizeof(KERNELS)/sizeof(KERNELS[0])); k++) {
+      if (!set_seed_kernel(KERNELS[k].kernel)) {
+        printf("%-8d %-8s %12s\n", LENGTHS[l], KERNELS[k].name,
+               "not supported");
+        continue;
+      }
+      double t = 0;
+      int nfound = 0;
+      for (r = 0; r < repeats; r++) {
+        memcpy(seqs, orig, nreads*sizeof(Fq_read));
+        double t0 = now();
+        for (i = 0; i < nreads; i++) {
+          rets[i] = trim_adapter(seqs + i, adap_list, ptr_idx);
+        }
+        t += now() - t0;
+        for (i = 0; i < nreads; i++) {
+          Bench_trim b = {rets[i], seqs[i].L, seqs[i].t_start,
+                          seqs[i].t_end};
+          if (r == 0 && k == 0) {
+            ref[i] = b;
+          } else if (memcmp(&b, ref + i, sizeof(Bench_trim))) {
+            nbad++;
+          }
+          nfound += (rets[i] != 1);
+        }
+      }
+      if (k == 0) tscalar = t;
+      printf("%-8d %-8s %12.1f %9.2fx %8d\n", LENGTHS[l], KERNELS[k].name,
+             1e9*t/repeats/nreads, tscalar/t, nfound/repeats);
+    }
+  }
+  set_seed_kernel(AD_KERNEL_AUTO);
+
+  free_Ad_index(ptr_idx);
+  free(orig);
+  free(seqs);
+  free(buffer);
+  free(ref);
+  free(rets);
+  if (nbad) {
+    fprintf(stderr, "ERROR: %d reads trimmed differently by the seed "
+            "kernels.\n", nbad);
+    exit(EXIT_FAILURE);
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,259 @@
+/****************************************************************************
+ * Copyright (C) 2017 by Paula Perez Rubio                                  *
+ *                                                                          *
+ * This file is part of FastqPuri.                                      *
+ *                                                                          *
+ *   FastqPuri is free software: you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as                *
+ *   published by the Free Software Foundation, either version 3 of the     *
+ *   License, or (at your option) any later version.                        *
+ *                                                                          *
+ *   FastqPuri is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *   GNU General Public License for more details.                           *
+ *                                                                          *
+ *   You should have received a copy of the GNU General Public License      *
+ *   along with FastqPuri.                                              *
+ *   If not, see <http://www.gnu.org/licenses/>.                            *
+ ****************************************************************************/
+
+/**
+ * @file bench_bloom.c
+ * @author Paula Perez <paulaperezrubio@gmail.com>
+ * @date 17.10.2026
+ * @brief microbenchmark of the batched Bloom filter queries
+ *
+ * Builds a Bloom filter (by default far larger than the last level cache)
+ * from a random reference and looks up random reads and reads sampled
+ * from the reference (with substitutions). The reads are looked up:
+ * - one by one, kmer by kmer (contains), as trimFilter did before
+ *   reads_inBloom,
+ * - one by one with reads_inBloom,
+ * - in blocks of NREADS_BLOCK reads with reads_inBloom, as trimFilter
+ *   does.
+ * The three must find the same reads, otherwise the program fails.
+ *
+ * Usage: bench_bloom [-m FILTER_MB] [-n NREADS] [-l READ_LENGTH]
+ *                    [-k KMERSIZE] [-g GENOME_LENGTH] [-b] [-s SCORE]
+ *
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <inttypes.h>
+#include "defines.h"
+#include "bloom.h"
+#include "trim.h"
+#include "struct_trimFilter.h"
+
+uint64_t alloc_mem = 0;  /**< global variable. Memory allocated in the heap.*/
+Iparam_trimFilter par_TF;  /**< global variable: score used by trim.c */
+
+static const char BASES[4] = {'A', 'C', 'G', 'T'};
+
+/**
+ * @brief monotonic time in seconds
+ * */
+static double now() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + 1e-9*ts.tv_nsec;
+}
+
+/**
+ * @brief number of kmers that have to be found for a read with N kmers
+ *        (same rule as min_hits in trim.c)
+ * */
+static int need_hits(int N, double score) {
+  if (N <= 0) {
+    return (0.0/N > score) ? 0 : 1;
+  }
+  if (score*N >= N + 1) {
+    return N + 1;
+  }
+  int h = (score > 0) ? (int)(score*N) : 0;
+  while (h > 0 && (double)(h - 1)/N > score) h--;
+  while (h <= N && !((double)h/N > score)) h++;
+  return h;
+}
+
+/**
+ * @brief looks up the kmers of one read one by one, until the outcome is
+ *        settled (is_read_inBloom before the batched queries)
+ * */
+static bool read_inBloom(Bfilter *ptr_bf, Bfkmer *ptr_bfkmer, Fq_read *seq,
+                         double score) {
+  int maxN = seq -> L - ptr_bf -> kmersize + 1;
+  int need = need_hits(maxN, score);
+  int hits = 0, nkmers = 0, position;
+  if (ptr_bf -> version == BF_VERSION_ROLL) {
+    ptr_bfkmer -> nvalid = 0;
+    for (position = 0; position < seq -> L && hits < need &&
+                       hits + maxN - nkmers >= need; position++) {
+      if (roll_kmer(ptr_bfkmer, (unsigned char)(seq -> line2[position]))) {
+         rollHash(ptr_bfkmer);
+         if (contains(ptr_bf, ptr_bfkmer)) hits++;
+      }
+      if (position >= ptr_bf -> kmersize - 1) nkmers++;
+    }
+  } else {
+    for (nkmers = 0; nkmers < maxN && hits < need &&
+                     hits + maxN - nkmers >= need; nkmers++) {
+      if (compact_kmer((unsigned char *)seq -> line2, nkmers, ptr_bfkmer)) {
+         multiHash(ptr_bfkmer);
+         if (contains(ptr_bf, ptr_bfkmer)) hits++;
+      }
+    }
+  }
+  return (hits >= need);
+}
+
+/**
+ * @brief prints the time of one lookup mode
+ * */
+static void report(const char *mode, double t, int nreads, int nfound) {
+  printf("%-28s %8.3f s %12.0f reads/s %8d found\n", mode, t, nreads/t,
+         nfound);
+}
+
+/**
+ * @brief bench_bloom main function
+ * */
+int main(int argc, char *argv[]) {
+  uint64_t filterMB = 1024;
+  uint64_t G = 5000000;
+  int nreads = 200000, L = 100, kmersize = 25, blocked = 0;
+  int option, i, j;
+  par_TF.score = 0.5;
+  while ((option = getopt(argc, argv, "m:n:l:k:g:bs:")) != -1) {
+    switch (option) {
+      case 'm': filterMB = strtoull(optarg, NULL, 10); break;
+      case 'n': nreads = atoi(optarg); break;
+      case 'l': L = atoi(optarg); break;
+      case 'k': kmersize = atoi(optarg); break;
+      case 'g': G = strtoull(optarg, NULL, 10); break;
+      case 'b': blocked = 1; break;
+      case 's': par_TF.score = atof(optarg); break;
+      default:
+        fprintf(stderr, "Usage: %s [-m FILTER_MB] [-n NREADS] "
+                "[-l READ_LENGTH] [-k KMERSIZE] [-g GENOME_LENGTH] [-b] "
+                "[-s SCORE]\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+  }
+  if (L < kmersize || L > READ_MAXLEN || nreads <= 0 || G < (uint64_t)L) {
+    fprintf(stderr, "Invalid read length, number of reads or genome "
+            "length.\n");
+    exit(EXIT_FAILURE);
+  }
+
+  // random reference, written to a fasta file for create_Bfilter
+  srand(1);
+  char *genome = malloc(G);
+  char *reads = malloc((uint64_t)nreads*L);
+  Fq_read *seqs = calloc(nreads, sizeof(Fq_read));
+  Fq_read **ptr_seqs = malloc(nreads*sizeof(Fq_read *));
+  bool *found_single = malloc(nreads*sizeof(bool));
+  bool *found_batch = malloc(nreads*sizeof(bool));
+  if (genome == NULL || reads == NULL || seqs == NULL || ptr_seqs == NULL ||
+      found_single == NULL || found_batch == NULL) {
+    fprintf(stderr, "Could not allocate the reference and the reads.\n");
+    exit(EXIT_FAILURE);
+  }
+  for (uint64_t g = 0; g < G; g++) genome[g] = BASES[rand() & 3];
+  char fastafile[] = "bench_bloom.fa";
+  FILE *f = fopen(fastafile, "w");
+  if (f == NULL) {
+    perror("Could not open bench_bloom.fa");
+    exit(EXIT_FAILURE);
+  }
+  fprintf(f, ">bench_bloom\n");
+  for (uint64_t g = 0; g < G; g += 80) {
+    fprintf(f, "%.*s\n", (int)min(80, G - g), genome + g);
+  }
+  fclose(f);
+
+  // half of the reads from the reference (2% substitutions), half random
+  for (i = 0; i < nreads; i++) {
+    char *r = reads + (uint64_t)i*L;
+    if (i & 1) {
+      uint64_t pos = ((uint64_t)rand() << 16 ^ rand()) % (G - L + 1);
+      memcpy(r, genome + pos, L);
+      for (j = 0; j < L; j++) {
+        if (rand() % 50 == 0) r[j] = BASES[rand() & 3];
+      }
+    } else {
+      for (j = 0; j < L; j++) r[j] = BASES[rand() & 3];
+    }
+    seqs[i].line2 = r;
+    seqs[i].L = L;
+    ptr_seqs[i] = seqs + i;
+  }
+
+  uint64_t bfsizeBits = filterMB*8*1024*1024;
+  if (blocked) bfsizeBits -= bfsizeBits % BF_BLOCK_BITS;
+  Bfilter *ptr_bf = create_Bfilter(fastafile, kmersize, bfsizeBits, 4, 0,
+                                   G - kmersize + 1, blocked, 1, 1);
+  unlink(fastafile);
+  Bfkmer *ptr_bfkmer = init_Bfkmer(kmersize, ptr_bf -> nhashValues);
+  Bfbatch *ptr_bb = init_Bfbatch(ptr_bf, NREADS_BLOCK, NREADS_BLOCK*L);
+  uint64_t probes[2] = {0, 0};
+  int nfound[3] = {0, 0, 0};
+  printf("filter: %" PRIu64 " MB, %s, kmersize %d; %d reads of %d bp, "
+         "score %.2f\n", filterMB, blocked ? "blocked" : "not blocked",
+         kmersize, nreads, L, par_TF.score);
+
+  double t0 = now();
+  for (i = 0; i < nreads; i++) {
+    found_single[i] = read_inBloom(ptr_bf, ptr_bfkmer, seqs + i,
+                                   par_TF.score);
+    nfound[0] += found_single[i];
+  }
+  report("contains, one read", now() - t0, nreads, nfound[0]);
+
+  t0 = now();
+  for (i = 0; i < nreads; i++) {
+    reads_inBloom(ptr_bf, ptr_bb, ptr_bfkmer, ptr_seqs + i, 1,
+                  found_batch + i, probes);
+    nfound[1] += found_batch[i];
+  }
+  report("reads_inBloom, one read", now() - t0, nreads, nfound[1]);
+  int nbad = 0;
+  for (i = 0; i < nreads; i++) nbad += (found_single[i] != found_batch[i]);
+
+  t0 = now();
+  for (i = 0; i < nreads; i += NREADS_BLOCK) {
+    reads_inBloom(ptr_bf, ptr_bb, ptr_bfkmer, ptr_seqs + i,
+                  min(NREADS_BLOCK, nreads - i), found_batch + i, probes);
+  }
+  double t = now() - t0;
+  for (i = 0; i < nreads; i++) {
+    nfound[2] += found_batch[i];
+    nbad += (found_single[i] != found_batch[i]);
+  }
+  char mode[64];
+  snprintf(mode, sizeof(mode), "reads_inBloom, block of %d", NREADS_BLOCK);
+  report(mode, t, nreads, nfound[2]);
+
+  free_Bfbatch(ptr_bb);
+  free_Bfkmer(ptr_bfkmer);
+  free(ptr_bfkmer);
+  free_Bfilter(ptr_bf);
+  free(ptr_bf);
+  free(genome);
+  free(reads);
+  free(seqs);
+  free(ptr_seqs);
+  free(found_single);
+  free(found_batch);
+  if (nbad) {
+    fprintf(stderr, "ERROR: %d reads differ between the lookup modes.\n",
+            nbad);
+    exit(EXIT_FAILURE);
+  }
+  return EXIT_SUCCESS;
+}
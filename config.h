@@ -0,0 +1,12 @@
+#define VERSION "1.0.7"
+#define INSTALL_DIR "/usr/local/bin"
+#define CMAKE_INSTALL_PREFIX "/usr/local"
+/* #undef HAVE_RPKG */
+/* #undef RSCRIPT_EXEC */
+#define READ_MAXLEN 400
+#define RMD_QUALITY_REPORT "/usr/local/share/FastqPuri/R/quality_report.Rmd"
+#define RMD_SUMMARY_REPORT "/usr/local/share/FastqPuri/R/summary_report.Rmd"
+#define RMD_SUMMARY_FILTER_REPORT "/usr/local/share/FastqPuri/R/summary_filter_report.Rmd"
+#define RMD_SUMMARY_FILTER_REPORTDS "/usr/local/share/FastqPuri/R/summary_filter_reportDS.Rmd"
+#define HAVE_ZLIB
+/* #undef HAVE_ZLIBNG */
@@ -22,6 +22,12 @@ $makeBloom -o EColi_0p01   -f ../fa_fq_files/EColi_genome.fa -p 0.01
 $makeBloom -o EColi_0p0075 -f ../fa_fq_files/EColi_genome.fa -p 0.0075
 $makeBloom -o EColi_0p005  -f ../fa_fq_files/EColi_genome.fa -p 0.005
 
+# Blocked filters (all bits of a kmer in one cache line), same FPRs
+$makeBloom -o EColi_0p02_blocked   -f ../fa_fq_files/EColi_genome.fa -p 0.02 -b y
+$makeBloom -o EColi_0p01_blocked   -f ../fa_fq_files/EColi_genome.fa -p 0.01 -b y
+$makeBloom -o EColi_0p0075_blocked -f ../fa_fq_files/EColi_genome.fa -p 0.0075 -b y
+$makeBloom -o EColi_0p005_blocked  -f ../fa_fq_files/EColi_genome.fa -p 0.005 -b y
+
 
 ##################################################################
 # STEP2: run trimFilter on the data                              #
@@ -31,7 +37,9 @@ pattern2="\- Discarded due to cont"
 EColi_fq="../fa_fq_files/EColi_reads.fq.gz"
 human_fq="../fa_fq_files/human_reads.fq.gz"
 
-for FPR in 0p02 0p01 0p0075 0p005; do  
+echo "filter,EColi_time,human_time" > time_bloom.csv
+for FPR in 0p02 0p01 0p0075 0p005 \
+           0p02_blocked 0p01_blocked 0p0075_blocked 0p005_blocked; do  
    for s in $(seq 0.05 0.01 0.2) ; do 
       $trimFilter -f "${EColi_fq}"  -l 150 --method BLOOM \
          --idx EColi_${FPR}.bf:"$s" 2>&1 | egrep "$pattern1|$pattern2" | \
@@ -61,6 +69,13 @@ for FPR in 0p02 0p01 0p0075 0p005; do
    echo "FN,TP,TN,FP" > ROC_${FPR}_bloom.csv                                       
    paste ooo iii | awk '{printf("%f,%f,%f,%f,%f\n",$1,$2,$3,$5,$6)}' \
     >> ROC_${FPR}_bloom.csv
+
+   # Lookup time: elapsed time of trimFilter at a fixed score
+   tEColi=$( { /usr/bin/time -f "%e" $trimFilter -f "${EColi_fq}" -l 150 \
+      --method BLOOM --idx EColi_${FPR}.bf:0.1 > /dev/null 2>&1 ; } 2>&1 )
+   thuman=$( { /usr/bin/time -f "%e" $trimFilter -f "${human_fq}" -l 150 \
+      --method BLOOM --idx EColi_${FPR}.bf:0.1 > /dev/null 2>&1 ; } 2>&1 )
+   echo "${FPR},${tEColi},${thuman}" >> time_bloom.csv
 done
 
 rm ooo iii 
@@ -40,10 +40,47 @@ typedef struct _ad_seq {
   char seq[READ_MAXLEN];  /**< adapter sequence */
   int Lpack;  /**< length of the packed sequence as is */
   int Lpack_sh;  /**< length of the shifted packed sequence*/
-  unsigned char pack[(READ_MAXLEN+1)/2];  /**< packed sequence */
-  unsigned char pack_sh[(READ_MAXLEN+1)/2];  /**< packed shifted sequence */
+  unsigned char pack[(READ_MAXLEN+1)/2 + PACK_PAD];  /**< packed sequence */
+  unsigned char pack_sh[(READ_MAXLEN+1)/2 + PACK_PAD];  /**< packed shifted
+                                                         sequence */
+  uint64_t peq[5];  /**< positions of every base (fw_1B code) in the first
+                       AD_MYERSLEN bases of the read strand adapter */
 } Ad_seq;
 
+/**
+ * @brief seed index of the adapters at least 16 bases long
+ *
+ * The first AD_SEEDLEN bases of every adapter are split in
+ * mismatches+1 chunks, and every chunk value (2 bits per base) points
+ * to the adapters containing it.
+ * */
+typedef struct _ad_index {
+  int maxbits;  /**< maximum number of different bits in a seed */
+  int nchunks;  /**< number of chunks of a seed */
+  uint64_t *ad;  /**< first 16 packed bases of every adapter */
+  uint64_t *adsh;  /**< first 15 packed, shifted bases of every adapter */
+  int *first;  /**< first adapter in ids of every chunk and value */
+  int *ids;  /**< adapter indices, grouped by chunk and value */
+  int nall;  /**< number of adapters at least 16 bases long */
+  int *all;  /**< adapters at least 16 bases long */
+  int nwild;  /**< number of adapters with other bases than ACGT */
+  int *wild;  /**< adapters with other bases than ACGT in their seed */
+} Ad_index;
+
+/**
+ * @brief bit-vector alignment of AD_MYERSLANES adapters to a read: column
+ *        j holds the vertical deltas of the edit distances of the adapter
+ *        prefixes to the read substrings ending before read base j
+ * */
+typedef struct _ad_edit {
+  uint64_t pv[READ_MAXLEN + 1][AD_MYERSLANES];  /**< positive deltas */
+  uint64_t mv[READ_MAXLEN + 1][AD_MYERSLANES];  /**< negative deltas */
+  int64_t dist[READ_MAXLEN + 1][AD_MYERSLANES];  /**< edit distance of the
+                                                     aligned adapter part */
+  bool hit[AD_MYERSLANES];  /**< true if a whole adapter part aligns with
+                                 few edits inside the read */
+} Ad_edit;
+
 void init_alLUTs();
 
 int process_seq(unsigned char *packed, unsigned char *read, int L, bool shift,
@@ -51,6 +88,62 @@ int process_seq(unsigned char *packed, unsigned char *read, int L, bool shift,
 
 Ad_seq *pack_adapter(Fa_data *ptr_fa);
 
-double obtain_score(Fq_read *seq, int pos_seq, Ad_seq *ptr_adap, int pos_ad, int zeroQ);
+Ad_index *index_adapter(Ad_seq *adap_list, int Nad, int mismatches);
+
+void free_Ad_index(Ad_index *ptr_idx);
+
+int seed_adapter(Ad_index *ptr_idx, Fq_read *seq, int *cand_ad,
+                 int *cand_pos);
+
+uint32_t match_bases(const char *s1, const char *s2, int n);
+
+double obtain_score(Fq_read *seq, int pos_seq, Ad_seq *ptr_adap, int pos_ad,
+                    int zeroQ, double minscore);
+
+uint64_t seed_windows(const unsigned char *pack, int n, uint64_t ad,
+                      uint64_t adsh, int maxbits, uint64_t *mask_sh);
+
+bool set_seed_kernel(int kernel);
+
+void edit_columns(Fq_read *seq, Ad_seq *adap_list, int n, int maxdist,
+                  Ad_edit *ptr_ed);
+
+int edit_adapter(Fq_read *seq, Ad_seq *ptr_adap, Ad_edit *ptr_ed, int l,
+                 int maxdist, double minscore, int zeroQ, double *score);
+
+/* static functions
+ * static uint64_t low_bits(int n);
+ * static uint32_t bases_scalar(const char *s1, const char *s2, int n);
+ * static __m256i codes_avx2(__m256i v, char other);
+ * static uint32_t match32_avx2(__m256i v1, __m256i v2);
+ * static uint32_t bases_avx2(const char *s1, const char *s2, int n);
+ * static uint64_t windows_scalar(const unsigned char *pack, int n,
+ *                                uint64_t ad, uint64_t adsh, int maxbits,
+ *                                uint64_t *mask_sh);
+ * static uint64_t windows_avx2(const unsigned char *pack, int n, uint64_t ad,
+ *                              uint64_t adsh, int maxbits, uint64_t *mask_sh);
+ * static uint64_t windows_avx512(const unsigned char *pack, int n,
+ *                                uint64_t ad, uint64_t adsh, int maxbits,
+ *                                uint64_t *mask_sh);
+ * static bool seed_isACGT(uint64_t seed);
+ * static uint64_t seed_code(uint64_t seed);
+ * static bool is_seed(Ad_index *ptr_idx, int i, int pos, uint64_t read64);
+ * static int add_seed(int i, int pos, int *cand_ad, int *cand_pos, int ncand);
+ * static void columns_scalar(const uint8_t *read, int L,
+ *                            uint64_t peq[5][AD_MYERSLANES],
+ *                            const uint64_t *top, const int *maxd,
+ *                            Ad_edit *ptr_ed);
+ * static void columns_avx2(const uint8_t *read, int L,
+ *                          uint64_t peq[5][AD_MYERSLANES],
+ *                          const uint64_t *top, const int *maxd,
+ *                          Ad_edit *ptr_ed);
+ * static void columns_avx512(const uint8_t *read, int L,
+ *                            uint64_t peq[5][AD_MYERSLANES],
+ *                            const uint64_t *top, const int *maxd,
+ *                            Ad_edit *ptr_ed);
+ * static int edit_cell(Ad_edit *ptr_ed, int l, int i, int j);
+ * static double edit_score(Fq_read *seq, Ad_seq *ptr_adap, Ad_edit *ptr_ed,
+ *                          int l, int i, int j, int zeroQ, int *pos);
+ * */
 
 #endif  // endif INIT_ALIGNER_H_
@@ -0,0 +1,120 @@
+/****************************************************************************
+ * Copyright (C) 2017 by Paula Perez Rubio                                  *
+ *                                                                          *
+ * This file is part of FastqPuri.                                      *
+ *                                                                          *
+ *   FastqPuri is free software: you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as                *
+ *   published by the Free Software Foundation, either version 3 of the     *
+ *   License, or (at your option) any later version.                        *
+ *                                                                          *
+ *   FastqPuri is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *   GNU General Public License for more details.                           *
+ *                                                                          *
+ *   You should have received a copy of the GNU General Public License      *
+ *   along with FastqPuri.                                              *
+ *   If not, see <http://www.gnu.org/licenses/>.                            *
+ ****************************************************************************/
+
+
+
+/**
+ * @file bgzf.h
+ * @brief BGZF (blocked gzip) writer, blocks compressed in parallel by a
+ *        pool of threads shared by all the outputs.
+ * @author Paula Perez <paulaperezrubio@gmail.com>
+ * @date 17.10.2026
+ *
+ * The output is a series of gzip members of at most 64 KiB each, with
+ * the BC extra field giving the size of the member, as written by
+ * bgzip/samtools. Any gzip reader decompresses it, and it can be indexed
+ * by downstream tools (bgzip -r, htslib).
+ *
+ */
+
+#ifndef BGZF_H_
+#define BGZF_H_
+
+#include <stdio.h>
+#include "zlib_gen.h"
+#include "pipeline.h"
+
+#ifdef HAVE_ZLIB
+
+struct _bgzf;
+
+/**
+ * @brief one BGZF block: uncompressed input and compressed output
+ * */
+typedef struct _bgzf_block {
+  char *in;  /**< uncompressed data (BGZF_BLOCK chars) */
+  int len;  /**< number of chars stored in in */
+  unsigned char *out;  /**< compressed block (BGZF_MAX_BLOCK chars) */
+  int size;  /**< size of the compressed block */
+  struct _bgzf *owner;  /**< writer the block belongs to */
+} Bgzf_block;
+
+/**
+ * @brief threads compressing the blocks of every BGZF output
+ *
+ * The full blocks of all the writers of a pool are handed over to one
+ * Pipeline, whose workers compress them and whose writer thread writes
+ * every block to the file of its writer, in the order they were handed
+ * over. The pipeline is started when the first block is full and
+ * stopped when the last writer is closed, so that small outputs are
+ * compressed in the calling thread.
+ * */
+typedef struct _bgzf_pool {
+  int nthreads;  /**< number of compressing threads */
+  int nslots;  /**< number of blocks in flight */
+  Bgzf_block *blocks;  /**< blocks in flight */
+  void **slot;  /**< pointers to blocks, ring of the pipeline */
+  z_stream *zs;  /**< one deflate stream per thread */
+  void **worker_arg;  /**< pointers to zs */
+  Pipeline *ptr_pl;  /**< pipeline, NULL while not running */
+  int nopen;  /**< number of writers not yet closed */
+  pthread_mutex_t push_lock;  /**< one writer hands over a block at a time */
+  pthread_mutex_t lock;  /**< protects nopen and the written counters */
+  pthread_cond_t written;  /**< signals that a block was written */
+} Bgzf_pool;
+
+/**
+ * @brief BGZF writer
+ *
+ * Data is collected in pend; every full block is handed over to the
+ * pool, which compresses and writes it to f.
+ * */
+typedef struct _bgzf {
+  FILE *f;  /**< output file */
+  Bgzf_pool *pool;  /**< pool compressing the blocks */
+  char *pend;  /**< block being filled */
+  int npend;  /**< number of chars stored in pend */
+  uint64_t npushed;  /**< number of blocks handed over to the pool */
+  uint64_t nwritten;  /**< number of blocks written by the pool */
+} Bgzf;
+
+Bgzf_pool *init_Bgzf_pool(int nthreads);
+
+void free_Bgzf_pool(Bgzf_pool *pool);
+
+Bgzf *init_Bgzf(FILE *f, Bgzf_pool *pool);
+
+void bgzf_write(Bgzf *ptr_bz, const char *str, int len);
+
+int free_Bgzf(Bgzf *ptr_bz);
+
+/* static functions
+ * init_zstream(z_stream *zs);
+ * compress_block(Bgzf_block *b, z_stream *zs);
+ * work_bgzf(void *ptr_block, void *ptr_zs);
+ * write_block(Bgzf_block *b, FILE *f);
+ * write_bgzf(void *ptr_block, void *ptr_pool);
+ * stop_pool(Bgzf_pool *pool);
+ * push_block(Bgzf *ptr_bz);
+ * */
+
+#endif  // endif HAVE_ZLIB
+
+#endif  // endif BGZF_H_
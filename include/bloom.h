@@ -46,6 +46,12 @@ typedef struct _bfilter {
   uint64_t bfsizeBits;  /**< bloom filter size (bits) (m)*/
   uint64_t bfsizeBytes;  /**< bloom filter size (bytes)*/
   uint64_t nelem;  /**< number of elements encoded in the bloom filter (n) */
+  int blocked;  /**< 1 if all bits of a kmer lie in one BF_BLOCK_BITS block*/
+  int version;  /**< BF_VERSION_CITY, BF_VERSION_ROLL or BF_VERSION_MINI */
+  int window;  /**< minimizer window (kmers), 1 if all kmers are stored */
+  uint64_t nblocks;  /**< number of blocks (only for blocked filters) */
+  int nhashValues;  /**< number of hash values computed per kmer */
+  size_t mapsize;  /**< size of the mapping if filter is mmapped, 0 otherwise*/
   unsigned char *filter; /**< filter sequence*/
 } Bfilter;
 
@@ -64,12 +70,57 @@ typedef struct _bfkmer {
   int hasOverhead;  /**< kmer has overhead when kmersize % 4!=0 */
   unsigned char *compact;  /**< encoded compactified sequence*/
   uint64_t *hashValues;  /**< Values of the hash functions*/
+  uint64_t fw;  /**< rolling forward kmer (2 bits per nucleotide) */
+  uint64_t rc;  /**< rolling reverse complement kmer */
+  uint64_t kmask;  /**< mask with the lowest 2*kmersize bits set */
+  int nvalid;  /**< number of consecutive valid bases rolled in */
+  int window;  /**< minimizer window (kmers), see roll_minimizer */
+  int nrun;  /**< number of consecutive valid kmers rolled in */
+  int imin;  /**< kmer of the run that is the current minimizer */
+  int iout;  /**< kmer of the run that was returned last as minimizer */
+  uint64_t *order;  /**< order of the last window kmers (ring buffer) */
+  uint64_t *canon;  /**< canonical last window kmers (ring buffer) */
 } Bfkmer;
 
+/**
+ * @brief kmers of several sequences (queries), looked up in a filter
+ *        together (see contains_batch)
+ * */
+typedef struct _bfbatch {
+  int nhashValues;  /**< hash values per kmer (as in Bfilter) */
+  int maxqueries;  /**< capacity of need, hits, left and probes */
+  int maxkmers;  /**< capacity of hashValues (in kmers) and query */
+  int nqueries;  /**< number of queries in the batch */
+  int nkmers;  /**< number of kmers in the batch */
+  uint64_t *hashValues;  /**< hash values of the kmers, nhashValues each */
+  int *query;  /**< query every kmer belongs to */
+  int *need;  /**< kmers that have to be found, per query */
+  int *hits;  /**< kmers found in the filter, per query */
+  int *left;  /**< kmers not looked up yet, per query */
+  int *probes;  /**< kmers looked up, per query */
+} Bfbatch;
+
+/**
+ * @brief chunk of a fasta file, inserted in a filter by a worker thread
+ * */
+typedef struct _bfchunk {
+  char *seq;  /**< chunk of sequence (see Fa_stream) */
+  uint64_t N;  /**< length of seq */
+} Bfchunk;
+
+/**
+ * @brief worker thread inserting chunks in a filter
+ * */
+typedef struct _bfworker {
+  Bfilter *ptr_bf;  /**< filter where the kmers are inserted */
+  Bfkmer *ptr_bfkmer;  /**< Bfkmer owned by the thread */
+} Bfworker;
+
 void init_LUTs();
 
 Bfilter *init_Bfilter(int kmersize, uint64_t bfsizeBits, int hashNum,
-                      double falsePosRate, uint64_t nelem);
+                      double falsePosRate, uint64_t nelem, int blocked,
+                      int version);
 
 Bfkmer *init_Bfkmer(int kmersize, int hashNum);
 
@@ -82,16 +133,57 @@ int compact_kmer(const unsigned char *sequence, uint64_t position,
 
 void multiHash(Bfkmer* ptr_bfkmer);
 
+int roll_kmer(Bfkmer *ptr_bfkmer, unsigned char base);
+
+void rollHash(Bfkmer* ptr_bfkmer);
+
+void set_window(Bfkmer *ptr_bfkmer, int window);
+
+int roll_minimizer(Bfkmer *ptr_bfkmer, unsigned char base);
+
+int flush_minimizer(Bfkmer *ptr_bfkmer);
+
 bool insert_and_fetch(Bfilter *pr_bf, Bfkmer* ptr_bfkmer);
 
 bool contains(Bfilter *ptr_bf, Bfkmer* ptr_bfkmer);
 
-Bfilter *create_Bfilter(Fa_data *ptr_fasta, int kmersize, uint64_t bfsizeBits,
-                        int hashNum, double falsePosRate, uint64_t nelem);
+Bfbatch *init_Bfbatch(Bfilter *ptr_bf, int maxqueries, int maxkmers);
+
+void free_Bfbatch(Bfbatch *ptr_bb);
+
+void reset_Bfbatch(Bfbatch *ptr_bb);
+
+int add_query(Bfilter *ptr_bf, Bfbatch *ptr_bb, Bfkmer *ptr_bfkmer,
+              const char *seq, int L, int need);
+
+void contains_batch(Bfilter *ptr_bf, Bfbatch *ptr_bb);
+
+Bfilter *create_Bfilter(char *fastafile, int kmersize, uint64_t bfsizeBits,
+                        int hashNum, double falsePosRate, uint64_t nelem,
+                        int blocked, int window, int nthreads);
 
 void save_Bfilter(Bfilter *ptr_bf, char *filterfile, char *paramfile);
 
 Bfilter *read_Bfilter(char *filterfile, char *paramfile);
 
+/* static functions
+ * static void insert_seq(Bfilter *ptr_bf, Bfkmer *ptr_bfkmer,
+ *                        const unsigned char *seq, uint64_t N);
+ * static void insert_worker(void *batch, void *arg);
+ * static Bfilter *new_Bfilter(int kmersize, uint64_t bfsizeBits, int hashNum,
+ *                      double falsePosRate, uint64_t nelem, int blocked,
+ *                      int version);
+ * static void alloc_filter(Bfilter *ptr_bf);
+ * static void print_Bfilter(Bfilter *ptr_bf);
+ * static uint64_t mix64(uint64_t x);
+ * static void hash_canon(Bfkmer *ptr_bfkmer, uint64_t canon);
+ * static void reset_run(Bfkmer *ptr_bfkmer);
+ * static bool insert_blocked(Bfilter *ptr_bf, Bfkmer* ptr_bfkmer);
+ * static bool contains_blocked(Bfilter *ptr_bf, const uint64_t *hashValues);
+ * static bool contains_values(Bfilter *ptr_bf, const uint64_t *hashValues);
+ * static void prefetch_kmer(Bfilter *ptr_bf, const uint64_t *hashValues);
+ * static bool is_settled(Bfbatch *ptr_bb, int q);
+ * */
+
 
 #endif  // endif BLOOM_MAKER_H_
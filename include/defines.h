@@ -73,15 +73,37 @@
 
 // Fasta files
 #define FA_ENTRY_BUF 20  /**< buffer for fasta entries*/
+#define FA_CHUNK 1048576  /**< new bases per chunk in a fasta stream */
 
 // Adapters
 #define LOG_4 0.60206    /**< log_10(4) for the adapters alignment score */
 #define MIN_NMATCHES 12  /**< minimum number of matches demanded*/
+#define AD_SCALE 100000  /**< fixed point scale of the adapters alignment score */
+#define AD_LOG4 60206  /**< LOG_4*AD_SCALE */
+#define AD_SEEDLEN 15  /**< bases of the adapters seed index */
+#define AD_CHUNKLEN 5  /**< bases per chunk of the seed index */
+#define AD_NVALUES 1024  /**< values of a chunk of the seed index, 4^5 */
+#define AD_MINIDX 16  /**< minimum number of adapters to build a seed index */
+#define AD_MAXCAND 256  /**< maximum number of seeds found per read */
+#define PACK_PAD 32  /**< bytes past a packed sequence read by seed_windows */
+#define AD_MINSIMD 24  /**< minimum number of windows tested with SIMD */
+#define AD_KERNEL_AUTO 0  /**< seed kernel: the widest supported by the cpu */
+#define AD_KERNEL_SCALAR 1  /**< seed kernel: windows tested one by one */
+#define AD_KERNEL_AVX2 2  /**< seed kernel: 32 windows at a time */
+#define AD_KERNEL_AVX512 3  /**< seed kernel: 64 windows at a time */
+#define AD_MYERSLEN 64  /**< adapter bases of the bit-vector alignment */
+#define AD_EDITLEN 16  /**< adapter bases per allowed edits (MYERS) */
+#define AD_MYERSLANES 8  /**< adapters aligned together (MYERS) */
+#define HAMMING 0  /**< adapters matched with mismatches only (popcount) */
+#define MYERS 1  /**< adapters matched with indels (Myers bit-vectors) */
 
 // Tree
 #define T_ACGT 4  /**< Number of children per node in tree*/
 #define NPOOL_1D 1048576  /**< Number of Node structs allocated in inner dim */
 #define NPOOL_2D 16  /**< Number of *Node allocated in outer dim */
+#define TREE_PREFIX 3  /**< bases partitioning the Lmers among threads */
+#define TREE_NPART 64  /**< number of partitions: T_ACGT^TREE_PREFIX */
+#define TREE_NOROOT UINT32_MAX  /**< partition without Lmers */
 #define MAX_FASZ_TREE 1e7 /**< Maximum fasta size for constructing a tree.
                                DECIDE A SENSIBLE SIZE */
 // BloomFilter
@@ -90,6 +112,30 @@
 #define KMER_LEN 25    /**< default kmer length */
 #define FALSE_POS_RATE 0.05  /**< default false positive rate */
 #define ZERO_POS_RATE 1e-14  /**< 0 threshold for a double */
+#define BF_BLOCK_BITS 512  /**< bits per block in a blocked bloom filter */
+#define BF_BLOCK_BYTES 64  /**< bytes per block (one cache line) */
+#define BF_BLOCK_NHASH 2  /**< hash values per kmer in a blocked filter */
+#define BF_VERSION_CITY 1  /**< filter version: CityHash64 of packed kmers */
+#define BF_VERSION_ROLL 2  /**< filter version: rolling 2-bit kmers */
+#define BF_VERSION_MINI 3  /**< filter version: rolling 2-bit kmers, only
+                                the (w,k)-minimizers are stored */
+#define BF_MAX_WINDOW 256  /**< largest minimizer window (in kmers) */
+#define BF_ROLL_MAXK 32  /**< largest kmer that fits in a rolling uint64_t */
+#define BF_PREFETCH 16  /**< kmers prefetched ahead in contains_batch */
+// Index files (Bloom filters, trees) mapped in memory
+#define MMAP_POPULATE 1  /**< 1: prefault mmapped indexes (MAP_POPULATE) */
+#define TREE_MAGIC "FQPTREE2"  /**< magic of tree files (with checksum) */
+#define TREE_MAGIC_V1 "FQPTREE1"  /**< magic of version 1 mappable trees */
+#define TREE_MAGIC_LEN 8  /**< length of TREE_MAGIC (bytes) */
+#define TREE_HEADER 32  /**< header of tree files (bytes) */
+#define TREE_HEADER_V1 16  /**< header of version 1 mappable trees (bytes) */
+#define TREE_EXT ".fqt"  /**< extension of mappable tree files */
+// Kmer sets
+#define KSET_MAGIC "FQPKSET1"  /**< magic of kmer set files */
+#define KSET_MAGIC_LEN 8  /**< length of KSET_MAGIC (bytes) */
+#define KSET_HEADER 32  /**< header of kmer set files (bytes) */
+#define KSET_EMPTY UINT64_MAX  /**< empty slot (never a canonical kmer) */
+#define KSET_MAXLOAD 0.75  /**< maximal load factor of a kmer set */
 
 // Trimming
 #define NO 0        /**< No trimming */
@@ -102,14 +148,22 @@
 #define ENDSFRAC 4  /**< trims at the ends and discards a read if the
                       remaining part has more than > percent lowQ bases */
 #define GLOBAL 5    /**< Trims a fixed # bases from e left and right*/
+#define WINDOW 6    /**< Trims the ends up to the first windows with mean
+                      quality >= minQ */
+#define MOTT 7      /**< Keeps the segment with the largest sum of
+                      quality - minQ (Mott, BWA -q) */
 
 #define TREE 1   /**< Use a tree to look for contaminations*/
 #define BLOOM 2  /**< Use a bloom filter to look for contaminations*/
+#define KMERSET 3  /**< Use a kmer set to look for contaminations*/
 
 #define ERROR 1000  /**< Encodes an error when reading in trimN, trimQ, method
                      options in trimFilter */
 #define DEFAULT_MINL 25  /**< Default minimum length under which we discard
                           the reads */
+#define DEFAULT_QWINDOW 4  /**< Default window length of trimQ WINDOW */
+#define TRIM_STRING 32  /**< maximal length of trimming info string.*/
+#define FQ_NIOV 9  /**< maximal number of segments of a written fq entry */
 
 // Classification of filters
 #define ADAP 0  /**<  Adapter filter */
@@ -131,4 +185,17 @@
 // Double stranded: number of outputfiles
 #define NFILES_DS 10  /**< number of outputfiles in double stranded case */
 
+// Multithreading
+#define NREADS_BATCH 8192  /**< Number of reads handed out to a worker */
+#define NREADS_BLOCK 32  /**< Number of reads filtered together by a worker
+                              (their Bloom filter queries are batched) */
+#define NBATCH_THREAD 4  /**< Number of batches in flight per worker thread */
+#define MAX_THREADS 256  /**< Maximum number of worker threads */
+
+// BGZF output
+#define BGZF_BLOCK 0xff00  /**< uncompressed bytes per BGZF block */
+#define BGZF_MAX_BLOCK 0x10000  /**< maximum size of a compressed block */
+#define BGZF_HEADER 18  /**< gzip header with the BC extra field */
+#define BGZF_FOOTER 8  /**< CRC32 and uncompressed size */
+
 #endif  // endif DEFINES_H_
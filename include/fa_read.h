@@ -30,6 +30,7 @@
 #ifndef FA_READ_H_
 #define FA_READ_H_
 
+#include <stdio.h>
 #include <stdint.h>
 
 /**
@@ -51,6 +52,35 @@ typedef struct _fa_data {
   Fa_entry *entry;  /**< Array with fasta entries (see Fa_entry)*/
 } Fa_data;
 
+/**
+ * @brief streams a fasta file in chunks of sequence
+ *
+ * Every chunk belongs to a single entry and holds at most FA_CHUNK new
+ * bases. Chunks following the first one of an entry start with the
+ * last `overlap` bases of the previous chunk, so that every k-mer with
+ * k = overlap + 1 is contained in exactly one chunk. Header (`>`) and
+ * comment (`;`) lines are skipped and lines may have any length.
+ * */
+typedef struct _fa_stream {
+  FILE *f;            /**< input file */
+  char *buffer;       /**< raw input buffer (B_LEN) */
+  int len;            /**< number of chars in buffer */
+  int pos;            /**< current position in buffer */
+  int bol;            /**< 1 if pos is at the beginning of a line */
+  int header;         /**< 1 if pos is inside a header line */
+  int entry_end;      /**< 1 if the last chunk closed its entry */
+  int overlap;        /**< number of bases carried between chunks */
+  int nentries;       /**< number of entries seen so far */
+  char *chunk;        /**< current chunk (FA_CHUNK + overlap chars) */
+  int N;              /**< number of bases in chunk */
+  int ncarry;         /**< bases at the start of chunk carried over */
+  uint64_t start;     /**< position of chunk[0] in its entry */
+} Fa_stream;
+
+Fa_stream *open_fa_stream(char *filename, int overlap);
+int next_fa_chunk(Fa_stream *ptr_fs);
+void close_fa_stream(Fa_stream *ptr_fs);
+uint64_t nkmers_fa(char *filename, int kmersize, uint64_t *size);
 int read_fasta(char *filename, Fa_data *ptr_fa);
 uint64_t size_fasta(Fa_data *ptr_fa);
 uint64_t nkmers(Fa_data *ptr_fa, int kmersize);
@@ -62,6 +92,7 @@ void free_fasta(Fa_data *ptr_fa);
 // static voiid realloc_fa(Fa_data *ptr_fa)
 // static voiid init_entries(Fa_data *ptr_fa)
 // static uint64_t swee_fa(char *filename, Fa_data *ptr_fa)
+// static int fill_fa_stream(Fa_stream *ptr_fs)
 
 
 #endif  // endif FA_READ_H_
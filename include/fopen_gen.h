@@ -54,16 +54,20 @@ FILE* fdopen(int, const char*);
 
 int setCloexec(int fd);
 FILE* fopen_gen(const char *path, const  char * mode);
+void set_compress_threads(int nthreads);
 
 /** 
  * Static functions
  * fopen_gen in READ mode:
  *  static const char* zcatExec(const char* path);
- *  static int uncompress(const char* path);
+ *  static int pipe_uncompress(const char* path);
  *  static FILE* funcompress(const char* path);
+ *  static bool is_gzip(const char* path);  (HAVE_ZLIB)
+ *  static FILE* fgzopen(const char* path);  (HAVE_ZLIB)
  * fopen_gen in WRITE mode:
+ *  static FILE* fbgzfopen(FILE *f, const char* path);  (HAVE_ZLIB)
  *  static const char* catExec(const char* path);
- *  static int compress(const char* path);
+ *  static int pipe_compress(const char* path);
  *  static FILE* compress(const char* path);
 */
 
@@ -29,23 +29,40 @@
 #ifndef FQ_READ_H_
 #define FQ_READ_H_
 
+#include <sys/uio.h>
 #include "config.h"
+#include "defines.h"
 
 /**
  * @brief stores a fastq entry
+ *
+ * The four lines are not copied: they point into the buffer the entry was
+ * read from, where the '\n' ending every line is replaced by '\0'. Trimming
+ * moves line2 and line4 and shortens L, so that only their first L chars
+ * belong to the read, and keeps the trimming coordinates used to annotate
+ * line3 when the entry is written.
  * */
 typedef struct _fq_read {
-  char line1[READ_MAXLEN];  /**< Line 1 in fastq entry*/
-  char line2[READ_MAXLEN];  /**< Line 2 in fastq entry*/
-  char line3[READ_MAXLEN];  /**< Line 3 in fastq entry*/
-  char line4[READ_MAXLEN];  /**< Line 4 in fastq entry*/
+  char *line1;  /**< Line 1 in fastq entry*/
+  char *line2;  /**< Line 2 in fastq entry*/
+  char *line3;  /**< Line 3 in fastq entry*/
+  char *line4;  /**< Line 4 in fastq entry*/
+  int L1;     /**< length of line 1*/
+  int L3;     /**< length of line 3*/
   int L;      /**< read length*/
   int start;  /**< nucleotide position start. Can only be different from zero
                    if the read has been filtered with this tool.*/
   int Lhalf;  /**< half of read length*/
+  int ntrim;  /**< number of times the read has been trimmed*/
+  int trim_pos;  /**< position of "TRIM" in line 3 of the input, -1 if none*/
+  char trim_type;  /**< type of the first trimming (N, Q, A)*/
+  int t_start;  /**< first position kept, relative to the original read*/
+  int t_end;  /**< last position kept, relative to the original read*/
+  char annot[TRIM_STRING];  /**< trimming info appended to line 3*/
   char extended[READ_MAXLEN];  /**< extended sequence, adapter added to 5' end*/
-  unsigned char pack[(READ_MAXLEN+1)/2];  /**< pack sequence*/
-  unsigned char packsh[(READ_MAXLEN+1)/2];  /**< pack sequence with shift*/
+  unsigned char pack[(READ_MAXLEN+1)/2 + PACK_PAD];  /**< pack sequence*/
+  unsigned char packsh[(READ_MAXLEN+1)/2 + PACK_PAD];  /**< pack sequence
+                                                        with shift*/
   int L_ad;      /**< length of adapter sequence */
   int L_ext;     /**< length of extended sequence */
   int L_pack;    /**< length of packed sequence */
@@ -55,6 +72,11 @@ typedef struct _fq_read {
 int get_fqread(Fq_read* seq, char* buffer, int pos1, int pos2,
                int nline, int read_len, int filter);
 void check_zeroQ(Fq_read *seq, int zeroQ, int nreads);
-int string_seq(Fq_read *seq, char *char_seq);
+void trim_read(Fq_read *seq, int t_start, int t_end, int L, char type);
+int iovec_seq(Fq_read *seq, struct iovec *iov);
+
+/* static functions
+ * static int scan_trim(const char *line3, int L3, int *start);
+ * */
 
 #endif  // endif FQ_READ_H_
@@ -0,0 +1,46 @@
+/****************************************************************************
+ * Copyright (C) 2017 by Paula Perez Rubio                                  *
+ *                                                                          *
+ * This file is part of FastqPuri.                                      *
+ *                                                                          *
+ *   FastqPuri is free software: you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as                *
+ *   published by the Free Software Foundation, either version 3 of the     *
+ *   License, or (at your option) any later version.                        *
+ *                                                                          *
+ *   FastqPuri is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *   GNU General Public License for more details.                           *
+ *                                                                          *
+ *   You should have received a copy of the GNU General Public License      *
+ *   along with FastqPuri.                                              *
+ *   If not, see <http://www.gnu.org/licenses/>.                            *
+ ****************************************************************************/
+
+
+
+/**
+ * @file fq_split.h
+ * @brief finds the line ends of the fq entries in a chunk of a file.
+ * @author Paula Perez <paulaperezrubio@gmail.com>
+ * @date 17.10.2026
+ *
+ * The '\n' are looked for 32 (AVX2) or 16 (SSE2) chars at a time, the
+ * kernel being chosen at runtime from the instructions supported by the
+ * CPU. A scalar loop is used on other architectures.
+ *
+ */
+
+#ifndef FQ_SPLIT_H_
+#define FQ_SPLIT_H_
+
+int split_fq(const char *buf, int len, int *ends, int *nl);
+
+/* static functions
+ * newlines_scalar(const char *buf, int i, int len, int *ends, int n);
+ * newlines_sse2(const char *buf, int len, int *ends);
+ * newlines_avx2(const char *buf, int len, int *ends);
+ * */
+
+#endif  // endif FQ_SPLIT_H_
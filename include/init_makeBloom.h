@@ -46,6 +46,9 @@ typedef struct _iparam_makeBloom {
   double falsePosRate; /**< false positive rate */
   uint64_t bfsizeBits;  /**< bloom filter size (bits)*/
   uint64_t nelem;  /**< number of elements that the bloomfilter will contain */
+  int blocked;  /**< 1 if a blocked (cache line) filter is constructed */
+  int nthreads;  /**< number of threads constructing the filter */
+  int window;  /**< minimizer window (kmers), 1 if all kmers are inserted */
 } Iparam_makeBloom;
 
 void printHelpDialog_makeBloom();
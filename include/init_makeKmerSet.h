@@ -0,0 +1,47 @@
+/****************************************************************************
+ * Copyright (C) 2017 by Paula Perez Rubio                                  *
+ *                                                                          *
+ * This file is part of FastqPuri.                                      *
+ *                                                                          *
+ *   FastqPuri is free software: you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as                *
+ *   published by the Free Software Foundation, either version 3 of the     *
+ *   License, or (at your option) any later version.                        *
+ *                                                                          *
+ *   FastqPuri is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *   GNU General Public License for more details.                           *
+ *                                                                          *
+ *   You should have received a copy of the GNU General Public License      *
+ *   along with FastqPuri.                                              *
+ *   If not, see <http://www.gnu.org/licenses/>.                            *
+ ****************************************************************************/
+
+/**
+ * @file init_makeKmerSet.h
+ * @author Paula Perez <paulaperezrubio@gmail.com>
+ * @date 17.10.2026
+ * @brief Help dialog for makeKmerSet and initialization of
+ * the command line arguments.
+ */
+
+#ifndef INIT_MAKEKMERSET_H_
+#define INIT_MAKEKMERSET_H_
+
+#include "defines.h"
+
+/**
+ * @brief contains makeKmerSet input parameters
+ */
+typedef struct _iparam_makeKmerSet {
+  char *inputfasta; /**< fasta input file */
+  char outputfile[MAX_FILENAME]; /**< outputfile path */
+  int kmersize; /**< kmer size */
+} Iparam_makeKmerSet;
+
+void printHelpDialog_makeKmerSet();
+
+void getarg_makeKmerSet(int argc, char **argv);
+
+#endif  // endif INIT_MAKEKMERSET_H_
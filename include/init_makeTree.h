@@ -38,6 +38,7 @@ typedef struct _iparam_makeTree {
   char *inputfasta; /**< fasta input file */
   char outputfile[MAX_FILENAME]; /**< outputfile path */
   int L; /**< tree depth */
+  int nthreads; /**< number of threads constructing the tree */
 } Iparam_makeTree;
 
 void printHelpDialog_makeTree();
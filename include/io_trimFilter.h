@@ -31,6 +31,7 @@
 
 #include <stdio.h>
 #include "defines.h"
+#include "pipeline.h"
 
 /**
  * @brief collects stats info from the filtering procedure
@@ -41,9 +42,24 @@ typedef struct _stats_TF {
   int discarded[NFILTERS];  /**< \# discarded reads: ADAP, CONT, LOWQ, NNNN */
   int good;  /**< \# good reads */
   int nreads;  /**< total number of reads in the fq file */
+  uint64_t probes[2];  /**< contamination lookups: done, skipped by the
+                            early exits (not written to the summary) */
 } Stats_TF;
 
-void buffer_output(FILE *fout, const char *a, const int len, const int fd_i);
+/**
+ * @brief batch of fq entries handed out to a worker thread
+ * */
+typedef struct _batch_TF {
+  Obuffer in;  /**< complete fq entries, as read from the input file */
+  Ebuffer in_ends;  /**< line ends of the entries in in */
+  char *entries;  /**< entries to be filtered: in.buf, or the buffer of the
+                       reader when filtering in the calling thread */
+  int *ends;  /**< line ends of the entries, 4 per entry */
+  int nentries;  /**< number of entries */
+  int nlines;  /**< input line number of the first line in the batch */
+  Stats_TF stats;  /**< stats of the reads in the batch */
+  Obuffer out[NFILTERS+1];  /**< output: ADAP, CONT, LOWQ, NNNN, GOOD */
+} Batch_TF;
 
 void write_summary_TF(Stats_TF tf_stats, char *filename);
 
@@ -31,6 +31,7 @@
 
 #include <stdio.h>
 #include "defines.h"
+#include "pipeline.h"
 
 /**
  * @brief collects stats info from the filtering procedure
@@ -42,9 +43,29 @@ typedef struct _stats_TFDS {
   int discarded[NFILTERS];  /**< \# discarded reads: ADAP, CONT, LOWQ, NNNN */
   int good;  /**< \# good reads */
   int nreads;  /**< total number of reads in the fq file */
+  uint64_t probes[2];  /**< contamination lookups: done, skipped by the
+                            early exits (not written to the summary) */
 } Stats_TFDS;
 
-void buffer_outputDS(FILE *fout, const char *a, const int len, const int fd_i);
+/**
+ * @brief batch of fq entry pairs handed out to a worker thread
+ * */
+typedef struct _batch_TFDS {
+  Obuffer in1;  /**< complete fq entries from the read 1 file */
+  Obuffer in2;  /**< the same number of entries from the read 2 file */
+  Ebuffer in1_ends;  /**< line ends of the entries in in1 */
+  Ebuffer in2_ends;  /**< line ends of the entries in in2 */
+  char *entries1;  /**< read 1 entries to be filtered: in1.buf, or the
+                        buffer of the reader when filtering in the calling
+                        thread */
+  char *entries2;  /**< read 2 entries to be filtered (as entries1) */
+  int *ends1;  /**< line ends of entries1, 4 per entry */
+  int *ends2;  /**< line ends of entries2, 4 per entry */
+  int npairs;  /**< number of read pairs */
+  int nlines;  /**< input line number of the first line in the batch */
+  Stats_TFDS stats;  /**< stats of the read pairs in the batch */
+  Obuffer out[NFILES_DS];  /**< output: ADAP, ..., GOOD, ADAP2, ..., GOOD2 */
+} Batch_TFDS;
 
 void write_summary_TFDS(Stats_TFDS tfds_stats, char *filename);
 
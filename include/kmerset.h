@@ -0,0 +1,77 @@
+/****************************************************************************
+ * Copyright (C) 2017 by Paula Perez Rubio                                  *
+ *                                                                          *
+ * This file is part of FastqPuri.                                      *
+ *                                                                          *
+ *   FastqPuri is free software: you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as                *
+ *   published by the Free Software Foundation, either version 3 of the     *
+ *   License, or (at your option) any later version.                        *
+ *                                                                          *
+ *   FastqPuri is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *   GNU General Public License for more details.                           *
+ *                                                                          *
+ *   You should have received a copy of the GNU General Public License      *
+ *   along with FastqPuri.                                              *
+ *   If not, see <http://www.gnu.org/licenses/>.                            *
+ ****************************************************************************/
+
+/**
+ * @file kmerset.h
+ * @author Paula Perez <paulaperezrubio@gmail.com>
+ * @date 17.10.2026
+ * @brief exact kmer set (open addressing hash table of 2-bit kmers)
+ *
+ * */
+
+#ifndef KMERSET_H_
+#define KMERSET_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include "defines.h"
+#include "bloom.h"
+
+/**
+ * @brief set of canonical kmers (kmersize <= BF_ROLL_MAXK)
+ *
+ * Every kmer is packed with 2 bits per nucleotide and the smaller of the
+ * forward and reverse complement kmers (canonical kmer) is stored in an
+ * open addressing hash table with linear probing. nslots is a power of
+ * two and empty slots contain KSET_EMPTY. Kmers are rolled in with the
+ * Bfkmer structure of the Bloom filters (roll_kmer).
+ *
+ * */
+typedef struct _kmerset {
+  int kmersize;  /**< kmer size */
+  uint64_t nelem;  /**< number of (distinct) kmers in the set */
+  uint64_t nslots;  /**< number of slots of the table (power of 2) */
+  uint64_t mask;  /**< nslots - 1 */
+  size_t mapsize;  /**< size of the mapping if the set is mmapped, 0 otherwise*/
+  void *map;  /**< mapping of the kmer set file (mapped sets only) */
+  uint64_t *table;  /**< hash table */
+} Kmerset;
+
+Kmerset *init_Kmerset(int kmersize, uint64_t maxelem);
+
+void free_Kmerset(Kmerset *ptr_ks);
+
+bool insert_kmer(Kmerset *ptr_ks, Bfkmer *ptr_bfkmer);
+
+bool contains_kmer(Kmerset *ptr_ks, Bfkmer *ptr_bfkmer);
+
+Kmerset *create_Kmerset(char *fastafile, int kmersize);
+
+void save_Kmerset(Kmerset *ptr_ks, char *filename);
+
+Kmerset *read_Kmerset(char *filename);
+
+/* static functions
+ * static uint64_t mix64(uint64_t x);
+ * static uint64_t canonical(Bfkmer *ptr_bfkmer);
+ * static Kmerset *map_Kmerset(char *filename);
+ * */
+
+#endif  // endif KMERSET_H_
@@ -0,0 +1,38 @@
+/****************************************************************************
+ * Copyright (C) 2017 by Paula Perez Rubio                                  *
+ *                                                                          *
+ * This file is part of FastqPuri.                                      *
+ *                                                                          *
+ *   FastqPuri is free software: you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as                *
+ *   published by the Free Software Foundation, either version 3 of the     *
+ *   License, or (at your option) any later version.                        *
+ *                                                                          *
+ *   FastqPuri is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *   GNU General Public License for more details.                           *
+ *                                                                          *
+ *   You should have received a copy of the GNU General Public License      *
+ *   along with FastqPuri.                                              *
+ *   If not, see <http://www.gnu.org/licenses/>.                            *
+ ****************************************************************************/
+
+/**
+ * @file mmap_gen.h
+ * @author Paula Perez <paulaperezrubio@gmail.com>
+ * @date 17.10.2026
+ * @brief Read-only memory mapping of index files (Bloom filters, trees).
+ *
+ * */
+
+#ifndef MMAP_GEN_H_
+#define MMAP_GEN_H_
+
+#include <stddef.h>
+
+void *mmap_gen(const char *filename, size_t minsize, size_t *size);
+
+void munmap_gen(void *map, size_t size);
+
+#endif  // endif MMAP_GEN_H_
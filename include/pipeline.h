@@ -0,0 +1,161 @@
+/****************************************************************************
+ * Copyright (C) 2017 by Paula Perez Rubio                                  *
+ *                                                                          *
+ * This file is part of FastqPuri.                                      *
+ *                                                                          *
+ *   FastqPuri is free software: you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as                *
+ *   published by the Free Software Foundation, either version 3 of the     *
+ *   License, or (at your option) any later version.                        *
+ *                                                                          *
+ *   FastqPuri is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *   GNU General Public License for more details.                           *
+ *                                                                          *
+ *   You should have received a copy of the GNU General Public License      *
+ *   along with FastqPuri.                                              *
+ *   If not, see <http://www.gnu.org/licenses/>.                            *
+ ****************************************************************************/
+
+
+/**
+ * @file pipeline.h
+ * @brief ordered batch pipeline: one reader, N workers, one writer.
+ *        Buffers to collect and read batches of fq entries.
+ * @author Paula Perez <paulaperezrubio@gmail.com>
+ * @date 17.10.2026
+ *
+ */
+
+#ifndef PIPELINE_H_
+#define PIPELINE_H_
+
+#include <stdio.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <sys/uio.h>
+#include "defines.h"
+
+/**
+ * @brief growing char buffer, owned by a single thread
+ * */
+typedef struct _obuffer {
+  char *buf;  /**< buffered chars */
+  int count;  /**< number of chars stored in buf */
+  int size;  /**< allocated size of buf */
+} Obuffer;
+
+/**
+ * @brief growing array of line ends of fq entries, owned by a single thread
+ * */
+typedef struct _ebuffer {
+  int *end;  /**< position of the '\n' ending every line, 4 per entry */
+  int count;  /**< number of line ends stored in end */
+  int size;  /**< allocated size of end */
+} Ebuffer;
+
+/**
+ * @brief reads complete fq entries from a file
+ *
+ * The file is read in chunks of B_LEN chars into buffer, and the line
+ * ends of all complete entries are found in one pass (see split_fq).
+ * Entries are handed out from pos on, and the entries not yet handed out
+ * at the end of the buffer are moved to the front before the next chunk
+ * is read.
+ * */
+typedef struct _fq_reader {
+  FILE *f;  /**< input file */
+  char *buffer;  /**< chunk of the input file */
+  int len;  /**< number of chars stored in buffer */
+  int pos;  /**< start of the first entry not yet handed out */
+  int *ends;  /**< line ends of the complete entries in buffer */
+  int nentries;  /**< number of complete entries in buffer */
+  int next;  /**< first entry not yet handed out */
+  int *view;  /**< line ends of the entries handed out by view_entries */
+  int nl;  /**< number of lines found after the last complete entry */
+  int nlines;  /**< number of lines handed out */
+  bool eof;  /**< true when the end of the file was reached */
+} Fq_reader;
+
+/**
+ * @brief function applied by a worker thread to a batch
+ * */
+typedef void (*work_fn)(void *batch, void *worker_arg);
+
+/**
+ * @brief function applied by the writer thread to a processed batch
+ * */
+typedef void (*write_fn)(void *batch, void *writer_arg);
+
+/**
+ * @brief ordered batch pipeline
+ *
+ * The batches are owned by the caller and recycled in a ring of nslots
+ * elements. The reader (calling thread) fills batch id in slot
+ * id % nslots, the workers process the batches in any order, and the
+ * writer thread hands them to write() strictly in the order in which they
+ * were read. A slot is given back to the reader once it has been written.
+ *
+ * */
+typedef struct _pipeline {
+  int nthreads;  /**< number of worker threads */
+  int nslots;  /**< number of batches in flight */
+  int nstarted;  /**< number of workers that picked their worker_arg */
+  void **slot;  /**< batches, provided by the caller */
+  int *state;  /**< state of every slot: EMPTY, FILLED, DONE */
+  uint64_t nread;  /**< number of batches handed out by the reader */
+  uint64_t nwork;  /**< number of batches taken by the workers */
+  uint64_t nwrite;  /**< number of batches written */
+  bool eof;  /**< true when the reader has no more batches */
+  work_fn work;  /**< processes a batch */
+  void **worker_arg;  /**< per-worker argument passed to work() */
+  write_fn write;  /**< writes a batch */
+  void *writer_arg;  /**< argument passed to write() */
+  pthread_mutex_t lock;  /**< protects the counters and the states */
+  pthread_cond_t cond;  /**< signals any change of state */
+  pthread_t *workers;  /**< worker threads */
+  pthread_t writer;  /**< writer thread */
+} Pipeline;
+
+Pipeline *init_pipeline(int nthreads, void **slot, int nslots,
+                        work_fn work, void **worker_arg,
+                        write_fn write, void *writer_arg);
+
+void *pipeline_next(Pipeline *ptr_pl);
+
+void pipeline_push(Pipeline *ptr_pl);
+
+void free_pipeline(Pipeline *ptr_pl);
+
+void buffer_append(Obuffer *ob, const char *str, const int len);
+
+void buffer_appendv(Obuffer *ob, const struct iovec *iov, const int n);
+
+void buffer_flush(Obuffer *ob, FILE *fout);
+
+void free_Obuffer(Obuffer *ob);
+
+void free_Ebuffer(Ebuffer *eb);
+
+Fq_reader *init_Fq_reader(FILE *f);
+
+int read_entries(Fq_reader *ptr_rd, Obuffer *ob, Ebuffer *eb, int n);
+
+int view_entries(Fq_reader *ptr_rd, char **entries, int **ends, int n);
+
+void unview_entries(Fq_reader *ptr_rd, int n);
+
+void free_Fq_reader(Fq_reader *ptr_rd);
+
+/* static functions
+ * worker_loop(void *arg);
+ * writer_loop(void *arg);
+ * buffer_grow(Obuffer *ob, const int len);
+ * ebuffer_append(Ebuffer *eb, const int *ends, const int n,
+ *                const int offset);
+ * fill_buffer(Fq_reader *ptr_rd);
+ * take_entries(Fq_reader *ptr_rd, int n);
+ * */
+
+#endif  // endif PIPELINE_H_
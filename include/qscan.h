@@ -0,0 +1,69 @@
+/****************************************************************************
+ * Copyright (C) 2017 by Paula Perez Rubio                                  *
+ *                                                                          *
+ * This file is part of FastqPuri.                                      *
+ *                                                                          *
+ *   FastqPuri is free software: you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as                *
+ *   published by the Free Software Foundation, either version 3 of the     *
+ *   License, or (at your option) any later version.                        *
+ *                                                                          *
+ *   FastqPuri is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *   GNU General Public License for more details.                           *
+ *                                                                          *
+ *   You should have received a copy of the GNU General Public License      *
+ *   along with FastqPuri.                                              *
+ *   If not, see <http://www.gnu.org/licenses/>.                            *
+ ****************************************************************************/
+
+/**
+ * @file qscan.h
+ * @brief scans of quality strings (lowQ bases) and sequences (N's).
+ * @author Paula Perez <paulaperezrubio@gmail.com>
+ * @date 17.10.2026
+ *
+ * The bytes of a read are classified 64 at a time into a bit mask (bit j
+ * set if byte j is a lowQ base or an N), 64 (AVX-512BW), 32 (AVX2) or 16
+ * (SSE2) bytes per instruction, the kernel being chosen at runtime from
+ * the instructions supported by the CPU. A scalar loop is used on other
+ * architectures. The bases are classified directly on the ASCII
+ * sequence: any char other than A, C, G, T (upper or lower case) is an N,
+ * as in Lmer_sLmer. Counts are obtained with popcount, the trimming
+ * positions with ctz/clz.
+ *
+ */
+
+#ifndef QSCAN_H_
+#define QSCAN_H_
+
+int count_lowQ(const char *qual, int L, int thr);
+
+int first_goodQ(const char *qual, int L, int thr);
+
+int last_goodQ(const char *qual, int L, int thr);
+
+int count_N(const char *seq, int L);
+
+int first_base(const char *seq, int L);
+
+int last_base(const char *seq, int L);
+
+int next_N(const char *seq, int i, int L);
+
+/* static functions
+ * static uint64_t low_bits(int n);
+ * static uint64_t lowQ_scalar(const char *qual, int i, int n, char thr);
+ * static uint64_t N_scalar(const char *seq, int i, int n);
+ * static uint64_t lowQ_sse2(const char *qual, int n, char thr);
+ * static uint64_t lowQ_avx2(const char *qual, int n, char thr);
+ * static uint64_t lowQ_avx512(const char *qual, int n, char thr);
+ * static uint64_t N_sse2(const char *seq, int n);
+ * static uint64_t N_avx2(const char *seq, int n);
+ * static uint64_t N_avx512(const char *seq, int n);
+ * static uint64_t lowQ_mask(const char *qual, int n, int thr);
+ * static uint64_t N_mask(const char *seq, int n);
+ * */
+
+#endif  // endif QSCAN_H_
@@ -41,6 +41,7 @@ typedef struct _adapter {
   char *ad2_fa;  /**< fasta file containing adapters from read 2*/
   int mismatches;   /**< Number of allowed mismatches*/
   double threshold;  /**< Score threshold*/
+  int mode;  /**< HAMMING(0), MYERS(1): mismatches only or also indels */
   int Nad;  /**< Number of adapters*/
 } Adapter;
 
@@ -58,9 +59,10 @@ typedef struct _iparam_trimFilter {
   bool uncompress;  /**< true if output uncompressed, false otherwise */
   Adapter ad;    /**< AdapterDS trimming parameters  */
   Bfkmer *ptr_bfkmer; /**< bloom filter kmer structure */
-  int trimQ;     /**< NO(0), FRAC(1), ENDS(2), ENDSFRAC(3), GLOBAL(4) */
+  int trimQ;     /**< NO(0), ALL(1), ENDS(2), FRAC(3), ENDSFRAC(4),
+                      GLOBAL(5), WINDOW(6), MOTT(7) */
   int trimN;     /**< NO(0), ALL(1), ENDS(2), STRIP(3) */
-  int method;    /**< TREE(1), BLOOM(2), 0, when not looking for cont*/
+  int method;    /**< TREE(1), BLOOM(2), KMERSET(3), 0, when not looking for cont*/
   bool is_fa;    /**< true if a fasta file was passed as a parameter*/
   bool is_idx;  /**< true if an index file was passed as a parameter */
   bool is_adapter;  /**< true if filtering adapter sequences*/
@@ -74,8 +76,10 @@ typedef struct _iparam_trimFilter {
   int globleft;  /**< number of bases globally trimming from the left */
   int globright; /**< number of bases globally trimming from the right */
   int percent;   /**< percentage of lowQ bases allowed in a read */
+  int qwindow;   /**< window length (bases) of trimQ WINDOW */
   int uncertain; /**< percentage of N bases allowed in a read */
   bool adapter_rm; /**< true if the adapter matching sequences should be dropped instead of trimmed */
+  int nthreads;  /**< number of worker threads */
 } Iparam_trimFilter;
 
 void free_parTF(Iparam_trimFilter *ptr_parTF);
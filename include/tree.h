@@ -34,11 +34,14 @@
 #include "fa_read.h"
 
 /**
- * @brief Node structure: formed out of T_ACGT pointers to Node structure.
+ * @brief Node structure: formed out of the indices of T_ACGT children.
  *
+ * Node n is the (n+1)th node allocated in the tree (the root is node 0),
+ * it is found in pool_2D[n / NPOOL_1D][n % NPOOL_1D]. Index 0 means no
+ * child, since the root is nobody's child.
  * */
 typedef struct _node {
-  struct _node *children[T_ACGT]; /**< T_ACGT pointers to Node structure*/
+  uint32_t children[T_ACGT]; /**< indices of the T_ACGT children */
 } Node;
 
 /**
@@ -56,6 +59,12 @@ typedef struct _node {
  * moment, and nnodes is the total number of nodes filled in. We limit
  * the number of allocated nodes to UINT_MAX (we cannot count more nodes!).
  *
+ * Flat trees (see flatten_tree) keep the children indices of all nodes in
+ * a single array, offsets, and pool_2D is NULL. Trees read from a file
+ * are flat; trees read from an uncompressed tree file (TREE_EXT, see
+ * save_tree) are not even rebuilt: the file is mapped in memory and
+ * offsets points to the children indices stored in it.
+ *
  * */
 typedef struct _tree {
   uint32_t L; /**< depth of the tree */
@@ -63,11 +72,36 @@ typedef struct _tree {
   uint32_t pool_available; /**< Number of empty nodes available in the pool*/
   uint32_t nnodes; /**< Number of nodes in the tree */
   Node **pool_2D; /**< 2D pool containing the nodes that form the tree */
+  const uint32_t *offsets; /**< flat trees: child k of node n is node
+                                offsets[T_ACGT*n + k] (0: no child) */
+  void *map; /**< mapping of the tree file (mapped trees only) */
+  size_t mapsize; /**< size of the mapping in bytes */
 } Tree;
 
+/**
+ * @brief data of a thread constructing a tree (see tree_from_fasta)
+ *
+ * The Lmers are partitioned by their first P bases. The thread owning a
+ * partition inserts the rest of its Lmers in a subtrie of its own tree,
+ * rooted at roots[p]. Indices in tree_ptr are local to the thread.
+ * */
+typedef struct _tworker {
+  Tree *tree_ptr;  /**< subtries of the partitions owned by the thread */
+  uint32_t roots[TREE_NPART];  /**< root of partition p (TREE_NOROOT) */
+  bool (*prefix)[TREE_NPART];  /**< prefix[d][c]: an Lmer starts with
+                                    prefix c of d < P bases and a
+                                    non ACGT base (set by thread 0) */
+  char **seq;  /**< batch of chunks (see Fa_stream), shared */
+  int *N;  /**< lengths of the chunks */
+  int nbatch;  /**< number of chunks in the batch */
+  int P;  /**< number of bases defining the partitions */
+  int id;  /**< thread index */
+  int nthreads;  /**< number of threads */
+} Tworker;
+
 Node *get_new_pool(Tree *tree_ptr);
 
-Node *new_node_buf(Tree *tree_ptr);
+uint32_t new_node_buf(Tree *tree_ptr);
 
 void free_all_nodes(Tree *tree_ptr);
 
@@ -77,14 +111,34 @@ void insert_entry(Tree *tree_ptr, Fa_entry *entry);
 
 double check_path(Tree *tree_ptr, char *read, int Lread);
 
-Tree *tree_from_fasta(Fa_data *fasta, int L);
+double check_path_flat(Tree *tree_ptr, char *read, int Lread);
+
+bool check_path_min(Tree *tree_ptr, char *read, int Lread, int need,
+                    int *nprobes);
+
+void flatten_tree(Tree *tree_ptr);
+
+Tree *tree_from_fasta(char *filename, int L, int nthreads);
 
 void save_tree(Tree *tree_ptr, char * filename);
 
 Tree *read_tree(char *filename);
 
 /* static functions
- * check_path(Tree *tree_ptr, char *Lmer, int Lread);
+ * static Node *get_node(Tree *tree_ptr, uint32_t n);
+ * static uint64_t free_pools(Tree *tree_ptr);
+ * static uint32_t *alloc_flat(uint32_t nnodes);
+ * static void insert_from(Tree *tree_ptr, uint32_t node, const char *Lmer,
+ *                         uint32_t len);
+ * static void *tree_worker(void *arg);
+ * static Tree *stitch_trees(Tworker *workers, int nthreads, uint32_t L);
+ * static bool has_Lmer(Tree *tree_ptr, char *Lmer, int L);
+ * static const uint32_t *tree_block(Tree *tree_ptr, uint32_t i,
+ *                                   uint32_t *sz);
+ * static uint64_t tree_checksum(Tree *tree_ptr);
+ * static uint64_t parse_header(Tree *tree_ptr, const unsigned char *header);
+ * static void check_tree(Tree *tree_ptr, uint64_t checksum, char *filename);
+ * static Tree *map_tree(char *filename);
  * */
 
 #endif  // endif TREE_H_
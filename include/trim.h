@@ -35,13 +35,17 @@
 #include "defines.h"
 #include "tree.h"
 #include "bloom.h"
+#include "kmerset.h"
 #include "adapters.h"
 
-int trim_adapter(Fq_read *seq, Ad_seq *adap_list);
+int trim_adapter(Fq_read *seq, Ad_seq *adap_list, Ad_index *ptr_idx);
 int trim_sequenceN(Fq_read *seq);
 int trim_sequenceQ(Fq_read *seq);
-bool is_read_inTree(Tree *tree_ptr, Fq_read *seq);
-bool is_read_inBloom(Bfilter *tree_ptr, Fq_read *seq, Bfkmer *ptr_Bfkmer);
+bool is_read_inTree(Tree *tree_ptr, Fq_read *seq, uint64_t *probes);
+void reads_inBloom(Bfilter *ptr_bf, Bfbatch *ptr_bb, Bfkmer *ptr_bfkmer,
+                   Fq_read **seqs, int nseqs, bool *found, uint64_t *probes);
+bool is_read_inKmerset(Kmerset *ptr_ks, Fq_read *seq, Bfkmer *ptr_bfkmer,
+                       uint64_t *probes);
 int Qtrim_global(Fq_read *seq, int left, int right, char type);
 
 /* static functions
@@ -52,6 +56,14 @@ int Qtrim_global(Fq_read *seq, int left, int right, char type);
 * static int Qtrim_ends(Fq_read *seq, int minQ, int minL);
 * static int Qtrim_frac(Fq_read *seq, int minQ ,int nlowQ );
 * static int Qtrim_endsfrac(Fq_read *seq, int minQ, int minL, int nlowQ );
+* static int Qtrim_window(Fq_read *seq, int minQ, int zeroQ, int minL, int w);
+* static int Qtrim_mott(Fq_read *seq, int minQ, int zeroQ, int minL);
+* static bool score_windows(Fq_read *seq, Ad_seq *ptr_adap, uint64_t mask,
+*                           uint64_t mask_sh, int pos0, double *score,
+*                           int *pos);
+* static int align_edit(Fq_read *seq, Ad_seq *ptr_adap, Ad_edit *ptr_ed,
+*                       int l);
+* static int min_hits(int N, double score);
 */
 
 #endif  // TRIM_H_
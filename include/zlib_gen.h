@@ -0,0 +1,56 @@
+/****************************************************************************
+ * Copyright (C) 2017 by Paula Perez Rubio                                  *
+ *                                                                          *
+ * This file is part of FastqPuri.                                      *
+ *                                                                          *
+ *   FastqPuri is free software: you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as                *
+ *   published by the Free Software Foundation, either version 3 of the     *
+ *   License, or (at your option) any later version.                        *
+ *                                                                          *
+ *   FastqPuri is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *   GNU General Public License for more details.                           *
+ *                                                                          *
+ *   You should have received a copy of the GNU General Public License      *
+ *   along with FastqPuri.                                              *
+ *   If not, see <http://www.gnu.org/licenses/>.                            *
+ ****************************************************************************/
+
+
+/**
+ * @file zlib_gen.h
+ * @brief zlib or zlib-ng (native API), whichever was found by cmake.
+ * @author Paula Perez <paulaperezrubio@gmail.com>
+ * @date 17.10.2026
+ *
+ * The zlib-ng native API prefixes every function with zng_; the zlib
+ * names are mapped to them, so that the code is written against zlib.
+ *
+ */
+
+#ifndef ZLIB_GEN_H_
+#define ZLIB_GEN_H_
+
+#include "config.h"
+
+#ifdef HAVE_ZLIBNG
+  #include <zlib-ng.h>
+  #define z_stream zng_stream
+  #define deflateInit2 zng_deflateInit2
+  #define deflateReset zng_deflateReset
+  #define deflate zng_deflate
+  #define deflateEnd zng_deflateEnd
+  #define crc32 zng_crc32
+  #define gzopen zng_gzopen
+  #define gzbuffer zng_gzbuffer
+  #define gzread zng_gzread
+  #define gztell zng_gztell
+  #define gzerror zng_gzerror
+  #define gzclose zng_gzclose
+#elif defined(HAVE_ZLIB)
+  #include <zlib.h>
+#endif
+
+#endif  // endif ZLIB_GEN_H_
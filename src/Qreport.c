@@ -35,6 +35,7 @@
 #include "init_Qreport.h"
 #include "fopen_gen.h"
 #include "fq_read.h"
+#include "pipeline.h"
 #include "stats_info.h"
 #include "Rcommand_Qreport.h"
 
@@ -46,10 +47,9 @@ Iparam_Qreport par_QR; /**< global variable: input parameters for Qreport*/
  * */
 int main(int argc, char *argv[]) {
   FILE *f;
-  int j = 0, nlines = 0, c1 = 0, c2 = -1;
-  char *buffer = malloc(sizeof(char)*(B_LEN + 1));
-  int newlen;
-  int offset = 0;
+  int i, k, nentries, nlines = 0, c1;
+  char *buffer;
+  int *ends;
   Info* res = malloc(sizeof *res);
   Fq_read* seq = malloc(sizeof *seq);
   clock_t start, end;
@@ -88,29 +88,23 @@ int main(int argc, char *argv[]) {
   // Initialize struct that will contain the output
   init_info(res);
 
-  // Read the fastq file
-  while ( (newlen = fread(buffer+offset, 1, B_LEN-offset, f) ) > 0) {
-    newlen += offset;
-    buffer[newlen++] =  '\0';
-    for (j = 0 ; buffer[j] != '\0' ; j++) {
-      if (buffer[j] == '\n') {
-        c2 = j;
-        par_QR.one_read_len &= get_fqread(seq, buffer, c1, c2, nlines,  par_QR.read_len, par_QR.filter);
-        if ( (nlines % 4) == 3 ) {
-          if (res -> nreads == 0) get_first_tile(res, seq);
-          update_info(res, seq);
-          if (res -> nreads % 1000000 == 0)
-            fprintf(stderr, "  %10d reads have been read.\n", res -> nreads);
-        }
-        c1 = c2 + 1;
-        nlines++;
+  // Read the fastq file: the entries are parsed in place, in the buffer
+  // of the reader
+  Fq_reader *ptr_rd = init_Fq_reader(f);
+  while ((nentries = view_entries(ptr_rd, &buffer, &ends, NREADS_BATCH)) > 0) {
+    c1 = 0;
+    for (i = 0; i < nentries; i++) {
+      for (k = 0; k < 4; k++) {
+        par_QR.one_read_len &= get_fqread(seq, buffer, c1, ends[4*i + k], nlines++,  par_QR.read_len, par_QR.filter);
+        c1 = ends[4*i + k] + 1;
       }
+      if (res -> nreads == 0) get_first_tile(res, seq);
+      update_info(res, seq);
+      if (res -> nreads % 1000000 == 0)
+        fprintf(stderr, "  %10d reads have been read.\n", res -> nreads);
     }
-    offset = newlen - c1 -1;
-    if (offset >  -1) memcpy(buffer, buffer+c1, offset);
-    c2 = -1;
-    c1 = 0;
   }  // end while
+  free_Fq_reader(ptr_rd);
 
   // Closing file
   fprintf(stderr, "- Finished reading file.\n");
@@ -150,11 +144,6 @@ int main(int argc, char *argv[]) {
       fprintf(stderr, "Exiting program.\n");
       exit(EXIT_FAILURE);
   }
-#else
-  fprintf(stderr, "WARNING: html reports are NOT being generated.\n");
-  fprintf(stderr, "         Dependencies not fulfilled.\n");
-#endif
-  free(buffer);
   free(command);
 
   // Removing tmp directory
@@ -165,6 +154,10 @@ int main(int argc, char *argv[]) {
       fprintf(stderr, "Exiting program.\n");
       exit(EXIT_FAILURE);
   }
+#else
+  fprintf(stderr, "WARNING: html reports are NOT being generated.\n");
+  fprintf(stderr, "         Dependencies not fulfilled.\n");
+#endif
 
   // Obtaining elapsed time
   end = clock();
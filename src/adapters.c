@@ -32,6 +32,10 @@
 #include "adapters.h"
 #include "Lmer.h"
 
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define ADAPTERS_X86
+#include <immintrin.h>
+#endif
 
 static uint8_t alfw0[256]; /**< variable for forward packing, first half */
 static uint8_t alfw1[256]; /**< variable for forward packing, second half */
@@ -39,6 +43,9 @@ static uint8_t albw0[256]; /**< variable for brackward packing, first half */
 static uint8_t albw1[256]; /**< variable for brackward packing, second half */
 extern uint8_t fw_1B[256];
 extern uint8_t bw_1B[256];
+int32_t Qpenalty[256];  /**< mismatch penalty (AD_SCALE units) of every
+                            quality, indexed by (uint8_t)(Q - zeroQ) */
+static int seed_kernel = AD_KERNEL_AUTO;  /**< kernel of seed_windows */
 
 /**
  * @brief look up table initialization for alignment (used for adapters)
@@ -55,8 +62,13 @@ extern uint8_t bw_1B[256];
  * With this variables we will encode sequences that can be compared
  * later on. Using the bitwise XOR operator, every mismatch will amount
  * to two bits set to 1.
+ *
+ * It also initializes Qpenalty, the Q/10 subtracted from the alignment
+ * score by a mismatch, as an integer number of 1/AD_SCALE units. Qualities
+ * below zeroQ (rejected by check_zeroQ) are not penalized.
  * */
 void init_alLUTs() {
+  int i;
   memset(alfw0, 0x00, 256);
   memset(alfw1, 0x00, 256);
   memset(albw0, 0x00, 256);
@@ -72,6 +84,10 @@ void init_alLUTs() {
   albw0['A'] = 0x08; albw0['C'] = 0x04; albw0['G'] = 0x02; albw0['T'] = 0x01;
   albw1['a'] = 0x80; albw1['c'] = 0x40; albw1['g'] = 0x20; albw1['t'] = 0x10;
   albw1['A'] = 0x80; albw1['C'] = 0x40; albw1['G'] = 0x20; albw1['T'] = 0x10;
+
+  for (i = 0; i < 256; i++) {
+    Qpenalty[i] = (i < 128) ? i*(AD_SCALE/10) : 0;
+  }
 }
 
 /**
@@ -121,13 +137,15 @@ int process_seq(unsigned char *packed, unsigned char *sequence, int L,
  *        <b>Ad_seq</b> structs.
  *
  * It reads the fasta structure. For every entry, an <b>Ad_seq</b> structure is
- * allocated and the sequences are processed to create the packed sequences.
+ * allocated and the sequences are processed to create the packed sequences,
+ * and the match masks of the bit-vector alignment (edit_adapter). The
+ * lookup table bw_1B must be initialized (init_map).
  * @param ptr_fa pointer to <b>Fa_data</b> structure
  * @return pointer to <b>Ad_seq</b>, where the information is stored.
  *
 * */
 Ad_seq *pack_adapter(Fa_data *ptr_fa) {
-  int i;
+  int i, j;
   Ad_seq *adap_list = malloc(sizeof(Ad_seq)*ptr_fa->nentries);
   for (i = 0; i< ptr_fa->nentries; i++) {
      adap_list[i].L = ptr_fa -> entry[i].N;
@@ -136,9 +154,112 @@ Ad_seq *pack_adapter(Fa_data *ptr_fa) {
                  (unsigned char *) adap_list[i].seq, adap_list[i].L, 0, 1);
      adap_list[i].Lpack_sh = process_seq(adap_list[i].pack_sh,
                  (unsigned char *) adap_list[i].seq, adap_list[i].L, 1, 1);
+     memset(adap_list[i].peq, 0, sizeof(adap_list[i].peq));
+     for (j = 0; j < min(adap_list[i].L, AD_MYERSLEN); j++) {
+       adap_list[i].peq[bw_1B[(uint8_t)adap_list[i].seq[adap_list[i].L-1-j]]]
+           |= (uint64_t)1 << j;
+     }
   }
   return adap_list;
 }
+
+/**
+ * @brief mask with the lowest n bits set (0 <= n <= 64)
+ * */
+static uint64_t low_bits(int n) {
+  return (n >= 64) ? ~(uint64_t)0 : (((uint64_t)1 << n) - 1);
+}
+
+/**
+ * @brief match mask of n <= 32 bases (scalar version)
+ * */
+static uint32_t bases_scalar(const char *s1, const char *s2, int n) {
+  int i;
+  uint32_t mask = 0;
+  for (i = 0; i < n; i++) {
+    mask |= (uint32_t)(fw_1B[(uint8_t)s1[i]] == bw_1B[(uint8_t)s2[-i]]) << i;
+  }
+  return mask;
+}
+
+#ifdef ADAPTERS_X86
+/**
+ * @brief fw_1B codes of 32 bases, other coding the bases other than ACGT
+ * */
+__attribute__((target("avx2")))
+static __m256i codes_avx2(__m256i v, char other) {
+  __m256i low = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+  __m256i a = _mm256_cmpeq_epi8(low, _mm256_set1_epi8('a'));
+  __m256i c = _mm256_cmpeq_epi8(low, _mm256_set1_epi8('c'));
+  __m256i g = _mm256_cmpeq_epi8(low, _mm256_set1_epi8('g'));
+  __m256i t = _mm256_cmpeq_epi8(low, _mm256_set1_epi8('t'));
+  __m256i code = _mm256_or_si256(
+      _mm256_and_si256(c, _mm256_set1_epi8(1)),
+      _mm256_or_si256(_mm256_and_si256(g, _mm256_set1_epi8(2)),
+                      _mm256_and_si256(t, _mm256_set1_epi8(3))));
+  return _mm256_blendv_epi8(_mm256_set1_epi8(other), code,
+           _mm256_or_si256(_mm256_or_si256(a, c), _mm256_or_si256(g, t)));
+}
+
+/**
+ * @brief match mask of 32 bases, v2 holding the second sequence backwards
+ *
+ * The bases of v2 are reversed and complemented (code ^ 3), coding the
+ * bases other than ACGT as 7 in both strings.
+ * */
+__attribute__((target("avx2")))
+static uint32_t match32_avx2(__m256i v1, __m256i v2) {
+  const __m256i rev = _mm256_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8,
+                                       7, 6, 5, 4, 3, 2, 1, 0,
+                                       15, 14, 13, 12, 11, 10, 9, 8,
+                                       7, 6, 5, 4, 3, 2, 1, 0);
+  v2 = _mm256_permute4x64_epi64(_mm256_shuffle_epi8(v2, rev), 0x4E);
+  return (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(
+      codes_avx2(v1, 7),
+      _mm256_xor_si256(codes_avx2(v2, 4), _mm256_set1_epi8(3))));
+}
+
+/**
+ * @brief match mask of n <= 32 bases, 32 at a time
+ *
+ * Fewer than 32 bases are copied first, not to read past the strings.
+ * */
+__attribute__((target("avx2")))
+static uint32_t bases_avx2(const char *s1, const char *s2, int n) {
+  char b1[32] = {0}, b2[32] = {0};
+  if (n < 32) {
+    memcpy(b1, s1, n);
+    memcpy(b2 + 32 - n, s2 - n + 1, n);
+    s1 = b1;
+    s2 = b2 + 31;
+  }
+  return match32_avx2(_mm256_loadu_si256((const __m256i *)s1),
+                      _mm256_loadu_si256((const __m256i *)(s2 - 31))) &
+         (uint32_t)low_bits(n);
+}
+#endif
+
+/**
+ * @brief compares n <= 32 read bases with n bases of the reverse
+ *        complement of a sequence
+ * @param s1 first read base
+ * @param s2 base of the sequence aligned to s1[0], the next ones being
+ *        s2[-1], s2[-2], ...
+ * @param n number of bases
+ * @return bit i is set if fw_1B[s1[i]] == bw_1B[s2[-i]]
+ *
+ * When the cpu supports AVX2, the 32 bases are compared at a time. Only
+ * the n bases are read.
+ * */
+uint32_t match_bases(const char *s1, const char *s2, int n) {
+#ifdef ADAPTERS_X86
+  if (__builtin_cpu_supports("avx2")) {
+    return bases_avx2(s1, s2, n);
+  }
+#endif
+  return bases_scalar(s1, s2, n);
+}
+
 /**
  * @brief computes score of a possible alignment, after having found a seed.
  *
@@ -146,29 +267,769 @@ Ad_seq *pack_adapter(Fa_data *ptr_fa) {
  *  - matching bases: score += log_10(4)
  *  - unmatching bases: score -= Q/10, where Q is the quality score.
  *
+ * The score is added up in 1/AD_SCALE units (AD_LOG4, Qpenalty), where
+ * both terms are exact. The bases are compared 32 at a time (match_bases),
+ * and the scoring stops as soon as the bases left cannot make up
+ * MIN_NMATCHES matches, or a score above minscore (when minscore >= -1,
+ * as -1 is then not above it either).
  * @param seq pointer to <b>Fq_read</b>.
  * @param pos_seq  read starting position of the alignment
  * @param ptr_adap pointer to <b>Ad_seq</b>, contains the adapter info
  * @param pos_ad adapter starting position of the alignment (reverse)
- * @return score of the alignment
+ * @param zeroQ value of ASCII character representing zero quality
+ * @param minscore scores not above minscore are not wanted
+ * @return score of the alignment, -1 if less than MIN_NMATCHES bases
+ *         match or the scoring stopped
  * */
-double obtain_score(Fq_read *seq, int pos_seq, Ad_seq *ptr_adap, int pos_ad, int zeroQ) {
+double obtain_score(Fq_read *seq, int pos_seq, Ad_seq *ptr_adap, int pos_ad,
+                    int zeroQ, double minscore) {
   if (pos_seq == -1) {
       pos_seq = 0;
       pos_ad++;
   }
   int Nbases = min(seq->L-pos_seq, ptr_adap->L-pos_ad);
-  int i;
+  int i, n, left;
   int Nmatches = 0;
-  double score = 0.0;
-  for (i=0; i < Nbases; i++) {
-    if (fw_1B[(uint8_t)(seq->line2[pos_seq + i])] ==
-        bw_1B[(uint8_t)(ptr_adap->seq[ptr_adap->L-1-i-pos_ad])]) {
-      score += LOG_4;
+  int score = 0;
+  bool cut = (minscore >= -1.0);
+  double lim = minscore*AD_SCALE - 1;
+  uint32_t mask, mis;
+  const char *read = seq -> line2 + pos_seq;
+  const char *qual = seq -> line4 + pos_seq;
+  const char *ad = ptr_adap -> seq + ptr_adap -> L - 1 - pos_ad;
+  if (Nbases < MIN_NMATCHES) return -1.0;
+  for (i = 0; i < Nbases; i += n) {
+    n = min(Nbases - i, 32);
+    mask = match_bases(read + i, ad - i, n);
+    left = Nbases - i - n;
+    Nmatches += __builtin_popcount(mask);
+    if (Nmatches + left < MIN_NMATCHES) return -1.0;
+    score += AD_LOG4*__builtin_popcount(mask);
+    for (mis = ~mask & (uint32_t)low_bits(n); mis; mis &= mis - 1) {
+      score -= Qpenalty[(uint8_t)(qual[i + __builtin_ctz(mis)] - zeroQ)];
+      if (cut && score + (double)AD_LOG4*left <= lim) return -1.0;
+    }
+  }
+  return (double)score/AD_SCALE;
+}
+
+/**
+ * @brief seed masks of n <= 64 windows (scalar version)
+ * */
+static uint64_t windows_scalar(const unsigned char *pack, int n, uint64_t ad,
+                               uint64_t adsh, int maxbits, uint64_t *mask_sh) {
+  int j;
+  uint64_t mask = 0, msh = 0, x;
+  for (j = 0; j < n; j++) {
+    memcpy(&x, pack + j, sizeof(uint64_t));
+    if (__builtin_popcountll((x ^ adsh) >> 4) <= maxbits) {
+      msh |= (uint64_t)1 << j;
+    }
+    if (__builtin_popcountll(x ^ ad) <= maxbits) {
+      mask |= (uint64_t)1 << j;
+    }
+  }
+  *mask_sh = msh;
+  return mask;
+}
+
+#ifdef ADAPTERS_X86
+/**
+ * @brief seed masks of n <= 64 windows, 32 windows at a time
+ *
+ * Byte k of 32 consecutive windows is compared with byte k of the seed
+ * in one instruction, and the differing bits are counted with a 4 bits
+ * look up table, adding up the counts of every byte.
+ * */
+__attribute__((target("avx2")))
+static uint64_t windows_avx2(const unsigned char *pack, int n, uint64_t ad,
+                             uint64_t adsh, int maxbits, uint64_t *mask_sh) {
+  int j, k;
+  uint64_t mask = 0, msh = 0;
+  const __m256i lut = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3,
+                                       1, 2, 2, 3, 2, 3, 3, 4,
+                                       0, 1, 1, 2, 1, 2, 2, 3,
+                                       1, 2, 2, 3, 2, 3, 3, 4);
+  const __m256i low4 = _mm256_set1_epi8(0x0F);
+  const __m256i lim = _mm256_set1_epi8(maxbits);
+  for (j = 0; j < n; j += 32) {
+    __m256i cnt = _mm256_setzero_si256(), cnt_sh = _mm256_setzero_si256();
+    for (k = 0; k < (int)sizeof(uint64_t); k++) {
+      __m256i v = _mm256_loadu_si256((const __m256i *)(pack + j + k));
+      __m256i x = _mm256_xor_si256(v, _mm256_set1_epi8((char)(ad >> 8*k)));
+      __m256i y = _mm256_and_si256(
+          _mm256_xor_si256(v, _mm256_set1_epi8((char)(adsh >> 8*k))),
+          _mm256_set1_epi8(k ? 0xFF : 0xF0));
+      cnt = _mm256_add_epi8(cnt, _mm256_add_epi8(
+          _mm256_shuffle_epi8(lut, _mm256_and_si256(x, low4)),
+          _mm256_shuffle_epi8(lut, _mm256_and_si256(_mm256_srli_epi16(x, 4),
+                                                    low4))));
+      cnt_sh = _mm256_add_epi8(cnt_sh, _mm256_add_epi8(
+          _mm256_shuffle_epi8(lut, _mm256_and_si256(y, low4)),
+          _mm256_shuffle_epi8(lut, _mm256_and_si256(_mm256_srli_epi16(y, 4),
+                                                    low4))));
+    }
+    mask |= (uint64_t)(uint32_t)~_mm256_movemask_epi8(
+                _mm256_cmpgt_epi8(cnt, lim)) << j;
+    msh |= (uint64_t)(uint32_t)~_mm256_movemask_epi8(
+               _mm256_cmpgt_epi8(cnt_sh, lim)) << j;
+  }
+  *mask_sh = msh & low_bits(n);
+  return mask & low_bits(n);
+}
+
+/**
+ * @brief seed masks of n <= 64 windows, all of them at a time
+ * */
+__attribute__((target("avx512bw")))
+static uint64_t windows_avx512(const unsigned char *pack, int n, uint64_t ad,
+                               uint64_t adsh, int maxbits, uint64_t *mask_sh) {
+  int k;
+  __mmask64 valid = low_bits(n);
+  const __m512i lut = _mm512_broadcast_i32x4(_mm_setr_epi8(0, 1, 1, 2, 1, 2,
+                                            2, 3, 1, 2, 2, 3, 2, 3, 3, 4));
+  const __m512i low4 = _mm512_set1_epi8(0x0F);
+  const __m512i lim = _mm512_set1_epi8(maxbits);
+  __m512i cnt = _mm512_setzero_si512(), cnt_sh = _mm512_setzero_si512();
+  for (k = 0; k < (int)sizeof(uint64_t); k++) {
+    __m512i v = _mm512_maskz_loadu_epi8(valid, pack + k);
+    __m512i x = _mm512_xor_si512(v, _mm512_set1_epi8((char)(ad >> 8*k)));
+    __m512i y = _mm512_and_si512(
+        _mm512_xor_si512(v, _mm512_set1_epi8((char)(adsh >> 8*k))),
+        _mm512_set1_epi8(k ? 0xFF : 0xF0));
+    cnt = _mm512_add_epi8(cnt, _mm512_add_epi8(
+        _mm512_shuffle_epi8(lut, _mm512_and_si512(x, low4)),
+        _mm512_shuffle_epi8(lut, _mm512_and_si512(_mm512_srli_epi16(x, 4),
+                                                  low4))));
+    cnt_sh = _mm512_add_epi8(cnt_sh, _mm512_add_epi8(
+        _mm512_shuffle_epi8(lut, _mm512_and_si512(y, low4)),
+        _mm512_shuffle_epi8(lut, _mm512_and_si512(_mm512_srli_epi16(y, 4),
+                                                  low4))));
+  }
+  *mask_sh = _mm512_mask_cmple_epi8_mask(valid, cnt_sh, lim);
+  return _mm512_mask_cmple_epi8_mask(valid, cnt, lim);
+}
+#endif
+
+/**
+ * @brief finds the seeds of an adapter in n <= 64 windows of a read
+ * @param pack packed read (process_seq) from the first window on,
+ *        followed by PACK_PAD bytes
+ * @param n number of windows
+ * @param ad first 8 packed bytes of the adapter (pack)
+ * @param adsh first 8 packed bytes of the shifted adapter (pack_sh)
+ * @param maxbits maximum number of differing bits in a seed
+ * @param mask_sh output: mask of the seeds of adsh
+ * @return mask of the seeds of ad
+ *
+ * Window j holds the 8 bytes of pack starting at j. Bit j of the output
+ * masks is set if at most maxbits bits of window ^ ad, or of
+ * (window ^ adsh) >> 4, are set: the popcount tests of the read loop of
+ * align_uint64. When the cpu supports AVX2 or AVX512BW, 32 or 64 windows
+ * are tested at a time. The bytes of pack past the last window may be
+ * read, but do not change the result.
+ * */
+uint64_t seed_windows(const unsigned char *pack, int n, uint64_t ad,
+                      uint64_t adsh, int maxbits, uint64_t *mask_sh) {
+  *mask_sh = 0;
+  if (n <= 0 || maxbits < 0) return 0;
+  if (maxbits >= 64) {
+    *mask_sh = low_bits(n);
+    return low_bits(n);
+  }
+#ifdef ADAPTERS_X86
+  // a few windows are faster tested one by one
+  if (n >= AD_MINSIMD) {
+    if (seed_kernel == AD_KERNEL_AVX512 || (seed_kernel == AD_KERNEL_AUTO &&
+        __builtin_cpu_supports("avx512bw"))) {
+      return windows_avx512(pack, n, ad, adsh, maxbits, mask_sh);
+    } else if (seed_kernel == AD_KERNEL_AVX2 ||
+               (seed_kernel == AD_KERNEL_AUTO &&
+                __builtin_cpu_supports("avx2"))) {
+      return windows_avx2(pack, n, ad, adsh, maxbits, mask_sh);
+    }
+  }
+#endif
+  return windows_scalar(pack, n, ad, adsh, maxbits, mask_sh);
+}
+
+/**
+ * @brief selects the kernel used by seed_windows
+ * @param kernel AD_KERNEL_AUTO (default), AD_KERNEL_SCALAR, AD_KERNEL_AVX2
+ *        or AD_KERNEL_AVX512
+ * @return true if the kernel was selected, false if the cpu does not
+ *         support it (the previous kernel is kept)
+ *
+ * Used to compare the kernels (bench/bench_adapter.c), they all give the
+ * same results.
+ * */
+bool set_seed_kernel(int kernel) {
+  bool ok = (kernel == AD_KERNEL_AUTO || kernel == AD_KERNEL_SCALAR);
+#ifdef ADAPTERS_X86
+  ok = ok || (kernel == AD_KERNEL_AVX2 && __builtin_cpu_supports("avx2")) ||
+       (kernel == AD_KERNEL_AVX512 && __builtin_cpu_supports("avx512bw"));
+#endif
+  if (ok) seed_kernel = kernel;
+  return ok;
+}
+
+/**
+ * @brief checks that the first AD_SEEDLEN packed bases of a seed are
+ *        A, C, G or T (no empty nibble)
+ * @param seed packed bases, as in pack (process_seq)
+ * @return true if all of them are A, C, G or T
+ * */
+static bool seed_isACGT(uint64_t seed) {
+  uint64_t x = seed | 0xF000000000000000ULL;
+  return !((x - 0x1111111111111111ULL) & ~x & 0x8888888888888888ULL);
+}
+
+/**
+ * @brief converts the first AD_SEEDLEN packed bases of a seed, one bit
+ *        set per base, to 2 bits per base
+ * @param seed packed bases (seed_isACGT must be true)
+ * @return base i in bits 2i, 2i+1 (A: 0, C: 1, G: 2, T: 3)
+ * */
+static uint64_t seed_code(uint64_t seed) {
+  uint64_t x = seed & 0x0FFFFFFFFFFFFFFFULL;
+  x = ((x >> 1) & 0x7777777777777777ULL) - ((x >> 3) & 0x1111111111111111ULL);
+  x = (x | (x >> 2)) & 0x0F0F0F0F0F0F0F0FULL;
+  x = (x | (x >> 4)) & 0x00FF00FF00FF00FFULL;
+  x = (x | (x >> 8)) & 0x0000FFFF0000FFFFULL;
+  return (x | (x >> 16)) & 0x00000000FFFFFFFFULL;
+}
+
+/**
+ * @brief builds the seed index of a list of adapters
+ * @param adap_list array of <b>Ad_seq</b>, as returned by pack_adapter
+ * @param Nad number of adapters in adap_list
+ * @param mismatches maximum number of mismatches allowed in a seed
+ * @return pointer to <b>Ad_index</b>, NULL if scanning every adapter
+ *         is cheaper than looking up the index
+ *
+ * A seed of align_uint64 is scored when at most 2*mismatches bits of
+ * the packed read and adapter differ. Where both are A, C, G or T, a
+ * mismatch costs 2 bits, so at most mismatches of their first
+ * AD_SEEDLEN bases differ, and one of mismatches+1 disjoint chunks is
+ * identical in the read and in the adapter. The chunks of every adapter
+ * are stored in a table indexed by their 2 bits per base code. Adapters
+ * with other bases in their seed are tested at every position.
+ * */
+Ad_index *index_adapter(Ad_seq *adap_list, int Nad, int mismatches) {
+  int i, c, v, nidx = 0;
+  for (i = 0; i < Nad; i++) {
+    nidx += (adap_list[i].L >= 16);
+  }
+  if (mismatches < 0 || mismatches + 1 > AD_SEEDLEN/AD_CHUNKLEN ||
+      nidx < AD_MINIDX) {
+    return NULL;
+  }
+  Ad_index *ptr_idx = calloc(1, sizeof(Ad_index));
+  ptr_idx -> maxbits = 2*mismatches;
+  ptr_idx -> nchunks = mismatches + 1;
+  int nfirst = ptr_idx -> nchunks * (AD_NVALUES + 1);
+  ptr_idx -> ad = calloc(Nad, sizeof(uint64_t));
+  ptr_idx -> adsh = calloc(Nad, sizeof(uint64_t));
+  ptr_idx -> first = calloc(nfirst, sizeof(int));
+  ptr_idx -> ids = malloc(nidx * ptr_idx -> nchunks * sizeof(int));
+  ptr_idx -> all = malloc(nidx * sizeof(int));
+  ptr_idx -> wild = malloc(nidx * sizeof(int));
+  // count the adapters of every chunk value
+  for (i = 0; i < Nad; i++) {
+    if (adap_list[i].L < 16) continue;
+    memcpy(&(ptr_idx -> ad[i]), adap_list[i].pack, sizeof(uint64_t));
+    memcpy(&(ptr_idx -> adsh[i]), adap_list[i].pack_sh, sizeof(uint64_t));
+    ptr_idx -> all[ptr_idx -> nall++] = i;
+    if (!seed_isACGT(ptr_idx -> ad[i])) {
+      ptr_idx -> wild[ptr_idx -> nwild++] = i;
+      continue;
+    }
+    uint64_t code = seed_code(ptr_idx -> ad[i]);
+    for (c = 0; c < ptr_idx -> nchunks; c++) {
+      v = (code >> 2*c*AD_CHUNKLEN) & (AD_NVALUES - 1);
+      ptr_idx -> first[c*(AD_NVALUES + 1) + v + 1]++;
+    }
+  }
+  for (v = 1; v < nfirst; v++) {
+    ptr_idx -> first[v] += ptr_idx -> first[v-1];
+  }
+  // store them, grouped by chunk value
+  int *next = malloc(nfirst * sizeof(int));
+  memcpy(next, ptr_idx -> first, nfirst * sizeof(int));
+  for (i = 0; i < Nad; i++) {
+    if (adap_list[i].L < 16 || !seed_isACGT(ptr_idx -> ad[i])) continue;
+    uint64_t code = seed_code(ptr_idx -> ad[i]);
+    for (c = 0; c < ptr_idx -> nchunks; c++) {
+      v = (code >> 2*c*AD_CHUNKLEN) & (AD_NVALUES - 1);
+      ptr_idx -> ids[next[c*(AD_NVALUES + 1) + v]++] = i;
+    }
+  }
+  free(next);
+  return ptr_idx;
+}
+
+/**
+ * @brief frees an <b>Ad_index</b>
+ * @param ptr_idx pointer to <b>Ad_index</b> (can be NULL)
+ * */
+void free_Ad_index(Ad_index *ptr_idx) {
+  if (ptr_idx == NULL) return;
+  free(ptr_idx -> ad);
+  free(ptr_idx -> adsh);
+  free(ptr_idx -> first);
+  free(ptr_idx -> ids);
+  free(ptr_idx -> all);
+  free(ptr_idx -> wild);
+  free(ptr_idx);
+}
+
+/**
+ * @brief tests a seed of an adapter in a read window as align_uint64 does
+ * @param ptr_idx pointer to <b>Ad_index</b>
+ * @param i adapter index
+ * @param pos read position of the seed
+ * @param read64 packed read window starting at byte pos/2
+ * @return true if at most ptr_idx -> maxbits bits differ
+ * */
+static bool is_seed(Ad_index *ptr_idx, int i, int pos, uint64_t read64) {
+  int n = (pos % 2) ?
+      __builtin_popcountl((ptr_idx -> adsh[i] ^ read64) >> 4) :
+      __builtin_popcountl(ptr_idx -> ad[i] ^ read64);
+  return (n <= ptr_idx -> maxbits);
+}
+
+/**
+ * @brief stores a seed found in a read
+ * @param i adapter index
+ * @param pos read position of the seed
+ * @param cand_ad adapter of every seed found so far
+ * @param cand_pos read position of every seed found so far
+ * @param ncand number of seeds found so far
+ * @return number of seeds found, -1 if there are more than AD_MAXCAND
+ *
+ * The seeds are kept sorted by adapter and, for every adapter, by
+ * decreasing position (the order of align_uint64), without duplicates.
+ * */
+static int add_seed(int i, int pos, int *cand_ad, int *cand_pos, int ncand) {
+  int j;
+  for (j = ncand; j > 0 && cand_ad[j-1] > i; j--) {}
+  if (j > 0 && cand_ad[j-1] == i && cand_pos[j-1] == pos) return ncand;
+  if (ncand == AD_MAXCAND) return -1;
+  memmove(cand_ad + j + 1, cand_ad + j, (ncand - j)*sizeof(int));
+  memmove(cand_pos + j + 1, cand_pos + j, (ncand - j)*sizeof(int));
+  cand_ad[j] = i;
+  cand_pos[j] = pos;
+  return ncand + 1;
+}
+
+/**
+ * @brief finds the seeds of all indexed adapters in a packed read
+ * @param ptr_idx pointer to <b>Ad_index</b>
+ * @param seq pointer to <b>Fq_read</b>, packed with process_seq
+ * @param cand_ad output: adapter of every seed (AD_MAXCAND elements)
+ * @param cand_pos output: read position of every seed (AD_MAXCAND elements)
+ * @return number of seeds found, -1 if there are more than AD_MAXCAND
+ *
+ * The read windows are the ones of the first loop of align_uint64 and
+ * a seed is kept under the same popcount criterion, so cand_pos holds
+ * the positions that align_uint64 would score, in the same order. Read
+ * windows with bases other than A, C, G, T are tested against every
+ * adapter.
+ * */
+int seed_adapter(Ad_index *ptr_idx, Fq_read *seq, int *cand_ad,
+                 int *cand_pos) {
+  int Nwindows = seq -> Lhalf - (int)sizeof(uint64_t) + 1;
+  int top = 2*Nwindows - 1;
+  int nextbad = seq -> L;  // there are no bases past the end of the read
+  int pos, c, k, i, ncand = 0;
+  uint64_t code = 0, read64;
+  for (pos = min(seq -> L, top + AD_SEEDLEN) - 1; pos >= 0; pos--) {
+    uint8_t b = fw_1B[(uint8_t)seq -> line2[pos]];
+    if (b > 3) {
+      nextbad = pos;
+      b = 0;
+    }
+    code = ((code << 2) | b) & ((1ULL << 2*AD_SEEDLEN) - 1);
+    if (pos > top) continue;
+    memcpy(&read64, seq -> pack + pos/2, sizeof(uint64_t));
+    if (nextbad < pos + AD_SEEDLEN) {
+      for (k = 0; k < ptr_idx -> nall; k++) {
+        i = ptr_idx -> all[k];
+        if (is_seed(ptr_idx, i, pos, read64) &&
+            (ncand = add_seed(i, pos, cand_ad, cand_pos, ncand)) < 0) {
+          return -1;
+        }
+      }
+      continue;
+    }
+    for (c = 0; c < ptr_idx -> nchunks; c++) {
+      int *first = ptr_idx -> first + c*(AD_NVALUES + 1) +
+                   ((code >> 2*c*AD_CHUNKLEN) & (AD_NVALUES - 1));
+      for (k = first[0]; k < first[1]; k++) {
+        i = ptr_idx -> ids[k];
+        if (is_seed(ptr_idx, i, pos, read64) &&
+            (ncand = add_seed(i, pos, cand_ad, cand_pos, ncand)) < 0) {
+          return -1;
+        }
+      }
+    }
+    for (k = 0; k < ptr_idx -> nwild; k++) {
+      i = ptr_idx -> wild[k];
+      if (is_seed(ptr_idx, i, pos, read64) &&
+          (ncand = add_seed(i, pos, cand_ad, cand_pos, ncand)) < 0) {
+        return -1;
+      }
+    }
+  }
+  return ncand;
+}
+
+/**
+ * @brief bit-vector alignment of AD_MYERSLANES adapters to a read, one
+ *        adapter after the other
+ * @param read read sequence
+ * @param L read length
+ * @param peq match masks of every lane and base (fw_1B code)
+ * @param top highest bit of the aligned adapter part of every lane
+ * @param maxd maximum edit distance of a whole adapter part of every lane
+ * @param ptr_ed pointer to <b>Ad_edit</b>, column 0 already set
+ * @see edit_columns
+ * */
+static void columns_scalar(const uint8_t *read, int L,
+                           uint64_t peq[5][AD_MYERSLANES],
+                           const uint64_t *top, const int *maxd,
+                           Ad_edit *ptr_ed) {
+  uint64_t eq, xv, xh, ph, mh, vp, vm;
+  int j, l, d;
+  for (l = 0; l < AD_MYERSLANES; l++) {
+    vp = ptr_ed -> pv[0][l];
+    vm = 0;
+    d = ptr_ed -> dist[0][l];
+    ptr_ed -> hit[l] = false;
+    for (j = 0; j < L; j++) {
+      eq = peq[fw_1B[read[j]]][l];
+      xv = eq | vm;
+      xh = (((eq & vp) + vp) ^ vp) | eq;
+      ph = vm | ~(xh | vp);
+      mh = vp & xh;
+      d += ((ph & top[l]) != 0) - ((mh & top[l]) != 0);
+      ph <<= 1;
+      mh <<= 1;
+      vp = mh | ~(xv | ph);
+      vm = ph & xv;
+      ptr_ed -> pv[j+1][l] = vp;
+      ptr_ed -> mv[j+1][l] = vm;
+      ptr_ed -> dist[j+1][l] = d;
+      if (d <= maxd[l] && j + 1 >= MIN_NMATCHES && j + 1 < L) {
+        ptr_ed -> hit[l] = true;
+      }
+    }
+  }
+}
+
+#ifdef ADAPTERS_X86
+/**
+ * @brief columns_scalar with the AD_MYERSLANES (8) adapters in the
+ *        lanes of two AVX2 registers, whose dependency chains overlap
+ * @see columns_scalar
+ * */
+__attribute__((target("avx2")))
+static void columns_avx2(const uint8_t *read, int L,
+                         uint64_t peq[5][AD_MYERSLANES],
+                         const uint64_t *top, const int *maxd,
+                         Ad_edit *ptr_ed) {
+  __m256i ones = _mm256_set1_epi64x(-1);
+  __m256i vtop[2], vlim[2], vp[2], vm[2], d[2], hit[2];
+  __m256i eq, xv, xh, ph, mh;
+  int j, h, l, mask;
+  for (h = 0; h < 2; h++) {
+    vtop[h] = _mm256_loadu_si256((const __m256i *)(top + 4*h));
+    vlim[h] = _mm256_set_epi64x(maxd[4*h+3] + 1, maxd[4*h+2] + 1,
+                                maxd[4*h+1] + 1, maxd[4*h] + 1);
+    vp[h] = _mm256_loadu_si256((const __m256i *)(ptr_ed -> pv[0] + 4*h));
+    vm[h] = _mm256_setzero_si256();
+    d[h] = _mm256_loadu_si256((const __m256i *)(ptr_ed -> dist[0] + 4*h));
+    hit[h] = _mm256_setzero_si256();
+  }
+  for (j = 0; j < L; j++) {
+    for (h = 0; h < 2; h++) {
+      eq = _mm256_loadu_si256((const __m256i *)(peq[fw_1B[read[j]]] + 4*h));
+      xv = _mm256_or_si256(eq, vm[h]);
+      xh = _mm256_or_si256(_mm256_xor_si256(_mm256_add_epi64(
+               _mm256_and_si256(eq, vp[h]), vp[h]), vp[h]), eq);
+      ph = _mm256_or_si256(vm[h], _mm256_andnot_si256(
+               _mm256_or_si256(xh, vp[h]), ones));
+      mh = _mm256_and_si256(vp[h], xh);
+      // cmpeq is -1 where the top bit is set
+      d[h] = _mm256_sub_epi64(d[h], _mm256_cmpeq_epi64(
+                 _mm256_and_si256(ph, vtop[h]), vtop[h]));
+      d[h] = _mm256_add_epi64(d[h], _mm256_cmpeq_epi64(
+                 _mm256_and_si256(mh, vtop[h]), vtop[h]));
+      ph = _mm256_slli_epi64(ph, 1);
+      mh = _mm256_slli_epi64(mh, 1);
+      vp[h] = _mm256_or_si256(mh, _mm256_andnot_si256(
+                  _mm256_or_si256(xv, ph), ones));
+      vm[h] = _mm256_and_si256(ph, xv);
+      _mm256_storeu_si256((__m256i *)(ptr_ed -> pv[j+1] + 4*h), vp[h]);
+      _mm256_storeu_si256((__m256i *)(ptr_ed -> mv[j+1] + 4*h), vm[h]);
+      _mm256_storeu_si256((__m256i *)(ptr_ed -> dist[j+1] + 4*h), d[h]);
+      if (j + 1 >= MIN_NMATCHES && j + 1 < L) {
+        hit[h] = _mm256_or_si256(hit[h], _mm256_cmpgt_epi64(vlim[h], d[h]));
+      }
+    }
+  }
+  mask = _mm256_movemask_pd(_mm256_castsi256_pd(hit[0])) |
+         _mm256_movemask_pd(_mm256_castsi256_pd(hit[1])) << 4;
+  for (l = 0; l < AD_MYERSLANES; l++) {
+    ptr_ed -> hit[l] = (mask >> l) & 1;
+  }
+}
+
+/**
+ * @brief columns_scalar with the AD_MYERSLANES (8) adapters in the
+ *        lanes of an AVX512 register
+ * @see columns_scalar
+ * */
+__attribute__((target("avx512f")))
+static void columns_avx512(const uint8_t *read, int L,
+                           uint64_t peq[5][AD_MYERSLANES],
+                           const uint64_t *top, const int *maxd,
+                           Ad_edit *ptr_ed) {
+  __m512i one = _mm512_set1_epi64(1);
+  __m512i vtop = _mm512_loadu_si512(top);
+  __m512i vlim = _mm512_set_epi64(maxd[7], maxd[6], maxd[5], maxd[4],
+                                  maxd[3], maxd[2], maxd[1], maxd[0]);
+  __m512i vp = _mm512_loadu_si512(ptr_ed -> pv[0]);
+  __m512i vm = _mm512_setzero_si512();
+  __m512i d = _mm512_loadu_si512(ptr_ed -> dist[0]);
+  __m512i eq, xv, xh, ph, mh;
+  __mmask8 hit = 0;
+  int j, l;
+  for (j = 0; j < L; j++) {
+    eq = _mm512_loadu_si512(peq[fw_1B[read[j]]]);
+    xv = _mm512_or_si512(eq, vm);
+    xh = _mm512_or_si512(_mm512_xor_si512(_mm512_add_epi64(
+             _mm512_and_si512(eq, vp), vp), vp), eq);
+    ph = _mm512_ternarylogic_epi64(vm, xh, vp, 0xF1);  // vm | ~(xh | vp)
+    mh = _mm512_and_si512(vp, xh);
+    d = _mm512_mask_add_epi64(d, _mm512_test_epi64_mask(ph, vtop), d, one);
+    d = _mm512_mask_sub_epi64(d, _mm512_test_epi64_mask(mh, vtop), d, one);
+    ph = _mm512_slli_epi64(ph, 1);
+    mh = _mm512_slli_epi64(mh, 1);
+    vp = _mm512_ternarylogic_epi64(mh, xv, ph, 0xF1);  // mh | ~(xv | ph)
+    vm = _mm512_and_si512(ph, xv);
+    _mm512_storeu_si512(ptr_ed -> pv[j+1], vp);
+    _mm512_storeu_si512(ptr_ed -> mv[j+1], vm);
+    _mm512_storeu_si512(ptr_ed -> dist[j+1], d);
+    if (j + 1 >= MIN_NMATCHES && j + 1 < L) {
+      hit |= _mm512_cmple_epi64_mask(d, vlim);
+    }
+  }
+  for (l = 0; l < AD_MYERSLANES; l++) {
+    ptr_ed -> hit[l] = (hit >> l) & 1;
+  }
+}
+#endif
+
+/**
+ * @brief aligns up to AD_MYERSLANES adapters to a read, allowing for indels
+ * @param seq pointer to <b>Fq_read</b>
+ * @param adap_list pointer to the first <b>Ad_seq</b>
+ * @param n number of adapters (at most AD_MYERSLANES)
+ * @param maxdist maximum number of edits per AD_EDITLEN adapter bases
+ * @param ptr_ed output: pointer to <b>Ad_edit</b>
+ *
+ * The first AD_MYERSLEN bases of every adapter are aligned to the read
+ * with the bit-parallel edit distance of Myers (Hyyro's formulation),
+ * one column per read base: the adapter may start anywhere in the read
+ * and end past it. If the whole adapter is aligned, it may also start
+ * before the read. The columns of the adapters are computed together,
+ * in the lanes of an AVX512 register or of two AVX2 registers when the
+ * cpu supports it, and are traced back by edit_adapter. Adapters shorter
+ * than MIN_NMATCHES are not aligned.
+ * */
+void edit_columns(Fq_read *seq, Ad_seq *adap_list, int n, int maxdist,
+                  Ad_edit *ptr_ed) {
+  uint64_t peq[5][AD_MYERSLANES], top[AD_MYERSLANES];
+  int maxd[AD_MYERSLANES];
+  int b, l, m;
+  memset(peq, 0, sizeof(peq));
+  for (l = 0; l < AD_MYERSLANES; l++) {
+    m = (l < n) ? min(adap_list[l].L, AD_MYERSLEN) : 0;
+    if (m < MIN_NMATCHES) {
+      // empty lane: never a hit
+      top[l] = 0;
+      maxd[l] = -1;
+      ptr_ed -> pv[0][l] = 0;
+      ptr_ed -> mv[0][l] = 0;
+      ptr_ed -> dist[0][l] = 0;
+      continue;
+    }
+    for (b = 0; b < 5; b++) {
+      peq[b][l] = adap_list[l].peq[b];
+    }
+    top[l] = (uint64_t)1 << (m - 1);
+    maxd[l] = maxdist*max(m/AD_EDITLEN, 1);
+    // column 0: adapter bases before the read are free if it is whole
+    ptr_ed -> pv[0][l] = (m == adap_list[l].L) ? 0 : ~(uint64_t)0;
+    ptr_ed -> mv[0][l] = 0;
+    ptr_ed -> dist[0][l] = (m == adap_list[l].L) ? 0 : m;
+  }
+#ifdef ADAPTERS_X86
+  if (__builtin_cpu_supports("avx512f")) {
+    columns_avx512((const uint8_t *)seq -> line2, seq -> L, peq, top, maxd,
+                   ptr_ed);
+    return;
+  } else if (__builtin_cpu_supports("avx2")) {
+    columns_avx2((const uint8_t *)seq -> line2, seq -> L, peq, top, maxd,
+                 ptr_ed);
+    return;
+  }
+#endif
+  columns_scalar((const uint8_t *)seq -> line2, seq -> L, peq, top, maxd,
+                 ptr_ed);
+}
+
+/**
+ * @brief edit distance of the first i bases of an adapter to the best
+ *        read substring ending before read base j
+ * @param ptr_ed pointer to <b>Ad_edit</b>
+ * @param l lane of the adapter
+ * @param i number of adapter bases
+ * @param j column (number of read bases)
+ * @return edit distance
+ * */
+static int edit_cell(Ad_edit *ptr_ed, int l, int i, int j) {
+  uint64_t low = low_bits(i);
+  return __builtin_popcountll(ptr_ed -> pv[j][l] & low) -
+         __builtin_popcountll(ptr_ed -> mv[j][l] & low);
+}
+
+/**
+ * @brief scores an alignment found by edit_columns, tracing it back
+ * @param seq pointer to <b>Fq_read</b>
+ * @param ptr_adap pointer to <b>Ad_seq</b>
+ * @param ptr_ed pointer to <b>Ad_edit</b>
+ * @param l lane of the adapter
+ * @param i number of adapter bases aligned
+ * @param j number of read bases up to the end of the alignment
+ * @param zeroQ value of ASCII character representing zero quality
+ * @param pos output: read position where the alignment starts, -1 if it
+ *        has less than MIN_NMATCHES matching bases
+ * @return score of the alignment
+ *
+ * The score is the one of obtain_score (added up in 1/AD_SCALE units),
+ * where an inserted read base and a deleted adapter base (charged to the
+ * read base before the gap) count as mismatches. Adapter bases past the
+ * AD_MYERSLEN aligned ones are scored without gaps.
+ * */
+static double edit_score(Fq_read *seq, Ad_seq *ptr_adap, Ad_edit *ptr_ed,
+                         int l, int i, int j, int zeroQ, int *pos) {
+  int k, d, up, match;
+  int Nmatches = 0;
+  int score = 0;
+  const char *ad = ptr_adap -> seq + ptr_adap -> L - 1;  // read strand: ad[-k]
+  for (k = i; i == AD_MYERSLEN && k < ptr_adap -> L && j + k - i < seq -> L;
+       k++) {
+    if (fw_1B[(uint8_t)seq -> line2[j + k - i]] == bw_1B[(uint8_t)ad[-k]]) {
+      score += AD_LOG4;
       Nmatches++;
     } else {
-      score -= (seq->line4[pos_seq + i] - zeroQ)/10.0;
+      score -= Qpenalty[(uint8_t)(seq -> line4[j + k - i] - zeroQ)];
+    }
+  }
+  d = edit_cell(ptr_ed, l, i, j);
+  while (i > 0 && j > 0) {
+    match = (fw_1B[(uint8_t)seq -> line2[j-1]] ==
+             bw_1B[(uint8_t)ad[1-i]]);
+    if (d == (up = edit_cell(ptr_ed, l, i-1, j-1)) + !match) {
+      if (match) {
+        score += AD_LOG4;
+        Nmatches++;
+      } else {
+        score -= Qpenalty[(uint8_t)(seq -> line4[j-1] - zeroQ)];
+      }
+      j--;
+    } else if (d != (up = edit_cell(ptr_ed, l, i-1, j)) + 1) {
+      // read base not in the adapter
+      score -= Qpenalty[(uint8_t)(seq -> line4[j-1] - zeroQ)];
+      j--;
+      d--;
+      continue;
+    } else {
+      // adapter base not in the read
+      score -= Qpenalty[(uint8_t)(seq -> line4[j-1] - zeroQ)];
+    }
+    i--;
+    d = up;
+  }
+  *pos = (Nmatches < MIN_NMATCHES) ? -1 : j;
+  return (double)score/AD_SCALE;
+}
+
+/**
+ * @brief finds the best alignment of an adapter aligned by edit_columns
+ * @param seq pointer to <b>Fq_read</b>
+ * @param ptr_adap pointer to <b>Ad_seq</b>
+ * @param ptr_ed pointer to <b>Ad_edit</b>
+ * @param l lane of the adapter in ptr_ed
+ * @param maxdist maximum number of edits per AD_EDITLEN adapter bases
+ * @param minscore alignments scoring at most minscore are not wanted
+ * @param zeroQ value of ASCII character representing zero quality
+ * @param score output: score of the best alignment
+ * @return read position where the best alignment starts, -1 if none
+ *
+ * Every alignment of i adapter bases with at most
+ * maxdist*max(floor(i/AD_EDITLEN), 1) edits (as many as mismatches in
+ * every seed of align_uint64) covering at least MIN_NMATCHES read bases,
+ * either of the whole aligned adapter part or ending at the end of the
+ * read, is traced back and scored (edit_score), unless even matching all
+ * its adapter bases would not score above minscore. Ties keep the
+ * alignment starting first.
+ * */
+int edit_adapter(Fq_read *seq, Ad_seq *ptr_adap, Ad_edit *ptr_ed, int l,
+                 int maxdist, double minscore, int zeroQ, double *score) {
+  int m = min(ptr_adap -> L, AD_MYERSLEN);
+  int L = seq -> L;
+  int i, j, d, lo, hi, lim, pos, best = -1;
+  double s;
+  *score = -1.0;
+  // whole adapter part aligned, ending inside the read
+  for (j = MIN_NMATCHES; ptr_ed -> hit[l] && j < L; j++) {
+    if (ptr_ed -> dist[j][l] <= maxdist*max(m/AD_EDITLEN, 1) &&
+        LOG_4*(m + min(ptr_adap -> L - m, L - j)) > minscore) {
+      s = edit_score(seq, ptr_adap, ptr_ed, l, m, j, zeroQ, &pos);
+      if (pos >= 0 && (best < 0 || s > *score ||
+                       (s == *score && pos < best))) {
+        *score = s;
+        best = pos;
+      }
+    }
+  }
+  // adapter prefixes aligned to the end of the read, by blocks of rows
+  // with the same maximum distance; the distance drops by one at most per
+  // negative delta, which rules out most blocks
+  for (lo = MIN_NMATCHES; lo <= m; lo = hi + 1) {
+    hi = min(max(lo/AD_EDITLEN, 1)*AD_EDITLEN + AD_EDITLEN - 1, m);
+    lim = maxdist*max(lo/AD_EDITLEN, 1);
+    d = edit_cell(ptr_ed, l, lo, L);
+    if (d - __builtin_popcountll(ptr_ed -> mv[L][l] & low_bits(hi) &
+                                 ~low_bits(lo)) > lim) {
+      continue;
+    }
+    for (i = lo; i <= hi; i++) {
+      if (i > lo) {
+        d += ((ptr_ed -> pv[L][l] >> (i-1)) & 1) -
+             ((ptr_ed -> mv[L][l] >> (i-1)) & 1);
+      }
+      if (d > lim || LOG_4*i <= minscore) continue;
+      s = edit_score(seq, ptr_adap, ptr_ed, l, i, L, zeroQ, &pos);
+      if (pos >= 0 && (best < 0 || s > *score ||
+                       (s == *score && pos < best))) {
+        *score = s;
+        best = pos;
+      }
     }
   }
-  return ((Nmatches < MIN_NMATCHES) ? -1.0 : score);
+  return best;
 }
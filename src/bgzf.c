@@ -0,0 +1,345 @@
+/****************************************************************************
+ * Copyright (C) 2017 by Paula Perez Rubio                                  *
+ *                                                                          *
+ * This file is part of FastqPuri.                                      *
+ *                                                                          *
+ *   FastqPuri is free software: you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as                *
+ *   published by the Free Software Foundation, either version 3 of the     *
+ *   License, or (at your option) any later version.                        *
+ *                                                                          *
+ *   FastqPuri is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *   GNU General Public License for more details.                           *
+ *                                                                          *
+ *   You should have received a copy of the GNU General Public License      *
+ *   along with FastqPuri.                                              *
+ *   If not, see <http://www.gnu.org/licenses/>.                            *
+ ****************************************************************************/
+
+
+
+/**
+ * @file bgzf.c
+ * @brief BGZF (blocked gzip) writer, blocks compressed in parallel by a
+ *        pool of threads shared by all the outputs.
+ * @author Paula Perez <paulaperezrubio@gmail.com>
+ * @date 17.10.2026
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bgzf.h"
+#include "defines.h"
+
+#ifdef HAVE_ZLIB
+
+/**
+ * @brief gzip header of a BGZF block, BSIZE (bytes 16, 17) to be filled
+ * */
+static const unsigned char bgzf_header[BGZF_HEADER] = {
+  0x1f, 0x8b, 0x08, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff,
+  0x06, 0x00, 'B', 'C', 0x02, 0x00, 0x00, 0x00};
+
+/**
+ * @brief empty BGZF block marking the end of the file
+ * */
+static const unsigned char bgzf_eof[BGZF_HEADER + 10] = {
+  0x1f, 0x8b, 0x08, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff,
+  0x06, 0x00, 'B', 'C', 0x02, 0x00, 0x1b, 0x00, 0x03, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
+
+/**
+ * @brief initializes a raw deflate stream (no zlib/gzip wrapper)
+ * */
+static void init_zstream(z_stream *zs) {
+  memset(zs, 0, sizeof(z_stream));
+  if (deflateInit2(zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -15, 8,
+                   Z_DEFAULT_STRATEGY) != Z_OK) {
+    fprintf(stderr, "Could not initialize the deflate stream.\n");
+    fprintf(stderr, "File: %s, line: %d\n", __FILE__, __LINE__);
+    fprintf(stderr, "Exiting program.\n");
+    exit(EXIT_FAILURE);
+  }
+}
+
+/**
+ * @brief compresses b -> in into a complete BGZF block in b -> out
+ *
+ * BGZF_BLOCK chars always fit in BGZF_MAX_BLOCK after compression, even
+ * if they are incompressible (see deflateBound).
+ * */
+static void compress_block(Bgzf_block *b, z_stream *zs) {
+  if (b -> out == NULL) {
+    b -> out = malloc(BGZF_MAX_BLOCK);
+    if (b -> out == NULL) {
+      fprintf(stderr, "Could not allocate memory for a BGZF block.\n");
+      fprintf(stderr, "File: %s, line: %d\n", __FILE__, __LINE__);
+      fprintf(stderr, "Exiting program.\n");
+      exit(EXIT_FAILURE);
+    }
+  }
+  unsigned char *out = b -> out;
+  memcpy(out, bgzf_header, BGZF_HEADER);
+  deflateReset(zs);
+  zs -> next_in = (unsigned char *)b -> in;
+  zs -> avail_in = b -> len;
+  zs -> next_out = out + BGZF_HEADER;
+  zs -> avail_out = BGZF_MAX_BLOCK - BGZF_HEADER - BGZF_FOOTER;
+  if (deflate(zs, Z_FINISH) != Z_STREAM_END) {
+    fprintf(stderr, "Could not compress a BGZF block.\n");
+    fprintf(stderr, "File: %s, line: %d\n", __FILE__, __LINE__);
+    fprintf(stderr, "Exiting program.\n");
+    exit(EXIT_FAILURE);
+  }
+  int size = BGZF_HEADER + zs -> total_out + BGZF_FOOTER;
+  uint32_t crc = crc32(crc32(0L, NULL, 0), (unsigned char *)b -> in,
+                       b -> len);
+  out[16] = (size - 1) & 0xff;
+  out[17] = (size - 1) >> 8;
+  int i;
+  for (i = 0; i < 4; i++) {
+    out[size - 8 + i] = (crc >> (8*i)) & 0xff;
+    out[size - 4 + i] = ((uint32_t)b -> len >> (8*i)) & 0xff;
+  }
+  b -> size = size;
+}
+
+/**
+ * @brief worker thread: compresses a block
+ * */
+static void work_bgzf(void *ptr_block, void *ptr_zs) {
+  compress_block((Bgzf_block *)ptr_block, (z_stream *)ptr_zs);
+}
+
+/**
+ * @brief writes a compressed block to f
+ * */
+static void write_block(Bgzf_block *b, FILE *f) {
+  if ((int)fwrite(b -> out, 1, b -> size, f) != b -> size) {
+    perror("Could not write a BGZF block");
+    fprintf(stderr, "File: %s, line: %d\n", __FILE__, __LINE__);
+    fprintf(stderr, "Exiting program.\n");
+    exit(EXIT_FAILURE);
+  }
+}
+
+/**
+ * @brief writer thread: writes a compressed block to the output file of
+ *        its writer and signals it
+ * */
+static void write_bgzf(void *ptr_block, void *ptr_pool) {
+  Bgzf_block *b = (Bgzf_block *)ptr_block;
+  Bgzf_pool *pool = (Bgzf_pool *)ptr_pool;
+  write_block(b, b -> owner -> f);
+  pthread_mutex_lock(&(pool -> lock));
+  b -> owner -> nwritten++;
+  pthread_cond_broadcast(&(pool -> written));
+  pthread_mutex_unlock(&(pool -> lock));
+}
+
+/**
+ * @brief initializes a pool of threads compressing BGZF blocks
+ * @param nthreads number of threads compressing blocks
+ * @return pointer to the pool, to be shared by the writers (init_Bgzf)
+ *
+ * No thread is started until a block is full.
+ * */
+Bgzf_pool *init_Bgzf_pool(int nthreads) {
+  int i;
+  Bgzf_pool *pool = calloc(1, sizeof(Bgzf_pool));
+  if (pool == NULL) {
+    fprintf(stderr, "Could not allocate memory for the BGZF threads.\n");
+    fprintf(stderr, "File: %s, line: %d\n", __FILE__, __LINE__);
+    fprintf(stderr, "Exiting program.\n");
+    exit(EXIT_FAILURE);
+  }
+  pool -> nthreads = max(nthreads, 1);
+  pool -> nslots = NBATCH_THREAD*(pool -> nthreads);
+  pool -> blocks = calloc(pool -> nslots, sizeof(Bgzf_block));
+  pool -> slot = malloc(pool -> nslots*sizeof(void *));
+  pool -> zs = malloc(pool -> nthreads*sizeof(z_stream));
+  pool -> worker_arg = malloc(pool -> nthreads*sizeof(void *));
+  if (pool -> blocks == NULL || pool -> slot == NULL || pool -> zs == NULL ||
+      pool -> worker_arg == NULL) {
+    fprintf(stderr, "Could not allocate memory for the BGZF threads.\n");
+    fprintf(stderr, "File: %s, line: %d\n", __FILE__, __LINE__);
+    fprintf(stderr, "Exiting program.\n");
+    exit(EXIT_FAILURE);
+  }
+  for (i = 0; i < pool -> nslots; i++) {
+    pool -> slot[i] = pool -> blocks + i;
+  }
+  for (i = 0; i < pool -> nthreads; i++) {
+    pool -> worker_arg[i] = pool -> zs + i;
+  }
+  pthread_mutex_init(&(pool -> push_lock), NULL);
+  pthread_mutex_init(&(pool -> lock), NULL);
+  pthread_cond_init(&(pool -> written), NULL);
+  return pool;
+}
+
+/**
+ * @brief stops the pipeline of a pool, if running, and frees the blocks
+ *
+ * Every block handed over is written before the threads are joined.
+ * */
+static void stop_pool(Bgzf_pool *pool) {
+  int i;
+  if (pool -> ptr_pl == NULL) return;
+  free_pipeline(pool -> ptr_pl);
+  pool -> ptr_pl = NULL;
+  for (i = 0; i < pool -> nthreads; i++) {
+    deflateEnd(pool -> zs + i);
+  }
+  for (i = 0; i < pool -> nslots; i++) {
+    free(pool -> blocks[i].in);
+    free(pool -> blocks[i].out);
+    pool -> blocks[i].in = NULL;
+    pool -> blocks[i].out = NULL;
+  }
+}
+
+/**
+ * @brief frees a pool, whose writers have all been closed (free_Bgzf)
+ * */
+void free_Bgzf_pool(Bgzf_pool *pool) {
+  stop_pool(pool);
+  pthread_mutex_destroy(&(pool -> push_lock));
+  pthread_mutex_destroy(&(pool -> lock));
+  pthread_cond_destroy(&(pool -> written));
+  free(pool -> blocks);
+  free(pool -> slot);
+  free(pool -> zs);
+  free(pool -> worker_arg);
+  free(pool);
+}
+
+/**
+ * @brief hands the pending block over to the pool (whose pipeline is
+ *        started here if it is not running) and takes an empty buffer in
+ *        exchange
+ * */
+static void push_block(Bgzf *ptr_bz) {
+  int i;
+  Bgzf_pool *pool = ptr_bz -> pool;
+  pthread_mutex_lock(&(pool -> push_lock));
+  if (pool -> ptr_pl == NULL) {
+    for (i = 0; i < pool -> nthreads; i++) {
+      init_zstream(pool -> zs + i);
+    }
+    pool -> ptr_pl = init_pipeline(pool -> nthreads, pool -> slot,
+                                   pool -> nslots, work_bgzf,
+                                   pool -> worker_arg, write_bgzf, pool);
+  }
+  Bgzf_block *b = pipeline_next(pool -> ptr_pl);
+  char *in = b -> in;
+  b -> in = ptr_bz -> pend;
+  b -> len = ptr_bz -> npend;
+  b -> owner = ptr_bz;
+  ptr_bz -> npushed++;
+  pipeline_push(pool -> ptr_pl);
+  pthread_mutex_unlock(&(pool -> push_lock));
+  ptr_bz -> pend = (in != NULL) ? in : malloc(BGZF_BLOCK);
+  ptr_bz -> npend = 0;
+  if (ptr_bz -> pend == NULL) {
+    fprintf(stderr, "Could not allocate memory for a BGZF block.\n");
+    fprintf(stderr, "File: %s, line: %d\n", __FILE__, __LINE__);
+    fprintf(stderr, "Exiting program.\n");
+    exit(EXIT_FAILURE);
+  }
+}
+
+/**
+ * @brief initializes a BGZF writer
+ * @param f output file, opened for writing
+ * @param pool pool of threads compressing the blocks (init_Bgzf_pool)
+ * @return pointer to the writer
+ *
+ * */
+Bgzf *init_Bgzf(FILE *f, Bgzf_pool *pool) {
+  Bgzf *ptr_bz = calloc(1, sizeof(Bgzf));
+  if (ptr_bz == NULL || (ptr_bz -> pend = malloc(BGZF_BLOCK)) == NULL) {
+    fprintf(stderr, "Could not allocate memory for the BGZF writer.\n");
+    fprintf(stderr, "File: %s, line: %d\n", __FILE__, __LINE__);
+    fprintf(stderr, "Exiting program.\n");
+    exit(EXIT_FAILURE);
+  }
+  ptr_bz -> f = f;
+  ptr_bz -> pool = pool;
+  pthread_mutex_lock(&(pool -> lock));
+  pool -> nopen++;
+  pthread_mutex_unlock(&(pool -> lock));
+  return ptr_bz;
+}
+
+/**
+ * @brief appends len chars of str to the BGZF output
+ * */
+void bgzf_write(Bgzf *ptr_bz, const char *str, int len) {
+  while (len > 0) {
+    int n = min(len, BGZF_BLOCK - ptr_bz -> npend);
+    memcpy(ptr_bz -> pend + ptr_bz -> npend, str, n);
+    ptr_bz -> npend += n;
+    str += n;
+    len -= n;
+    if (ptr_bz -> npend == BGZF_BLOCK) push_block(ptr_bz);
+  }
+}
+
+/**
+ * @brief writes the last block and the end-of-file marker, closes the
+ *        output file and frees the writer
+ * @return 0 (failing to write or close the file exits the program)
+ *
+ * The pipeline of the pool is stopped when its last writer is closed.
+ * */
+int free_Bgzf(Bgzf *ptr_bz) {
+  Bgzf_pool *pool = ptr_bz -> pool;
+  if (ptr_bz -> npushed > 0) {
+    if (ptr_bz -> npend > 0) push_block(ptr_bz);
+    pthread_mutex_lock(&(pool -> lock));
+    while (ptr_bz -> nwritten < ptr_bz -> npushed) {
+      pthread_cond_wait(&(pool -> written), &(pool -> lock));
+    }
+    pthread_mutex_unlock(&(pool -> lock));
+  } else if (ptr_bz -> npend > 0) {
+    // small output, compressed in the calling thread
+    z_stream zs;
+    Bgzf_block b = {ptr_bz -> pend, ptr_bz -> npend, NULL, 0, ptr_bz};
+    init_zstream(&zs);
+    compress_block(&b, &zs);
+    deflateEnd(&zs);
+    write_block(&b, ptr_bz -> f);
+    free(b.out);
+  }
+  if (fwrite(bgzf_eof, 1, sizeof(bgzf_eof), ptr_bz -> f)
+      != sizeof(bgzf_eof)) {
+    perror("Could not write the BGZF end-of-file block");
+    fprintf(stderr, "File: %s, line: %d\n", __FILE__, __LINE__);
+    fprintf(stderr, "Exiting program.\n");
+    exit(EXIT_FAILURE);
+  }
+  if (fclose(ptr_bz -> f) != 0) {
+    perror("Could not close a BGZF output file");
+    fprintf(stderr, "File: %s, line: %d\n", __FILE__, __LINE__);
+    fprintf(stderr, "Exiting program.\n");
+    exit(EXIT_FAILURE);
+  }
+  pthread_mutex_lock(&(pool -> lock));
+  bool last = (--(pool -> nopen) == 0);
+  pthread_mutex_unlock(&(pool -> lock));
+  if (last) {
+    pthread_mutex_lock(&(pool -> push_lock));
+    stop_pool(pool);
+    pthread_mutex_unlock(&(pool -> push_lock));
+  }
+  free(ptr_bz -> pend);
+  free(ptr_bz);
+  return 0;
+}
+
+#endif  // endif HAVE_ZLIB
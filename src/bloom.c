@@ -27,8 +27,11 @@
  */
 
 #include "bloom.h"
+#include "mmap_gen.h"
+#include "pipeline.h"
 #include <string.h>
 #include <stdio.h>
+#include <stdlib.h>
 
 /**
 * @brief Global variables (lookup table)
@@ -36,6 +39,7 @@
 * */
 static uint8_t fw0[256], fw1[256], fw2[256], fw3[256];
 static uint8_t bw0[256], bw1[256], bw2[256], bw3[256];
+static uint8_t nt2b[256];
 
 /**
  * @brief bitMask, ith bit set to 1 in position i
@@ -62,6 +66,9 @@ extern uint64_t alloc_mem; /**< allocated memory */
  * With these variables, we will be able to encode a Sequence
  * using 2 bits per nucleotide.
  *
+ * nt2b maps 'a', 'c', 'g', 't' (and capitals) to 0, 1, 2, 3 and all other
+ * characters to 0xFF. It is used to roll kmers in (see roll_kmer).
+ *
  *  */
 void init_LUTs() {
   memset(fw0, 0xFF, 256);
@@ -90,30 +97,41 @@ void init_LUTs() {
   bw2['A'] = 0x0C; bw2['C'] = 0x08; bw2['G'] = 0x04; bw2['T'] = 0x00;
   bw3['a'] = 0x03; bw3['c'] = 0x02; bw3['g'] = 0x01; bw3['t'] = 0x00;
   bw3['A'] = 0x03; bw3['C'] = 0x02; bw3['G'] = 0x01; bw3['T'] = 0x00;
+
+  memset(nt2b, 0xFF, 256);
+  nt2b['a'] = 0x00; nt2b['c'] = 0x01; nt2b['g'] = 0x02; nt2b['t'] = 0x03;
+  nt2b['A'] = 0x00; nt2b['C'] = 0x01; nt2b['G'] = 0x02; nt2b['T'] = 0x03;
 }
 
 /**
- * @brief initialization of a Bfilter structure
- * @param kmersize number of elements of the kmer
- * @param bfsizeBits size of the bloomfilter (in Bits)
- * @param hashNum number of hash functions to be computed
- * @param falsePosRate false positive rate
- * @param nelem number of elemens (kmers in the sequece) contained in the filter
- * @return pointer to initialized Bfilter structure
- *
- * Given a kmersize, bfsizeBits, number of hash functions, we
- * assign these values to the struture and the two additional values:
- * kmersizeBytes = (kmersize + BASESINCHAR - 1 )/BASESINCHAR
+ * @brief Bfilter structure with its parameters set and no filter (NULL)
  *
+ * Checks the parameters and assigns them, see init_Bfilter.
  * */
-Bfilter *init_Bfilter(int kmersize, uint64_t bfsizeBits, int hashNum,
-                      double falsePosRate, uint64_t nelem) {
+static Bfilter *new_Bfilter(int kmersize, uint64_t bfsizeBits, int hashNum,
+                      double falsePosRate, uint64_t nelem, int blocked,
+                      int version) {
   if (bfsizeBits % BITSPERCHAR != 0) {
      fprintf(stderr, "Bloom filter size (bits) has to be a multiple of 8.\n");
      fprintf(stderr, "Exiting program.\n");
      fprintf(stderr, "File: %s, line: %d\n", __FILE__, __LINE__);
      exit(EXIT_FAILURE);
   }
+  if (blocked && (bfsizeBits % BF_BLOCK_BITS != 0 || bfsizeBits == 0)) {
+     fprintf(stderr, "Blocked bloom filter size (bits) has to be a ");
+     fprintf(stderr, "positive multiple of %d.\n", BF_BLOCK_BITS);
+     fprintf(stderr, "Exiting program.\n");
+     fprintf(stderr, "File: %s, line: %d\n", __FILE__, __LINE__);
+     exit(EXIT_FAILURE);
+  }
+  if (version != BF_VERSION_CITY && ((version != BF_VERSION_ROLL &&
+      version != BF_VERSION_MINI) || kmersize > BF_ROLL_MAXK)) {
+     fprintf(stderr, "Bloom filter version %d not supported for ", version);
+     fprintf(stderr, "kmersize = %d.\n", kmersize);
+     fprintf(stderr, "Exiting program.\n");
+     fprintf(stderr, "File: %s, line: %d\n", __FILE__, __LINE__);
+     exit(EXIT_FAILURE);
+  }
   Bfilter *ptr_bf = malloc(sizeof(Bfilter));
   alloc_mem += sizeof(Bfilter);
   ptr_bf -> kmersize = kmersize;
@@ -123,10 +141,33 @@ Bfilter *init_Bfilter(int kmersize, uint64_t bfsizeBits, int hashNum,
   ptr_bf -> bfsizeBits = bfsizeBits;
   ptr_bf -> bfsizeBytes = bfsizeBits/BITSPERCHAR;
   ptr_bf -> nelem = nelem;
+  ptr_bf -> blocked = blocked;
+  ptr_bf -> nblocks = blocked ? bfsizeBits / BF_BLOCK_BITS : 0;
+  ptr_bf -> version = version;
+  ptr_bf -> window = 1;
+  ptr_bf -> nhashValues = (blocked || version != BF_VERSION_CITY) ?
+                          BF_BLOCK_NHASH : hashNum;
+  ptr_bf -> mapsize = 0;
+  ptr_bf -> filter = NULL;
+  return ptr_bf;
+}
+
+/**
+ * @brief allocates the filter of a Bfilter structure and sets it to 0
+ * */
+static void alloc_filter(Bfilter *ptr_bf) {
   fprintf(stderr, "Allocating %" PRIu64 " bytes of memory to 0.\n",
           ptr_bf -> bfsizeBytes);
-  ptr_bf -> filter = (unsigned char *) calloc(ptr_bf ->  bfsizeBytes,
-                                           sizeof(unsigned char));
+  if (ptr_bf -> blocked) {
+    ptr_bf -> filter = (unsigned char *) aligned_alloc(BF_BLOCK_BYTES,
+                                                       ptr_bf -> bfsizeBytes);
+    if (ptr_bf -> filter != NULL) {
+      memset(ptr_bf -> filter, 0, ptr_bf -> bfsizeBytes);
+    }
+  } else {
+    ptr_bf -> filter = (unsigned char *) calloc(ptr_bf ->  bfsizeBytes,
+                                             sizeof(unsigned char));
+  }
   if (ptr_bf -> filter == NULL) {
      fprintf(stderr, "Error when allocating memory for the bloom filter.\n");
      fprintf(stderr, "Exiting program.\n");
@@ -134,15 +175,53 @@ Bfilter *init_Bfilter(int kmersize, uint64_t bfsizeBits, int hashNum,
      exit(EXIT_FAILURE);
   }
   alloc_mem += ptr_bf -> bfsizeBytes * sizeof(unsigned char);
+}
+
+/**
+ * @brief initialization of a Bfilter structure
+ * @param kmersize number of elements of the kmer
+ * @param bfsizeBits size of the bloomfilter (in Bits)
+ * @param hashNum number of hash functions to be computed
+ * @param falsePosRate false positive rate
+ * @param nelem number of elemens (kmers in the sequece) contained in the filter
+ * @param blocked 1 for a blocked filter, 0 otherwise
+ * @param version BF_VERSION_CITY or BF_VERSION_ROLL
+ * @return pointer to initialized Bfilter structure
+ *
+ * Given a kmersize, bfsizeBits, number of hash functions, we
+ * assign these values to the struture and the two additional values:
+ * kmersizeBytes = (kmersize + BASESINCHAR - 1 )/BASESINCHAR
+ *
+ * A blocked filter is split in blocks of BF_BLOCK_BITS bits (one cache
+ * line) and is allocated aligned to BF_BLOCK_BYTES, so that every kmer
+ * touches a single cache line. Its size has to be a multiple of
+ * BF_BLOCK_BITS.
+ *
+ * Version BF_VERSION_ROLL filters (kmersize <= BF_ROLL_MAXK) derive all
+ * bit positions from 2 hash values, BF_VERSION_CITY filters from hashNum
+ * (or BF_BLOCK_NHASH if blocked) CityHash64 values.
+ *
+ * */
+Bfilter *init_Bfilter(int kmersize, uint64_t bfsizeBits, int hashNum,
+                      double falsePosRate, uint64_t nelem, int blocked,
+                      int version) {
+  Bfilter *ptr_bf = new_Bfilter(kmersize, bfsizeBits, hashNum, falsePosRate,
+                                nelem, blocked, version);
+  alloc_filter(ptr_bf);
   return ptr_bf;
 }
 
 /**
- * @brief free Bfilter memory
+ * @brief free Bfilter memory (or unmap the filter if it was mapped)
  * */
 void free_Bfilter(Bfilter * ptr_bf) {
-  free(ptr_bf -> filter);
-  alloc_mem -= ptr_bf -> bfsizeBytes;
+  if (ptr_bf -> mapsize) {
+    munmap_gen(ptr_bf -> filter, ptr_bf -> mapsize);
+    ptr_bf -> mapsize = 0;
+  } else {
+    free(ptr_bf -> filter);
+    alloc_mem -= ptr_bf -> bfsizeBytes;
+  }
 }
 
 
@@ -154,7 +233,9 @@ void free_Bfilter(Bfilter * ptr_bf) {
  * @return pointer to a Bfkmer structure
  *
  *  kmersizeBytes, halfsizeBytes, hangingBases, hasOverhead hashNum are assigned
- *  and memory is allocated and set to 0 for compact and hashValues
+ *  and memory is allocated and set to 0 for compact and hashValues. The
+ *  rolling kmer (fw, rc, nvalid) is reset, and minimizers are not used
+ *  (window = 1, see set_window).
  * */
 Bfkmer *init_Bfkmer(int kmersize, int hashNum) {
   Bfkmer *ptr_bfkmer = malloc(sizeof(Bfkmer));
@@ -164,6 +245,17 @@ Bfkmer *init_Bfkmer(int kmersize, int hashNum) {
   ptr_bfkmer -> hangingBases = 0;
   ptr_bfkmer -> hasOverhead = 0;
   ptr_bfkmer -> hashNum = hashNum;
+  ptr_bfkmer -> fw = 0;
+  ptr_bfkmer -> rc = 0;
+  ptr_bfkmer -> kmask = (kmersize >= BF_ROLL_MAXK) ? ~(uint64_t)0 :
+                        ((uint64_t)1 << (2*kmersize)) - 1;
+  ptr_bfkmer -> nvalid = 0;
+  ptr_bfkmer -> window = 1;
+  ptr_bfkmer -> nrun = 0;
+  ptr_bfkmer -> imin = -1;
+  ptr_bfkmer -> iout = -1;
+  ptr_bfkmer -> order = NULL;
+  ptr_bfkmer -> canon = NULL;
   if (kmersize % BITSPERCHAR != 0) {
       ptr_bfkmer -> halfsizeBytes++;
       if ((ptr_bfkmer -> hangingBases = kmersize % 4) > 0) {
@@ -183,8 +275,10 @@ Bfkmer *init_Bfkmer(int kmersize, int hashNum) {
 void free_Bfkmer(Bfkmer *ptr_bfkmer) {
   free(ptr_bfkmer->compact);
   free(ptr_bfkmer->hashValues);
-  alloc_mem -= ptr_bfkmer -> kmersizeBytes * sizeof(unsigned char);
-  alloc_mem -= ptr_bfkmer -> hashNum * sizeof(uint64_t);
+  set_window(ptr_bfkmer, 1);
+  __sync_fetch_and_sub(&alloc_mem, ptr_bfkmer -> kmersizeBytes *
+                       sizeof(unsigned char) +
+                       ptr_bfkmer -> hashNum * sizeof(uint64_t));
 }
 
 /**
@@ -219,7 +313,8 @@ void free_Bfkmer(Bfkmer *ptr_bfkmer) {
  *   @endcode
  *  (In this case, we would store m_bw)
  *
- *
+ * m_fw and m_bw are freed before returning, and are not counted in
+ * alloc_mem: compact_kmer runs in the threads of trimFilter.
  * */
 int compact_kmer(const unsigned char *sequence, uint64_t position,
                        Bfkmer *ptr_bfkmer) {
@@ -240,7 +335,6 @@ int compact_kmer(const unsigned char *sequence, uint64_t position,
     fprintf(stderr, "File: %s, line: %d\n", __FILE__, __LINE__);
     exit(EXIT_FAILURE);
   }
-  alloc_mem += 2* (ptr_bfkmer -> kmersizeBytes)*sizeof(unsigned char);
   int idx;  // indexes the compactified
   uint64_t b = position;  // position in sequence
   uint64_t revb = position +
@@ -253,7 +347,6 @@ int compact_kmer(const unsigned char *sequence, uint64_t position,
     if ((m_fw[idx] == 0xFF) || (fw3[sequence[b]] == 0xFF)) {
       // discards kmers with N's
       free(m_fw); free(m_bw);
-      alloc_mem -= 2* (ptr_bfkmer -> kmersizeBytes)*sizeof(unsigned char);
       return 0;
     }
     m_fw[idx] |= fw3[sequence[b++]];
@@ -265,7 +358,6 @@ int compact_kmer(const unsigned char *sequence, uint64_t position,
     if ((m_bw[idx] == 0xFF) || (bw3[sequence[revb]] == 0xFF)) {
       // discards kmers with N's
       free(m_fw); free(m_bw);
-      alloc_mem -= 2* (ptr_bfkmer -> kmersizeBytes)*sizeof(unsigned char);
       return 0;
     }
     m_bw[idx] |= bw3[sequence[revb--]];
@@ -273,7 +365,6 @@ int compact_kmer(const unsigned char *sequence, uint64_t position,
     // Check which one is lexicographically smaller
     if (m_fw[idx] < m_bw[idx]) {  // go on with forward
        free(m_bw);
-       alloc_mem -= (ptr_bfkmer -> kmersizeBytes)*sizeof(unsigned char);
        for (++idx; idx < (ptr_bfkmer->kmersizeBytes-ptr_bfkmer->hasOverhead);
             idx++) {
          m_fw[idx] |= fw0[sequence[b++]];
@@ -282,7 +373,6 @@ int compact_kmer(const unsigned char *sequence, uint64_t position,
          if ((m_fw[idx] == 0xFF) || (fw3[sequence[b]] == 0xFF)) {
              // discards kmers with N's
              free(m_fw);
-             alloc_mem -= (ptr_bfkmer->kmersizeBytes)*sizeof(unsigned char);
              return 0;
          }
          m_fw[idx] |= fw3[sequence[b++]];
@@ -302,7 +392,6 @@ int compact_kmer(const unsigned char *sequence, uint64_t position,
              m_fw[idx] |= fw2[sequence[b++]];
              break;
            default:
-             alloc_mem -= (ptr_bfkmer -> kmersizeBytes)*sizeof(unsigned char);
              free(m_fw);
              fprintf(stderr, "hangingBases = %d \n", ptr_bfkmer->hangingBases);
              fprintf(stderr, "hangingBases can only be: 0,1,2,3.\n");
@@ -313,18 +402,15 @@ int compact_kmer(const unsigned char *sequence, uint64_t position,
          }
          if (m_fw[idx] == 0xFF) {
                // discards kmers with N's
-               alloc_mem -= (ptr_bfkmer -> kmersizeBytes)*sizeof(unsigned char);
                free(m_fw);
                return 0;
          }
        }  // endif (ptr_bfkmer -> hasOverhead)
        memcpy(ptr_bfkmer -> compact, m_fw, ptr_bfkmer->kmersizeBytes);
        free(m_fw);
-       alloc_mem -= (ptr_bfkmer -> kmersizeBytes)*sizeof(unsigned char);
        return 1;
     } else if (m_fw[idx] > m_bw[idx]) {  // go on with backward
        free(m_fw);
-       alloc_mem -= (ptr_bfkmer -> kmersizeBytes)*sizeof(unsigned char);
        for (++idx; idx < (ptr_bfkmer->kmersizeBytes-ptr_bfkmer -> hasOverhead);
             idx++) {
          m_bw[idx] |= bw0[sequence[revb--]];
@@ -333,7 +419,6 @@ int compact_kmer(const unsigned char *sequence, uint64_t position,
          if ((m_bw[idx] == 0xFF) || (bw3[sequence[revb]] == 0xFF)) {
              // discards kmers with N's
              free(m_bw);
-             alloc_mem -= (ptr_bfkmer -> kmersizeBytes)*sizeof(unsigned char);
              return 0;
          }
          m_bw[idx] |= bw3[sequence[revb--]];
@@ -353,7 +438,6 @@ int compact_kmer(const unsigned char *sequence, uint64_t position,
              m_bw[idx] |= bw2[sequence[revb--]];
              break;
            default:
-             alloc_mem -= (ptr_bfkmer -> kmersizeBytes)*sizeof(unsigned char);
              free(m_bw);
              fprintf(stderr, "hangingBases = %d \n", ptr_bfkmer->hangingBases);
              fprintf(stderr, "hangingBases can only be: 0,1,2,3.\n");
@@ -365,19 +449,16 @@ int compact_kmer(const unsigned char *sequence, uint64_t position,
          if (m_bw[idx] == 0xFF) {
            // discards kmers with N's
            free(m_bw);
-           alloc_mem -= (ptr_bfkmer -> kmersizeBytes)*sizeof(unsigned char);
            return 0;
          }
        }  // endif ptr_bfkmer -> has Overhead
        memcpy(ptr_bfkmer -> compact, m_bw, ptr_bfkmer->kmersizeBytes);
        free(m_bw);
-       alloc_mem -= (ptr_bfkmer -> kmersizeBytes)*sizeof(unsigned char);
        return 2;
     }
   }  // end for idx
   // If it is a palindrome go on with forward
   free(m_bw);
-  alloc_mem -= (ptr_bfkmer -> kmersizeBytes)*sizeof(unsigned char);
   for (++idx; idx < (ptr_bfkmer -> kmersizeBytes - ptr_bfkmer -> hasOverhead);
        idx++) {
     m_fw[idx] |= fw0[sequence[b++]];
@@ -386,7 +467,6 @@ int compact_kmer(const unsigned char *sequence, uint64_t position,
     if ((m_fw[idx] == 0xFF) || (fw3[sequence[b]] == 0xFF)) {
         // discards kmers with N's
         free(m_fw); free(m_bw);
-        alloc_mem -= 2 * (ptr_bfkmer -> kmersizeBytes)*sizeof(unsigned char);
         return 0;
     }
     m_fw[idx] |= fw3[sequence[b++]];
@@ -417,13 +497,11 @@ int compact_kmer(const unsigned char *sequence, uint64_t position,
     if (m_fw[idx] == 0xFF) {
       // discards kmers with N's
       free(m_fw);
-      alloc_mem -= (ptr_bfkmer -> kmersizeBytes)*sizeof(unsigned char);
       return 0;
     }
   }  // end for idx
   memcpy(ptr_bfkmer -> compact, m_fw, ptr_bfkmer->kmersizeBytes);
   free(m_fw);
-  alloc_mem -= (ptr_bfkmer -> kmersizeBytes)*sizeof(unsigned char);
   return 3;
 }
 
@@ -441,6 +519,217 @@ void multiHash(Bfkmer* ptr_bfkmer) {
   }
 }
 
+/**
+ * @brief rolls a base into the kmer (forward and reverse complement)
+ * @param ptr_bfkmer initialized Bfkmer, kmersize <= BF_ROLL_MAXK
+ * @param base next nucleotide of the sequence
+ * @return 1 if the last kmersize bases form a valid kmer, 0 otherwise
+ *
+ * The forward kmer is shifted 2 bits to the left and the base code is
+ * appended; the complement code enters the reverse complement from the
+ * left. Both updates are O(1). A base other than A, C, G, T resets the
+ * kmer, so that kmers with N's are discarded. Set nvalid to 0 before
+ * rolling in a new sequence.
+ *
+ * */
+int roll_kmer(Bfkmer *ptr_bfkmer, unsigned char base) {
+  uint64_t c = nt2b[base];
+  if (c == 0xFF) {
+     ptr_bfkmer -> nvalid = 0;
+     return 0;
+  }
+  ptr_bfkmer -> fw = ((ptr_bfkmer -> fw << 2) | c) & ptr_bfkmer -> kmask;
+  ptr_bfkmer -> rc = (ptr_bfkmer -> rc >> 2) |
+                     ((3 - c) << (2*(ptr_bfkmer -> kmersize - 1)));
+  return (++(ptr_bfkmer -> nvalid) >= ptr_bfkmer -> kmersize);
+}
+
+/**
+ * @brief 64 bit mixing function (finalizer of splitmix64)
+ * */
+static uint64_t mix64(uint64_t x) {
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+  return x ^ (x >> 31);
+}
+
+/**
+ * @brief obtains the 2 hash values of a canonical kmer
+ * */
+static void hash_canon(Bfkmer *ptr_bfkmer, uint64_t canon) {
+  ptr_bfkmer -> hashValues[0] = mix64(canon);
+  ptr_bfkmer -> hashValues[1] = mix64(canon ^ 0x9e3779b97f4a7c15ULL);
+}
+
+/**
+ * @brief obtains the 2 hash values of a rolled kmer
+ *
+ * The canonical kmer (the smaller of fw and rc) is mixed into
+ * hashValues[0] and hashValues[1]. The hashNum bit positions are derived
+ * from them by double hashing (see insert_and_fetch).
+ * */
+void rollHash(Bfkmer* ptr_bfkmer) {
+  uint64_t canon = (ptr_bfkmer -> fw < ptr_bfkmer -> rc) ? ptr_bfkmer -> fw :
+                                                           ptr_bfkmer -> rc;
+  hash_canon(ptr_bfkmer, canon);
+}
+
+/**
+ * @brief sets the minimizer window of a Bfkmer
+ * @param ptr_bfkmer initialized Bfkmer
+ * @param window number of consecutive kmers a minimizer is chosen from,
+ *        in [1, BF_MAX_WINDOW]. 1 frees the window (all kmers are used).
+ * */
+void set_window(Bfkmer *ptr_bfkmer, int window) {
+  if (ptr_bfkmer -> window == window) {
+    return;
+  }
+  if (ptr_bfkmer -> window > 1) {
+    free(ptr_bfkmer -> order);
+    free(ptr_bfkmer -> canon);
+    __sync_fetch_and_sub(&alloc_mem,
+                         2*ptr_bfkmer -> window*sizeof(uint64_t));
+    ptr_bfkmer -> order = NULL;
+    ptr_bfkmer -> canon = NULL;
+  }
+  ptr_bfkmer -> window = window;
+  if (window > 1) {
+    ptr_bfkmer -> order = malloc(window*sizeof(uint64_t));
+    ptr_bfkmer -> canon = malloc(window*sizeof(uint64_t));
+    __sync_fetch_and_add(&alloc_mem, 2*window*sizeof(uint64_t));
+  }
+}
+
+/**
+ * @brief starts a new run of valid kmers (after an N or a new sequence)
+ * */
+static void reset_run(Bfkmer *ptr_bfkmer) {
+  ptr_bfkmer -> nrun = 0;
+  ptr_bfkmer -> imin = -1;
+  ptr_bfkmer -> iout = -1;
+}
+
+/**
+ * @brief rolls a base in and selects the (w,k)-minimizers of a sequence
+ * @param ptr_bfkmer Bfkmer with a window w > 1 (see set_window)
+ * @param base next nucleotide of the sequence
+ * @return 1 if a new minimizer was selected, its hash values are then in
+ *         hashValues (as computed by rollHash), 0 otherwise
+ *
+ * The minimizer of w consecutive kmers is the one with the smallest
+ * order, a hash of the canonical kmer independent of the filter hash
+ * values (the leftmost one if there are ties). It only depends on the w
+ * kmers, so a read and the reference select the same minimizers where
+ * they share w + k - 1 bases. Every minimizer is returned once, when it
+ * is first selected (about 2/(w+1) of the kmers). Runs of valid kmers
+ * shorter than w (between N's) give the minimizer of the whole run. Set
+ * nvalid to 0 before rolling in a new sequence, and call
+ * flush_minimizer at its end.
+ * */
+int roll_minimizer(Bfkmer *ptr_bfkmer, unsigned char base) {
+  if (!roll_kmer(ptr_bfkmer, base)) {
+    return (ptr_bfkmer -> nvalid == 0) ? flush_minimizer(ptr_bfkmer) : 0;
+  }
+  int w = ptr_bfkmer -> window;
+  int r = ptr_bfkmer -> nrun++;
+  int first = max(r - w + 1, 0);  // first kmer of the window ending at r
+  uint64_t *order = ptr_bfkmer -> order;
+  uint64_t canon = (ptr_bfkmer -> fw < ptr_bfkmer -> rc) ? ptr_bfkmer -> fw :
+                                                           ptr_bfkmer -> rc;
+  order[r % w] = mix64(canon ^ 0xd6e8feb86659fd93ULL);
+  ptr_bfkmer -> canon[r % w] = canon;
+  if (ptr_bfkmer -> imin < first) {
+    // the minimizer left the window: scan the whole window
+    int j;
+    ptr_bfkmer -> imin = first;
+    for (j = first + 1; j <= r; j++) {
+      if (order[j % w] < order[ptr_bfkmer -> imin % w]) ptr_bfkmer -> imin = j;
+    }
+  } else if (order[r % w] < order[ptr_bfkmer -> imin % w]) {
+    ptr_bfkmer -> imin = r;
+  }
+  if (r < w - 1 || ptr_bfkmer -> imin == ptr_bfkmer -> iout) {
+    return 0;
+  }
+  ptr_bfkmer -> iout = ptr_bfkmer -> imin;
+  hash_canon(ptr_bfkmer, ptr_bfkmer -> canon[ptr_bfkmer -> imin % w]);
+  return 1;
+}
+
+/**
+ * @brief ends the current run of valid kmers (see roll_minimizer)
+ * @param ptr_bfkmer Bfkmer with a window w > 1 (see set_window)
+ * @return 1 if the run was shorter than w kmers: its minimizer is then
+ *         in hashValues. 0 otherwise.
+ * */
+int flush_minimizer(Bfkmer *ptr_bfkmer) {
+  int nrun = ptr_bfkmer -> nrun;
+  int imin = ptr_bfkmer -> imin;
+  reset_run(ptr_bfkmer);
+  if (nrun == 0 || nrun >= ptr_bfkmer -> window) {
+    return 0;
+  }
+  hash_canon(ptr_bfkmer, ptr_bfkmer -> canon[imin % ptr_bfkmer -> window]);
+  return 1;
+}
+
+/**
+ * @brief inserts a kmer in a blocked filter
+ *
+ * @param ptr_bf pointer to a blocked Bfilter structure
+ * @param ptr_bfkmer pointer to Bfkmer structure, where the BF_BLOCK_NHASH
+ *        hash values are stored
+ * @return true if all bits of the kmer were already set to one previously.
+ *
+ * The first hash value selects the block, hashValues[0] mod(nblocks). The
+ * hashNum bit positions inside the block are obtained by double hashing
+ * from the lower (h) and upper (step) 32 bits of the second hash value:
+ * pos_i = (h + i*step) mod(BF_BLOCK_BITS). step is forced to be odd, so
+ * that the hashNum positions are all different.
+ *
+ * */
+static bool insert_blocked(Bfilter *ptr_bf, Bfkmer* ptr_bfkmer) {
+  bool result = true;
+  int i;
+  unsigned char *block = ptr_bf -> filter + BF_BLOCK_BYTES *
+           (ptr_bfkmer -> hashValues[0] % ptr_bf -> nblocks);
+  uint32_t h = (uint32_t)(ptr_bfkmer -> hashValues[1]);
+  uint32_t step = (uint32_t)(ptr_bfkmer -> hashValues[1] >> 32) | 1;
+  uint32_t pos;
+  for (i = 0; i < ptr_bf -> hashNum; i++, h += step) {
+     pos = h % BF_BLOCK_BITS;
+     result &= ((__sync_fetch_and_or(&(block[pos/BITSPERCHAR]),
+           bitMask[pos % BITSPERCHAR]))>>(pos % BITSPERCHAR)) & 1;
+  }
+  return result;
+}
+
+/**
+ * @brief check if kmer is contained in a blocked filter
+ * @param ptr_bf pointer to a blocked Bfilter structure
+ * @param hashValues hash values of the kmer (see Bfkmer)
+ * @return true if all corresponding bits were set to 1 in the filter
+ *
+ * Positions are computed as in insert_blocked, all of them lie in the
+ * same cache line.
+ *
+ * */
+static bool contains_blocked(Bfilter *ptr_bf, const uint64_t *hashValues) {
+  int i;
+  const unsigned char *block = ptr_bf -> filter + BF_BLOCK_BYTES *
+           (hashValues[0] % ptr_bf -> nblocks);
+  uint32_t h = (uint32_t)(hashValues[1]);
+  uint32_t step = (uint32_t)(hashValues[1] >> 32) | 1;
+  uint32_t pos;
+  for (i = 0; i < ptr_bf -> hashNum; i++, h += step) {
+     pos = h % BF_BLOCK_BITS;
+     if (!(block[pos / BITSPERCHAR] & bitMask[pos % BITSPERCHAR])) {
+         return false;
+     }
+  }
+  return true;
+}
+
 /**
  * @brief inserts the hashvalues of a kmer in filter
  *
@@ -453,14 +742,24 @@ void multiHash(Bfkmer* ptr_bfkmer) {
  * - modValue = hashvalue mod(filter size) is calculated.
  * - the bit in position modValue of the filter is set to 1.
  *
+ * In BF_VERSION_ROLL filters the ith hashvalue is
+ * hashValues[0] + i*hashValues[1] (double hashing).
+ * Blocked filters are handled by insert_blocked.
+ *
  * */
 bool insert_and_fetch(Bfilter *ptr_bf, Bfkmer* ptr_bfkmer) {
+  if (ptr_bf -> blocked) {
+    return insert_blocked(ptr_bf, ptr_bfkmer);
+  }
   bool result = true;
   int i = 0;
-  uint64_t modValue;
+  uint64_t hash, modValue;
   // iterates through hashed values adding it to the filter
   for (i = 0; i < ptr_bf -> hashNum; i++) {
-     modValue = (ptr_bfkmer -> hashValues[i]) % (ptr_bf -> bfsizeBits);
+     hash = (ptr_bf -> version != BF_VERSION_CITY) ?
+            ptr_bfkmer -> hashValues[0] + i * ptr_bfkmer -> hashValues[1] :
+            ptr_bfkmer -> hashValues[i];
+     modValue = hash % (ptr_bf -> bfsizeBits);
      result &= ((__sync_fetch_and_or(&(ptr_bf->filter[modValue/BITSPERCHAR]),
            bitMask[modValue % BITSPERCHAR]))>>(modValue % BITSPERCHAR)) & 1;
   }
@@ -468,18 +767,26 @@ bool insert_and_fetch(Bfilter *ptr_bf, Bfkmer* ptr_bfkmer) {
 }
 
 /**
- * @brief check if kmer is contained in the filter
+ * @brief check if the hash values of a kmer are contained in the filter
  * @param ptr_bf pointer to a Bfilter structure, where a bloomfilter is stored
- * @param ptr_bfkmer pointer to a Bfkmer structure containing the hash values
+ * @param hashValues hash values of the kmer (see Bfkmer)
  * @return true if all corresponding bits were set to 1 in the filter
  *
+ * Positions are computed as in insert_and_fetch. Blocked filters are
+ * handled by contains_blocked.
+ *
  * */
-bool contains(Bfilter *ptr_bf, Bfkmer* ptr_bfkmer) {
+static bool contains_values(Bfilter *ptr_bf, const uint64_t *hashValues) {
+  if (ptr_bf -> blocked) {
+    return contains_blocked(ptr_bf, hashValues);
+  }
   int i = 0;
-  uint64_t modValue;
+  uint64_t hash, modValue;
   // iterates through hashed values and check whether they are in the filter
-  for (i = 0; i < ptr_bfkmer -> hashNum; i++) {
-     modValue = (ptr_bfkmer -> hashValues[i]) % (ptr_bf -> bfsizeBits);
+  for (i = 0; i < ptr_bf -> hashNum; i++) {
+     hash = (ptr_bf -> version != BF_VERSION_CITY) ?
+            hashValues[0] + i * hashValues[1] : hashValues[i];
+     modValue = hash % (ptr_bf -> bfsizeBits);
      unsigned char bit = bitMask[modValue % BITSPERCHAR];
      if (((ptr_bf -> filter)[modValue / BITSPERCHAR] & bit) != bit) {
          return false;
@@ -489,40 +796,365 @@ bool contains(Bfilter *ptr_bf, Bfkmer* ptr_bfkmer) {
 }
 
 /**
- * @brief creates a bloom filter from a fasta structure.
- * @param ptr_fasta pointer to fasta structure
+ * @brief check if kmer is contained in the filter
+ * @param ptr_bf pointer to a Bfilter structure, where a bloomfilter is stored
+ * @param ptr_bfkmer pointer to a Bfkmer structure containing the hash values
+ * @return true if all corresponding bits were set to 1 in the filter
+ *
+ * */
+bool contains(Bfilter *ptr_bf, Bfkmer* ptr_bfkmer) {
+  return contains_values(ptr_bf, ptr_bfkmer -> hashValues);
+}
+
+/**
+ * @brief initializes a Bfbatch structure
+ * @param ptr_bf pointer to the Bfilter that will be queried
+ * @param maxqueries number of queries (reads) per batch
+ * @param maxkmers number of kmers per batch (it grows if needed)
+ * @return pointer to an empty Bfbatch
+ *
+ * */
+Bfbatch *init_Bfbatch(Bfilter *ptr_bf, int maxqueries, int maxkmers) {
+  Bfbatch *ptr_bb = calloc(1, sizeof(Bfbatch));
+  ptr_bb -> nhashValues = ptr_bf -> nhashValues;
+  ptr_bb -> maxqueries = maxqueries;
+  ptr_bb -> maxkmers = maxkmers;
+  ptr_bb -> hashValues = malloc((size_t)maxkmers*ptr_bb -> nhashValues*
+                                sizeof(uint64_t));
+  ptr_bb -> query = malloc(maxkmers*sizeof(int));
+  ptr_bb -> need = malloc(maxqueries*sizeof(int));
+  ptr_bb -> hits = malloc(maxqueries*sizeof(int));
+  ptr_bb -> left = malloc(maxqueries*sizeof(int));
+  ptr_bb -> probes = malloc(maxqueries*sizeof(int));
+  __sync_fetch_and_add(&alloc_mem, sizeof(Bfbatch) + (uint64_t)maxkmers*
+      (ptr_bb -> nhashValues*sizeof(uint64_t) + sizeof(int)) +
+      4*maxqueries*sizeof(int));  // threads
+  return ptr_bb;
+}
+
+/**
+ * @brief free Bfbatch
+ * */
+void free_Bfbatch(Bfbatch *ptr_bb) {
+  __sync_fetch_and_sub(&alloc_mem, sizeof(Bfbatch) +
+      (uint64_t)(ptr_bb -> maxkmers)*
+      (ptr_bb -> nhashValues*sizeof(uint64_t) + sizeof(int)) +
+      4*(ptr_bb -> maxqueries)*sizeof(int));
+  free(ptr_bb -> hashValues);
+  free(ptr_bb -> query);
+  free(ptr_bb -> need);
+  free(ptr_bb -> hits);
+  free(ptr_bb -> left);
+  free(ptr_bb -> probes);
+  free(ptr_bb);
+}
+
+/**
+ * @brief empties a Bfbatch, so that a new batch of queries can be added
+ * */
+void reset_Bfbatch(Bfbatch *ptr_bb) {
+  ptr_bb -> nkmers = 0;
+  ptr_bb -> nqueries = 0;
+}
+
+/**
+ * @brief adds the kmers of a sequence to a batch as a new query
+ * @param ptr_bf pointer to the Bfilter that will be queried
+ * @param ptr_bb pointer to Bfbatch, with less than maxqueries queries
+ * @param ptr_bfkmer Bfkmer used to obtain the hash values of the kmers
+ * @param seq sequence (a fastq read)
+ * @param L length of seq
+ * @param need number of kmers that have to be found (see contains_batch)
+ * @return index of the query in the batch
+ *
+ * The hash values of all valid kmers of seq (no N's) are computed and
+ * stored, as they would be by rollHash or multiHash before contains. For
+ * BF_VERSION_MINI filters, only the minimizers of seq are (roll_minimizer).
+ * */
+int add_query(Bfilter *ptr_bf, Bfbatch *ptr_bb, Bfkmer *ptr_bfkmer,
+              const char *seq, int L, int need) {
+  int q = ptr_bb -> nqueries++;
+  int nh = ptr_bb -> nhashValues;
+  int position;
+  int maxN = L - ptr_bf -> kmersize + 1;
+  if (ptr_bb -> nkmers + max(maxN, 0) > ptr_bb -> maxkmers) {
+    int maxkmers = 2*(ptr_bb -> nkmers + maxN);
+    __sync_fetch_and_add(&alloc_mem,
+                         (uint64_t)(maxkmers - ptr_bb -> maxkmers)*
+                         (nh*sizeof(uint64_t) + sizeof(int)));
+    ptr_bb -> maxkmers = maxkmers;
+    ptr_bb -> hashValues = realloc(ptr_bb -> hashValues,
+                                   (size_t)maxkmers*nh*sizeof(uint64_t));
+    ptr_bb -> query = realloc(ptr_bb -> query, maxkmers*sizeof(int));
+  }
+  uint64_t *hv = ptr_bb -> hashValues + (size_t)(ptr_bb -> nkmers)*nh;
+  int *query = ptr_bb -> query + ptr_bb -> nkmers;
+  int n = 0;
+  if (ptr_bf -> window > 1) {
+    set_window(ptr_bfkmer, ptr_bf -> window);
+    ptr_bfkmer -> nvalid = 0;
+    for (position = 0; position <= L; position++) {
+      if ((position < L) ?
+          roll_minimizer(ptr_bfkmer, (unsigned char)seq[position]) :
+          flush_minimizer(ptr_bfkmer)) {
+        memcpy(hv + n*nh, ptr_bfkmer -> hashValues, nh*sizeof(uint64_t));
+        query[n++] = q;
+      }
+    }
+  } else if (ptr_bf -> version == BF_VERSION_ROLL) {
+    ptr_bfkmer -> nvalid = 0;
+    for (position = 0; position < L; position++) {
+      if (roll_kmer(ptr_bfkmer, (unsigned char)seq[position])) {
+        rollHash(ptr_bfkmer);
+        memcpy(hv + n*nh, ptr_bfkmer -> hashValues, nh*sizeof(uint64_t));
+        query[n++] = q;
+      }
+    }
+  } else {
+    for (position = 0; position < maxN; position++) {
+      if (compact_kmer((const unsigned char *)seq, position, ptr_bfkmer)) {
+        multiHash(ptr_bfkmer);
+        memcpy(hv + n*nh, ptr_bfkmer -> hashValues, nh*sizeof(uint64_t));
+        query[n++] = q;
+      }
+    }
+  }
+  ptr_bb -> nkmers += n;
+  ptr_bb -> need[q] = need;
+  ptr_bb -> hits[q] = 0;
+  ptr_bb -> left[q] = n;
+  ptr_bb -> probes[q] = 0;
+  return q;
+}
+
+/**
+ * @brief prefetches the bytes of the filter holding the bits of a kmer
+ * @param ptr_bf pointer to a Bfilter structure
+ * @param hashValues hash values of the kmer (see Bfkmer)
+ *
+ * Positions are computed as in contains_values: one cache line for
+ * blocked filters, hashNum of them otherwise.
+ * */
+static void prefetch_kmer(Bfilter *ptr_bf, const uint64_t *hashValues) {
+  if (ptr_bf -> blocked) {
+    __builtin_prefetch(ptr_bf -> filter + BF_BLOCK_BYTES *
+                       (hashValues[0] % ptr_bf -> nblocks));
+    return;
+  }
+  int i;
+  uint64_t hash;
+  for (i = 0; i < ptr_bf -> hashNum; i++) {
+     hash = (ptr_bf -> version != BF_VERSION_CITY) ?
+            hashValues[0] + i * hashValues[1] : hashValues[i];
+     __builtin_prefetch(ptr_bf -> filter +
+                        (hash % (ptr_bf -> bfsizeBits))/BITSPERCHAR);
+  }
+}
+
+/**
+ * @brief checks whether the outcome of a query is already settled
+ * @return true if need kmers were found, or the ones left cannot reach it
+ * */
+static bool is_settled(Bfbatch *ptr_bb, int q) {
+  return (ptr_bb -> hits[q] >= ptr_bb -> need[q] ||
+          ptr_bb -> hits[q] + ptr_bb -> left[q] < ptr_bb -> need[q]);
+}
+
+/**
+ * @brief looks up the kmers of a batch of queries in a filter
+ * @param ptr_bf pointer to a Bfilter structure
+ * @param ptr_bb pointer to a Bfbatch structure, filled with add_query
+ *
+ * The kmers are resolved in the order they were added, and the filter
+ * bytes of the kmer BF_PREFETCH positions ahead are prefetched, so that
+ * BF_PREFETCH memory accesses are in flight instead of one at a time.
+ * The kmers of a query are only looked up until its outcome is settled:
+ * hits[q] >= need[q] (found), or too few kmers left (not found). probes[q]
+ * counts the kmers of query q that were looked up.
+ * */
+void contains_batch(Bfilter *ptr_bf, Bfbatch *ptr_bb) {
+  int i;
+  int nh = ptr_bb -> nhashValues;
+  int nkmers = ptr_bb -> nkmers;
+  const uint64_t *hv = ptr_bb -> hashValues;
+  const int *query = ptr_bb -> query;
+  for (i = 0; i < min(BF_PREFETCH, nkmers); i++) {
+    prefetch_kmer(ptr_bf, hv + (size_t)i*nh);
+  }
+  for (i = 0; i < nkmers; i++) {
+    int ahead = i + BF_PREFETCH;
+    if (ahead < nkmers && !is_settled(ptr_bb, query[ahead])) {
+      prefetch_kmer(ptr_bf, hv + (size_t)ahead*nh);
+    }
+    int q = query[i];
+    if (is_settled(ptr_bb, q)) continue;
+    ptr_bb -> left[q]--;
+    ptr_bb -> probes[q]++;
+    if (contains_values(ptr_bf, hv + (size_t)i*nh)) {
+      ptr_bb -> hits[q]++;
+    }
+  }
+}
+
+/**
+ * @brief inserts all kmers of a sequence in a filter
+ * @param ptr_bf pointer to Bfilter structure
+ * @param ptr_bfkmer initialized Bfkmer (owned by the calling thread)
+ * @param seq sequence (a chunk of a fasta entry, see Fa_stream)
+ * @param N length of seq
+ *
+ * The kmers starting at positions 0, ..., N - kmersize are inserted, or
+ * only their minimizers in BF_VERSION_MINI filters.
+ * */
+static void insert_seq(Bfilter *ptr_bf, Bfkmer *ptr_bfkmer,
+                       const unsigned char *seq, uint64_t N) {
+  uint64_t position;
+  int kmersize = ptr_bf -> kmersize;
+  if (N < (uint64_t)kmersize)
+    return;
+  if (ptr_bf -> window > 1) {
+    set_window(ptr_bfkmer, ptr_bf -> window);
+    ptr_bfkmer -> nvalid = 0;
+    for (position = 0; position < N; position++) {
+      if (roll_minimizer(ptr_bfkmer, seq[position])) {
+        insert_and_fetch(ptr_bf, ptr_bfkmer);
+      }
+    }
+    if (flush_minimizer(ptr_bfkmer)) {
+      insert_and_fetch(ptr_bf, ptr_bfkmer);
+    }
+  } else if (ptr_bf -> version == BF_VERSION_ROLL) {
+    ptr_bfkmer -> nvalid = 0;
+    for (position = 0; position < N; position++) {
+      if (roll_kmer(ptr_bfkmer, seq[position])) {
+        rollHash(ptr_bfkmer);
+        insert_and_fetch(ptr_bf, ptr_bfkmer);
+      }
+    }
+  } else {
+    for (position = 0; position < N - kmersize + 1; position++) {
+      if (compact_kmer(seq, position, ptr_bfkmer)) {
+        multiHash(ptr_bfkmer);
+        insert_and_fetch(ptr_bf, ptr_bfkmer);
+      }
+    }
+  }
+}
+
+/**
+ * @brief pipeline work function: inserts the kmers of a Bfchunk
+ * */
+static void insert_worker(void *batch, void *arg) {
+  Bfchunk *c = (Bfchunk *)batch;
+  Bfworker *w = (Bfworker *)arg;
+  insert_seq(w -> ptr_bf, w -> ptr_bfkmer, (unsigned char *)c -> seq, c -> N);
+}
+
+/**
+ * @brief creates a bloom filter from a fasta file.
+ * @param fastafile path to the fasta file
  * @param kmersize length of kmers to be inserted in the filter
  * @param bfsizeBits size of Bloom filter in bits
  * @param hashNum number of hash functions to be used
  * @param falsePosRate false positive rate
  * @param nelem number of elemens (kmers in the sequece) contained in the filter
+ * @param blocked 1 to construct a blocked filter, 0 otherwise
+ * @param window minimizer window (in kmers), 1 to insert all kmers
+ * @param nthreads number of threads inserting kmers
  * @return pointer to Bloom filter structure, where the fasta file was encoded.
+ *
+ * Filters with kmersize <= BF_ROLL_MAXK are constructed as BF_VERSION_ROLL
+ * filters: kmers are rolled in base by base (roll_kmer, rollHash). Larger
+ * kmers are compactified and hashed at every position (BF_VERSION_CITY).
+ * With window > 1 (and kmersize <= BF_ROLL_MAXK), only the
+ * (window,kmersize)-minimizers are inserted (BF_VERSION_MINI, see
+ * roll_minimizer).
+ *
+ * The fasta file is streamed in chunks overlapping by
+ * kmersize + window - 2 bases
+ * (see Fa_stream), so only the filter and 2*nthreads chunks are held in
+ * memory. With nthreads > 1, the chunks are inserted by a pool of
+ * nthreads workers (see Pipeline) while the next ones are read. Bits are
+ * set with atomic operations (insert_and_fetch) and the order of
+ * insertion does not matter, so the filter is identical for any number
+ * of threads.
  * */
-Bfilter *create_Bfilter(Fa_data *ptr_fasta, int kmersize, uint64_t bfsizeBits,
-                       int hashNum, double falsePosRate, uint64_t nelem) {
+Bfilter *create_Bfilter(char *fastafile, int kmersize, uint64_t bfsizeBits,
+                       int hashNum, double falsePosRate, uint64_t nelem,
+                       int blocked, int window, int nthreads) {
   init_LUTs();
+  int version = (kmersize > BF_ROLL_MAXK) ? BF_VERSION_CITY :
+                (window > 1) ? BF_VERSION_MINI : BF_VERSION_ROLL;
   Bfilter *ptr_bf = init_Bfilter(kmersize, bfsizeBits, hashNum,
-                                falsePosRate, nelem);
-  int i, isvalid;
-  uint64_t maxN, position;
-  Bfkmer *ptr_bfkmer = init_Bfkmer(kmersize, hashNum);
+                                falsePosRate, nelem, blocked, version);
+  ptr_bf -> window = (version == BF_VERSION_MINI) ? window : 1;
+  int overlap = kmersize + ptr_bf -> window - 2;
+  int i;
   fprintf(stderr, "Creating a bloomfilter.\n");
   fprintf(stderr, "- false positive rate: %f\n", falsePosRate);
   fprintf(stderr, "- kmersize: %d\n", kmersize);
   fprintf(stderr, "- size of bloom filter (in bits): %" PRIu64 "\n", bfsizeBits);
   fprintf(stderr, "- number of hash functions used: %d\n", hashNum);
   fprintf(stderr, "- number of elements that will be inserted: %" PRIu64 "\n", nelem);
-  for (i=0; i < ptr_fasta -> nentries; i++) {
-    maxN = ptr_fasta -> entry[i].N - kmersize + 1;
-    for (position = 0; position < maxN; position++) {
-      isvalid = compact_kmer((unsigned char *)(ptr_fasta -> entry[i].seq),
-                             position, ptr_bfkmer);
-      if (isvalid) {
-          multiHash(ptr_bfkmer);
-          insert_and_fetch(ptr_bf, ptr_bfkmer);
-      }
+  if (blocked) {
+    fprintf(stderr, "- blocked filter, block size (in bits): %d\n",
+            BF_BLOCK_BITS);
+  }
+  fprintf(stderr, "- filter version: %d\n", version);
+  if (version == BF_VERSION_MINI) {
+    fprintf(stderr, "- minimizer window (in kmers): %d\n", window);
+  }
+  fprintf(stderr, "- number of threads: %d\n", nthreads);
+  Fa_stream *ptr_fs = open_fa_stream(fastafile, overlap);
+  if (nthreads <= 1) {
+    Bfkmer *ptr_bfkmer = init_Bfkmer(kmersize, ptr_bf -> nhashValues);
+    while (next_fa_chunk(ptr_fs)) {
+      insert_seq(ptr_bf, ptr_bfkmer, (unsigned char *)ptr_fs -> chunk,
+                 ptr_fs -> N);
+    }
+    free_Bfkmer(ptr_bfkmer);
+    free(ptr_bfkmer);
+    close_fa_stream(ptr_fs);
+    return ptr_bf;
+  }
+  // the next chunks are read while the workers insert the previous ones
+  int nslots = 2*nthreads;
+  Bfworker workers[nthreads];
+  Bfchunk chunks[nslots];
+  void *worker_arg[nthreads], *slot[nslots];
+  for (i = 0; i < nthreads; i++) {
+    workers[i].ptr_bf = ptr_bf;
+    workers[i].ptr_bfkmer = init_Bfkmer(kmersize, ptr_bf -> nhashValues);
+    worker_arg[i] = workers + i;
+  }
+  for (i = 0; i < nslots; i++) {
+    chunks[i].seq = malloc(FA_CHUNK + overlap);
+    if (chunks[i].seq == NULL) {
+      fprintf(stderr, "Error occured when trying to allocate %d Bytes.\n",
+              FA_CHUNK + overlap);
+      fprintf(stderr, "File: %s, line: %d\n", __FILE__, __LINE__);
+      fprintf(stderr, "Exiting program.\n");
+      exit(EXIT_FAILURE);
     }
+    slot[i] = chunks + i;
+  }
+  Pipeline *ptr_pl = init_pipeline(nthreads, slot, nslots, insert_worker,
+                                   worker_arg, NULL, NULL);
+  while (next_fa_chunk(ptr_fs)) {
+    Bfchunk *c = (Bfchunk *)pipeline_next(ptr_pl);
+    memcpy(c -> seq, ptr_fs -> chunk, ptr_fs -> N);
+    c -> N = ptr_fs -> N;
+    pipeline_push(ptr_pl);
+  }
+  free_pipeline(ptr_pl);
+  for (i = 0; i < nthreads; i++) {
+    free_Bfkmer(workers[i].ptr_bfkmer);
+    free(workers[i].ptr_bfkmer);
+  }
+  for (i = 0; i < nslots; i++) {
+    free(chunks[i].seq);
   }
+  close_fa_stream(ptr_fs);
   return ptr_bf;
 }
 
@@ -539,6 +1171,9 @@ Bfilter *create_Bfilter(Fa_data *ptr_fasta, int kmersize, uint64_t bfsizeBits,
  * - bfsizeBits
  * - falsePosRate
  * - nelem
+ * - version (only for BF_VERSION_ROLL and BF_VERSION_MINI filters)
+ * - window (only for BF_VERSION_MINI filters)
+ * - blockBits (only for blocked filters)
  *
  * */
 void save_Bfilter(Bfilter *ptr_bf, char *filterfile, char *paramfile) {
@@ -568,9 +1203,37 @@ void save_Bfilter(Bfilter *ptr_bf, char *filterfile, char *paramfile) {
   fprintf(fout, "bfsizeBits = %" PRIu64  "\n", ptr_bf -> bfsizeBits);
   fprintf(fout, "falsePosRate = %lf\n", ptr_bf -> falsePosRate);
   fprintf(fout, "nelem = %" PRIu64 "\n", ptr_bf -> nelem);
+  if (ptr_bf -> version != BF_VERSION_CITY) {
+    fprintf(fout, "version = %d\n", ptr_bf -> version);
+  }
+  if (ptr_bf -> version == BF_VERSION_MINI) {
+    fprintf(fout, "window = %d\n", ptr_bf -> window);
+  }
+  if (ptr_bf -> blocked) {
+    fprintf(fout, "blockBits = %d\n", BF_BLOCK_BITS);
+  }
   fclose(fout);
 }
 
+/**
+ * @brief prints the parameters of a Bfilter to stderr
+ * */
+static void print_Bfilter(Bfilter *ptr_bf) {
+  fprintf(stderr, "kmersize = %d\n", ptr_bf -> kmersize);
+  fprintf(stderr, "hashNum = %d\n", ptr_bf -> hashNum);
+  fprintf(stderr, "bfsizeBits = %" PRIu64 "\n", ptr_bf -> bfsizeBits);
+  fprintf(stderr, "bfsizeBytes: %" PRIu64 "\n", ptr_bf -> bfsizeBytes);
+  fprintf(stderr, "falsePosRate: %lf\n", ptr_bf -> falsePosRate);
+  fprintf(stderr, "nelem: %" PRIu64 "\n", ptr_bf -> nelem);
+  fprintf(stderr, "version: %d\n", ptr_bf -> version);
+  if (ptr_bf -> version == BF_VERSION_MINI) {
+    fprintf(stderr, "window: %d\n", ptr_bf -> window);
+  }
+  if (ptr_bf -> blocked) {
+    fprintf(stderr, "blockBits: %d\n", BF_BLOCK_BITS);
+  }
+}
+
 /**
  * @brief reads a bloom filter from a file
  * @param filterfile path to file containing the filter
@@ -581,7 +1244,14 @@ void save_Bfilter(Bfilter *ptr_bf, char *filterfile, char *paramfile) {
  * where kmersize, hashNum and bfsizeBits are stored,
  * and the actual filter file. If one of them is missing,
  * the program exits with an error. If successful, a pointer
- * to a Bfilter structure with the bloom filter is return
+ * to a Bfilter structure with the bloom filter is return.
+ * The filter file is mapped in memory (read only, shared with other
+ * processes using the same filter, see mmap_gen) and queried directly
+ * on the mapping. If it cannot be mapped, it is read into memory.
+ * Blocked filters are detected by an additional blockBits line
+ * in the paramfile, the filter version by a version line (files without
+ * it are BF_VERSION_CITY filters). BF_VERSION_MINI filters also need a
+ * window line.
  *
  * */
 Bfilter *read_Bfilter(char *filterfile, char *paramfile) {
@@ -594,7 +1264,8 @@ Bfilter *read_Bfilter(char *filterfile, char *paramfile) {
      exit(EXIT_FAILURE);
      return NULL;
   }
-  int kmersize, hashNum;
+  int kmersize, hashNum, value, blocked = 0, version = BF_VERSION_CITY;
+  int window = 0;
   double falsePosRate;
   uint64_t bfsizeBits, nelem;
   char tmp1[30], tmp2[30];
@@ -603,9 +1274,58 @@ Bfilter *read_Bfilter(char *filterfile, char *paramfile) {
   fscanf(fin, "%s %s %" SCNu64 , tmp1, tmp2, &bfsizeBits);
   fscanf(fin, "%s %s %lf", tmp1, tmp2, &falsePosRate);
   fscanf(fin, "%s %s %" SCNu64 ,tmp1, tmp2, &nelem);
+  while (fscanf(fin, "%29s %29s %d", tmp1, tmp2, &value) == 3) {
+     if (!strcmp(tmp1, "version")) {
+        version = value;
+     } else if (!strcmp(tmp1, "window")) {
+        window = value;
+     } else if (!strcmp(tmp1, "blockBits")) {
+        if (value != BF_BLOCK_BITS) {
+           fprintf(stderr, "Blocked bloom filter with blockBits = %d found,\n",
+                   value);
+           fprintf(stderr, "only blockBits = %d is supported.\n",
+                   BF_BLOCK_BITS);
+           fprintf(stderr, "Exiting program.\n");
+           fprintf(stderr, "File: %s, line: %d\n", __FILE__, __LINE__);
+           exit(EXIT_FAILURE);
+        }
+        blocked = 1;
+     }
+  }
   fclose(fin);
-  Bfilter *ptr_bf = init_Bfilter(kmersize, bfsizeBits, hashNum,
-                             falsePosRate, nelem);
+  if (version == BF_VERSION_MINI && (window < 2 || window > BF_MAX_WINDOW)) {
+     fprintf(stderr, "Minimizer bloom filter with an invalid window (%d),\n",
+             window);
+     fprintf(stderr, "expected window in [2, %d] in %s.\n", BF_MAX_WINDOW,
+             paramfile);
+     fprintf(stderr, "Exiting program.\n");
+     fprintf(stderr, "File: %s, line: %d\n", __FILE__, __LINE__);
+     exit(EXIT_FAILURE);
+  }
+  Bfilter *ptr_bf = new_Bfilter(kmersize, bfsizeBits, hashNum,
+                             falsePosRate, nelem, blocked, version);
+  if (version == BF_VERSION_MINI) {
+     ptr_bf -> window = window;
+  }
+  size_t mapsize;
+  ptr_bf -> filter = mmap_gen(filterfile, 0, &mapsize);
+  if (ptr_bf -> filter != NULL) {
+     ptr_bf -> mapsize = mapsize;
+     if ((uint64_t)mapsize != ptr_bf -> bfsizeBytes) {
+        free_Bfilter(ptr_bf);
+        fprintf(stderr, "Expected bfsizeBytes (%" PRIu64 ") != real "
+                "bfsizeBytes.(%zu)\n", ptr_bf -> bfsizeBytes, mapsize);
+        fprintf(stderr, "Exiting program.\n");
+        fprintf(stderr, "File: %s, line: %d\n", __FILE__, __LINE__);
+        exit(EXIT_FAILURE);
+        return NULL;
+     }
+     fprintf(stderr, "Mapping a bloom filter from: %s (filter), %s (param) \n",
+             filterfile, paramfile);
+     print_Bfilter(ptr_bf);
+     return ptr_bf;
+  }
+  alloc_filter(ptr_bf);
   fin = fopen(filterfile, "rb");
   if (fin == NULL) {
       free_Bfilter(ptr_bf);
@@ -643,12 +1363,7 @@ Bfilter *read_Bfilter(char *filterfile, char *paramfile) {
   }
   fprintf(stderr, "Reading a bloom filter from: %s (filter), %s (param) \n",
           filterfile, paramfile);
-  fprintf(stderr, "kmersize = %d\n", ptr_bf -> kmersize);
-  fprintf(stderr, "hashNum = %d\n", ptr_bf -> hashNum);
-  fprintf(stderr, "bfsizeBits = %" PRIu64 "\n", ptr_bf -> bfsizeBits);
-  fprintf(stderr, "bfsizeBytes: %" PRIu64 "\n", ptr_bf -> bfsizeBytes);
-  fprintf(stderr, "falsePosRate: %lf\n", ptr_bf -> falsePosRate);
-  fprintf(stderr, "nelem: %" PRIu64 "\n", ptr_bf -> nelem);
+  print_Bfilter(ptr_bf);
   fread(ptr_bf -> filter, sizeof(char), ptr_bf -> bfsizeBytes, fin);
   fclose(fin);
   return ptr_bf;
@@ -301,6 +301,162 @@ uint64_t nkmers(Fa_data *ptr_fa, int kmersize) {
   return n_kmers;
 }
 
+/**
+ * @brief opens a fasta file for streaming
+ * @param filename path to a fasta input file.
+ * @param overlap number of bases shared by consecutive chunks of an entry
+ *        (kmersize - 1).
+ * @return pointer to an initialized Fa_stream.
+ *
+ * Only the raw input buffer and one chunk are kept in memory, so the
+ * memory footprint does not depend on the size of the fasta file.
+ * */
+Fa_stream *open_fa_stream(char *filename, int overlap) {
+  Fa_stream *ptr_fs = malloc(sizeof(Fa_stream));
+  ptr_fs -> f = fopen_gen(filename, "r");
+  if (ptr_fs -> f == NULL) {
+     fprintf(stderr, "File: %s, line: %d\n", __FILE__, __LINE__);
+     fprintf(stderr, "File %s not found. Exiting program.\n", filename);
+     exit(EXIT_FAILURE);
+  }
+  ptr_fs -> overlap = overlap > 0 ? overlap : 0;
+  ptr_fs -> buffer = malloc(sizeof(char) * B_LEN);
+  ptr_fs -> chunk = malloc(sizeof(char) * (FA_CHUNK + ptr_fs -> overlap));
+  if (ptr_fs -> buffer == NULL || ptr_fs -> chunk == NULL) {
+    fprintf(stderr, "Error occured when trying to allocate %d Bytes.\n",
+          B_LEN + FA_CHUNK + ptr_fs -> overlap);
+    fprintf(stderr, "File: %s, line: %d\n", __FILE__, __LINE__);
+    fprintf(stderr, "Exiting program.\n");
+    exit(EXIT_FAILURE);
+  }
+  alloc_mem += sizeof(Fa_stream) + B_LEN + FA_CHUNK + ptr_fs -> overlap;
+  ptr_fs -> len = 0;
+  ptr_fs -> pos = 0;
+  ptr_fs -> bol = 1;
+  ptr_fs -> header = 0;
+  ptr_fs -> entry_end = 1;
+  ptr_fs -> nentries = 0;
+  ptr_fs -> N = 0;
+  ptr_fs -> ncarry = 0;
+  ptr_fs -> start = 0;
+  return ptr_fs;
+}
+
+/**
+ * @brief refills the raw buffer of a fasta stream
+ * @param ptr_fs pointer to Fa_stream.
+ * @return number of chars read (0 at the end of the file).
+ *
+ * */
+static int fill_fa_stream(Fa_stream *ptr_fs) {
+  ptr_fs -> len = fread(ptr_fs -> buffer, 1, B_LEN, ptr_fs -> f);
+  ptr_fs -> pos = 0;
+  return ptr_fs -> len;
+}
+
+/**
+ * @brief reads the next chunk of sequence from a fasta stream
+ * @param ptr_fs pointer to Fa_stream.
+ * @return 1 if a chunk with new bases was read, 0 at the end of the file.
+ *
+ * If the previous chunk did not close its entry, its last `overlap`
+ * bases are moved to the front of the chunk (ncarry) and new bases are
+ * appended until FA_CHUNK of them are read or the entry ends. The
+ * consumer may modify the chunk in place (e.g. encode the bases); the
+ * carried bases keep those modifications.
+ * */
+int next_fa_chunk(Fa_stream *ptr_fs) {
+  int keep = 0;
+  if (!ptr_fs -> entry_end) {
+    keep = min(ptr_fs -> overlap, ptr_fs -> N);
+    memmove(ptr_fs -> chunk, ptr_fs -> chunk + ptr_fs -> N - keep, keep);
+    ptr_fs -> start += ptr_fs -> N - keep;
+  } else {
+    ptr_fs -> start = 0;
+  }
+  ptr_fs -> N = keep;
+  ptr_fs -> entry_end = 0;
+  int cap = FA_CHUNK + keep;
+  while (ptr_fs -> N < cap) {
+    if (ptr_fs -> pos == ptr_fs -> len && !fill_fa_stream(ptr_fs)) {
+      ptr_fs -> entry_end = 1;
+      break;
+    }
+    char *p = ptr_fs -> buffer + ptr_fs -> pos;
+    int avail = ptr_fs -> len - ptr_fs -> pos;
+    char *nl = memchr(p, '\n', avail);
+    if (ptr_fs -> header) {
+      ptr_fs -> pos = nl ? ptr_fs -> pos + (nl - p) + 1 : ptr_fs -> len;
+      ptr_fs -> header = (nl == NULL);
+      ptr_fs -> bol = (nl != NULL);
+      continue;
+    }
+    if (ptr_fs -> bol && (*p == '>' || *p == ';')) {
+      if (*p == '>') {
+        // close the current entry before consuming the next header
+        if (ptr_fs -> N > keep) {
+          ptr_fs -> entry_end = 1;
+          break;
+        }
+        ptr_fs -> nentries++;
+        ptr_fs -> N = keep = 0;
+        ptr_fs -> start = 0;
+        cap = FA_CHUNK;
+      }
+      ptr_fs -> header = 1;
+      continue;
+    }
+    if (ptr_fs -> nentries == 0)
+      ptr_fs -> nentries = 1;  // sequence without a header line
+    int linelen = nl ? (int)(nl - p) : avail;
+    int n = min(linelen, cap - ptr_fs -> N);
+    memcpy(ptr_fs -> chunk + ptr_fs -> N, p, n);
+    ptr_fs -> N += n;
+    ptr_fs -> pos += n;
+    ptr_fs -> bol = 0;
+    if (nl && n == linelen) {
+      ptr_fs -> pos++;
+      ptr_fs -> bol = 1;
+    }
+  }
+  ptr_fs -> ncarry = keep;
+  return ptr_fs -> N > keep;
+}
+
+/**
+ * @brief closes a fasta stream and frees its buffers
+ * @param ptr_fs pointer to Fa_stream.
+ *
+ * */
+void close_fa_stream(Fa_stream *ptr_fs) {
+  fclose(ptr_fs -> f);
+  alloc_mem -= sizeof(Fa_stream) + B_LEN + FA_CHUNK + ptr_fs -> overlap;
+  free(ptr_fs -> buffer);
+  free(ptr_fs -> chunk);
+  free(ptr_fs);
+}
+
+/**
+ * @brief number of kmers of length kmersize contained in a fasta file
+ * @param filename path to a fasta input file.
+ * @param kmersize length of the kmers.
+ * @param size if not NULL, total number of nucleotides is stored here.
+ * @returns number of kmers, counted as nkmers does.
+ *
+ * The file is streamed, it is never loaded in memory as a whole.
+ * */
+uint64_t nkmers_fa(char *filename, int kmersize, uint64_t *size) {
+  Fa_stream *ptr_fs = open_fa_stream(filename, 0);
+  uint64_t nbases = 0;
+  while (next_fa_chunk(ptr_fs))
+    nbases += ptr_fs -> N;
+  uint64_t n_kmers = nbases + (uint64_t)ptr_fs -> nentries * (kmersize - 1);
+  close_fa_stream(ptr_fs);
+  if (size != NULL)
+    *size = nbases;
+  return n_kmers;
+}
+
 /**
  * @brief free fasta file
  * @param ptr_fa pointer to Fa_data structure.
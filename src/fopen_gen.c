@@ -26,6 +26,10 @@
  * bunzip2 or xzdec) and return a handle to the open pipe. When opening 
  * in the writing mode (only for .gz, .bam), a pipe to a program is opened 
  * that compresses the output. 
+ * If zlib (or zlib-ng) was found at configure time, gzip files are
+ * decompressed in-process instead, behind a FILE* from fopencookie,
+ * and .gz output is written in BGZF format by a pool of threads shared
+ * by all the output files (bgzf.c).
  *
  * @file fopen_gen.c
  * @brief Uncompress/compress input/output files using pipes.
@@ -40,13 +44,18 @@
  */
 
 
+#define _GNU_SOURCE  // fopencookie
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 #include <assert.h>
 #include <sys/types.h>
 #include <fcntl.h>
+#include "config.h"
 #include "fopen_gen.h"
+#include "defines.h"
+#include "zlib_gen.h"
+#include "bgzf.h"
 
 
 /* 
@@ -89,7 +98,7 @@ static const char* catExec(const char* path) {
  *  Not thread safe.
  * @return a file descriptor
  */
-static int uncompress(const char *path) {
+static int pipe_uncompress(const char *path) {
   const char *zcat = zcatExec(path);
   assert(zcat != NULL);
 
@@ -140,7 +149,7 @@ static int uncompress(const char *path) {
  *  Not thread safe.
  * @return a file descriptor
  */
-static int compress(const char *path) {
+static int pipe_compress(const char *path) {
   const char *zcat  = catExec(path);
   assert(zcat != NULL);
 
@@ -208,7 +217,7 @@ int setCloexec(int fd) {
  * @return a FILE pointer
  */
 static FILE* funcompress(const char* path) {
-  int fd = uncompress(path);
+  int fd = pipe_uncompress(path);
   if (fd == -1) {
      perror(path);
      exit(EXIT_FAILURE);
@@ -221,7 +230,7 @@ static FILE* funcompress(const char* path) {
  * @return a FILE pointer
  */
 static FILE* fcompress(const char* path) {
-  int fd = compress(path);
+  int fd = pipe_compress(path);
   if (fd == -1) {
      perror(path);
      exit(EXIT_FAILURE);
@@ -229,13 +238,152 @@ static FILE* fcompress(const char* path) {
   return fdopen(fd, "w");
 }
 
+#ifdef HAVE_ZLIB
+/**
+ * @brief true if path is a gzip file that zlib can read (not a tarball).
+ * */
+static bool is_gzip(const char *path) {
+  int strl = strlen(path);
+  return strl >= 3 && !strcmp(path + strl - 3, ".gz") &&
+     !(strl >= 7 && !strcmp(path + strl - 7, ".tar.gz"));
+}
+
+/**
+ * @brief fopencookie read function: decompresses into buf.
+ * @return number of bytes read, 0 at the end of the file
+ *
+ * Decompression errors, including a stream cut before its end, exit the
+ * program.
+ * */
+static ssize_t gz_cookie_read(void *cookie, char *buf, size_t size) {
+  int n = gzread((gzFile)cookie, buf, size);
+  if (n <= 0) {
+    // 0 is also returned at the end of a truncated stream (Z_BUF_ERROR)
+    int err = Z_OK;
+    const char *msg = gzerror((gzFile)cookie, &err);
+    if (n < 0 || err != Z_OK) {
+      fprintf(stderr, "Error decompressing file: %s\n", msg);
+      fprintf(stderr, "File: %s, line: %d\n", __FILE__, __LINE__);
+      fprintf(stderr, "Exiting program.\n");
+      exit(EXIT_FAILURE);
+    }
+  }
+  return n;
+}
+
+/**
+ * @brief fopencookie seek function: only reports the current position
+ *        (ftell), counted in uncompressed bytes.
+ * */
+static int gz_cookie_seek(void *cookie, off64_t *offset, int whence) {
+  if (whence != SEEK_CUR || *offset != 0) return -1;
+  *offset = gztell((gzFile)cookie);
+  return (*offset < 0) ? -1 : 0;
+}
+
+/**
+ * @brief fopencookie close function
+ * */
+static int gz_cookie_close(void *cookie) {
+  return (gzclose((gzFile)cookie) == Z_OK) ? 0 : -1;
+}
+
+/**
+ * @brief Open a gzip file and decompress it in-process with zlib.
+ *  The returned FILE* is used as any other: fread, ftell, fclose.
+ * @return a FILE pointer
+ */
+static FILE* fgzopen(const char* path) {
+  gzFile gz = gzopen(path, "rb");
+  if (gz == NULL) {
+     perror(path);
+     exit(EXIT_FAILURE);
+  }
+  gzbuffer(gz, B_LEN);
+  cookie_io_functions_t io = {gz_cookie_read, NULL, gz_cookie_seek,
+                              gz_cookie_close};
+  FILE *f = fopencookie(gz, "r", io);
+  if (f == NULL) {
+     perror(path);
+     exit(EXIT_FAILURE);
+  }
+  return f;
+}
+
+/**
+ * @brief number of threads compressing the BGZF output files
+ * */
+static int compress_threads = 1;
+
+/**
+ * @brief pool of threads shared by all BGZF output files
+ * */
+static Bgzf_pool *compress_pool = NULL;
+
+/**
+ * @brief fopencookie write function: appends buf to the BGZF output.
+ * */
+static ssize_t bgzf_cookie_write(void *cookie, const char *buf, size_t size) {
+  bgzf_write((Bgzf *)cookie, buf, size);
+  return size;
+}
+
+/**
+ * @brief fopencookie close function: flushes and closes the BGZF output.
+ * */
+static int bgzf_cookie_close(void *cookie) {
+  return free_Bgzf((Bgzf *)cookie);
+}
+
+/**
+ * @brief Compress the output written to f in BGZF format, in-process.
+ * @return a FILE pointer
+ */
+static FILE* fbgzfopen(FILE *f, const char* path) {
+  cookie_io_functions_t io = {NULL, bgzf_cookie_write, NULL,
+                              bgzf_cookie_close};
+  if (compress_pool == NULL) {
+    compress_pool = init_Bgzf_pool(compress_threads);
+  }
+  FILE *fz = fopencookie(init_Bgzf(f, compress_pool), "w", io);
+  if (fz == NULL) {
+     perror(path);
+     exit(EXIT_FAILURE);
+  }
+  return fz;
+}
+#endif
+
+/**
+ * @brief Sets the number of threads compressing the .gz output files
+ *        opened afterwards with fopen_gen (BGZF, only with zlib).
+ *
+ * The threads are shared by all the output files, so that nthreads
+ * compress the blocks of every file, whatever their number. It must not
+ * be called while .gz output files are open.
+ * */
+void set_compress_threads(int nthreads) {
+#ifdef HAVE_ZLIB
+  if (compress_pool != NULL) {
+    free_Bgzf_pool(compress_pool);
+    compress_pool = NULL;
+  }
+  compress_threads = max(nthreads, 1);
+#else
+  (void) nthreads;
+#endif
+}
+
 /** 
  * @brief Generalized fopen function.
  * fopen_gen is to be used as fopen. Can be used in 
  * read and in write mode. When used in read mode with a compressed 
  * extension, the file will be first decompressed and then read.
+ * When built with zlib, .gz files are decompressed in-process, the
+ * other formats (.bz2, .xz, .bam, .sra, ...) through a pipe.
  * When used in write mode with a compressed extension, 
- * the output will be compressed. 
+ * the output will be compressed (.gz in BGZF format, in parallel,
+ * when built with zlib). 
  * @return a FILE pointer
  * */
 FILE* fopen_gen(const char *path, const  char * mode) {
@@ -247,6 +395,14 @@ FILE* fopen_gen(const char *path, const  char * mode) {
      fprintf(stderr, "File: %s, line: %d\n", __FILE__, __LINE__);
      _exit(EXIT_FAILURE);
   }
+#ifdef HAVE_ZLIB
+  if (is_gzip(path) && (!strcmp(mode, "r"))) {
+     fclose(f);
+     return fgzopen(path);
+  } else if (is_gzip(path) && (!strcmp(mode, "w"))) {
+     return fbgzfopen(f, path);
+  }
+#endif
   if (f && zcatExec(path) != NULL && (!strcmp(mode, "r"))) {
      fclose(f);
      return funcompress(path);
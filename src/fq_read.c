@@ -33,6 +33,41 @@
 #include "fq_read.h"
 #include "str_manip.h"
 
+/**
+ * @brief finds the TRIMX:s:e annotation ending line 3 of a fastq entry
+ * @param line3 line 3 of a fastq entry
+ * @param L3 length of line3
+ * @param start output: s, the first position kept, relative to the
+ *        original read (left unchanged if there is no annotation)
+ * @return position of "TRIM" in line3, -1 if there is no annotation
+ *
+ * trimFilter always writes the annotation at the end of line 3 (see
+ * iovec_seq), so it is scanned backwards from the end: only the
+ * annotation itself is read, whatever the length of line 3. Hand-written
+ * headers with the annotation elsewhere fall back to a forward search.
+ * */
+static int scan_trim(const char *line3, int L3, int *start) {
+  int i = L3 - 1;
+  int s = 0, pow10 = 1;
+  while (i >= 0 && line3[i] >= '0' && line3[i] <= '9') i--;  // e
+  if (i < L3 - 1 && i > 0 && line3[i] == ':') {
+    int last = --i;
+    for (; i >= 0 && line3[i] >= '0' && line3[i] <= '9'; i--) {  // s
+      s += (line3[i] - '0')*pow10;
+      pow10 *= 10;
+    }
+    if (i < last && i >= 5 && line3[i] == ':' &&
+        !strncmp(line3 + i - 5, "TRIM", 4)) {
+      *start = s;
+      return i - 5;
+    }
+  }
+  if ((i = strindex((char *)line3, "TRIM")) == -1) return -1;
+  // length of TRIMN: or TRIMQ: or TRIMA: or TRIMX:
+  sscanf(&line3[i + 6], "%d", start);
+  return i;
+}
+
 
 /**
  * @brief reads fastq line from a buffer
@@ -40,7 +75,10 @@
  * a fastq line is read from a buffer and the relevant
  * information is stored in a structure <b>Fq_read</b>. Depending
  * on the value of <b>filter</b>, information about whether
- * the read was trimmed is stored.
+ * the read was trimmed is stored. The line is not copied: the
+ * corresponding line in seq points into the buffer, and the '\n' at
+ * pos2 is replaced by '\0'. The buffer has to be kept until the
+ * entry has been processed.
  *
  * @param seq pointer to <b>Fq_read</b>, where the info will be stored.
  * @param buffer variable where the file being read is stored.
@@ -64,13 +102,15 @@ int get_fqread(Fq_read *seq, char* buffer, int pos1, int pos2, int nline, int re
     exit(EXIT_FAILURE);
   }
   int one_read_len = 1;
+  buffer[pos2] = '\0';
   switch (nline % 4) {
   case 0: // fastq header
-    memcpy(seq -> line1 , buffer + pos1, pos2 - pos1);
-    seq -> line1[pos2-pos1]='\0';
+    seq -> line1 = buffer + pos1;
+    seq -> L1 = pos2 - pos1;
+    seq -> ntrim = 0;
     break;
   case 1: // fastq bases of read
-    memcpy(seq -> line2 , buffer + pos1, pos2 - pos1);
+    seq -> line2 = buffer + pos1;
     seq -> L = pos2 - pos1;
     // Exit programm if seq -> L > read_len
     if ((seq -> L) > read_len) {
@@ -81,20 +121,14 @@ int get_fqread(Fq_read *seq, char* buffer, int pos1, int pos2, int nline, int re
       fprintf(stderr, "Exiting program.\n");
       exit(EXIT_FAILURE);
     }
-    seq -> line2[pos2 - pos1] = '\0';
     if (seq -> L != read_len) one_read_len = 0;
     break;
   case 2:
-    memcpy(seq -> line3, buffer + pos1, pos2 - pos1);
-    seq -> line3[pos2 - pos1]='\0';
+    seq -> line3 = buffer + pos1;
+    seq -> L3 = pos2 - pos1;
     seq -> start = 0;
     if (filter == 1) {
-      char *trim = "TRIM";
-      int i, end;
-      if ( (i = strindex(seq -> line3, trim)) > 0 ) {
-        i += 6;  // length of TRIMN: or TRIMQ:
-        sscanf(&(seq -> line3[i]), "%d:%d", &(seq->start), &end);
-      }
+      scan_trim(seq -> line3, seq -> L3, &(seq -> start));
     }
     break;
   case 3:
@@ -108,8 +142,7 @@ int get_fqread(Fq_read *seq, char* buffer, int pos1, int pos2, int nline, int re
       fprintf(stderr, "Exiting program.\n");
       exit(EXIT_FAILURE);
     }
-    memcpy(seq -> line4 , buffer + pos1, pos2 - pos1);
-    seq -> line4[pos2 - pos1]='\0';
+    seq -> line4 = buffer + pos1;
     break;
   }
   return one_read_len;
@@ -128,7 +161,7 @@ void check_zeroQ(Fq_read *seq, int zeroQ, int nread) {
   if (nread > 0) return; // this check on all reads actually does not take much time (e.g. ~1.9 of 83.16s)
   int lowestQ = 255;
   int highestQ = 0;
-  for (int k = 0; seq->line4[k]; k++) {
+  for (int k = 0; k < seq -> L; k++) {
     if (lowestQ > seq->line4[k]) lowestQ = seq->line4[k];
     if (highestQ < seq->line4[k]) highestQ = seq->line4[k];
   }
@@ -144,14 +177,83 @@ void check_zeroQ(Fq_read *seq, int zeroQ, int nread) {
   }
 }
 
+/**
+ * @brief keeps the sub-sequence [t_start, t_end] of a read
+ * @param seq pointer to <b>Fq_read</b>
+ * @param t_start first position kept, relative to the current read
+ * @param t_end last position written in the annotation, relative to the
+ *        current read
+ * @param L new read length
+ * @param type char indicating the type of trimming (N, Q, A).
+ *
+ * No chars are moved: line2 and line4 are advanced to t_start and the
+ * coordinates, relative to the original read, are stored in seq. If
+ * line3 carries a TRIM annotation from a previous run (scan_trim), its
+ * start is taken as offset. The annotation is only rendered when the
+ * entry is written (iovec_seq).
+ *
+ * t_end and L are clamped to the end of the current read: an adapter
+ * found at the read start (align_uint64) may ask to keep more bases than
+ * the read has, and line2/line4 are not terminated past the read.
+ *
+ * */
+void trim_read(Fq_read *seq, int t_start, int t_end, int L, char type) {
+  if (seq -> ntrim == 0) {
+    seq -> trim_type = type;
+    seq -> t_start = 0;
+    seq -> trim_pos = scan_trim(seq -> line3, seq -> L3, &(seq -> t_start));
+  }
+  t_end = min(t_end, seq -> L);
+  L = min(L, seq -> L - t_start);
+  seq -> t_end = seq -> t_start + t_end;
+  seq -> t_start += t_start;
+  seq -> line2 += t_start;
+  seq -> line4 += t_start;
+  seq -> L = L;
+  seq -> ntrim++;
+}
 
 /**
- * @brief writes the fq entry in a string
- * @param seq pointer to <b>Fq_read</b>, where the info will be stored.
- * @param char_seq: pointer to buffer, where the sequence will be stored
- * @warning change the call to sprintf to snprintf
- */
-int string_seq(Fq_read *seq, char *char_seq ) {
-  return(snprintf(char_seq, 4*READ_MAXLEN, "%s\n%s\n%s\n%s\n", seq -> line1,
-          seq -> line2, seq -> line3, seq -> line4));
+ * @brief describes the fq entry as a list of segments to be written
+ * @param seq pointer to <b>Fq_read</b>
+ * @param iov array of at least FQ_NIOV elements, where the segments
+ *        are stored
+ * @return number of segments
+ *
+ * The lines are referenced in the buffer they were read from, only the
+ * trimming info appended to line3 is written to seq -> annot. The
+ * annotation is the same that was obtained by appending it to line3 after
+ * every trimming step: a TRIM annotation found in line3 was cut away
+ * (leaving the space in front of it) and replaced by a TRIMX one.
+ * */
+int iovec_seq(Fq_read *seq, struct iovec *iov) {
+  static char newline[] = "\n";
+  int n = 0;
+  iov[n].iov_base = seq -> line1;
+  iov[n++].iov_len = seq -> L1;
+  iov[n].iov_base = newline;
+  iov[n++].iov_len = 1;
+  iov[n].iov_base = seq -> line2;
+  iov[n++].iov_len = seq -> L;
+  iov[n].iov_base = newline;
+  iov[n++].iov_len = 1;
+  iov[n].iov_base = seq -> line3;
+  if (seq -> ntrim == 0) {
+    iov[n++].iov_len = seq -> L3;
+  } else {
+    bool annotated = (seq -> trim_pos != -1);
+    iov[n++].iov_len = annotated ? seq -> trim_pos : seq -> L3;
+    iov[n].iov_base = seq -> annot;
+    iov[n++].iov_len = snprintf(seq -> annot, TRIM_STRING, "%*s TRIM%c:%d:%d",
+          seq -> ntrim - 1, "",
+          (!annotated && seq -> ntrim == 1) ? seq -> trim_type : 'X',
+          seq -> t_start, seq -> t_end);
+  }
+  iov[n].iov_base = newline;
+  iov[n++].iov_len = 1;
+  iov[n].iov_base = seq -> line4;
+  iov[n++].iov_len = seq -> L;
+  iov[n].iov_base = newline;
+  iov[n++].iov_len = 1;
+  return n;
 }
@@ -0,0 +1,125 @@
+/****************************************************************************
+ * Copyright (C) 2017 by Paula Perez Rubio                                  *
+ *                                                                          *
+ * This file is part of FastqPuri.                                      *
+ *                                                                          *
+ *   FastqPuri is free software: you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as                *
+ *   published by the Free Software Foundation, either version 3 of the     *
+ *   License, or (at your option) any later version.                        *
+ *                                                                          *
+ *   FastqPuri is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *   GNU General Public License for more details.                           *
+ *                                                                          *
+ *   You should have received a copy of the GNU General Public License      *
+ *   along with FastqPuri.                                              *
+ *   If not, see <http://www.gnu.org/licenses/>.                            *
+ ****************************************************************************/
+
+
+
+/**
+ * @file fq_split.c
+ * @brief finds the line ends of the fq entries in a chunk of a file.
+ * @author Paula Perez <paulaperezrubio@gmail.com>
+ * @date 17.10.2026
+ *
+ */
+
+#include <stdint.h>
+#include "fq_split.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SPLIT_X86
+#include <immintrin.h>
+#endif
+
+/**
+ * @brief finds the positions of the '\n' in buf from position i on
+ *        (scalar version)
+ * @param buf chunk of the file
+ * @param i first position to look at
+ * @param len number of chars in buf
+ * @param ends positions of the '\n' found
+ * @param n number of '\n' already stored in ends
+ * @return number of '\n' stored in ends
+ * */
+static int newlines_scalar(const char *buf, int i, int len, int *ends,
+                           int n) {
+  for (; i < len; i++) {
+    ends[n] = i;
+    n += (buf[i] == '\n');
+  }
+  return n;
+}
+
+#ifdef SPLIT_X86
+/**
+ * @brief finds the positions of the '\n' in buf, 16 chars at a time
+ * @return number of '\n' stored in ends
+ * */
+__attribute__((target("sse2")))
+static int newlines_sse2(const char *buf, int len, int *ends) {
+  int i, n = 0;
+  const __m128i nl = _mm_set1_epi8('\n');
+  for (i = 0; i + 16 <= len; i += 16) {
+    __m128i chunk = _mm_loadu_si128((const __m128i *)(buf + i));
+    uint32_t mask = _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, nl));
+    while (mask) {
+      ends[n++] = i + __builtin_ctz(mask);
+      mask &= mask - 1;
+    }
+  }
+  return newlines_scalar(buf, i, len, ends, n);
+}
+
+/**
+ * @brief finds the positions of the '\n' in buf, 32 chars at a time
+ * @return number of '\n' stored in ends
+ * */
+__attribute__((target("avx2")))
+static int newlines_avx2(const char *buf, int len, int *ends) {
+  int i, n = 0;
+  const __m256i nl = _mm256_set1_epi8('\n');
+  for (i = 0; i + 32 <= len; i += 32) {
+    __m256i chunk = _mm256_loadu_si256((const __m256i *)(buf + i));
+    uint32_t mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, nl));
+    while (mask) {
+      ends[n++] = i + __builtin_ctz(mask);
+      mask &= mask - 1;
+    }
+  }
+  return newlines_scalar(buf, i, len, ends, n);
+}
+#endif
+
+/**
+ * @brief finds the line ends of all complete fq entries in a chunk
+ * @param buf chunk of the file, starting with an entry
+ * @param len number of chars in buf
+ * @param ends positions of the '\n' ending the lines, 4 per entry. It must
+ *        have room for one position per char of buf.
+ * @param nl number of lines found after the last complete entry
+ * @return number of complete entries
+ *
+ * Line k of entry i goes from ends[4*i + k - 1] + 1 (0 for the first
+ * line) to ends[4*i + k], not included.
+ * */
+int split_fq(const char *buf, int len, int *ends, int *nl) {
+  int n;
+#ifdef SPLIT_X86
+  if (__builtin_cpu_supports("avx2")) {
+    n = newlines_avx2(buf, len, ends);
+  } else if (__builtin_cpu_supports("sse2")) {
+    n = newlines_sse2(buf, len, ends);
+  } else {
+    n = newlines_scalar(buf, 0, len, ends, 0);
+  }
+#else
+  n = newlines_scalar(buf, 0, len, ends, 0);
+#endif
+  *nl = n % 4;
+  return n / 4;
+}
@@ -47,6 +47,8 @@ void printHelpDialog_makeBloom() {
    " --kmersize [KMERSIZE] \n"
    "                   (--fal_pos_rate [p] | --hashNum [HASHNUM] |"
    " --bfsizeBits [SIZEBITS])\n"
+   "                   --blocked [y|n] --threads [NTHREADS]"
+   " --window [WINDOW]\n"
    "Options: \n"
    " -v, --version      Prints package version.\n"
    " -h, --help         Prints help dialog.\n"
@@ -59,6 +61,21 @@ void printHelpDialog_makeBloom() {
    " -m, --bfsizeBits   size of the filter in bits. It will be forced to be\n"
    "                    a multiple of 8. Optional (default value computed\n"
    "                    from the false positive rate).\n"
+   " -b, --blocked      construct a blocked filter: yes or no. All bits of a\n"
+   "                    kmer are set in one 512 bit block (one cache line),\n"
+   "                    its size is forced to be a multiple of 512. Lookups\n"
+   "                    are faster and the false positive rate slightly\n"
+   "                    higher. Optional (default no).\n"
+   " -t, --threads      number of threads constructing the filter. The\n"
+   "                    filter is identical for any number of threads.\n"
+   "                    Optional (default 1).\n"
+   " -w, --window       minimizer window, in kmers. Only the kmer with the\n"
+   "                    smallest hash of every WINDOW consecutive kmers is\n"
+   "                    inserted (about 2/(WINDOW+1) of the kmers): the\n"
+   "                    filter is that much smaller, reads are scored on\n"
+   "                    their minimizers. Needs kmersize <= 32 and should\n"
+   "                    not exceed read length - kmersize + 1. Optional\n"
+   "                    (default 1: all kmers are inserted).\n"
    "NOTE: the options -p, -g, -m are mutually exclusive. The program \n"
    "      will give an error if more than one of them are passed as input.\n"
    "      It is recommended to pass the false positive rate and let the \n"
@@ -75,7 +92,7 @@ void printHelpDialog_makeBloom() {
  *   and stores them in the global variable par_MB.
 */
 void getarg_makeBloom(int argc, char **argv) {
-  if ( argc != 2 && (argc > 9 || argc % 2 == 0 || argc == 1) ) {
+  if ( argc != 2 && (argc > 15 || argc % 2 == 0 || argc == 1) ) {
      fprintf(stderr, "Not adequate number of arguments\n");
      printHelpDialog_makeBloom();
      fprintf(stderr, "File: %s, line: %d\n", __FILE__, __LINE__);
@@ -89,7 +106,10 @@ void getarg_makeBloom(int argc, char **argv) {
       {"kmersize", required_argument, 0, 'k'},
       {"fal_pos_rate", required_argument, 0, 'p'},
       {"hashNum", required_argument, 0, 'g'},
-      {"bfsizeBits", required_argument, 0, 'm'}
+      {"bfsizeBits", required_argument, 0, 'm'},
+      {"blocked", required_argument, 0, 'b'},
+      {"threads", required_argument, 0, 't'},
+      {"window", required_argument, 0, 'w'}
   };
   int i;
   for (i = 0; i < argc; i++) {
@@ -103,7 +123,7 @@ void getarg_makeBloom(int argc, char **argv) {
     }
   }
   char options;
-  while ((options = getopt_long(argc, argv, "hvf:o:k:p:g:m:", long_options, 0))
+  while ((options = getopt_long(argc, argv, "hvf:o:k:p:g:m:b:t:w:", long_options, 0))
         != -1) {
     switch (options) {
       case 'h':  // show the HelpDialog
@@ -134,6 +154,28 @@ void getarg_makeBloom(int argc, char **argv) {
       case 'm':
         sscanf(optarg, "%" SCNu64, &par_MB.bfsizeBits);
         break;
+      case 'b':
+        if (!strncmp(optarg, "no", 3) || !strncmp(optarg, "n", 2) ||
+            !strncmp(optarg, "NO", 3) || !strncmp(optarg, "N", 2)) {
+           par_MB.blocked = 0;
+        } else if (!strncmp(optarg, "yes", 4) || !strncmp(optarg, "y", 2) ||
+            !strncmp(optarg, "YES", 4) || !strncmp(optarg, "Y", 2)) {
+           par_MB.blocked = 1;
+        } else {
+           fprintf(stderr, "--blocked,-b: optionERR. You must pass  \n");
+           fprintf(stderr, "one of the following options: \n");
+           fprintf(stderr, "y|Y|yes|YES|n|N|no|NO");
+           fprintf(stderr, " and you passed %s\n", optarg);
+           fprintf(stderr, "File: %s, line: %d\n", __FILE__, __LINE__);
+           exit(EXIT_FAILURE);
+        }
+        break;
+      case 't':
+        par_MB.nthreads = atoi(optarg);
+        break;
+      case 'w':
+        par_MB.window = atoi(optarg);
+        break;
       default:
         fprintf(stderr, "%s: option `-%c' is invalid: ignored\n",
                               argv[0], options);
@@ -166,6 +208,15 @@ void getarg_makeBloom(int argc, char **argv) {
      fprintf(stderr, "File: %s, line: %d\n", __FILE__, __LINE__);
      exit(EXIT_FAILURE);
   }
+  if (par_MB.nthreads == 0) {
+     par_MB.nthreads = 1;
+  } else if (par_MB.nthreads < 0 || par_MB.nthreads > MAX_THREADS) {
+     fprintf(stderr, "OPTION_ERROR: --threads must be in [1,%d].\n",
+             MAX_THREADS);
+     fprintf(stderr, "Exiting program.\n");
+     fprintf(stderr, "File: %s, line: %d\n", __FILE__, __LINE__);
+     exit(EXIT_FAILURE);
+  }
   if (!(par_MB.kmersize)) {
       par_MB.kmersize = KMER_LEN;
   } else  if (par_MB.kmersize < 4) {
@@ -174,12 +225,27 @@ void getarg_makeBloom(int argc, char **argv) {
      fprintf(stderr, "File: %s, line: %d\n", __FILE__, __LINE__);
      exit(EXIT_FAILURE);
   }
+  if (par_MB.window == 0) {
+     par_MB.window = 1;
+  } else if (par_MB.window < 0 || par_MB.window > BF_MAX_WINDOW) {
+     fprintf(stderr, "OPTION_ERROR: --window must be in [1,%d].\n",
+             BF_MAX_WINDOW);
+     fprintf(stderr, "Exiting program.\n");
+     fprintf(stderr, "File: %s, line: %d\n", __FILE__, __LINE__);
+     exit(EXIT_FAILURE);
+  } else if (par_MB.window > 1 && par_MB.kmersize > BF_ROLL_MAXK) {
+     fprintf(stderr, "OPTION_ERROR: --window needs kmersize <= %d.\n",
+             BF_ROLL_MAXK);
+     fprintf(stderr, "Exiting program.\n");
+     fprintf(stderr, "File: %s, line: %d\n", __FILE__, __LINE__);
+     exit(EXIT_FAILURE);
+  }
 
   if (!par_MB.hashNum && !par_MB.bfsizeBits &&
       (fabs(par_MB.falsePosRate) < ZERO_POS_RATE)) {
        fprintf(stderr, "Default values: falsePosRate = 0.05\n");
        fprintf(stderr, "Other parameters inferred from it\n");
-       par_MB.falsePosRate = KMER_LEN;
+       par_MB.falsePosRate = FALSE_POS_RATE;
     } else if (par_MB.hashNum && !par_MB.bfsizeBits &&
               (fabs(par_MB.falsePosRate) < ZERO_POS_RATE)) {
        fprintf(stderr, "Input parameter: hashNum = %d\n", par_MB.hashNum);
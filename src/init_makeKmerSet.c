@@ -0,0 +1,144 @@
+/****************************************************************************
+ * Copyright (C) 2017 by Paula Perez Rubio                                  *
+ *                                                                          *
+ * This file is part of FastqPuri.                                      *
+ *                                                                          *
+ *   FastqPuri is free software: you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as                *
+ *   published by the Free Software Foundation, either version 3 of the     *
+ *   License, or (at your option) any later version.                        *
+ *                                                                          *
+ *   FastqPuri is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *   GNU General Public License for more details.                           *
+ *                                                                          *
+ *   You should have received a copy of the GNU General Public License      *
+ *   along with FastqPuri.                                              *
+ *   If not, see <http://www.gnu.org/licenses/>.                            *
+ ****************************************************************************/
+
+/**
+ * @file init_makeKmerSet.c
+ * @author Paula Perez <paulaperezrubio@gmail.com>
+ * @date 17.10.2026
+ * @brief Help dialog for makeKmerSet and initialization of
+ * the command line arguments.
+ */
+
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "init_makeKmerSet.h"
+#include "str_manip.h"
+#include "config.h"
+
+extern Iparam_makeKmerSet par_MK; /**< Input parameters of makeKmerSet */
+
+/**
+ * @brief Function that prints makeKmerSet help dialog when called.
+*/
+void printHelpDialog_makeKmerSet() {
+  const char dialog[] =
+   "Usage: ./makeKmerSet -f|--fasta <FASTA_INPUT> -o|--output <OUTPUT_FILE>\n"
+   "                     [-k|--kmersize <KMERSIZE>]\n"
+   "Reads a *fa file, stores all its kmers in an exact kmer set and saves\n"
+   "it in OUTPUT_FILE.\n"
+   "Options: \n"
+   " -v, --version  Prints package version.\n"
+   " -h, --help     Prints help dialog.\n"
+   " -f, --fasta    Fasta input file. Mandatory option.\n"
+   " -o, --output   Output file. Mandatory option. The file is mapped in\n"
+   "                memory by trimFilter/trimFilterPE unless it is\n"
+   "                compressed (*gz).\n"
+   " -k, --kmersize kmer length, at most 32. Default: 25.\n\n";
+  fprintf(stderr, "%s", dialog);
+}
+
+/**
+ * @brief Reads in the arguments passed through the command line to
+ *   makeKmerSet and stores them in the global variable par_MK.
+*/
+void getarg_makeKmerSet(int argc, char **argv) {
+  if (argc != 2 && argc != 5 && argc != 7) {
+     fprintf(stderr, "Not adequate number of arguments\n");
+     printHelpDialog_makeKmerSet();
+     fprintf(stderr, "File: %s, line: %d\n", __FILE__, __LINE__);
+     exit(EXIT_FAILURE);
+  }
+  static struct option long_options[] = {
+      {"version", no_argument, 0, 'v'},
+      {"help", no_argument, 0, 'h'},
+      {"fasta", required_argument, 0, 'f'},
+      {"output", required_argument, 0, 'o'},
+      {"kmersize", required_argument, 0, 'k'}
+  };
+  int i;
+  for (i = 0; i < argc; i++) {
+    if (!str_isascii(argv[i])) {
+      fprintf(stderr, "input parameter %s contains non ASCII chars.\n",
+              argv[i]);
+      fprintf(stderr, "only ASCII characters allowed in the input. ");
+      fprintf(stderr, "Please correct for that.\n");
+      fprintf(stderr, "File: %s, line: %d\n", __FILE__, __LINE__);
+      exit(EXIT_FAILURE);
+    }
+  }
+  par_MK.kmersize = KMER_LEN;
+  char options;
+  while ((options = getopt_long(argc, argv, "hvf:o:k:", long_options, 0))
+        != -1) {
+    switch (options) {
+      case 'h':  // show the HelpDialog
+        printHelpDialog_makeKmerSet();
+        exit(EXIT_SUCCESS);
+        break;
+      case 'v':  // Print version
+        printf("makeKmerSet version %s \nWritten by Paula Perez Rubio\n",
+               VERSION);
+        exit(EXIT_SUCCESS);
+        break;
+      case 'f':
+        par_MK.inputfasta = optarg;
+        break;
+      case 'o':
+        snprintf(par_MK.outputfile, MAX_FILENAME, "%s", optarg);
+        break;
+      case 'k':
+        par_MK.kmersize = atoi(optarg);
+        break;
+      default:
+        fprintf(stderr, "%s: option `-%c' is invalid: ignored\n",
+                              argv[0], options);
+        printHelpDialog_makeKmerSet();
+        fprintf(stderr, "File: %s, line: %d\n", __FILE__, __LINE__);
+        exit(EXIT_FAILURE);
+        break;
+    }
+  }
+  // Since the variable par_MK is global, it is automatically initialized to
+  // 0 when created.
+  if (par_MK.inputfasta == NULL) {
+     printHelpDialog_makeKmerSet();
+     fprintf(stderr, "Input fasta file name was not properly initialized. \n");
+     fprintf(stderr, "Exiting program.\n");
+     fprintf(stderr, "File: %s, line: %d\n", __FILE__, __LINE__);
+     exit(EXIT_FAILURE);
+  }
+  if  (!strncmp(par_MK.outputfile, "", MAX_FILENAME)) {
+     printHelpDialog_makeKmerSet();
+     fprintf(stderr, "Output file name was not properly initialized. \n");
+     fprintf(stderr, "Exiting program.\n");
+     fprintf(stderr, "File: %s, line: %d\n", __FILE__, __LINE__);
+     exit(EXIT_FAILURE);
+  }
+  if (par_MK.kmersize < 1 || par_MK.kmersize > BF_ROLL_MAXK) {
+     printHelpDialog_makeKmerSet();
+     fprintf(stderr, "kmersize must be in [1, %d]. \n", BF_ROLL_MAXK);
+     fprintf(stderr, "Exiting program.\n");
+     fprintf(stderr, "File: %s, line: %d\n", __FILE__, __LINE__);
+     exit(EXIT_FAILURE);
+  }
+}
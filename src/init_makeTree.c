@@ -44,6 +44,7 @@ void printHelpDialog_makeTree() {
   const char dialog[] =
    "Usage: ./makeTree -f|--fasta <FASTA_INPUT> -l|--depth <DEPTH> "
    "-o, --output <OUTPUT_FILE>\n"
+   "                  [-t|--threads <NTHREADS>]\n"
    "Reads a *fa file, constructs a tree of depth DEPTH and saves it\n"
    "compressed in OUTPUT_FILE.\n"
    "Options: \n"
@@ -53,7 +54,13 @@ void printHelpDialog_makeTree() {
    " Mandatory option.\n"
    " -l, --depth depth of the tree structure. Mandatory option. \n"
    " -o, --output Output file. If the extension is not *gz, it is added."
-   " Mandatory option.\n\n";
+   " Mandatory option.\n"
+   "              If the extension is " TREE_EXT ", the tree is stored\n"
+   "              uncompressed, so that trimFilter/trimFilterPE can map it\n"
+   "              in memory instead of reconstructing it.\n"
+   " -t, --threads number of threads constructing the tree. Optional\n"
+   "              (default 1). The tree contains the same Lmers for any\n"
+   "              number of threads, only the order of the nodes differs.\n\n";
   fprintf(stderr, "%s", dialog);
 }
 
@@ -62,7 +69,7 @@ void printHelpDialog_makeTree() {
  *   and stores them in the global variable par_MT.
 */
 void getarg_makeTree(int argc, char **argv) {
-  if (argc != 2 && argc != 7) {
+  if (argc != 2 && argc != 7 && argc != 9) {
      fprintf(stderr, "Not adequate number of arguments\n");
      printHelpDialog_makeTree();
      fprintf(stderr, "File: %s, line: %d\n", __FILE__, __LINE__);
@@ -73,7 +80,8 @@ void getarg_makeTree(int argc, char **argv) {
       {"help", no_argument, 0, 'h'},
       {"fasta", required_argument, 0, 'f'},
       {"depth", required_argument, 0, 'l'},
-      {"output", required_argument, 0, 'o'}
+      {"output", required_argument, 0, 'o'},
+      {"threads", required_argument, 0, 't'}
   };
   int i;
   for (i = 0; i < argc; i++) {
@@ -87,7 +95,7 @@ void getarg_makeTree(int argc, char **argv) {
     }
   }
   char options;
-  while ((options = getopt_long(argc, argv, "hvf:l:o:", long_options, 0))
+  while ((options = getopt_long(argc, argv, "hvf:l:o:t:", long_options, 0))
         != -1) {
     switch (options) {
       case 'h':  // show the HelpDialog
@@ -105,12 +113,17 @@ void getarg_makeTree(int argc, char **argv) {
         par_MT.L = atoi(optarg);
         break;
       case 'o':
-        if (!strcmp(optarg + strlen(optarg) - 3, ".gz")) {
+        if (!strcmp(optarg + strlen(optarg) - 3, ".gz") ||
+            (strlen(optarg) >= strlen(TREE_EXT) &&
+             !strcmp(optarg + strlen(optarg) - strlen(TREE_EXT), TREE_EXT))) {
           snprintf(par_MT.outputfile, MAX_FILENAME, "%s", optarg);
         } else {
           snprintf(par_MT.outputfile, MAX_FILENAME, "%s.gz", optarg);
         }
         break;
+      case 't':
+        par_MT.nthreads = atoi(optarg);
+        break;
       default:
         fprintf(stderr, "%s: option `-%c' is invalid: ignored\n",
                               argv[0], options);
@@ -143,4 +156,13 @@ void getarg_makeTree(int argc, char **argv) {
      fprintf(stderr, "File: %s, line: %d\n", __FILE__, __LINE__);
      exit(EXIT_FAILURE);
   }
+  if (par_MT.nthreads == 0) {
+     par_MT.nthreads = 1;
+  } else if (par_MT.nthreads < 0 || par_MT.nthreads > MAX_THREADS) {
+     fprintf(stderr, "OPTION_ERROR: --threads must be in [1,%d].\n",
+             MAX_THREADS);
+     fprintf(stderr, "Exiting program.\n");
+     fprintf(stderr, "File: %s, line: %d\n", __FILE__, __LINE__);
+     exit(EXIT_FAILURE);
+  }
 }
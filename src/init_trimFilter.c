@@ -46,13 +46,16 @@ void printHelpDialog_trimFilter() {
    "Usage: trimFilter --ifq <INPUT_FILE.fq> --length <READ_LENGTH> \n"
    "                  --output [O_PREFIX] --gzip [y|n]\n"
    "                  --adapter [<ADAPTERS.fa>:<mismatches>:<score>]\n"
-   "                  --method [TREE|BLOOM] \n"
+   "                  --admode [HAMMING|MYERS]\n"
+   "                  --method [TREE|BLOOM|KMERSET] \n"
    "                  (--idx [<INDEX_FILE>:<score>:<lmer_len>] |\n"
    "                   --ifa [<INPUT.fa>:<score>:[lmer_len]])\n"
-   "                  --trimQ [NO|ALL|ENDS|FRAC|ENDSFRAC|GLOBAL]\n"
+   "                  --trimQ [NO|ALL|ENDS|FRAC|ENDSFRAC|GLOBAL|WINDOW|MOTT]\n"
    "                  --minL [MINL]  --minQ [MINQ] --zeroQ [ZEROQ]\n"
-   "                  (--percent [percent] | --global [n1:n2])\n"
+   "                  (--percent [percent] | --global [n1:n2] |\n"
+   "                   --window [w])\n"
    "                  --trimN [NO|ALL|ENDS|STRIP|FRAC]  \n"
+   "                  --threads [NTHREADS]\n"
    "Reads in a fq file (gz, bz2, z formats also accepted) and removes: \n"
    "  * low quality reads,\n"
    "  * reads containing N base callings,\n"
@@ -66,18 +69,25 @@ void printHelpDialog_trimFilter() {
    " -l, --length  read length: length of the reads, mandatory option.\n"
    " -o, --output  output prefix (with path), optional (default ./out).\n"
    " -z, --gzip    gzip output files: yes or no (default yes)\n"
+   "               (BGZF format, compressed by --threads threads).\n"
    " -A, --adapter adapter input. Three fields separated by colons:\n"
    "               <ADAPTERS.fa>: fasta file containing adapters,\n"
    "               <mismatches>: maximum mismatch count allowed,\n"
    "               <score>: score threshold  for the aligner.\n"
+   " -M, --admode  HAMMING: adapters are matched with mismatches only,\n"
+   "                        seeded by their first 16 bases (default),\n"
+   "               MYERS:   adapters are matched with mismatches and indels\n"
+   "                        (bit-vector edit distance of their first 64\n"
+   "                        bases); <mismatches> is the maximum number of\n"
+   "                        edits per 16 adapter bases.\n"
    " -x, --idx     index input file. To be included with methods to remove.\n"
-   "               contaminations (TREE, BLOOM). 3 fields separated by colons: \n"
-   "               <INDEX_FILE>: output of makeTree, makeBloom,\n"
+   "               contaminations (TREE, BLOOM, KMERSET). 3 fields separated by colons: \n"
+   "               <INDEX_FILE>: output of makeTree, makeBloom, makeKmerSet,\n"
    "               <score>: score threshold to accept a match [0,1],\n"
    "               [lmer_len]: the length of the lmers to be \n"
    "                        looked for in the reads [1,READ_LENGTH].\n"
    " -a, --ifa     fasta input file of potential contaminations.\n" 
-   "               To be included only with method TREE\n"
+   "               To be included only with methods TREE, KMERSET\n"
    "               (it excludes the option --idx). Otherwise, an\n"
    "               index file has to be precomputed and given as parameter\n"
    "               (see option --idx). 3 fields separated by colons: \n"
@@ -89,6 +99,8 @@ void printHelpDialog_trimFilter() {
    " -C, --method  method used to look for contaminations: \n"
    "               TREE:  uses a 4-ary tree. Index file optional,\n"
    "               BLOOM: uses a bloom filter. Index file mandatory.\n"
+   "               KMERSET: uses an exact set of kmers (lmer_len <= 32).\n"
+   "                      Index file optional.\n"
    " -Q, --trimQ   NO:       does nothing to low quality reads (default),\n"
    "               ALL:      removes all reads containing at least one low\n"
    "                         quality nucleotide.\n"
@@ -102,6 +114,11 @@ void printHelpDialog_trimFilter() {
    "                         allowed by the option -p.\n"
    "               GLOBAL:   removes n1 bases on the left and n2 on the \n"
    "                         right, specified in -g.\n"
+   "               WINDOW:   trims the ends up to the first windows of -w\n"
+   "                         bases whose mean quality is at least -q,\n"
+   "               MOTT:     keeps the segment with the largest sum of\n"
+   "                         quality - q (Mott algorithm, BWA -q on both\n"
+   "                         ends).\n"
    "               All reads are discarded if they are shorter than MINL\n"
    "               (specified with -m or --minL).\n"     
    " -m, --minL    minimum length allowed for a read before it is discarded\n"
@@ -113,6 +130,7 @@ void printHelpDialog_trimFilter() {
    " -g, --global  required option if --trimQ GLOBAL is passed. Two int,\n"
    "               n1:n2, have to be passed specifying the number of bases \n"
    "               to be globally cut from the left and right, respectively.\n"
+   " -w, --window  window length of --trimQ WINDOW (default 4).\n"
    " -N, --trimN   NO:     does nothing to reads containing N's,\n"
    "               ALL:    removes all reads containing N's,\n"
    "               ENDS:   trims ends of reads with N's,\n"
@@ -120,7 +138,10 @@ void printHelpDialog_trimFilter() {
    "               FRAC:   removes the reads if the uncertainty is above a threshold\n"
    "                       (-u), default to 10 percent\n"
    "               All reads are discarded if they are shorter than the\n"
-   "               sequence length specified by -m/--minL.\n";
+   "               sequence length specified by -m/--minL.\n"
+   " -t, --threads number of worker threads filtering the reads (default 1).\n"
+   "               The tree of --ifa is also constructed with them.\n"
+   "               The output is identical for any number of threads.\n";
   fprintf(stderr, "%s", dialog);
 }
 
@@ -129,7 +150,7 @@ void printHelpDialog_trimFilter() {
  *        and stores them in the global variable par_TF.
 */
 void getarg_trimFilter(int argc, char **argv) {
-  if ( argc != 2 && (argc > 27 || argc % 2 == 0 || argc == 1) ) {
+  if ( argc != 2 && (argc > 33 || argc % 2 == 0 || argc == 1) ) {
      fprintf(stderr, "Not adequate number of arguments\n");
      printHelpDialog_trimFilter();
      fprintf(stderr, "File: %s, line: %d\n", __FILE__, __LINE__);
@@ -163,11 +184,15 @@ void getarg_trimFilter(int argc, char **argv) {
      {"global", required_argument, 0, 'g'},
      {"minL", required_argument, 0, 'm'},
      {"trimN", required_argument, 0, 'N'},
+     {"threads", required_argument, 0, 't'},
+     {"window", required_argument, 0, 'w'},
+     {"admode", required_argument, 0, 'M'},
+     {0, 0, 0, 0}
   };
   int option;
   int method_len = 20;
   Split globTrim, adapt, tree_fa, index;
-  while ((option = getopt_long(argc, argv, "hvf:l:o:z:A:q:x:a:C:Q:m:p:g:N:0:",
+  while ((option = getopt_long(argc, argv, "hvf:l:o:z:A:q:x:a:C:Q:m:p:g:N:0:t:w:M:",
         long_options, 0)) != -1) {
     switch (option) {
       case 'h':
@@ -217,6 +242,10 @@ void getarg_trimFilter(int argc, char **argv) {
          par_TF.ad.mismatches = atoi(adapt.s[1]);
          par_TF.ad.threshold = atof(adapt.s[2]);
          break;
+      case 'M':
+         par_TF.ad.mode = (!strncmp(optarg, "HAMMING", method_len)) ? HAMMING :
+            (!strncmp(optarg, "MYERS", method_len)) ? MYERS : ERROR;
+         break;
       case 'q':
          par_TF.minQ = atoi(optarg);
          break;
@@ -259,7 +288,8 @@ void getarg_trimFilter(int argc, char **argv) {
          break;
       case 'C':
          par_TF.method = (!strncmp(optarg, "TREE", method_len)) ? TREE :
-            (!strncmp(optarg, "BLOOM", method_len)) ? BLOOM : ERROR;
+            (!strncmp(optarg, "BLOOM", method_len)) ? BLOOM :
+            (!strncmp(optarg, "KMERSET", method_len)) ? KMERSET : ERROR;
          break;
       case 'Q':
          par_TF.trimQ = (!strncmp(optarg, "NO", method_len)) ? NO :
@@ -267,7 +297,9 @@ void getarg_trimFilter(int argc, char **argv) {
             (!strncmp(optarg, "FRAC", method_len)) ? FRAC :
             (!strncmp(optarg, "ENDS", method_len)) ? ENDS :
             (!strncmp(optarg, "ENDSFRAC", method_len)) ? ENDSFRAC :
-            (!strncmp(optarg, "GLOBAL", method_len)) ? GLOBAL : ERROR;
+            (!strncmp(optarg, "GLOBAL", method_len)) ? GLOBAL :
+            (!strncmp(optarg, "WINDOW", method_len)) ? WINDOW :
+            (!strncmp(optarg, "MOTT", method_len)) ? MOTT : ERROR;
          break;
       case 'm':
          par_TF.minL = atoi(optarg);
@@ -294,6 +326,12 @@ void getarg_trimFilter(int argc, char **argv) {
             (!strncmp(optarg, "STRIP", method_len)) ? STRIP : 
             (!strncmp(optarg, "FRAC", method_len)) ? FRAC : ERROR;
          break;
+      case 't':
+         par_TF.nthreads = atoi(optarg);
+         break;
+      case 'w':
+         par_TF.qwindow = atoi(optarg);
+         break;
       default:
         fprintf(stderr, "%s: option `-%c' is invalid: ignored\n",
                            argv[0], optopt);
@@ -347,6 +385,14 @@ void getarg_trimFilter(int argc, char **argv) {
     fprintf(stderr, "   Adapter fasta files: %s\n", par_TF.ad.ad_fa);
     fprintf(stderr, "   Number of mismatches: %d\n", par_TF.ad.mismatches);
     fprintf(stderr, "   Score threshold: %f\n", par_TF.ad.threshold);
+    fprintf(stderr, "   Matching: %s\n", (par_TF.ad.mode == MYERS) ?
+            "MYERS (mismatches and indels)" : "HAMMING (mismatches)");
+  }
+  if (par_TF.ad.mode != HAMMING && par_TF.ad.mode != MYERS) {
+    fprintf(stderr, "OPTION_ERROR: Invalid --admode option.\n");
+    fprintf(stderr, "Exiting program\n");
+    fprintf(stderr, "File: %s, line: %d\n", __FILE__, __LINE__);
+    exit(EXIT_FAILURE);
   }
   // handling minQ
   if (par_TF.minQ == 0) {
@@ -433,9 +479,31 @@ void getarg_trimFilter(int argc, char **argv) {
         fprintf(stderr, "File: %s, line: %d\n", __FILE__, __LINE__);
         exit(EXIT_FAILURE);
      }
+  } else if (par_TF.method == KMERSET) {
+     fprintf(stderr, "- Looking for contaminations with a kmer set.\n");
+     if (par_TF.is_fa == par_TF.is_idx) {
+        fprintf(stderr, "OPTION_ERROR: either a fasta or an index input file must\n");
+        fprintf(stderr, "              be given. Revise options with --help.\n");
+        fprintf(stderr, "Exiting program\n");
+        fprintf(stderr, "File: %s, line: %d\n", __FILE__, __LINE__);
+        exit(EXIT_FAILURE);
+     } else if (par_TF.is_fa) {
+        if (par_TF.kmersize < 1 || par_TF.kmersize > BF_ROLL_MAXK) {
+          fprintf(stderr, "OPTION_ERROR: lmer_len must be in [1, %d] for a kmer set.\n",
+                  BF_ROLL_MAXK);
+          fprintf(stderr, "Exiting program\n");
+          fprintf(stderr, "File: %s, line: %d\n", __FILE__, __LINE__);
+          exit(EXIT_FAILURE);
+        }
+        fprintf(stderr, "- Constructing kmer set on the flight from %s.\n", par_TF.Ifa);
+        fprintf(stderr, "- kmer length: %d\n", par_TF.kmersize);
+     } else {
+        fprintf(stderr, "- Reading kmer set from file %s.\n", par_TF.Iidx);
+     }
+     fprintf(stderr, "- Threshold score: %f\n", par_TF.score);
   } else {
      fprintf(stderr, "OPTION_ERROR: Invalid --method option.\n");
-     fprintf(stderr, "              Possible options: TREE, BLOOM\n");
+     fprintf(stderr, "              Possible options: TREE, BLOOM, KMERSET\n");
      fprintf(stderr, "              Revise your options with --help.\n");
      fprintf(stderr, "Exiting program\n");
      fprintf(stderr, "File: %s, line: %d\n", __FILE__, __LINE__);
@@ -465,9 +533,19 @@ void getarg_trimFilter(int argc, char **argv) {
   } else if (par_TF.trimQ == GLOBAL) {
     fprintf(stderr, "- Trimming low Q bases method: GLOBAL\n");
     fprintf(stderr, "- Trimming globally %d from left and %d from right\n", par_TF.globleft, par_TF.globright);
+  } else if (par_TF.trimQ == WINDOW) {
+    if (par_TF.qwindow == 0) {
+      par_TF.qwindow = DEFAULT_QWINDOW;
+    }
+    fprintf(stderr, "- Trimming low Q bases method: WINDOW\n");
+    fprintf(stderr, "- Ends trimmed up to windows of %d bases with mean "
+            "quality >= %d\n", par_TF.qwindow, par_TF.minQ);
+  } else if (par_TF.trimQ == MOTT) {
+    fprintf(stderr, "- Trimming low Q bases method: MOTT\n");
   } else {
       fprintf(stderr, "OPTION_ERROR: Invalid --trimQ option.\n");
-      fprintf(stderr, "              Possible options: NO, ALL, ENDS, FRAC, ENDSFRAC, GLOBAL.\n");
+      fprintf(stderr, "              Possible options: NO, ALL, ENDS, FRAC, ENDSFRAC, GLOBAL,\n");
+      fprintf(stderr, "              WINDOW, MOTT.\n");
       fprintf(stderr, "              Revise your options with --help.\n");
       fprintf(stderr, "Exiting program\n");
       fprintf(stderr, "File: %s, line: %d\n", __FILE__, __LINE__);
@@ -491,6 +569,18 @@ void getarg_trimFilter(int argc, char **argv) {
       fprintf(stderr, "File: %s, line: %d\n", __FILE__, __LINE__);
       exit(EXIT_FAILURE);
   }
+  if ((par_TF.trimQ != WINDOW) && (par_TF.qwindow != 0)) {
+      fprintf(stderr, "OPTION_ERROR: --window passed as an option, but WINDOW not passed to --trimQ.\n");
+      fprintf(stderr, "              Revise your options with --help.\n");
+      fprintf(stderr, "Exiting program\n");
+      fprintf(stderr, "File: %s, line: %d\n", __FILE__, __LINE__);
+      exit(EXIT_FAILURE);
+  } else if (par_TF.trimQ == WINDOW && par_TF.qwindow < 1) {
+      fprintf(stderr, "OPTION_ERROR: --window must be at least 1.\n");
+      fprintf(stderr, "Exiting program\n");
+      fprintf(stderr, "File: %s, line: %d\n", __FILE__, __LINE__);
+      exit(EXIT_FAILURE);
+  }
   if (par_TF.trimN == NO) {
      fprintf(stderr, "- Trimming reads with N's, method: NO\n");
   } else if (par_TF.trimN == ALL) {
@@ -519,4 +609,16 @@ void getarg_trimFilter(int argc, char **argv) {
   } else {
     fprintf(stderr, "- Minimum accepted trimmed read length: %d.\n", par_TF.minL);
   }
+  if (par_TF.nthreads == 0) {
+    par_TF.nthreads = 1;
+    fprintf(stderr, "- Number of threads: %d (default).\n", par_TF.nthreads);
+  } else if (par_TF.nthreads < 0 || par_TF.nthreads > MAX_THREADS) {
+    fprintf(stderr, "OPTION_ERROR: --threads must be in [1,%d].\n", MAX_THREADS);
+    fprintf(stderr, "              Revise your options with --help.\n");
+    fprintf(stderr, "Exiting program\n");
+    fprintf(stderr, "File: %s, line: %d\n", __FILE__, __LINE__);
+    exit(EXIT_FAILURE);
+  } else {
+    fprintf(stderr, "- Number of threads: %d.\n", par_TF.nthreads);
+  }
 }
@@ -20,7 +20,7 @@
 
 /**
  * @file io_trimFilter.c 
- * @brief buffer fq output, write summary file
+ * @brief write summary file
  * @author Paula Perez <paulaperezrubio@gmail.com>
  * @date 29.08.2017
  *
@@ -33,28 +33,6 @@
 #include "defines.h"
 
 
-/**
- * @brief buffers the output before writing to disk, writes out summary
- * @param fout FILE pointer where we might write to disk;
- * @param str string we want to add
- * @param len length of the string we want to add
- * @param fd_i identifier: GOOD, ADAP, CONT, LOWQ, NNNN
- *
- * */
-void buffer_output(FILE *fout, const char *str, const int len, const int fd_i) {
-  // defined static so that it doesn't get inizialized every time
-  static char buf[NFILTERS+1][B_LEN];
-  static int count[NFILTERS+1] = {0};
-  // empties the buffer if there is no "str" or buffer is full or len == 0
-  if (count[fd_i] + len >= B_LEN || str == NULL ||
-     (int)(strlen(str)) != len || len == 0) {
-     fwrite(buf[fd_i], 1, count[fd_i], fout);
-     count[fd_i] = 0;
-  }
-  memcpy(buf[fd_i]+count[fd_i] , str, len);
-  count[fd_i]+= len;
-}
-
 /**
  * @brief writes stats of filtering to summary file (binary)
  *
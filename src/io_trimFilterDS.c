@@ -20,7 +20,7 @@
 
 /**
  * @file io_trimFilter.c
- * @brief buffer fq output, write summary file
+ * @brief write summary file
  * @author Paula Perez <paulaperezrubio@gmail.com>
  * @date 29.08.2017
  *
@@ -33,30 +33,6 @@
 #include "defines.h"
 
 
-/**
- * @brief buffers the output before writing to disk
- * @param fout FILE pointer where we might write to disk;
- * @param str string we want to add
- * @param len length of the string we want to add
- * @param fd_i identifier: GOOD1, ADAP1, CONT1, LOWQ1, NNNN1,
- *                         GOOD2, ADAP2, CONT2, LOWQ2, NNNN2
- *
- *
- * */
-void buffer_outputDS(FILE *fout, const char *str, const int len, const int fd_i) {
-  // defined static so that it doesn't get inizialized every time
-  static char buf[NFILES_DS][B_LEN];
-  static int count[NFILES_DS] = {0};
-  // empties the buffer if there is no "str" or buffer is full or len == 0
-  if (count[fd_i] + len >= B_LEN || str == NULL ||
-     (int)(strlen(str)) != len || len == 0) {
-     fwrite(buf[fd_i], 1, count[fd_i], fout);
-     count[fd_i] = 0;
-  }
-  memcpy(buf[fd_i]+count[fd_i] , str, len);
-  count[fd_i]+= len;
-}
-
 /**
  * @brief writes stats of filtering to summary file (binary)
  *
@@ -0,0 +1,302 @@
+/****************************************************************************
+ * Copyright (C) 2017 by Paula Perez Rubio                                  *
+ *                                                                          *
+ * This file is part of FastqPuri.                                      *
+ *                                                                          *
+ *   FastqPuri is free software: you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as                *
+ *   published by the Free Software Foundation, either version 3 of the     *
+ *   License, or (at your option) any later version.                        *
+ *                                                                          *
+ *   FastqPuri is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *   GNU General Public License for more details.                           *
+ *                                                                          *
+ *   You should have received a copy of the GNU General Public License      *
+ *   along with FastqPuri.                                              *
+ *   If not, see <http://www.gnu.org/licenses/>.                            *
+ ****************************************************************************/
+
+/**
+ * @file kmerset.c
+ * @author Paula Perez <paulaperezrubio@gmail.com>
+ * @date 17.10.2026
+ * @brief exact kmer set (open addressing hash table of 2-bit kmers)
+ *
+ * */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "kmerset.h"
+#include "fa_read.h"
+#include "fopen_gen.h"
+#include "mmap_gen.h"
+
+extern uint64_t alloc_mem;  // global variable: memory allocated in the heap.
+
+/**
+ * @brief 64 bit mixing function (finalizer of splitmix64)
+ * */
+static uint64_t mix64(uint64_t x) {
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+  return x ^ (x >> 31);
+}
+
+/**
+ * @brief canonical kmer: the smaller of the forward and reverse complement
+ *        rolled kmers
+ * */
+static uint64_t canonical(Bfkmer *ptr_bfkmer) {
+  return (ptr_bfkmer -> fw < ptr_bfkmer -> rc) ? ptr_bfkmer -> fw :
+                                                 ptr_bfkmer -> rc;
+}
+
+/**
+ * @brief allocates an empty kmer set
+ * @param kmersize kmer size (<= BF_ROLL_MAXK)
+ * @param maxelem maximal number of kmers that will be inserted
+ * @return pointer to Kmerset structure
+ *
+ * The table is the smallest power of two keeping the load factor under
+ * KSET_MAXLOAD for maxelem kmers.
+ * */
+Kmerset *init_Kmerset(int kmersize, uint64_t maxelem) {
+  Kmerset *ptr_ks = calloc(1, sizeof(Kmerset));
+  ptr_ks -> kmersize = kmersize;
+  ptr_ks -> nslots = 2;
+  while (ptr_ks -> nslots * KSET_MAXLOAD < maxelem + 1) {
+    ptr_ks -> nslots <<= 1;
+  }
+  ptr_ks -> mask = ptr_ks -> nslots - 1;
+  ptr_ks -> table = malloc(ptr_ks -> nslots * sizeof(uint64_t));
+  if (ptr_ks -> table == NULL) {
+    fprintf(stderr, "Error occured. Could not allocate %" PRIu64 " Bytes.\n",
+           ptr_ks -> nslots * sizeof(uint64_t));
+    fprintf(stderr, "File: %s, line: %d\n", __FILE__, __LINE__);
+    fprintf(stderr, "Exiting program.\n");
+    exit(EXIT_FAILURE);
+  }
+  memset(ptr_ks -> table, 0xFF, ptr_ks -> nslots * sizeof(uint64_t));
+  alloc_mem += sizeof(Kmerset) + ptr_ks -> nslots * sizeof(uint64_t);
+  return ptr_ks;
+}
+
+/**
+ * @brief frees a kmer set (or unmaps it, for mapped sets)
+ * */
+void free_Kmerset(Kmerset *ptr_ks) {
+  if (ptr_ks -> mapsize) {
+    munmap_gen(ptr_ks -> map, ptr_ks -> mapsize);
+  } else {
+    free(ptr_ks -> table);
+    alloc_mem -= ptr_ks -> nslots * sizeof(uint64_t);
+  }
+  free(ptr_ks);
+  alloc_mem -= sizeof(Kmerset);
+}
+
+/**
+ * @brief inserts the rolled kmer of ptr_bfkmer in a kmer set
+ * @param ptr_ks pointer to Kmerset structure
+ * @param ptr_bfkmer kmer rolled in with roll_kmer
+ * @return true if the kmer was already in the set
+ *
+ * */
+bool insert_kmer(Kmerset *ptr_ks, Bfkmer *ptr_bfkmer) {
+  uint64_t kmer = canonical(ptr_bfkmer);
+  uint64_t i = mix64(kmer) & ptr_ks -> mask;
+  while (ptr_ks -> table[i] != KSET_EMPTY) {
+    if (ptr_ks -> table[i] == kmer) {
+      return true;
+    }
+    i = (i + 1) & ptr_ks -> mask;
+  }
+  if (ptr_ks -> nelem + 1 >= ptr_ks -> nslots) {
+    fprintf(stderr, "Kmer set is full (%" PRIu64 " slots).\n",
+           ptr_ks -> nslots);
+    fprintf(stderr, "File: %s, line: %d\n", __FILE__, __LINE__);
+    fprintf(stderr, "Exiting program.\n");
+    exit(EXIT_FAILURE);
+  }
+  ptr_ks -> table[i] = kmer;
+  ptr_ks -> nelem++;
+  return false;
+}
+
+/**
+ * @brief checks whether the rolled kmer of ptr_bfkmer is in a kmer set
+ * @param ptr_ks pointer to Kmerset structure
+ * @param ptr_bfkmer kmer rolled in with roll_kmer
+ * @return true if the kmer is in the set (no false positives)
+ *
+ * */
+bool contains_kmer(Kmerset *ptr_ks, Bfkmer *ptr_bfkmer) {
+  uint64_t kmer = canonical(ptr_bfkmer);
+  uint64_t i = mix64(kmer) & ptr_ks -> mask;
+  const uint64_t *table = ptr_ks -> table;
+  while (table[i] != KSET_EMPTY) {
+    if (table[i] == kmer) {
+      return true;
+    }
+    i = (i + 1) & ptr_ks -> mask;
+  }
+  return false;
+}
+
+/**
+ * @brief creates a kmer set from a fasta file
+ * @param fastafile path to the fasta file
+ * @param kmersize kmer size (<= BF_ROLL_MAXK)
+ * @return pointer to Kmerset structure containing all kmers of fastafile
+ *
+ * The fasta file is streamed twice (see Fa_stream): the first pass counts
+ * the kmers to size the table, the second one inserts them.
+ * */
+Kmerset *create_Kmerset(char *fastafile, int kmersize) {
+  uint64_t nbases = 0;
+  uint64_t maxelem = nkmers_fa(fastafile, kmersize, &nbases);
+  init_LUTs();
+  Kmerset *ptr_ks = init_Kmerset(kmersize, maxelem);
+  Bfkmer *ptr_bfkmer = init_Bfkmer(kmersize, 1);
+  fprintf(stderr, "Creating a kmer set.\n");
+  fprintf(stderr, "- kmersize: %d\n", kmersize);
+  fprintf(stderr, "- number of nucleotides: %" PRIu64 "\n", nbases);
+  fprintf(stderr, "- number of slots: %" PRIu64 " (%" PRIu64 " bytes)\n",
+          ptr_ks -> nslots, ptr_ks -> nslots * sizeof(uint64_t));
+  Fa_stream *ptr_fs = open_fa_stream(fastafile, kmersize - 1);
+  while (next_fa_chunk(ptr_fs)) {
+    int position;
+    ptr_bfkmer -> nvalid = 0;
+    for (position = 0; position < ptr_fs -> N; position++) {
+      if (roll_kmer(ptr_bfkmer, (unsigned char)(ptr_fs -> chunk[position]))) {
+        insert_kmer(ptr_ks, ptr_bfkmer);
+      }
+    }
+  }
+  close_fa_stream(ptr_fs);
+  free_Bfkmer(ptr_bfkmer);
+  free(ptr_bfkmer);
+  fprintf(stderr, "- number of distinct kmers: %" PRIu64 "\n",
+          ptr_ks -> nelem);
+  return ptr_ks;
+}
+
+/**
+ * @brief saves a kmer set to disk
+ * @param ptr_ks pointer to Kmerset structure
+ * @param filename path to the output file
+ *
+ * The file contains a KSET_HEADER bytes header: KSET_MAGIC, kmersize
+ * (int32_t), 4 bytes set to 0, nelem and nslots (uint64_t); followed by
+ * the table. Uncompressed files are mapped in memory by read_Kmerset.
+ * */
+void save_Kmerset(Kmerset *ptr_ks, char *filename) {
+  int32_t header[2] = {ptr_ks -> kmersize, 0};
+  FILE *f = fopen_gen(filename, "w");
+  if (f == NULL) {
+    fprintf(stderr, "Error encountered when trying to open file %s.\n",
+           filename);
+    fprintf(stderr, "File: %s, line: %d\n", __FILE__, __LINE__);
+    fprintf(stderr, "Exiting program.\n");
+    exit(EXIT_FAILURE);
+  }
+  fwrite(KSET_MAGIC, sizeof(char), KSET_MAGIC_LEN, f);
+  fwrite(header, sizeof(int32_t), 2, f);
+  fwrite(&(ptr_ks -> nelem), sizeof(uint64_t), 1, f);
+  fwrite(&(ptr_ks -> nslots), sizeof(uint64_t), 1, f);
+  fwrite(ptr_ks -> table, sizeof(uint64_t), ptr_ks -> nslots, f);
+  fclose(f);
+}
+
+/**
+ * @brief maps a kmer set file in memory
+ * @param filename path to the kmer set file
+ * @return pointer to a mapped Kmerset structure, NULL if filename could
+ *         not be mapped
+ *
+ * */
+static Kmerset *map_Kmerset(char *filename) {
+  size_t mapsize;
+  unsigned char *map = mmap_gen(filename, KSET_HEADER, &mapsize);
+  if (map == NULL) {
+    return NULL;
+  }
+  if (memcmp(map, KSET_MAGIC, KSET_MAGIC_LEN)) {
+    munmap_gen(map, mapsize);
+    return NULL;
+  }
+  Kmerset *ptr_ks = calloc(1, sizeof(Kmerset));
+  alloc_mem += sizeof(Kmerset);
+  int32_t kmersize;
+  memcpy(&kmersize, map + KSET_MAGIC_LEN, sizeof(int32_t));
+  memcpy(&(ptr_ks -> nelem), map + KSET_MAGIC_LEN + 8, sizeof(uint64_t));
+  memcpy(&(ptr_ks -> nslots), map + KSET_MAGIC_LEN + 16, sizeof(uint64_t));
+  ptr_ks -> kmersize = kmersize;
+  ptr_ks -> mask = ptr_ks -> nslots - 1;
+  if (mapsize != KSET_HEADER + ptr_ks -> nslots * sizeof(uint64_t)) {
+    fprintf(stderr, "Kmer set file %s is corrupted: %" PRIu64 " bytes found,",
+           filename, (uint64_t)mapsize);
+    fprintf(stderr, " %" PRIu64 " expected.\n",
+           KSET_HEADER + ptr_ks -> nslots * sizeof(uint64_t));
+    fprintf(stderr, "File: %s, line: %d\n", __FILE__, __LINE__);
+    fprintf(stderr, "Exiting program.\n");
+    exit(EXIT_FAILURE);
+  }
+  ptr_ks -> map = map;
+  ptr_ks -> mapsize = mapsize;
+  ptr_ks -> table = (uint64_t *)(map + KSET_HEADER);
+  return ptr_ks;
+}
+
+/**
+ * @brief reads a kmer set from disk
+ * @param filename path to the kmer set file (see save_Kmerset)
+ * @return pointer to Kmerset structure
+ *
+ * Uncompressed files are mapped in memory (map_Kmerset), compressed ones
+ * are read in a table allocated on the heap.
+ * */
+Kmerset *read_Kmerset(char *filename) {
+  fprintf(stderr, "- Reading a kmer set from %s\n", filename);
+  Kmerset *ptr_ks = map_Kmerset(filename);
+  if (ptr_ks == NULL) {
+    char magic[KSET_MAGIC_LEN];
+    int32_t header[2];
+    uint64_t nelem = 0, nslots = 0;
+    FILE *f = fopen_gen(filename, "r");
+    if (f == NULL ||
+        fread(magic, sizeof(char), KSET_MAGIC_LEN, f) != KSET_MAGIC_LEN ||
+        memcmp(magic, KSET_MAGIC, KSET_MAGIC_LEN) ||
+        fread(header, sizeof(int32_t), 2, f) != 2 ||
+        fread(&nelem, sizeof(uint64_t), 1, f) != 1 ||
+        fread(&nslots, sizeof(uint64_t), 1, f) != 1) {
+      fprintf(stderr, "Could not read a kmer set from %s.\n", filename);
+      fprintf(stderr, "File: %s, line: %d\n", __FILE__, __LINE__);
+      fprintf(stderr, "Exiting program.\n");
+      exit(EXIT_FAILURE);
+    }
+    ptr_ks = calloc(1, sizeof(Kmerset));
+    alloc_mem += sizeof(Kmerset);
+    ptr_ks -> kmersize = header[0];
+    ptr_ks -> nelem = nelem;
+    ptr_ks -> nslots = nslots;
+    ptr_ks -> mask = nslots - 1;
+    ptr_ks -> table = malloc(nslots * sizeof(uint64_t));
+    if (ptr_ks -> table == NULL ||
+        fread(ptr_ks -> table, sizeof(uint64_t), nslots, f) != nslots) {
+      fprintf(stderr, "Could not read a kmer set from %s.\n", filename);
+      fprintf(stderr, "File: %s, line: %d\n", __FILE__, __LINE__);
+      fprintf(stderr, "Exiting program.\n");
+      exit(EXIT_FAILURE);
+    }
+    alloc_mem += nslots * sizeof(uint64_t);
+    fclose(f);
+  }
+  fprintf(stderr, "- kmersize: %d\n", ptr_ks -> kmersize);
+  fprintf(stderr, "- number of kmers: %" PRIu64 "\n", ptr_ks -> nelem);
+  fprintf(stderr, "- number of slots: %" PRIu64 "\n", ptr_ks -> nslots);
+  return ptr_ks;
+}
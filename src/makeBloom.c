@@ -66,16 +66,25 @@ int main(int argc, char *argv[]) {
   fprintf(stderr, "- kmersize: %d\n", par_MB.kmersize);
   fprintf(stderr, "- Filter output file : %s\n", par_MB.filterfile);
   fprintf(stderr, "- Param output file : %s\n", par_MB.paramfile);
+  fprintf(stderr, "- Blocked filter : %s\n", par_MB.blocked ? "yes" : "no");
+  fprintf(stderr, "- Number of threads : %d\n", par_MB.nthreads);
+  fprintf(stderr, "- Minimizer window : %d\n", par_MB.window);
 
-  // Read fasta file
-  Fa_data *ptr_fa = malloc(sizeof(Fa_data));
-  fprintf(stderr, "* STEP 1: Reading fasta file ...\n ");
-  read_fasta(par_MB.inputfasta, ptr_fa);
+  // Obtaining the number of elements that the filter will have (the fasta
+  // file is streamed, never loaded as a whole)
+  fprintf(stderr, "* STEP 1: Counting kmers in fasta file ...\n ");
+  uint64_t nbases = 0;
+  par_MB.nelem = nkmers_fa(par_MB.inputfasta, par_MB.kmersize, &nbases);
+  fprintf(stderr, "- Number of nucleotides: %" PRIu64 "\n", nbases);
+  if (par_MB.window > 1) {
+    // about 2/(window + 1) of the kmers are minimizers
+    par_MB.nelem = (uint64_t)ceil(2.0*par_MB.nelem/(par_MB.window + 1));
+    fprintf(stderr, "- Expected number of minimizers: %" PRIu64 "\n",
+            par_MB.nelem);
+  }
 
-  // Obtaining the number of elements that the filter will have and setting
-  // all parameters
+  // Setting all parameters
   fprintf(stderr, "* STEP 2: Setting parameters for the filter ... \n");
-  par_MB.nelem = nkmers(ptr_fa, par_MB.kmersize);
 
   if (fabs(par_MB.falsePosRate) > ZERO_POS_RATE) {
       par_MB.bfsizeBits = (uint64_t)(-log(1.0* par_MB.falsePosRate)
@@ -96,22 +105,24 @@ int main(int argc, char *argv[]) {
      fprintf(stderr, "File: %s, line: %d\n", __FILE__, __LINE__);
      exit(EXIT_FAILURE);
   }
+  // A blocked filter is made of whole blocks (rounded up)
+  if (par_MB.blocked &&
+      (par_MB.bfsizeBits % BF_BLOCK_BITS || par_MB.bfsizeBits == 0)) {
+      par_MB.bfsizeBits += BF_BLOCK_BITS - par_MB.bfsizeBits % BF_BLOCK_BITS;
+  }
 
   // Constructing  bloom filter
   fprintf(stderr, "* STEP 3: Constructing bloomfilter ... \n");
-  Bfilter *ptr_bf = create_Bfilter(ptr_fa, par_MB.kmersize, par_MB.bfsizeBits,
-                    par_MB.hashNum, par_MB.falsePosRate, par_MB.nelem);
-
-  // Free fasta file
-  fprintf(stderr, "* STEP 4: Deallocating fasta file structure...\n");
-  free_fasta(ptr_fa);
+  Bfilter *ptr_bf = create_Bfilter(par_MB.inputfasta, par_MB.kmersize, par_MB.bfsizeBits,
+                    par_MB.hashNum, par_MB.falsePosRate, par_MB.nelem,
+                    par_MB.blocked, par_MB.window, par_MB.nthreads);
 
   // Save bloomfilter
-  fprintf(stderr, "* STEP 5: Saving bloom filter to file ... \n");
+  fprintf(stderr, "* STEP 4: Saving bloom filter to file ... \n");
   save_Bfilter(ptr_bf, par_MB.filterfile, par_MB.paramfile);
 
   // Deallocating bloomfilter
-  fprintf(stderr, "* STEP 6: Deallocating bloomfilter ... \n");
+  fprintf(stderr, "* STEP 5: Deallocating bloomfilter ... \n");
   free_Bfilter(ptr_bf);
 
   // Obtaining elapsed time
@@ -0,0 +1,87 @@
+/****************************************************************************
+ * Copyright (C) 2017 by Paula Perez Rubio                                  *
+ *                                                                          *
+ * This file is part of FastqPuri.                                      *
+ *                                                                          *
+ *   FastqPuri is free software: you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as                *
+ *   published by the Free Software Foundation, either version 3 of the     *
+ *   License, or (at your option) any later version.                        *
+ *                                                                          *
+ *   FastqPuri is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *   GNU General Public License for more details.                           *
+ *                                                                          *
+ *   You should have received a copy of the GNU General Public License      *
+ *   along with FastqPuri.                                              *
+ *   If not, see <http://www.gnu.org/licenses/>.                            *
+ ****************************************************************************/
+
+/**
+ * @file makeKmerSet.c
+ * @author Paula Perez <paulaperezrubio@gmail.com>
+ * @date 17.10.2026
+ * @brief makeKmerSet main function
+ *
+ * This file contains the makeKmerSet main function. It reads a fasta file,
+ * stores all its canonical kmers in an exact kmer set and saves it to a
+ * file. See README_makeKmerSet.md for more details.
+ *
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+#include "defines.h"
+#include "kmerset.h"
+#include "init_makeKmerSet.h"
+
+uint64_t alloc_mem = 0;  /**< global variable. Memory allocated in the heap.*/
+Iparam_makeKmerSet par_MK;  /**< global variable: Input parameters of makeKmerSet.*/
+
+/**
+ * @brief makeKmerSet main function
+ *
+ * */
+int main(int argc, char *argv[]) {
+  clock_t start, end;
+  double cpu_time_used;
+  time_t rawtime;
+  struct tm * timeinfo;
+
+  // Start the clock
+  start = clock();
+  time(&rawtime);
+  timeinfo = localtime(&rawtime);
+
+  // Get arguments
+  fprintf(stderr, "makeKmerSet from FastqPuri\n");
+  getarg_makeKmerSet(argc, argv);
+  fprintf(stderr, "Starting makeKmerSet at: %s", asctime(timeinfo));
+  fprintf(stderr, "makeKmerSet exec: constructing and storing a kmer set.\n");
+  fprintf(stderr, "- Input file: %s\n", par_MK.inputfasta);
+  fprintf(stderr, "- kmersize: %d\n", par_MK.kmersize);
+  fprintf(stderr, "- Output file : %s\n", par_MK.outputfile);
+
+  // Constructing the kmer set (the fasta file is streamed)
+  fprintf(stderr, "* STEP 1: Constructing kmer set ... \n");
+  Kmerset *ptr_ks = create_Kmerset(par_MK.inputfasta, par_MK.kmersize);
+
+  // Save kmer set
+  fprintf(stderr, "* STEP 2: Saving kmer set to file ... \n");
+  save_Kmerset(ptr_ks, par_MK.outputfile);
+
+  // Deallocating kmer set
+  fprintf(stderr, "* STEP 3: Deallocating kmer set ... \n");
+  free_Kmerset(ptr_ks);
+
+  // Obtaining elapsed time
+  end = clock();
+  cpu_time_used = (double)(end - start)/CLOCKS_PER_SEC;
+  time(&rawtime);
+  timeinfo = localtime(&rawtime);
+  fprintf(stderr, "Finishing program at: %s", asctime(timeinfo) );
+  fprintf(stderr, "Time elapsed: %f s.\n", cpu_time_used);
+  return 0;
+}
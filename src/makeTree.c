@@ -63,13 +63,14 @@ int main(int argc, char *argv[]) {
   fprintf(stderr, "makeTree exec: constructing a tree and storing it\n.");
   fprintf(stderr, "- Input file: %s\n", par_MT.inputfasta);
   fprintf(stderr, "- Tree depth: %d\n", par_MT.L);
+  fprintf(stderr, "- Number of threads: %d\n", par_MT.nthreads);
   fprintf(stderr, "- Output file : %s\n", par_MT.outputfile);
 
-  // Read fasta file
-  Fa_data *ptr_fa = malloc(sizeof(Fa_data));
-  fprintf(stderr, "* STEP 1: Reading fasta file ...\n ");
-  read_fasta(par_MT.inputfasta, ptr_fa);
-  if (size_fasta(ptr_fa) > MAX_FASZ_TREE) {
+  // Check the size of the fasta file (streamed, never loaded as a whole)
+  uint64_t nbases = 0;
+  fprintf(stderr, "* STEP 1: Sweeping fasta file ...\n ");
+  nkmers_fa(par_MT.inputfasta, par_MT.L, &nbases);
+  if (nbases > MAX_FASZ_TREE) {
     fprintf(stderr, "Fasta file is larger than %d.\b", (int) MAX_FASZ_TREE);
     fprintf(stderr, "This is too large for constructing a tree.\n");
     fprintf(stderr, "Try a Suffix Array or a bloomfilter instead.\n");
@@ -80,18 +81,15 @@ int main(int argc, char *argv[]) {
 
   // Constructing tree
   fprintf(stderr, "* STEP 2: Constructing tree ... \n");
-  Tree *ptr_tree = tree_from_fasta(ptr_fa, par_MT.L);
-
-  // Free fasta file
-  fprintf(stderr, "* STEP 3: Deallocating fasta file structure...\n");
-  free_fasta(ptr_fa);
+  Tree *ptr_tree = tree_from_fasta(par_MT.inputfasta, par_MT.L,
+                                   par_MT.nthreads);
 
   // Save tree
-  fprintf(stderr, "* STEP 4: Saving tree to file ... \n");
+  fprintf(stderr, "* STEP 3: Saving tree to file ... \n");
   save_tree(ptr_tree, par_MT.outputfile);
 
   // Deallocating tree
-  fprintf(stderr, "* STEP 5: Deallocating tree structure ... \n");
+  fprintf(stderr, "* STEP 4: Deallocating tree structure ... \n");
   free_all_nodes(ptr_tree);
 
   // Obtaining elapsed time
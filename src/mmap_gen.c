@@ -0,0 +1,92 @@
+/****************************************************************************
+ * Copyright (C) 2017 by Paula Perez Rubio                                  *
+ *                                                                          *
+ * This file is part of FastqPuri.                                      *
+ *                                                                          *
+ *   FastqPuri is free software: you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as                *
+ *   published by the Free Software Foundation, either version 3 of the     *
+ *   License, or (at your option) any later version.                        *
+ *                                                                          *
+ *   FastqPuri is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *   GNU General Public License for more details.                           *
+ *                                                                          *
+ *   You should have received a copy of the GNU General Public License      *
+ *   along with FastqPuri.                                              *
+ *   If not, see <http://www.gnu.org/licenses/>.                            *
+ ****************************************************************************/
+
+/**
+ * @file mmap_gen.c
+ * @author Paula Perez <paulaperezrubio@gmail.com>
+ * @date 17.10.2026
+ * @brief Read-only memory mapping of index files (Bloom filters, trees).
+ *
+ * Index files are mapped with MAP_SHARED, so that all processes running
+ * on a host with the same index share one copy of it in the page cache,
+ * and queries run directly on the mapping. If MMAP_POPULATE is set in
+ * defines.h, the mapping is populated when it is created (MAP_POPULATE),
+ * avoiding page faults while querying.
+ *
+ * */
+
+#define _GNU_SOURCE  // MAP_POPULATE
+#include <stdio.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "mmap_gen.h"
+#include "defines.h"
+
+/**
+ * @brief maps a file in memory (read only)
+ * @param filename path to the file
+ * @param minsize the file is only mapped if it is larger than minsize
+ *        bytes (e.g. the size of a header)
+ * @param size will contain the size of the mapping (bytes)
+ * @return pointer to the mapping, NULL if the file could not be mapped
+ *
+ * The caller decides what to do if the file cannot be mapped (e.g.
+ * compressed files, file systems not supporting mmap): usually, fall
+ * back to reading the file with fread.
+ *
+ * */
+void *mmap_gen(const char *filename, size_t minsize, size_t *size) {
+  struct stat st;
+  int fd = open(filename, O_RDONLY);
+  if (fd < 0) {
+    return NULL;
+  }
+  if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) ||
+      (uint64_t)st.st_size <= minsize) {
+    close(fd);
+    return NULL;
+  }
+  int flags = MAP_SHARED;
+#if MMAP_POPULATE && defined(MAP_POPULATE)
+  flags |= MAP_POPULATE;
+#endif
+  void *map = mmap(NULL, st.st_size, PROT_READ, flags, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    return NULL;
+  }
+#ifdef MADV_HUGEPAGE
+  madvise(map, st.st_size, MADV_HUGEPAGE);  // advisory, failure is harmless
+#endif
+  *size = st.st_size;
+  return map;
+}
+
+/**
+ * @brief unmaps a mapping created with mmap_gen
+ * */
+void munmap_gen(void *map, size_t size) {
+  if (map != NULL && munmap(map, size) != 0) {
+    fprintf(stderr, "WARNING: could not unmap index file.\n");
+  }
+}
@@ -0,0 +1,440 @@
+/****************************************************************************
+ * Copyright (C) 2017 by Paula Perez Rubio                                  *
+ *                                                                          *
+ * This file is part of FastqPuri.                                      *
+ *                                                                          *
+ *   FastqPuri is free software: you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as                *
+ *   published by the Free Software Foundation, either version 3 of the     *
+ *   License, or (at your option) any later version.                        *
+ *                                                                          *
+ *   FastqPuri is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *   GNU General Public License for more details.                           *
+ *                                                                          *
+ *   You should have received a copy of the GNU General Public License      *
+ *   along with FastqPuri.                                              *
+ *   If not, see <http://www.gnu.org/licenses/>.                            *
+ ****************************************************************************/
+
+
+/**
+ * @file pipeline.c
+ * @brief ordered batch pipeline: one reader, N workers, one writer.
+ *        Buffers to collect and read batches of fq entries.
+ * @author Paula Perez <paulaperezrubio@gmail.com>
+ * @date 17.10.2026
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pipeline.h"
+#include "fq_split.h"
+
+#define EMPTY 0   /**< slot can be filled by the reader */
+#define FILLED 1  /**< slot waits for a worker */
+#define DONE 2    /**< slot waits for the writer */
+
+/**
+ * @brief worker thread: processes batches until the reader is done
+ * */
+static void *worker_loop(void *arg) {
+  Pipeline *ptr_pl = (Pipeline *)arg;
+  pthread_mutex_lock(&(ptr_pl -> lock));
+  void *worker_arg = ptr_pl -> worker_arg[ptr_pl -> nstarted++];
+  while (1) {
+    while (ptr_pl -> nwork == ptr_pl -> nread && !(ptr_pl -> eof)) {
+      pthread_cond_wait(&(ptr_pl -> cond), &(ptr_pl -> lock));
+    }
+    if (ptr_pl -> nwork == ptr_pl -> nread) break;
+    int i = (ptr_pl -> nwork++) % ptr_pl -> nslots;
+    pthread_mutex_unlock(&(ptr_pl -> lock));
+    ptr_pl -> work(ptr_pl -> slot[i], worker_arg);
+    pthread_mutex_lock(&(ptr_pl -> lock));
+    ptr_pl -> state[i] = DONE;
+    pthread_cond_broadcast(&(ptr_pl -> cond));
+  }
+  pthread_mutex_unlock(&(ptr_pl -> lock));
+  return NULL;
+}
+
+/**
+ * @brief writer thread: writes the processed batches in input order
+ * */
+static void *writer_loop(void *arg) {
+  Pipeline *ptr_pl = (Pipeline *)arg;
+  pthread_mutex_lock(&(ptr_pl -> lock));
+  while (1) {
+    int i = ptr_pl -> nwrite % ptr_pl -> nslots;
+    while (ptr_pl -> state[i] != DONE &&
+           !(ptr_pl -> eof && ptr_pl -> nwrite == ptr_pl -> nread)) {
+      pthread_cond_wait(&(ptr_pl -> cond), &(ptr_pl -> lock));
+    }
+    if (ptr_pl -> state[i] != DONE) break;
+    pthread_mutex_unlock(&(ptr_pl -> lock));
+    if (ptr_pl -> write != NULL) {
+      ptr_pl -> write(ptr_pl -> slot[i], ptr_pl -> writer_arg);
+    }
+    pthread_mutex_lock(&(ptr_pl -> lock));
+    ptr_pl -> state[i] = EMPTY;
+    ptr_pl -> nwrite++;
+    pthread_cond_broadcast(&(ptr_pl -> cond));
+  }
+  pthread_mutex_unlock(&(ptr_pl -> lock));
+  return NULL;
+}
+
+/**
+ * @brief initializes a pipeline and starts its worker and writer threads
+ * @param nthreads number of worker threads
+ * @param slot array of nslots batches, allocated by the caller
+ * @param nslots number of batches (should be larger than nthreads)
+ * @param work function processing a batch
+ * @param worker_arg array of nthreads arguments, one for every worker
+ * @param write function writing a processed batch, or NULL if the batches
+ *        are only given back to the reader once processed
+ * @param writer_arg argument passed to write
+ * @return pointer to the running pipeline
+ *
+ * */
+Pipeline *init_pipeline(int nthreads, void **slot, int nslots,
+                        work_fn work, void **worker_arg,
+                        write_fn write, void *writer_arg) {
+  int i;
+  Pipeline *ptr_pl = calloc(1, sizeof(Pipeline));
+  ptr_pl -> state = calloc(nslots, sizeof(int));
+  ptr_pl -> workers = calloc(nthreads, sizeof(pthread_t));
+  if (ptr_pl -> state == NULL || ptr_pl -> workers == NULL) {
+    fprintf(stderr, "Could not allocate memory for the pipeline.\n");
+    fprintf(stderr, "File: %s, line: %d\n", __FILE__, __LINE__);
+    fprintf(stderr, "Exiting program.\n");
+    exit(EXIT_FAILURE);
+  }
+  ptr_pl -> nthreads = nthreads;
+  ptr_pl -> nslots = nslots;
+  ptr_pl -> slot = slot;
+  ptr_pl -> work = work;
+  ptr_pl -> worker_arg = worker_arg;
+  ptr_pl -> write = write;
+  ptr_pl -> writer_arg = writer_arg;
+  pthread_mutex_init(&(ptr_pl -> lock), NULL);
+  pthread_cond_init(&(ptr_pl -> cond), NULL);
+  for (i = 0; i < nthreads; i++) {
+    if (pthread_create(ptr_pl -> workers + i, NULL, worker_loop, ptr_pl)) {
+      fprintf(stderr, "Could not create worker thread %d.\n", i);
+      fprintf(stderr, "File: %s, line: %d\n", __FILE__, __LINE__);
+      fprintf(stderr, "Exiting program.\n");
+      exit(EXIT_FAILURE);
+    }
+  }
+  if (pthread_create(&(ptr_pl -> writer), NULL, writer_loop, ptr_pl)) {
+    fprintf(stderr, "Could not create writer thread.\n");
+    fprintf(stderr, "File: %s, line: %d\n", __FILE__, __LINE__);
+    fprintf(stderr, "Exiting program.\n");
+    exit(EXIT_FAILURE);
+  }
+  return ptr_pl;
+}
+
+/**
+ * @brief returns the next batch to be filled by the reader
+ *
+ * Blocks until the batch that occupied the slot before has been written.
+ * The batch is handed over to the workers with pipeline_push.
+ * */
+void *pipeline_next(Pipeline *ptr_pl) {
+  int i = ptr_pl -> nread % ptr_pl -> nslots;
+  pthread_mutex_lock(&(ptr_pl -> lock));
+  while (ptr_pl -> state[i] != EMPTY) {
+    pthread_cond_wait(&(ptr_pl -> cond), &(ptr_pl -> lock));
+  }
+  pthread_mutex_unlock(&(ptr_pl -> lock));
+  return ptr_pl -> slot[i];
+}
+
+/**
+ * @brief hands the batch obtained with pipeline_next over to the workers
+ * */
+void pipeline_push(Pipeline *ptr_pl) {
+  pthread_mutex_lock(&(ptr_pl -> lock));
+  ptr_pl -> state[ptr_pl -> nread % ptr_pl -> nslots] = FILLED;
+  ptr_pl -> nread++;
+  pthread_cond_broadcast(&(ptr_pl -> cond));
+  pthread_mutex_unlock(&(ptr_pl -> lock));
+}
+
+/**
+ * @brief signals the end of the input, waits until every batch has been
+ *        written and frees the pipeline (not the batches).
+ * */
+void free_pipeline(Pipeline *ptr_pl) {
+  int i;
+  pthread_mutex_lock(&(ptr_pl -> lock));
+  ptr_pl -> eof = true;
+  pthread_cond_broadcast(&(ptr_pl -> cond));
+  pthread_mutex_unlock(&(ptr_pl -> lock));
+  for (i = 0; i < ptr_pl -> nthreads; i++) {
+    pthread_join(ptr_pl -> workers[i], NULL);
+  }
+  pthread_join(ptr_pl -> writer, NULL);
+  pthread_mutex_destroy(&(ptr_pl -> lock));
+  pthread_cond_destroy(&(ptr_pl -> cond));
+  free(ptr_pl -> state);
+  free(ptr_pl -> workers);
+  free(ptr_pl);
+}
+
+/**
+ * @brief enlarges an output buffer so that len more chars fit in it
+ * */
+static void buffer_grow(Obuffer *ob, const int len) {
+  int size = (ob -> size) ? ob -> size : B_LEN;
+  while (ob -> count + len > size) size *= 2;
+  ob -> buf = realloc(ob -> buf, size);
+  if (ob -> buf == NULL) {
+    fprintf(stderr, "Could not allocate memory for an output buffer.\n");
+    fprintf(stderr, "File: %s, line: %d\n", __FILE__, __LINE__);
+    fprintf(stderr, "Exiting program.\n");
+    exit(EXIT_FAILURE);
+  }
+  ob -> size = size;
+}
+
+/**
+ * @brief appends a string to a growing output buffer
+ * @param ob pointer to Obuffer (zero initialized before the first call)
+ * @param str string we want to add
+ * @param len length of the string we want to add
+ *
+ * The buffer belongs to the caller, so that every thread can collect its
+ * output without locking.
+ * */
+void buffer_append(Obuffer *ob, const char *str, const int len) {
+  if (ob -> count + len > ob -> size) buffer_grow(ob, len);
+  memcpy(ob -> buf + ob -> count, str, len);
+  ob -> count += len;
+}
+
+/**
+ * @brief appends a list of segments to a growing output buffer, like writev
+ * @param ob pointer to Obuffer (zero initialized before the first call)
+ * @param iov segments we want to add
+ * @param n number of segments
+ *
+ * */
+void buffer_appendv(Obuffer *ob, const struct iovec *iov, const int n) {
+  int i, len = 0;
+  for (i = 0; i < n; i++) {
+    len += iov[i].iov_len;
+  }
+  if (ob -> count + len > ob -> size) buffer_grow(ob, len);
+  for (i = 0; i < n; i++) {
+    memcpy(ob -> buf + ob -> count, iov[i].iov_base, iov[i].iov_len);
+    ob -> count += iov[i].iov_len;
+  }
+}
+
+/**
+ * @brief writes the content of an output buffer to disk and empties it
+ * */
+void buffer_flush(Obuffer *ob, FILE *fout) {
+  if (ob -> count > 0) {
+    fwrite(ob -> buf, 1, ob -> count, fout);
+  }
+  ob -> count = 0;
+}
+
+/**
+ * @brief frees the memory allocated in an output buffer
+ * */
+void free_Obuffer(Obuffer *ob) {
+  free(ob -> buf);
+  ob -> buf = NULL;
+  ob -> count = 0;
+  ob -> size = 0;
+}
+
+/**
+ * @brief appends the line ends of entries to a growing buffer
+ * @param eb pointer to Ebuffer (zero initialized before the first call)
+ * @param ends line ends we want to add
+ * @param n number of line ends
+ * @param offset added to every line end
+ * */
+static void ebuffer_append(Ebuffer *eb, const int *ends, const int n,
+                           const int offset) {
+  int i;
+  if (eb -> count + n > eb -> size) {
+    int size = (eb -> size) ? eb -> size : B_LEN/64;
+    while (eb -> count + n > size) size *= 2;
+    eb -> end = realloc(eb -> end, size*sizeof(int));
+    if (eb -> end == NULL) {
+      fprintf(stderr, "Could not allocate memory for the line ends.\n");
+      fprintf(stderr, "File: %s, line: %d\n", __FILE__, __LINE__);
+      fprintf(stderr, "Exiting program.\n");
+      exit(EXIT_FAILURE);
+    }
+    eb -> size = size;
+  }
+  for (i = 0; i < n; i++) {
+    eb -> end[eb -> count++] = ends[i] + offset;
+  }
+}
+
+/**
+ * @brief frees the memory allocated in a buffer of line ends
+ * */
+void free_Ebuffer(Ebuffer *eb) {
+  free(eb -> end);
+  eb -> end = NULL;
+  eb -> count = 0;
+  eb -> size = 0;
+}
+
+/**
+ * @brief initializes a Fq_reader for the (already opened) file f
+ * */
+Fq_reader *init_Fq_reader(FILE *f) {
+  Fq_reader *ptr_rd = calloc(1, sizeof(Fq_reader));
+  ptr_rd -> buffer = malloc(sizeof(char)*(B_LEN + 1));
+  ptr_rd -> ends = malloc(sizeof(int)*B_LEN);
+  ptr_rd -> view = malloc(sizeof(int)*B_LEN);
+  if (ptr_rd -> buffer == NULL || ptr_rd -> ends == NULL ||
+      ptr_rd -> view == NULL) {
+    fprintf(stderr, "Could not allocate memory for the input buffer.\n");
+    fprintf(stderr, "File: %s, line: %d\n", __FILE__, __LINE__);
+    fprintf(stderr, "Exiting program.\n");
+    exit(EXIT_FAILURE);
+  }
+  ptr_rd -> f = f;
+  return ptr_rd;
+}
+
+/**
+ * @brief moves the entries not yet handed out to the front of the buffer,
+ *        reads the next chunk of the file after them and indexes the
+ *        complete entries
+ * */
+static void fill_buffer(Fq_reader *ptr_rd) {
+  char *buffer = ptr_rd -> buffer;
+  int rest = ptr_rd -> len - ptr_rd -> pos;
+  if (rest == B_LEN) {
+    fprintf(stderr, "Found a fq entry longer than %d chars.\n", B_LEN);
+    fprintf(stderr, "File: %s, line: %d\n", __FILE__, __LINE__);
+    fprintf(stderr, "Exiting program.\n");
+    exit(EXIT_FAILURE);
+  }
+  memmove(buffer, buffer + ptr_rd -> pos, rest);
+  ptr_rd -> len = rest;
+  ptr_rd -> pos = 0;
+  int newlen = fread(buffer + rest, 1, B_LEN - rest, ptr_rd -> f);
+  if (newlen <= 0) {
+    ptr_rd -> eof = true;
+  } else {
+    ptr_rd -> len += newlen;
+  }
+  ptr_rd -> nentries = split_fq(buffer, ptr_rd -> len, ptr_rd -> ends,
+                                &(ptr_rd -> nl));
+  ptr_rd -> next = 0;
+}
+
+/**
+ * @brief hands out up to n of the indexed entries
+ * @return number of entries handed out
+ * */
+static int take_entries(Fq_reader *ptr_rd, int n) {
+  int avail = ptr_rd -> nentries - ptr_rd -> next;
+  if (n > avail) n = avail;
+  ptr_rd -> next += n;
+  ptr_rd -> pos = (ptr_rd -> next) ?
+                  ptr_rd -> ends[4*(ptr_rd -> next) - 1] + 1 : 0;
+  ptr_rd -> nlines += 4*n;
+  return n;
+}
+
+/**
+ * @brief appends up to n complete fq entries to ob
+ * @param ptr_rd pointer to Fq_reader
+ * @param ob output buffer where the entries are appended
+ * @param eb if not NULL, the ends of their lines (relative to the first
+ *        entry appended to ob) are appended to it
+ * @param n maximum number of entries
+ * @return number of entries appended (smaller than n only at the end
+ *         of the file)
+ *
+ * Lines are delimited by '\n', and a trailing line without it is ignored,
+ * like in the sequential loops of trimFilter and trimFilterPE. After the
+ * end of the file, ptr_rd -> nl contains the number of lines of an
+ * incomplete last entry.
+ * */
+int read_entries(Fq_reader *ptr_rd, Obuffer *ob, Ebuffer *eb, int n) {
+  int nentries = 0;
+  int start = ob -> count;
+  while (1) {
+    int first = ptr_rd -> next;
+    int pos = ptr_rd -> pos;
+    int k = take_entries(ptr_rd, n - nentries);
+    if (eb != NULL) {
+      ebuffer_append(eb, ptr_rd -> ends + 4*first, 4*k,
+                     ob -> count - start - pos);
+    }
+    buffer_append(ob, ptr_rd -> buffer + pos, ptr_rd -> pos - pos);
+    nentries += k;
+    if (nentries == n || ptr_rd -> eof) break;
+    fill_buffer(ptr_rd);
+  }
+  return nentries;
+}
+
+/**
+ * @brief hands out up to n complete fq entries without copying them
+ * @param ptr_rd pointer to Fq_reader
+ * @param entries set to the first entry, in the buffer of ptr_rd
+ * @param ends set to the ends of their lines, relative to *entries
+ * @param n maximum number of entries
+ * @return number of entries (0 only at the end of the file)
+ *
+ * Less than n entries are handed out only if they fill the buffer or at
+ * the end of the file. They remain valid (and can be modified) until the
+ * next call.
+ * */
+int view_entries(Fq_reader *ptr_rd, char **entries, int **ends, int n) {
+  while (1) {
+    int avail = ptr_rd -> nentries - ptr_rd -> next;
+    if (avail >= n || ptr_rd -> eof) break;
+    if (avail > 0 && ptr_rd -> pos == 0 && ptr_rd -> len == B_LEN) break;
+    fill_buffer(ptr_rd);
+  }
+  int first = ptr_rd -> next;
+  int pos = ptr_rd -> pos;
+  int i, k = take_entries(ptr_rd, n);
+  for (i = 0; i < 4*k; i++) {
+    ptr_rd -> view[i] = ptr_rd -> ends[4*first + i] - pos;
+  }
+  *entries = ptr_rd -> buffer + pos;
+  *ends = ptr_rd -> view;
+  return k;
+}
+
+/**
+ * @brief gives back the last n entries handed out by view_entries, so that
+ *        they are handed out again by the next call
+ * @param ptr_rd pointer to Fq_reader
+ * @param n number of entries (they must be unmodified)
+ * */
+void unview_entries(Fq_reader *ptr_rd, int n) {
+  take_entries(ptr_rd, -n);  // moves back over the last n entries
+}
+
+/**
+ * @brief frees a Fq_reader (the file is not closed)
+ * */
+void free_Fq_reader(Fq_reader *ptr_rd) {
+  free(ptr_rd -> buffer);
+  free(ptr_rd -> ends);
+  free(ptr_rd -> view);
+  free(ptr_rd);
+}
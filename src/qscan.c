@@ -0,0 +1,329 @@
+/****************************************************************************
+ * Copyright (C) 2017 by Paula Perez Rubio                                  *
+ *                                                                          *
+ * This file is part of FastqPuri.                                      *
+ *                                                                          *
+ *   FastqPuri is free software: you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as                *
+ *   published by the Free Software Foundation, either version 3 of the     *
+ *   License, or (at your option) any later version.                        *
+ *                                                                          *
+ *   FastqPuri is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of         *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the          *
+ *   GNU General Public License for more details.                           *
+ *                                                                          *
+ *   You should have received a copy of the GNU General Public License      *
+ *   along with FastqPuri.                                              *
+ *   If not, see <http://www.gnu.org/licenses/>.                            *
+ ****************************************************************************/
+
+/**
+ * @file qscan.c
+ * @brief scans of quality strings (lowQ bases) and sequences (N's).
+ * @author Paula Perez <paulaperezrubio@gmail.com>
+ * @date 17.10.2026
+ *
+ */
+
+#include <stdint.h>
+#include <limits.h>
+#include "qscan.h"
+#include "defines.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define QSCAN_X86
+#include <immintrin.h>
+#endif
+
+/**
+ * @brief mask with the lowest n bits set (0 <= n <= 64)
+ * */
+static uint64_t low_bits(int n) {
+  return (n >= 64) ? ~(uint64_t)0 : (((uint64_t)1 << n) - 1);
+}
+
+/**
+ * @brief sets bit j of the mask if qual[j] < thr, for j = i, ..., n - 1
+ *        (scalar version)
+ * */
+static uint64_t lowQ_scalar(const char *qual, int i, int n, char thr) {
+  uint64_t mask = 0;
+  for (; i < n; i++) {
+    mask |= (uint64_t)(qual[i] < thr) << i;
+  }
+  return mask;
+}
+
+/**
+ * @brief sets bit j of the mask if seq[j] is an N, for j = i, ..., n - 1
+ *        (scalar version)
+ * */
+static uint64_t N_scalar(const char *seq, int i, int n) {
+  uint64_t mask = 0;
+  for (; i < n; i++) {
+    char c = seq[i] | 0x20;  // lower case
+    mask |= (uint64_t)(c != 'a' && c != 'c' && c != 'g' && c != 't') << i;
+  }
+  return mask;
+}
+
+#ifdef QSCAN_X86
+/**
+ * @brief lowQ mask of n <= 64 quality chars, 16 at a time
+ * */
+__attribute__((target("sse2")))
+static uint64_t lowQ_sse2(const char *qual, int n, char thr) {
+  int i;
+  uint64_t mask = 0;
+  const __m128i t = _mm_set1_epi8(thr);
+  for (i = 0; i + 16 <= n; i += 16) {
+    __m128i q = _mm_loadu_si128((const __m128i *)(qual + i));
+    mask |= (uint64_t)(uint32_t)_mm_movemask_epi8(_mm_cmplt_epi8(q, t)) << i;
+  }
+  return mask | lowQ_scalar(qual, i, n, thr);
+}
+
+/**
+ * @brief lowQ mask of n <= 64 quality chars, 32 at a time
+ * */
+__attribute__((target("avx2")))
+static uint64_t lowQ_avx2(const char *qual, int n, char thr) {
+  int i;
+  uint64_t mask = 0;
+  const __m256i t = _mm256_set1_epi8(thr);
+  for (i = 0; i + 32 <= n; i += 32) {
+    __m256i q = _mm256_loadu_si256((const __m256i *)(qual + i));
+    mask |= (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpgt_epi8(t, q))
+            << i;
+  }
+  return mask | lowQ_scalar(qual, i, n, thr);
+}
+
+/**
+ * @brief lowQ mask of n <= 64 quality chars, in one masked load
+ * */
+__attribute__((target("avx512bw")))
+static uint64_t lowQ_avx512(const char *qual, int n, char thr) {
+  __mmask64 valid = low_bits(n);
+  __m512i q = _mm512_maskz_loadu_epi8(valid, qual);
+  return _mm512_mask_cmplt_epi8_mask(valid, q, _mm512_set1_epi8(thr));
+}
+
+/**
+ * @brief N mask of n <= 64 bases, 16 at a time
+ * */
+__attribute__((target("sse2")))
+static uint64_t N_sse2(const char *seq, int n) {
+  int i;
+  uint64_t mask = 0;
+  const __m128i lower = _mm_set1_epi8(0x20);
+  for (i = 0; i + 16 <= n; i += 16) {
+    __m128i c = _mm_or_si128(_mm_loadu_si128((const __m128i *)(seq + i)),
+                             lower);
+    __m128i base = _mm_or_si128(
+        _mm_or_si128(_mm_cmpeq_epi8(c, _mm_set1_epi8('a')),
+                     _mm_cmpeq_epi8(c, _mm_set1_epi8('c'))),
+        _mm_or_si128(_mm_cmpeq_epi8(c, _mm_set1_epi8('g')),
+                     _mm_cmpeq_epi8(c, _mm_set1_epi8('t'))));
+    mask |= (uint64_t)(~(uint32_t)_mm_movemask_epi8(base) & 0xffff) << i;
+  }
+  return mask | N_scalar(seq, i, n);
+}
+
+/**
+ * @brief N mask of n <= 64 bases, 32 at a time
+ * */
+__attribute__((target("avx2")))
+static uint64_t N_avx2(const char *seq, int n) {
+  int i;
+  uint64_t mask = 0;
+  const __m256i lower = _mm256_set1_epi8(0x20);
+  for (i = 0; i + 32 <= n; i += 32) {
+    __m256i c = _mm256_or_si256(
+        _mm256_loadu_si256((const __m256i *)(seq + i)), lower);
+    __m256i base = _mm256_or_si256(
+        _mm256_or_si256(_mm256_cmpeq_epi8(c, _mm256_set1_epi8('a')),
+                        _mm256_cmpeq_epi8(c, _mm256_set1_epi8('c'))),
+        _mm256_or_si256(_mm256_cmpeq_epi8(c, _mm256_set1_epi8('g')),
+                        _mm256_cmpeq_epi8(c, _mm256_set1_epi8('t'))));
+    mask |= (uint64_t)(~(uint32_t)_mm256_movemask_epi8(base)) << i;
+  }
+  return mask | N_scalar(seq, i, n);
+}
+
+/**
+ * @brief N mask of n <= 64 bases, in one masked load
+ * */
+__attribute__((target("avx512bw")))
+static uint64_t N_avx512(const char *seq, int n) {
+  __mmask64 valid = low_bits(n);
+  __m512i c = _mm512_or_si512(_mm512_maskz_loadu_epi8(valid, seq),
+                              _mm512_set1_epi8(0x20));
+  __mmask64 base = _mm512_cmpeq_epi8_mask(c, _mm512_set1_epi8('a')) |
+                   _mm512_cmpeq_epi8_mask(c, _mm512_set1_epi8('c')) |
+                   _mm512_cmpeq_epi8_mask(c, _mm512_set1_epi8('g')) |
+                   _mm512_cmpeq_epi8_mask(c, _mm512_set1_epi8('t'));
+  return ~base & valid;
+}
+#endif
+
+/**
+ * @brief bit j set if qual[j] < thr, for the n <= 64 first quality chars
+ *
+ * Thresholds out of the range of char give the same result as the
+ * comparison of the promoted chars (all or none are lowQ).
+ * */
+static uint64_t lowQ_mask(const char *qual, int n, int thr) {
+  if (thr > CHAR_MAX) {
+    return low_bits(n);
+  } else if (thr <= CHAR_MIN) {
+    return 0;
+  }
+#ifdef QSCAN_X86
+  if (__builtin_cpu_supports("avx512bw")) {
+    return lowQ_avx512(qual, n, (char)thr);
+  } else if (__builtin_cpu_supports("avx2")) {
+    return lowQ_avx2(qual, n, (char)thr);
+  } else if (__builtin_cpu_supports("sse2")) {
+    return lowQ_sse2(qual, n, (char)thr);
+  }
+#endif
+  return lowQ_scalar(qual, 0, n, (char)thr);
+}
+
+/**
+ * @brief bit j set if seq[j] is an N, for the n <= 64 first bases
+ * */
+static uint64_t N_mask(const char *seq, int n) {
+#ifdef QSCAN_X86
+  if (__builtin_cpu_supports("avx512bw")) {
+    return N_avx512(seq, n);
+  } else if (__builtin_cpu_supports("avx2")) {
+    return N_avx2(seq, n);
+  } else if (__builtin_cpu_supports("sse2")) {
+    return N_sse2(seq, n);
+  }
+#endif
+  return N_scalar(seq, 0, n);
+}
+
+/**
+ * @brief counts the lowQ bases of a read
+ * @param qual quality string (line 4 of a fastq entry)
+ * @param L read length
+ * @param thr lowest accepted quality char (zeroQ + minQ)
+ * @return number of positions i with qual[i] < thr
+ * */
+int count_lowQ(const char *qual, int L, int thr) {
+  int i, n = 0;
+  for (i = 0; i < L; i += 64) {
+    n += __builtin_popcountll(lowQ_mask(qual + i, min(L - i, 64), thr));
+  }
+  return n;
+}
+
+/**
+ * @brief finds the first base of a read that is not lowQ
+ * @param qual quality string (line 4 of a fastq entry)
+ * @param L read length
+ * @param thr lowest accepted quality char (zeroQ + minQ)
+ * @return first position i with qual[i] >= thr, L if there is none
+ * */
+int first_goodQ(const char *qual, int L, int thr) {
+  int i;
+  for (i = 0; i < L; i += 64) {
+    int n = min(L - i, 64);
+    uint64_t good = ~lowQ_mask(qual + i, n, thr) & low_bits(n);
+    if (good) {
+      return i + __builtin_ctzll(good);
+    }
+  }
+  return L;
+}
+
+/**
+ * @brief finds the last base of a read that is not lowQ
+ * @param qual quality string (line 4 of a fastq entry)
+ * @param L read length
+ * @param thr lowest accepted quality char (zeroQ + minQ)
+ * @return last position i with qual[i] >= thr, -1 if there is none
+ * */
+int last_goodQ(const char *qual, int L, int thr) {
+  int i;
+  for (i = (L - 1) & ~63; i >= 0; i -= 64) {
+    int n = min(L - i, 64);
+    uint64_t good = ~lowQ_mask(qual + i, n, thr) & low_bits(n);
+    if (good) {
+      return i + 63 - __builtin_clzll(good);
+    }
+  }
+  return -1;
+}
+
+/**
+ * @brief counts the N's of a read
+ * @param seq sequence (line 2 of a fastq entry)
+ * @param L read length
+ * @return number of chars other than A, C, G, T
+ * */
+int count_N(const char *seq, int L) {
+  int i, n = 0;
+  for (i = 0; i < L; i += 64) {
+    n += __builtin_popcountll(N_mask(seq + i, min(L - i, 64)));
+  }
+  return n;
+}
+
+/**
+ * @brief finds the first base of a read that is not an N
+ * @param seq sequence (line 2 of a fastq entry)
+ * @param L read length
+ * @return first position that is not an N, L if there is none
+ * */
+int first_base(const char *seq, int L) {
+  int i;
+  for (i = 0; i < L; i += 64) {
+    int n = min(L - i, 64);
+    uint64_t base = ~N_mask(seq + i, n) & low_bits(n);
+    if (base) {
+      return i + __builtin_ctzll(base);
+    }
+  }
+  return L;
+}
+
+/**
+ * @brief finds the last base of a read that is not an N
+ * @param seq sequence (line 2 of a fastq entry)
+ * @param L read length
+ * @return last position that is not an N, -1 if there is none
+ * */
+int last_base(const char *seq, int L) {
+  int i;
+  for (i = (L - 1) & ~63; i >= 0; i -= 64) {
+    int n = min(L - i, 64);
+    uint64_t base = ~N_mask(seq + i, n) & low_bits(n);
+    if (base) {
+      return i + 63 - __builtin_clzll(base);
+    }
+  }
+  return -1;
+}
+
+/**
+ * @brief finds the next N of a read
+ * @param seq sequence (line 2 of a fastq entry)
+ * @param i first position to look at
+ * @param L read length
+ * @return first position >= i that is an N, L if there is none
+ * */
+int next_N(const char *seq, int i, int L) {
+  for (; i < L; i += 64) {
+    uint64_t mask = N_mask(seq + i, min(L - i, 64));
+    if (mask) {
+      return i + __builtin_ctzll(mask);
+    }
+  }
+  return L;
+}
@@ -30,9 +30,12 @@
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <pthread.h>
 #include "tree.h"
 #include "Lmer.h"
 #include "fopen_gen.h"
+#include "mmap_gen.h"
+#include "city.h"
 
 extern uint64_t alloc_mem;  // global variable: memory allocated in the heap.
 
@@ -52,7 +55,7 @@ Node* get_new_pool(Tree *tree_ptr) {
          fprintf(stderr, "Exiting program.\n");
          exit(EXIT_FAILURE);
     }
-    alloc_mem += sizeof(Node*)*(NPOOL_2D);
+    __sync_fetch_and_add(&alloc_mem, sizeof(Node*)*(NPOOL_2D));
   }
   pool_1D = malloc(sizeof(Node) * NPOOL_1D );
   if (pool_1D == NULL) {
@@ -63,36 +66,47 @@ Node* get_new_pool(Tree *tree_ptr) {
       fprintf(stderr, "Exiting program.\n");
       exit(EXIT_FAILURE);
   }
-  alloc_mem += (sizeof(Node) * NPOOL_1D );
+  __sync_fetch_and_add(&alloc_mem, sizeof(Node) * NPOOL_1D);  // threads
   tree_ptr -> pool_2D[(tree_ptr -> pool_count)++] = pool_1D;
   return pool_1D;
 }
 
+/**
+ * @brief node n of a tree built with insert_Lmer
+ *
+ * */
+static Node *get_node(Tree *tree_ptr, uint32_t n) {
+  return tree_ptr -> pool_2D[n / NPOOL_1D] + n % NPOOL_1D;
+}
+
 /**
  * @brief moves to the next node (allocating new memory if necessary)
  * @param tree_ptr pointer to Tree structure
- * @return address to next node
+ * @return index of the next node
  *
  *  The function checks if there are available nodes (information stored
  *  in the variable tree_ptr -> pool_available) and goes to the next node.
  *  If there is no nodes  left, it allocates a new pool_1D, and
  *  if there is no room left in the outter dimension, it reallocates
  *  NPOOL_2D more Node*'s. If the number of nodes reaches UINT_MAX,
- *  the program returns an error message and exits.
+ *  the program returns an error message and exits. The next node is
+ *  located from pool_count and pool_available, so that no state is kept
+ *  outside of tree_ptr.
  *
  * */
-Node* new_node_buf(Tree *tree_ptr) {
+uint32_t new_node_buf(Tree *tree_ptr) {
   int i;
-  static Node *pool_1D = NULL;
   // Check if there are nodes available
   if (!tree_ptr -> pool_available) {
-      pool_1D = get_new_pool(tree_ptr);
+      get_new_pool(tree_ptr);
       tree_ptr -> pool_available = NPOOL_1D;
   }
-  Node *newnode = pool_1D++;  // Move to the next node
+  // Move to the next node: the first unused one in the last pool
+  Node *newnode = tree_ptr -> pool_2D[tree_ptr -> pool_count - 1] +
+                  (NPOOL_1D - tree_ptr -> pool_available);
   // Initialize node
   for (i = 0; i < T_ACGT; i++) {
-     newnode -> children[i] = NULL;
+     newnode -> children[i] = 0;
   }
   // Exits if UINT_MAX is reached
   if (tree_ptr -> nnodes == UINT_MAX) {
@@ -102,35 +116,75 @@ Node* new_node_buf(Tree *tree_ptr) {
     exit(EXIT_FAILURE);
   }
   // Update variables
-  tree_ptr -> nnodes++;
   tree_ptr -> pool_available--;
-  return newnode;
+  return tree_ptr -> nnodes++;
 }
 
 /**
- * @brief frees the whole tree structure
+ * @brief frees the pools of Nodes of a tree
  * @param tree_ptr pointer to Tree structure
- *
- * This function deallocates the memory allocated in a Tree structure.
+ * @return number of bytes deallocated
  *
  * */
-void free_all_nodes(Tree *tree_ptr) {
+static uint64_t free_pools(Tree *tree_ptr) {
   uint32_t i;
   uint32_t N = tree_ptr -> pool_count;
   uint64_t dealloc_mem = 0;
-  fprintf(stderr, "Deallocating Tree structure\n");
   for (i = 0; i < N; i++) {
      if (tree_ptr -> pool_2D[i] != NULL) {
          free(tree_ptr -> pool_2D[i]);
          dealloc_mem += sizeof(Node) * NPOOL_1D;
      }
   }
-  tree_ptr -> nnodes -= tree_ptr -> pool_available;
   free(tree_ptr -> pool_2D);
   dealloc_mem += sizeof(Node *)*N;
   tree_ptr -> pool_2D = NULL;
   tree_ptr -> pool_count = 0;
   tree_ptr -> pool_available = 0;
+  return dealloc_mem;
+}
+
+/**
+ * @brief allocates the children array of a flat tree
+ * @param nnodes number of nodes
+ * @return array of T_ACGT*nnodes uint32_t
+ *
+ * */
+static uint32_t *alloc_flat(uint32_t nnodes) {
+  uint64_t sz = (uint64_t)nnodes*T_ACGT*sizeof(uint32_t);
+  uint32_t *flat = malloc(sz);
+  if (flat == NULL) {
+    fprintf(stderr, "Could not allocate %" PRIu64 " bytes for a flat tree\n",
+            sz);
+    fprintf(stderr, "File: %s, line: %d\n", __FILE__, __LINE__);
+    fprintf(stderr, "Exiting program.\n");
+    exit(EXIT_FAILURE);
+  }
+  alloc_mem += sz;
+  return flat;
+}
+
+/**
+ * @brief frees the whole tree structure
+ * @param tree_ptr pointer to Tree structure
+ *
+ * This function deallocates the memory allocated in a Tree structure
+ * (or unmaps the tree file for mapped trees).
+ *
+ * */
+void free_all_nodes(Tree *tree_ptr) {
+  uint64_t dealloc_mem = 0;
+  fprintf(stderr, "Deallocating Tree structure\n");
+  if (tree_ptr -> map != NULL) {
+    munmap_gen(tree_ptr -> map, tree_ptr -> mapsize);
+    tree_ptr -> map = NULL;
+    tree_ptr -> mapsize = 0;
+  } else if (tree_ptr -> offsets != NULL) {
+    free((uint32_t *)tree_ptr -> offsets);
+    dealloc_mem += (uint64_t)(tree_ptr -> nnodes)*T_ACGT*sizeof(uint32_t);
+  }
+  tree_ptr -> offsets = NULL;
+  dealloc_mem += free_pools(tree_ptr);
   tree_ptr -> nnodes = 0;
   tree_ptr -> L = 0;
   fprintf(stderr, "%" PRIu64 " Bytes deallocated.\n", dealloc_mem);
@@ -139,23 +193,35 @@ void free_all_nodes(Tree *tree_ptr) {
 }
 
 /**
- * @brief Lmer insertion in the tree (depth L).
+ * @brief inserts the len first bases of Lmer below node
  *
  * */
-void insert_Lmer(Tree *tree_ptr, char *Lmer) {
+static void insert_from(Tree *tree_ptr, uint32_t node, const char *Lmer,
+                        uint32_t len) {
   uint32_t i = 0;
-  Node *current = tree_ptr -> pool_2D[0];
-  for (i = 0; i < tree_ptr -> L; i++) {
-    if ((unsigned char)Lmer[i] >= T_ACGT) {
+  uint32_t current = node;
+  for (i = 0; i < len; i++) {
+    unsigned char c = (unsigned char)Lmer[i];
+    if (c >= T_ACGT) {
        break;
     }  // ignore N's
-    if (current -> children[(unsigned char) Lmer[i]] == NULL) {
-        current -> children[(unsigned char) Lmer[i]] = new_node_buf(tree_ptr);
+    uint32_t child = get_node(tree_ptr, current) -> children[c];
+    if (child == 0) {
+        child = new_node_buf(tree_ptr);  // may allocate a new pool
+        get_node(tree_ptr, current) -> children[c] = child;
     }
-    current = current -> children[(unsigned char) Lmer[i]];
+    current = child;
   }
 }
 
+/**
+ * @brief Lmer insertion in the tree (depth L).
+ *
+ * */
+void insert_Lmer(Tree *tree_ptr, char *Lmer) {
+  insert_from(tree_ptr, 0, Lmer, tree_ptr -> L);
+}
+
 /**
  * @brief fasta entry insertion in the tree (depth L).
  * */
@@ -169,25 +235,311 @@ void insert_entry(Tree *tree_ptr, Fa_entry *entry) {
 }
 
 /**
- * @brief create Tree structure from fasta structure.
- * @param fasta pointer to fasta structure 
+ * @brief thread function: inserts the Lmers of the partitions of a thread
+ *
+ * All threads read the same batch of chunks, in the order of the file.
+ * An Lmer belongs to partition p, the code of its first P bases, and is
+ * inserted by thread p % nthreads below roots[p].
+ * */
+static void *tree_worker(void *arg) {
+  Tworker *w = (Tworker *)arg;
+  int P = w -> P;
+  uint32_t L = w -> tree_ptr -> L;
+  int b, i, j;
+  for (b = 0; b < w -> nbatch; b++) {
+    const char *seq = w -> seq[b];
+    int nLmers = w -> N[b] - (int)L + 1;
+    for (i = 0; i < nLmers; i++) {
+      uint32_t p = 0;
+      for (j = 0; j < P && (unsigned char)seq[i+j] < T_ACGT; j++) {
+        p = T_ACGT*p + (unsigned char)seq[i+j];
+      }
+      if (j < P) {  // the serial tree keeps the path up to the N
+        if (w -> id == 0 && j > 0) {
+          w -> prefix[j][p] = true;
+        }
+        continue;
+      }
+      if ((int)(p % w -> nthreads) != w -> id) {
+        continue;
+      }
+      if (w -> roots[p] == TREE_NOROOT) {
+        w -> roots[p] = new_node_buf(w -> tree_ptr);
+      }
+      insert_from(w -> tree_ptr, w -> roots[p], seq + i + P, L - P);
+    }
+  }
+  return NULL;
+}
+
+/**
+ * @brief joins the subtries built by tree_worker into a flat tree
+ * @param workers data of the threads, their trees are freed
+ * @param nthreads number of threads
+ * @param L depth of the tree
+ * @return flat tree (see flatten_tree)
+ *
+ * The root and the nodes of depth 1, ..., P-1 come first, followed by the
+ * nodes of every thread, whose indices are shifted. Every pool is freed as
+ * soon as it is copied.
+ * */
+static Tree *stitch_trees(Tworker *workers, int nthreads, uint32_t L) {
+  int P = workers[0].P;
+  int d, t;
+  uint32_t c, k, i, j, sz;
+  bool (*exists)[TREE_NPART] = workers[0].prefix;
+  uint32_t id[TREE_PREFIX][TREE_NPART] = {{0}};
+  uint64_t offset[nthreads];
+  uint64_t nnodes = 1;
+  // Prefixes of the partitions found, numbered by depth
+  for (c = 0; c < (1u << 2*P); c++) {
+    if (workers[c % nthreads].roots[c] != TREE_NOROOT) {
+      for (d = 1; d < P; d++) {
+        exists[d][c >> 2*(P - d)] = true;
+      }
+    }
+  }
+  for (d = 1; d < P; d++) {
+    for (c = 0; c < (1u << 2*d); c++) {
+      if (exists[d][c]) {
+        id[d][c] = nnodes++;
+      }
+    }
+  }
+  for (t = 0; t < nthreads; t++) {
+    offset[t] = nnodes;
+    nnodes += workers[t].tree_ptr -> nnodes;
+  }
+  if (nnodes > UINT_MAX) {
+    fprintf(stderr, "Maximal number of nodes reached\n");
+    fprintf(stderr, "File: %s, line: %d\n", __FILE__, __LINE__);
+    fprintf(stderr, "Exiting program.\n");
+    exit(EXIT_FAILURE);
+  }
+  Tree *tree_ptr = (Tree *)calloc(1, sizeof(Tree));
+  tree_ptr -> L = L;
+  tree_ptr -> nnodes = (uint32_t)nnodes;
+  uint32_t *flat = alloc_flat(tree_ptr -> nnodes);
+  // Children of the root and of the prefixes
+  for (d = 0; d < P; d++) {
+    for (c = 0; c < (1u << 2*d); c++) {
+      if (d > 0 && !exists[d][c]) {
+        continue;
+      }
+      for (k = 0; k < T_ACGT; k++) {
+        uint32_t child = T_ACGT*c + k, idx = 0;
+        if (d + 1 < P) {
+          idx = exists[d + 1][child] ? id[d + 1][child] : 0;
+        } else {
+          t = child % nthreads;
+          if (workers[t].roots[child] != TREE_NOROOT) {
+            idx = workers[t].roots[child] + offset[t];
+          }
+        }
+        flat[T_ACGT*id[d][c] + k] = idx;
+      }
+    }
+  }
+  // Nodes of the threads, with shifted indices
+  for (t = 0; t < nthreads; t++) {
+    Tree *sub = workers[t].tree_ptr;
+    uint32_t *dst = flat + offset[t]*T_ACGT;
+    for (i = 0; i < sub -> pool_count; i++) {
+      sz = min(NPOOL_1D, sub -> nnodes - i*NPOOL_1D);
+      const uint32_t *src = sub -> pool_2D[i] -> children;
+      for (j = 0; j < sz*T_ACGT; j++) {
+        dst[j] = src[j] ? src[j] + (uint32_t)offset[t] : 0;
+      }
+      dst += (uint64_t)sz*T_ACGT;
+      free(sub -> pool_2D[i]);
+      sub -> pool_2D[i] = NULL;
+      alloc_mem -= sizeof(Node) * NPOOL_1D;
+    }
+    alloc_mem -= free_pools(sub);
+    free(sub);
+  }
+  tree_ptr -> offsets = flat;
+  return tree_ptr;
+}
+
+/**
+ * @brief create Tree structure from a fasta file.
+ * @param filename path to the fasta file
  * @param L tree length
+ * @param nthreads number of threads constructing the tree
  *
+ * The fasta file is streamed in chunks overlapping by L - 1 bases (see
+ * Fa_stream), so only one chunk is held in memory besides the tree. The
+ * bases carried over from the previous chunk are already converted by
+ * Lmer_sLmer.
+ *
+ * With several threads, the Lmers are partitioned by their first
+ * P = min(TREE_PREFIX, L) bases and every thread builds the subtries of
+ * its partitions (see tree_worker), reading batches of nthreads chunks.
+ * The subtries are joined in a flat tree (see stitch_trees). The tree
+ * contains the same paths as the one built by a single thread, only the
+ * numbering of the nodes differs.
  * */
-Tree *tree_from_fasta(Fa_data *fasta, int L) {
-  int i;
+Tree *tree_from_fasta(char *filename, int L, int nthreads) {
+  int i, nbatch;
   init_map();  // NO OLVIDAR initializes the lookup table
-  Tree *tree_ptr = (Tree*)calloc(1, sizeof(Tree));
-  tree_ptr -> L = L;
-  new_node_buf(tree_ptr);
-  for (i = 0; i < fasta->nentries; i++) {
-    insert_entry(tree_ptr, fasta->entry+i);
+  Fa_stream *ptr_fs = open_fa_stream(filename, L - 1);
+  if (nthreads <= 1) {
+    Tree *tree_ptr = (Tree*)calloc(1, sizeof(Tree));
+    tree_ptr -> L = L;
+    new_node_buf(tree_ptr);
+    while (next_fa_chunk(ptr_fs)) {
+      char *chunk = ptr_fs -> chunk;
+      Lmer_sLmer(chunk + ptr_fs -> ncarry, ptr_fs -> N - ptr_fs -> ncarry);
+      for (i = 0; i < ptr_fs -> N - L + 1; i++) {
+        insert_Lmer(tree_ptr, chunk + i);
+      }
+    }
+    close_fa_stream(ptr_fs);
+    fprintf(stderr, "- Tree allocated.\n");
+    mem_usageMB();
+    return tree_ptr;
+  }
+  int P = min(TREE_PREFIX, L);
+  nthreads = min(nthreads, 1 << 2*P);
+  fprintf(stderr, "- Constructing the tree with %d threads.\n", nthreads);
+  pthread_t threads[nthreads];
+  Tworker workers[nthreads];
+  char *seq[nthreads];
+  int N[nthreads];
+  bool prefix[TREE_PREFIX][TREE_NPART] = {{false}};
+  for (i = 0; i < nthreads; i++) {
+    seq[i] = malloc(FA_CHUNK + L - 1);
+    if (seq[i] == NULL) {
+      fprintf(stderr, "Error occured when trying to allocate %d Bytes.\n",
+              FA_CHUNK + L - 1);
+      fprintf(stderr, "File: %s, line: %d\n", __FILE__, __LINE__);
+      fprintf(stderr, "Exiting program.\n");
+      exit(EXIT_FAILURE);
+    }
+    workers[i].tree_ptr = (Tree*)calloc(1, sizeof(Tree));
+    workers[i].tree_ptr -> L = L;
+    memset(workers[i].roots, 0xFF, sizeof(workers[i].roots));  // TREE_NOROOT
+    workers[i].prefix = prefix;
+    workers[i].seq = seq;
+    workers[i].N = N;
+    workers[i].P = P;
+    workers[i].id = i;
+    workers[i].nthreads = nthreads;
+  }
+  do {
+    // read a batch of chunks, then insert them concurrently
+    for (nbatch = 0; nbatch < nthreads && next_fa_chunk(ptr_fs); nbatch++) {
+      Lmer_sLmer(ptr_fs -> chunk + ptr_fs -> ncarry,
+                 ptr_fs -> N - ptr_fs -> ncarry);
+      memcpy(seq[nbatch], ptr_fs -> chunk, ptr_fs -> N);
+      N[nbatch] = ptr_fs -> N;
+    }
+    for (i = 0; i < nthreads; i++) {
+      workers[i].nbatch = nbatch;
+      if (nbatch && pthread_create(threads + i, NULL, tree_worker,
+                                   workers + i)) {
+        fprintf(stderr, "Could not create thread %d.\n", i);
+        fprintf(stderr, "File: %s, line: %d\n", __FILE__, __LINE__);
+        fprintf(stderr, "Exiting program.\n");
+        exit(EXIT_FAILURE);
+      }
+    }
+    for (i = 0; nbatch && i < nthreads; i++) {
+      pthread_join(threads[i], NULL);
+    }
+  } while (nbatch == nthreads);
+  close_fa_stream(ptr_fs);
+  for (i = 0; i < nthreads; i++) {
+    free(seq[i]);
   }
   fprintf(stderr, "- Tree allocated.\n");
   mem_usageMB();
+  Tree *tree_ptr = stitch_trees(workers, nthreads, L);
+  fprintf(stderr, "- Subtrees joined: %" PRIu32 " nodes.\n",
+          tree_ptr -> nnodes);
   return tree_ptr;
 }
 
+/**
+ * @brief converts a tree into a flat trie
+ * @param tree_ptr pointer to Tree structure (built with insert_Lmer)
+ *
+ * The children of all nodes are stored in a single array of uint32_t:
+ * child k of node n is node offsets[T_ACGT*n + k] (0: no child, the root
+ * is node 0). Since the nodes already store the indices of their
+ * children, the pools are just concatenated. Nodes keep their insertion
+ * order, which is the order of the Lmers in the fasta file: consecutive
+ * Lmers of a read coming from the reference walk through nearby nodes (a
+ * depth-first order was measured to be slower, see README_makeTree.md).
+ *
+ * Every pool is freed as soon as it is copied, so the memory peak does
+ * not exceed the one of the tree built. The tree can be queried and
+ * saved, but no more Lmers can be inserted.
+ * */
+void flatten_tree(Tree *tree_ptr) {
+  if (tree_ptr -> offsets != NULL) {
+    return;
+  }
+  uint32_t i, sz = NPOOL_1D;
+  uint32_t nnodes = tree_ptr -> nnodes;
+  uint32_t npools = tree_ptr -> pool_count;
+  uint32_t *flat = NULL;
+  for (i = 0; i < npools; i++) {
+    if (i == npools - 1) {
+      sz = nnodes - i*NPOOL_1D;
+    }
+    flat = realloc(flat, ((uint64_t)i*NPOOL_1D + sz)*T_ACGT*sizeof(uint32_t));
+    if (flat == NULL) {
+      fprintf(stderr, "Could not allocate memory for a flat tree\n");
+      fprintf(stderr, "File: %s, line: %d\n", __FILE__, __LINE__);
+      fprintf(stderr, "Exiting program.\n");
+      exit(EXIT_FAILURE);
+    }
+    alloc_mem += (uint64_t)sz*T_ACGT*sizeof(uint32_t);
+    memcpy(flat + (uint64_t)i*NPOOL_1D*T_ACGT, tree_ptr -> pool_2D[i],
+           (uint64_t)sz*sizeof(Node));
+    free(tree_ptr -> pool_2D[i]);
+    tree_ptr -> pool_2D[i] = NULL;
+    alloc_mem -= sizeof(Node) * NPOOL_1D;
+  }
+  alloc_mem -= free_pools(tree_ptr);
+  tree_ptr -> offsets = flat;
+  fprintf(stderr, "- Tree flattened: %" PRIu32 " nodes, %" PRIu64 " bytes.\n",
+         nnodes, (uint64_t)nnodes*T_ACGT*sizeof(uint32_t));
+  mem_usageMB();
+}
+
+/**
+ * @brief checks if read is found in a flat tree and outputs a score
+ * @param tree_ptr pointer to Tree structure (flattened or mapped)
+ * @param read Read or reverse complement
+ * @param Lread length of read
+ * @returns score = (number of Lmers of reads found in read) / (Lread-L+1)
+ *
+ * The tree is walked through the children indices in offsets.
+ *
+ * */
+double check_path_flat(Tree *tree_ptr, char *read, int Lread) {
+  int L = (int)tree_ptr -> L;
+  L = min(L, Lread);  // Maximum depth
+  int N = Lread - L + 1;   // number of checks we have to do
+  int Nsuccess = 0;
+  int i, j;
+  const uint32_t *offsets = tree_ptr -> offsets;
+  for (i = 0; i < N; i++) {
+    uint32_t node = 0;
+    for (j = 0; j < L; j++) {
+      unsigned char c = (unsigned char)read[i+j];
+      if (c >= T_ACGT || (node = offsets[T_ACGT*node + c]) == 0) {
+         break;
+      }
+    }
+    if (j == L) Nsuccess++;
+  }
+  return((double)Nsuccess/N);
+}
+
 /**
  * @brief checks if read is found in tree and outputs a score
  * @param tree_ptr pointer to Tree structure
@@ -195,22 +547,27 @@ Tree *tree_from_fasta(Fa_data *fasta, int L) {
  * @param Lread length of read
  * @returns score = (number of Lmers of reads found in read) / (Lread-L+1)
  *
+ * Flattened and mapped trees are queried with check_path_flat.
+ *
  * */
 double check_path(Tree *tree_ptr, char *read, int Lread) {
+  if (tree_ptr -> offsets != NULL) {
+    return check_path_flat(tree_ptr, read, Lread);
+  }
   int L = (int)tree_ptr -> L; 
   L = min(L, Lread);  // Maximum depth
   int N = Lread - L + 1;   // number of checks we have to do
   int Nsuccess = 0;
   int i, j;
   for (i = 0; i < N; i++) {
-    Node* current = tree_ptr -> pool_2D[0];
+    uint32_t current = 0;
     bool found = true;
     for (j = 0; j < L; j++) {
-      if (current->children[(unsigned char)read[i+j]] == NULL) {
+      if ((unsigned char)read[i+j] >= T_ACGT ||
+          (current = get_node(tree_ptr, current) ->
+                     children[(unsigned char)read[i+j]]) == 0) {
           found = false;
           break;
-      } else {
-          current = current -> children[(unsigned char)read[i+j]];
       }
     }
     if (found) Nsuccess++;
@@ -219,27 +576,118 @@ double check_path(Tree *tree_ptr, char *read, int Lread) {
   return((double)Nsuccess/N);
 }
 
+/**
+ * @brief checks if an Lmer (encoded with Lmer_sLmer) is found in a tree
+ * @param tree_ptr pointer to Tree structure (flat or built with insert_Lmer)
+ * @param Lmer first base of the Lmer in the read
+ * @param L depth of the search
+ * @returns true if the path of the Lmer exists, false otherwise
+ *
+ * */
+static bool has_Lmer(Tree *tree_ptr, char *Lmer, int L) {
+  const uint32_t *offsets = tree_ptr -> offsets;
+  uint32_t node = 0;
+  int j;
+  for (j = 0; j < L; j++) {
+    unsigned char c = (unsigned char)Lmer[j];
+    if (c >= T_ACGT) {
+      return false;
+    }
+    node = (offsets != NULL) ? offsets[T_ACGT*node + c] :
+                               get_node(tree_ptr, node) -> children[c];
+    if (node == 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief checks if at least need Lmers of a read are found in a tree
+ * @param tree_ptr pointer to Tree structure
+ * @param read Read or reverse complement
+ * @param Lread length of read
+ * @param need number of Lmers that have to be found
+ * @param nprobes output: number of Lmers looked up
+ * @returns true if at least need Lmers were found, false otherwise
+ *
+ * Same decision as comparing the score of check_path against a threshold,
+ * but the Lmers are only looked up until it is settled: either need Lmers
+ * were found, or the ones left can no longer reach need.
+ * */
+bool check_path_min(Tree *tree_ptr, char *read, int Lread, int need,
+                    int *nprobes) {
+  int L = min((int)tree_ptr -> L, Lread);  // Maximum depth
+  int N = Lread - L + 1;   // number of Lmers in the read
+  int Nsuccess = 0;
+  int i;
+  for (i = 0; i < N && Nsuccess < need && Nsuccess + N - i >= need; i++) {
+    if (has_Lmer(tree_ptr, read + i, L)) Nsuccess++;
+  }
+  *nprobes = i;
+  return (Nsuccess >= need);
+}
+
+/**
+ * @brief block i of the children indices of a tree
+ * @param tree_ptr pointer to Tree structure (flat or built with insert_Lmer)
+ * @param i block index, in [0, (nnodes + NPOOL_1D - 1)/NPOOL_1D)
+ * @param sz output: number of nodes in the block (NPOOL_1D but the last)
+ * @return children indices of nodes i*NPOOL_1D, ..., i*NPOOL_1D + sz - 1
+ *
+ * A block is a pool of the tree (or the same nodes of a flat tree).
+ * */
+static const uint32_t *tree_block(Tree *tree_ptr, uint32_t i, uint32_t *sz) {
+  *sz = min(NPOOL_1D, tree_ptr -> nnodes - i*NPOOL_1D);
+  if (tree_ptr -> offsets != NULL) {
+    return tree_ptr -> offsets + (uint64_t)i*NPOOL_1D*T_ACGT;
+  }
+  return tree_ptr -> pool_2D[i] -> children;
+}
+
+/**
+ * @brief checksum of the children indices of a tree
+ * @param tree_ptr pointer to Tree structure (flat or built with insert_Lmer)
+ * @return CityHash64 of the blocks of children indices (see tree_block),
+ *         each one seeded with the hash of the previous ones
+ *
+ * */
+static uint64_t tree_checksum(Tree *tree_ptr) {
+  uint32_t i, sz;
+  uint32_t nblocks = (tree_ptr -> nnodes + NPOOL_1D - 1)/NPOOL_1D;
+  uint64_t checksum = 0;
+  for (i = 0; i < nblocks; i++) {
+    const uint32_t *block = tree_block(tree_ptr, i, &sz);
+    checksum = CityHash64WithSeed((const char *)block,
+                                  (size_t)sz*T_ACGT*sizeof(uint32_t), checksum);
+  }
+  return checksum;
+}
+
 /**
  * @brief saves Tree to disk in filename
  * @param tree_ptr pointer to Tree structure
  * @param filename string containing filename
  *
- * The tree structure is stored as follows: every address is stored in a
- * uint32_t (we are not allowing trees with more than UINT_MAX nodes).
- * For every node, the addresses of the children are stored in the
- * following fashion:
- *  - If it is pointing to NULL: 0.
- *  - Otherwise: i2, the index in the outer dimension of pool_2D is identified,
- *    and the difference jump = pool_2D[i][j].children[k] - pool_2D[i2]
- *    is computed. i2*NPOOL_D1 + jump is then stored for child k.
+ * The nodes store the indices of their children, so they are written as
+ * they are, one pool (NPOOL_1D nodes, 16 MB) per fwrite. Every index is
+ * stored in a uint32_t (we are not allowing trees with more than UINT_MAX
+ * nodes). The file starts with a header of TREE_HEADER bytes:
+ *  - TREE_MAGIC (TREE_MAGIC_LEN bytes),
+ *  - L and nnodes (uint32_t),
+ *  - checksum of the children indices (uint64_t, see tree_checksum),
+ *  - 8 bytes set to 0 (reserved),
+ * followed by the T_ACGT children of every node: the children of node n
+ * are found at the offset TREE_HEADER + n*T_ACGT*4 bytes.
+ *
+ * If filename ends with TREE_EXT, the file is written uncompressed and
+ * can be mapped in memory and queried without being rebuilt (see
+ * read_tree).
  *
  * */
 void save_tree(Tree *tree_ptr, char *filename) {
   fprintf(stderr, "- Storing the tree structure in %s\n", filename);
   fprintf(stderr, "- Number of nodes to be stored: %d\n", tree_ptr-> nnodes);
-  uint32_t i, j, k, i2;
-  uint32_t sz = NPOOL_1D;
-  uint64_t jump;
   FILE *f = fopen_gen(filename, "w");
   if (f == NULL) {
     fprintf(stderr, "Error encountered when trying to open file %s.\n",
@@ -248,67 +696,135 @@ void save_tree(Tree *tree_ptr, char *filename) {
     fprintf(stderr, "Exiting program.\n");
     exit(EXIT_FAILURE);
   }
-  uint32_t *buffer = calloc(NPOOL_1D*T_ACGT, sizeof(uint32_t));
-  if (buffer == NULL) {
-    fprintf(stderr,
-             "Could not allocate buffer to store a tree structure;\n");
-    fprintf(stderr,
-          "Revise: NPOOL_D1, NPOOL_D2, and reduce the size of the former.\n");
-    fprintf(stderr, "Alternatively, use a computer with larger memory\n");
+  uint32_t i, sz;
+  uint32_t nblocks = (tree_ptr -> nnodes + NPOOL_1D - 1)/NPOOL_1D;
+  unsigned char header[TREE_HEADER] = {0};
+  uint64_t checksum = tree_checksum(tree_ptr);
+  bool ok = true;
+  memcpy(header, TREE_MAGIC, TREE_MAGIC_LEN);
+  memcpy(header + TREE_MAGIC_LEN, &(tree_ptr -> L), sizeof(uint32_t));
+  memcpy(header + TREE_MAGIC_LEN + 4, &(tree_ptr -> nnodes), sizeof(uint32_t));
+  memcpy(header + TREE_MAGIC_LEN + 8, &checksum, sizeof(uint64_t));
+  ok = (fwrite(header, 1, TREE_HEADER, f) == TREE_HEADER);
+  for (i = 0; ok && i < nblocks; i++) {
+    const uint32_t *block = tree_block(tree_ptr, i, &sz);
+    ok = (fwrite(block, sizeof(uint32_t), (size_t)sz*T_ACGT, f) ==
+          (size_t)sz*T_ACGT);
+  }
+  if (!ok) {
+    fprintf(stderr, "Error encountered when writing the tree to %s.\n",
+           filename);
     fprintf(stderr, "File: %s, line: %d\n", __FILE__, __LINE__);
     fprintf(stderr, "Exiting program.\n");
     exit(EXIT_FAILURE);
   }
-  alloc_mem += NPOOL_1D*T_ACGT;
-  fwrite(&(tree_ptr -> nnodes), sizeof(uint32_t), 1, f);
-  fwrite(&(tree_ptr -> L), sizeof(uint32_t), 1, f);
-  for (i = 0; i < tree_ptr -> pool_count; i++) {
-    if (i == tree_ptr -> pool_count -1) {
-         sz = (tree_ptr -> nnodes)%NPOOL_1D;
-    }
-    for (j = 0; j < sz; j++) {
-      for (k = 0; k < T_ACGT; k++) {
-          if ((tree_ptr -> pool_2D[i][j]).children[k] == NULL) {
-            buffer[T_ACGT*j + k] = 0;
-          } else {
-            int flag = false;
-            for (i2=0; i2 < tree_ptr -> pool_count; i2++) {
-              jump = (uint64_t) ((tree_ptr -> pool_2D[i][j]).children[k] -
-                                tree_ptr -> pool_2D[i2]);
-              if (jump < NPOOL_1D) {
-                 buffer[T_ACGT*j + k] = (uint32_t)(NPOOL_1D*i2 + jump);
-                 flag = true;
-                 break;
-              }
-            }
-            if (flag == false) {
-              fprintf(stderr, "Something weird occured with the");
-              fprintf(stderr, " indices when storing the Tree structure\n");
-              fprintf(stderr, "File: %s, line: %d\n", __FILE__, __LINE__);
-              fprintf(stderr, "Exiting program.\n");
-              exit(EXIT_FAILURE);
-            }
-         }
-       }
-    }
-     fwrite(buffer, sizeof(unsigned int), sz*T_ACGT, f);
-  }
-  free(buffer);
-  alloc_mem -= NPOOL_1D*T_ACGT;
   fclose(f);
 }
 
+/**
+ * @brief parses the header of a tree file
+ * @param tree_ptr pointer to Tree structure, L and nnodes are set
+ * @param header first TREE_HEADER bytes of the file (starting with
+ *        TREE_MAGIC) or TREE_HEADER_V1 bytes (starting with TREE_MAGIC_V1)
+ * @return checksum stored in the header (0 for version 1 files)
+ *
+ * */
+static uint64_t parse_header(Tree *tree_ptr, const unsigned char *header) {
+  uint64_t checksum = 0;
+  if (!memcmp(header, TREE_MAGIC, TREE_MAGIC_LEN)) {
+    memcpy(&(tree_ptr -> L), header + TREE_MAGIC_LEN, sizeof(uint32_t));
+    memcpy(&(tree_ptr -> nnodes), header + TREE_MAGIC_LEN + 4,
+           sizeof(uint32_t));
+    memcpy(&checksum, header + TREE_MAGIC_LEN + 8, sizeof(uint64_t));
+  } else {
+    memcpy(&(tree_ptr -> nnodes), header + TREE_MAGIC_LEN, sizeof(uint32_t));
+    memcpy(&(tree_ptr -> L), header + TREE_MAGIC_LEN + 4, sizeof(uint32_t));
+  }
+  return checksum;
+}
+
+/**
+ * @brief exits if the children indices of a tree do not match checksum
+ * @param tree_ptr pointer to a flat Tree structure
+ * @param checksum checksum stored in the header of the file
+ * @param filename name of the file (for the error message)
+ *
+ * */
+static void check_tree(Tree *tree_ptr, uint64_t checksum, char *filename) {
+  if (tree_checksum(tree_ptr) != checksum) {
+    fprintf(stderr, "Tree file %s is corrupted: checksum mismatch.\n",
+           filename);
+    fprintf(stderr, "File: %s, line: %d\n", __FILE__, __LINE__);
+    fprintf(stderr, "Exiting program.\n");
+    exit(EXIT_FAILURE);
+  }
+}
+
+/**
+ * @brief maps an uncompressed tree file in memory
+ * @param filename string with the filename
+ * @return pointer to a mapped Tree structure, NULL if filename could not be
+ *         mapped or does not start with TREE_MAGIC (or TREE_MAGIC_V1).
+ *
+ * */
+static Tree *map_tree(char *filename) {
+  size_t mapsize, header;
+  unsigned char *map = mmap_gen(filename, TREE_HEADER_V1, &mapsize);
+  if (map == NULL) {
+    return NULL;
+  }
+  if (!memcmp(map, TREE_MAGIC, TREE_MAGIC_LEN) && mapsize >= TREE_HEADER) {
+    header = TREE_HEADER;
+  } else if (!memcmp(map, TREE_MAGIC_V1, TREE_MAGIC_LEN)) {
+    header = TREE_HEADER_V1;
+  } else {
+    munmap_gen(map, mapsize);
+    return NULL;
+  }
+  Tree *tree_ptr = (Tree *)calloc(1, sizeof(Tree));
+  alloc_mem += sizeof(Tree);
+  uint64_t checksum = parse_header(tree_ptr, map);
+  if (mapsize != header +
+      (uint64_t)(tree_ptr -> nnodes)*T_ACGT*sizeof(uint32_t)) {
+    fprintf(stderr, "Tree file %s is corrupted: %" PRIu64 " bytes found,",
+           filename, (uint64_t)mapsize);
+    fprintf(stderr, " %" PRIu64 " expected.\n", (uint64_t)(header +
+           (uint64_t)(tree_ptr -> nnodes)*T_ACGT*sizeof(uint32_t)));
+    fprintf(stderr, "File: %s, line: %d\n", __FILE__, __LINE__);
+    fprintf(stderr, "Exiting program.\n");
+    exit(EXIT_FAILURE);
+  }
+  tree_ptr -> map = map;
+  tree_ptr -> mapsize = mapsize;
+  tree_ptr -> offsets = (const uint32_t *)(map + header);
+  if (header == TREE_HEADER) {
+    check_tree(tree_ptr, checksum, filename);
+  }
+  fprintf(stderr, "- Tree mapped: %" PRIu32 " nodes, %" PRIu64 " bytes.\n",
+         tree_ptr -> nnodes, (uint64_t)mapsize);
+  return tree_ptr;
+}
+
 /**
  * @brief read tree from file
  * @param filename string with the filename
  * @return pointer to Tree structure
  *
- * This function unwinds the process carried out in save_tree and
- * assigns addresses to the children of every given node.
+ * Uncompressed files (see save_tree) are mapped in memory (map_tree), so
+ * that concurrent processes share them and no reconstruction is needed.
+ * Otherwise, the children indices are read as one block into a flat tree
+ * (see flatten_tree), which is queried with check_path_flat. In both
+ * cases, the children indices are validated against the checksum in the
+ * header. Files written by older versions (no header, or TREE_MAGIC_V1)
+ * are read without validation.
  * */
 Tree* read_tree(char *filename) {
-  uint32_t i, j, k;
   fprintf(stderr, "- Reading a tree structure from %s\n", filename);
+  init_map();  // reads are encoded with the lookup table in check_path
+  Tree *mapped = map_tree(filename);
+  if (mapped != NULL) {
+    return mapped;
+  }
   FILE *f = fopen_gen(filename, "r");
   if (f == NULL) {
     fprintf(stderr, "Error encountered when trying to open file %s.\n",
@@ -317,69 +833,44 @@ Tree* read_tree(char *filename) {
     fprintf(stderr, "Exiting program.\n");
     exit(EXIT_FAILURE);
   }
-  uint32_t *buffer = calloc(NPOOL_1D*T_ACGT, sizeof(uint32_t));
-  if (buffer == NULL) {
-    fprintf(stderr,
-           "Could not allocate buffer when reading a tree structure;\n");
-    fprintf(stderr,
-           "Revise: NPOOL_D1, NPOOL_D2, and reduce the size of the former.\n");
-    fprintf(stderr, "Alternatively, use a computer with larger memory\n");
-    fprintf(stderr, "File: %s, line: %d\n", __FILE__, __LINE__);
-    fprintf(stderr, "Exiting program.\n");
-    exit(EXIT_FAILURE);
-  }
-  alloc_mem += NPOOL_1D*T_ACGT;
   Tree *tree_ptr = (Tree *)calloc(1, sizeof(Tree));
   alloc_mem += sizeof(Tree);
-  int sz = NPOOL_1D;
   // Initializing the tree structure
-  fread(&(tree_ptr -> nnodes), sizeof(uint32_t), 1, f);
-  fread(&(tree_ptr -> L), sizeof(uint32_t), 1, f);
-  tree_ptr -> pool_count = tree_ptr -> nnodes/NPOOL_1D + 1;
-  tree_ptr -> pool_available = NPOOL_1D - tree_ptr -> nnodes % NPOOL_1D;
-  tree_ptr -> pool_2D = calloc(tree_ptr->pool_count, sizeof(Node*));
-  if (tree_ptr -> pool_2D == NULL) {
-     fprintf(stderr, "Could not allocate pool_2D when reading a tree\n");
-     fprintf(stderr, "File: %s, line: %d\n", __FILE__, __LINE__);
-     fprintf(stderr, "Exiting program.\n");
-     exit(EXIT_FAILURE);
-  }
-  alloc_mem += sizeof(Node*)*tree_ptr->pool_count;
-  for (i = 0; i < tree_ptr -> pool_count; i++) {
-     tree_ptr->pool_2D[i] = calloc(sz, sizeof(Node));
-     if (tree_ptr->pool_2D[i] == NULL) {
-        fprintf(stderr, "Could not allocate pool_2D[%d] when reading a tree\n",
-              i);
-        fprintf(stderr, "File: %s, line: %d\n", __FILE__, __LINE__);
-        fprintf(stderr, "Exiting program.\n");
-        exit(EXIT_FAILURE);
-     }
-     alloc_mem += sizeof(Node)*sz;
+  unsigned char header[TREE_HEADER] = {0};
+  uint64_t checksum = 0;
+  size_t hlen = TREE_MAGIC_LEN;  // no header: nnodes and L
+  size_t nread = fread(header, 1, TREE_MAGIC_LEN, f);
+  bool versioned = (nread == TREE_MAGIC_LEN) &&
+                   !memcmp(header, TREE_MAGIC, TREE_MAGIC_LEN);
+  if (versioned) {
+    hlen = TREE_HEADER;
+    nread += fread(header + TREE_MAGIC_LEN, 1, TREE_HEADER - TREE_MAGIC_LEN, f);
+    checksum = parse_header(tree_ptr, header);
+  } else if (nread == TREE_MAGIC_LEN &&
+             !memcmp(header, TREE_MAGIC_V1, TREE_MAGIC_LEN)) {
+    hlen = TREE_HEADER_V1;
+    nread += fread(header + TREE_MAGIC_LEN, 1,
+                   TREE_HEADER_V1 - TREE_MAGIC_LEN, f);
+    parse_header(tree_ptr, header);
+  } else {
+    memcpy(&(tree_ptr -> nnodes), header, sizeof(uint32_t));
+    memcpy(&(tree_ptr -> L), header + sizeof(uint32_t), sizeof(uint32_t));
   }
+  uint64_t nchildren = (uint64_t)(tree_ptr -> nnodes)*T_ACGT;
   fprintf(stderr, "- Allocating %" PRIu64 " bytes.\n",
-         (uint64_t)(sizeof(Node)*sz + sizeof(Node*))*(tree_ptr -> pool_count));
-  // Reconstructing addresses
-  for (i = 0; i < tree_ptr -> pool_count; i++) {
-     if (i == tree_ptr -> pool_count-1) {
-        sz = (tree_ptr -> nnodes) % NPOOL_1D + 1;
-     }
-     fread(buffer, sizeof(uint32_t), sz*T_ACGT, f);
-     for (j = 0; j < NPOOL_1D; j++) {
-       for (k = 0; k < T_ACGT; k++) {
-           uint64_t jump = buffer[T_ACGT*j +k];
-           if (jump != 0) {
-             tree_ptr -> pool_2D[i][j].children[k] =
-                tree_ptr -> pool_2D[jump/NPOOL_1D]
-                +  (jump % NPOOL_1D);
-           } else {
-             tree_ptr -> pool_2D[i][j].children[k] = NULL;
-           }
-        }
-     }
+         nchildren*sizeof(uint32_t));
+  uint32_t *buffer = alloc_flat(tree_ptr -> nnodes);
+  if (nread != hlen ||
+      fread(buffer, sizeof(uint32_t), nchildren, f) != nchildren) {
+    fprintf(stderr, "Tree file %s is truncated.\n", filename);
+    fprintf(stderr, "File: %s, line: %d\n", __FILE__, __LINE__);
+    fprintf(stderr, "Exiting program.\n");
+    exit(EXIT_FAILURE);
   }
   fclose(f);
-  free(buffer);
-  alloc_mem -= NPOOL_1D*T_ACGT;
+  tree_ptr -> offsets = buffer;
+  if (versioned) {
+    check_tree(tree_ptr, checksum, filename);
+  }
   return(tree_ptr);
 }
-
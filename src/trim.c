@@ -29,16 +29,14 @@
 #include <string.h>
 #include <stdlib.h>
 #include "trim.h"
+#include "qscan.h"
 #include "str_manip.h"
 #include "defines.h"
 #include "config.h"
 #include "struct_trimFilter.h"
 
-extern int Nencode;
 extern Iparam_trimFilter par_TF;
 
-#define TRIM_STRING 20 /**< maximal length of trimming info string.*/
-
 /**
 *
 * @brief checks if a sequence contains any non standard base callings (N's)
@@ -49,16 +47,7 @@ extern Iparam_trimFilter par_TF;
 * any char different from the former ones is classified as N.
 * */
 static int no_N(Fq_read *seq) {
-  int i;
-  char Lmer[seq -> L];
-  memcpy(Lmer, seq -> line2, seq -> L);
-  Lmer_sLmer(Lmer, seq -> L);
-  for (i = 0; i < seq -> L; i++) {
-    if (Lmer[i] >= Nencode) {
-      return 0;
-    }
-  }
-  return 1;
+  return (next_N(seq -> line2, 0, seq -> L) == seq -> L);
 }
 
 /**
@@ -71,16 +60,7 @@ static int no_N(Fq_read *seq) {
 * any char different from the former ones is classified as N.
 * */
 static int Nuncertain(Fq_read *seq, int threshold) {
-  int i;
-  char Lmer[seq -> L];
-  memcpy(Lmer, seq -> line2, seq -> L);
-  Lmer_sLmer(Lmer, seq -> L);
-  float ncount=0;
-  for (i = 0; i < seq -> L; i++) {
-    if (Lmer[i] >= Nencode) {
-      ncount++;
-    }
-  }
+  float ncount = count_N(seq -> line2, seq -> L);
   ncount=ncount*100/(float)seq -> L;
   return (ncount<=threshold);
 }
@@ -91,70 +71,34 @@ static int Nuncertain(Fq_read *seq, int threshold) {
  * @param minL minimum accepted trimmed length
  * @return 0 if not used, 1 if accepted as is, 2 if accepted and trimmed
  *
+ * The N's are found one after the other with next_N, the first of the
+ * largest N-free sub-seqs is kept.
  * */
 static int Nfree_Lmer(Fq_read *seq, int minL) {
   int pos = 0;  // 1st pos. of the largest N-free sub-seq
   int pos_curr = 0;  // 1st pos. of the current N-free sub-seq (updated in loop)
   int len_max = 0;  // length of the largest N-free sub-seq
-  int len_cur = 0;  // length of the current N-free sub-seq (updated in loop)
-  int len_cum = 0;  // cumulative N-free length as we run in the loop
-  int i;
-  char Lmer[seq->L];
-  memcpy(Lmer, seq->line2, seq -> L);
-  Lmer_sLmer(Lmer, seq->L);
-  for (i = 0 ; i < seq -> L; i++) {
-     len_cum++;
-     if (Lmer[i] >= Nencode) {
-        pos_curr = i + 1 - len_cum;
-        len_cur = i - pos_curr;
-        len_cum = 0;
-        if (len_cur > len_max) {
-           pos = pos_curr;
-           len_max = len_cur;
-        }
-     }
-  }
-  if (len_cum == seq -> L) {
+  int i = next_N(seq -> line2, 0, seq -> L);
+  if (i == seq -> L) {
      return 1;
   }
+  for (; i < seq -> L; i = next_N(seq -> line2, i + 1, seq -> L)) {
+     if (i - pos_curr > len_max) {
+        pos = pos_curr;
+        len_max = i - pos_curr;
+     }
+     pos_curr = i + 1;
+  }
   // Consider last piece
-  if (len_cum > len_max) {
-     len_max = len_cum;
-     pos = seq -> L - len_max;
+  if (seq -> L - pos_curr > len_max) {
+     len_max = seq -> L - pos_curr;
+     pos = pos_curr;
   }
   // Check the length, discard it if < Lmin, and trim it otherwise
   if (len_max < minL) {
      return 0;
   } else {
-     memmove(seq -> line2, seq -> line2+pos, len_max);
-     seq -> line2[len_max] = '\0';
-     memmove(seq -> line4, seq -> line4+pos, len_max);
-     seq -> line4[len_max] = '\0';
-     seq -> L = len_max;
-     char add[TRIM_STRING];
-     int init;
-     int t_start = pos; 
-     int t_end = pos + len_max -1; 
-     if ((init = strindex(seq->line3, "TRIM")) == -1) {
-        snprintf(add, TRIM_STRING, " TRIMQ:%d:%d", t_start, t_end);
-     } else {
-        init += 6;  // length of TRIMN: or TRIMQ: or TRIMA: or TRIMX:
-        int told_start, told_end;
-        sscanf(&(seq -> line3[init]), "%d:%d", &told_start, &told_end);
-        t_start += told_start;
-        t_end += told_start;
-        seq -> line3[init - 6] = '\0';
-        snprintf(add, TRIM_STRING, " TRIMX:%d:%d", t_start, t_end);
-     }
-     if (strlen(add) + strlen(seq -> line3) > READ_MAXLEN) {
-       fprintf(stderr, "Cannot append  %s to %s.\n", add, seq -> line3);
-       fprintf(stderr, "sequence exceeds the predifined limit.\n");
-       fprintf(stderr, "Set READ_MAXLEN to a larger value in cmake\n");
-       fprintf(stderr, "File: %s, line: %d\n", __FILE__, __LINE__);
-       fprintf(stderr, "Exiting program.\n");
-       exit(EXIT_FAILURE);
-     }
-     strncat(seq -> line3, add, TRIM_STRING);
+     trim_read(seq, pos, pos + len_max - 1, len_max, 'Q');
      return 2;
   }
 }
@@ -167,47 +111,14 @@ static int Nfree_Lmer(Fq_read *seq, int minL) {
  *
  * */
 static int Ntrim_ends(Fq_read *seq, int minL) {
-  char Lmer[seq-> L];
-  int t_start = 0;
-  int t_end = seq -> L - 1;
-  memcpy(Lmer, seq->line2, seq -> L);
-  Lmer_sLmer(Lmer, seq->L);
-  while (Lmer[t_start] >= Nencode)
-     t_start++;
-  while (Lmer[t_end] >= Nencode)
-     t_end--;
+  int t_start = first_base(seq -> line2, seq -> L);
+  int t_end = last_base(seq -> line2, seq -> L);
   if ((t_end - t_start) == (seq -> L - 1)) {
      return 1;
   } else if ((t_end - t_start) < minL - 1) {
      return 0;
   } else {
-    (seq -> L) = t_end - t_start + 1;
-    memmove(seq -> line4, seq -> line4 + t_start, seq -> L);
-    memmove(seq -> line2, seq -> line2 + t_start, seq -> L);
-    seq -> line4[seq -> L] = '\0';
-    seq -> line2[seq -> L] = '\0';
-    char add[TRIM_STRING];
-    int init;
-    if ((init = strindex(seq->line3, "TRIM")) == -1) {
-       snprintf(add, TRIM_STRING, " TRIMN:%d:%d", t_start, t_end);
-    } else {
-       init += 6;  // length of TRIMN: or TRIMQ: or TRIMA: or TRIMX:
-       int told_start, told_end;
-       sscanf(&(seq -> line3[init]), "%d:%d", &told_start, &told_end);
-       t_start += told_start;
-       t_end += told_start;
-       seq -> line3[init - 6] = '\0';
-       snprintf(add, TRIM_STRING, " TRIMX:%d:%d", t_start, t_end);
-    }
-    if (strlen(add) + strlen(seq -> line3) > READ_MAXLEN) {
-      fprintf(stderr, "Cannot append  %s to %s.\n", add, seq -> line3);
-      fprintf(stderr, "sequence exceeds the predifined limit.\n");
-      fprintf(stderr, "Set READ_MAXLEN to a larger value in cmake\n");
-      fprintf(stderr, "File: %s, line: %d\n", __FILE__, __LINE__);
-      fprintf(stderr, "Exiting program.\n");
-      exit(EXIT_FAILURE);
-    }
-    strncat(seq -> line3, add, TRIM_STRING);
+    trim_read(seq, t_start, t_end, t_end - t_start + 1, 'N');
     return 2;
   }
 }
@@ -220,12 +131,7 @@ static int Ntrim_ends(Fq_read *seq, int minL) {
  *
  * */
 static int no_lowQ(Fq_read *seq, int minQ, int zeroQ) {
-  int i;
-  for (i = 0; i < seq -> L; i++) {
-    if (seq->line4[i] < (zeroQ + minQ))
-        return 0;
-  }
-  return 1;
+  return (count_lowQ(seq -> line4, seq -> L, zeroQ + minQ) == 0);
 }
 
 /**
@@ -237,14 +143,9 @@ static int no_lowQ(Fq_read *seq, int minQ, int zeroQ) {
  *
  * */
 static int Qtrim_ends(Fq_read *seq, int minQ, int zeroQ, int minL) {
-  // Beginning of sequence:
   int L = (seq->L)-1;
-  int t_start = 0;
-  int t_end = L;
-  while (seq->line4[t_start] < (zeroQ + minQ))
-     t_start++;
-  while (seq->line4[t_end] < (zeroQ + minQ))
-     t_end--;
+  int t_start = first_goodQ(seq -> line4, seq -> L, zeroQ + minQ);
+  int t_end = last_goodQ(seq -> line4, seq -> L, zeroQ + minQ);
   // Accept sequence as is
   if ((t_end - t_start) == L) {
      return 1;
@@ -254,33 +155,7 @@ static int Qtrim_ends(Fq_read *seq, int minQ, int zeroQ, int minL) {
      return 0;
   }
   // Trim the sequence
-  (seq -> L) = t_end - t_start + 1;
-  memmove(seq -> line4, seq -> line4 + t_start, seq -> L);
-  memmove(seq -> line2, seq -> line2 + t_start, seq -> L);
-  seq -> line4[seq -> L] = '\0';
-  seq -> line2[seq -> L] = '\0';
-  char add[TRIM_STRING];
-  int init;
-  if ((init = strindex(seq->line3, "TRIM")) == -1) {
-     snprintf(add, TRIM_STRING, " TRIMQ:%d:%d", t_start, t_end);
-  } else {
-     init += 6;  // length of TRIMN: or TRIMQ: or TRIMA: or TRIMX:
-     int told_start, told_end;
-     sscanf(&(seq -> line3[init]), "%d:%d", &told_start, &told_end);
-     t_start += told_start;
-     t_end += told_start;
-     seq -> line3[init - 6] = '\0';
-     snprintf(add, TRIM_STRING, " TRIMX:%d:%d", t_start, t_end);
-  }
-  if (strlen(add) + strlen(seq -> line3) > READ_MAXLEN) {
-    fprintf(stderr, "Cannot append  %s to %s.\n", add, seq -> line3);
-    fprintf(stderr, "sequence exceeds the predifined limit.\n");
-    fprintf(stderr, "Set READ_MAXLEN to a larger value in cmake\n");
-    fprintf(stderr, "File: %s, line: %d\n", __FILE__, __LINE__);
-    fprintf(stderr, "Exiting program.\n");
-    exit(EXIT_FAILURE);
-  }
-  strncat(seq -> line3, add, TRIM_STRING);
+  trim_read(seq, t_start, t_end, t_end - t_start + 1, 'Q');
   return 2;
 }
 
@@ -292,12 +167,8 @@ static int Qtrim_ends(Fq_read *seq, int minQ, int zeroQ, int minL) {
  * @return 0 if not used, 1 if accepted as is
  * */
 static int Qtrim_frac(Fq_read *seq, int minQ, int zeroQ, int nlowQ) {
-  int ilowQ = 0, i = 0;
-  while (i < (seq->L) &&  ilowQ < nlowQ) {
-     if (seq->line4[i] < (zeroQ + minQ)) ilowQ++;
-     i++;
-  }
-  return (ilowQ == nlowQ) ? 0: 1;
+  int ilowQ = count_lowQ(seq -> line4, seq -> L, zeroQ + minQ);
+  return (ilowQ >= nlowQ) ? 0: 1;
 }
 
 /*
@@ -315,53 +186,119 @@ static int Qtrim_frac(Fq_read *seq, int minQ, int zeroQ, int nlowQ) {
  * */
 static int Qtrim_endsfrac(Fq_read *seq, int minQ, int zeroQ, int minL, int nlowQ ) {
   int L = (seq->L)-1;  // last accessible element of the sequence
-  int t_start = 0;
-  int t_end = L;
-  int ilowQ = 0;
-  int i;
-  while (seq->line4[t_start] < (zeroQ + minQ))
-    t_start++;
-  while (seq->line4[t_end] < (zeroQ + minQ))
-    t_end--;
-  i = t_start;
-  while (i < t_end && ilowQ < nlowQ) {
-    if (seq->line4[i] < (zeroQ + minQ)) ilowQ++;
-    i++;
+  int t_start = first_goodQ(seq -> line4, seq -> L, zeroQ + minQ);
+  int t_end = last_goodQ(seq -> line4, seq -> L, zeroQ + minQ);
+  int ilowQ = count_lowQ(seq -> line4 + t_start, t_end - t_start,
+                         zeroQ + minQ);
+  // Discard sequence
+  if (ilowQ >= nlowQ || (t_end - t_start) < minL - 1) return 0;
+  // Accept sequence as is
+  if ((t_end - t_start) == L) {
+     return 1;
+  }
+  // Trim the sequence
+  trim_read(seq, t_start, t_end, t_end - t_start + 1, 'Q');
+  return 2;
+}
+
+/**
+ * @brief trims the ends up to the first windows with mean quality >= minQ
+ * @param seq fastq read
+ * @param minQ minimum accepted mean quality value
+ * @param minL minimum accepted trimmed length
+ * @param w window length
+ * @return 0 if not used, 1 if accepted as is, 2 if accepted and trimmed
+ *
+ * The read is kept from the first to the last window of w bases whose
+ * mean quality is at least minQ, without the lowQ bases at the outer
+ * ends of these windows. Unlike in Qtrim_ends, isolated good bases in a
+ * lowQ tail do not stop the trimming. The window sums are updated in
+ * O(1) per base, from each end until a good window is found.
+ * */
+static int Qtrim_window(Fq_read *seq, int minQ, int zeroQ, int minL, int w) {
+  const char *qual = seq -> line4;
+  int L = (seq->L)-1;
+  int thr = zeroQ + minQ;
+  int t_start = -1, t_end = -1;
+  int i, sum = 0;  // sum of quality - thr over the current window
+  w = min(w, seq -> L);
+  for (i = 0; i < w; i++) sum += qual[i] - thr;
+  for (i = 0; i + w <= seq -> L; i++) {
+    if (sum >= 0) {
+      t_start = i;
+      break;
+    }
+    if (i + w < seq -> L) sum += qual[i + w] - qual[i];
+  }
+  // Discard sequence: no good window
+  if (t_start < 0) return 0;
+  sum = 0;
+  for (i = seq -> L - w; i < seq -> L; i++) sum += qual[i] - thr;
+  for (i = seq -> L - w; i >= t_start; i--) {
+    if (sum >= 0) {
+      t_end = i;
+      break;
+    }
+    if (i > 0) sum += qual[i - 1] - qual[i + w - 1];
+  }
+  t_start += first_goodQ(qual + t_start, w, thr);
+  t_end += last_goodQ(qual + t_end, w, thr);
+  // Accept sequence as is
+  if ((t_end - t_start) == L) {
+     return 1;
   }
   // Discard sequence
-  if (ilowQ == nlowQ || (t_end - t_start) < minL - 1) return 0;
+  if ((t_end - t_start) < minL - 1) {
+     return 0;
+  }
+  // Trim the sequence
+  trim_read(seq, t_start, t_end, t_end - t_start + 1, 'Q');
+  return 2;
+}
+
+/**
+ * @brief keeps the segment of the read with the largest sum of
+ *        quality - minQ (Mott algorithm)
+ * @param seq fastq read
+ * @param minQ minimum accepted quality value
+ * @param minL minimum accepted trimmed length
+ * @return 0 if not used, 1 if accepted as is, 2 if accepted and trimmed
+ *
+ * Every base adds its quality - minQ to a segment, and the segment with
+ * the largest sum is kept (maximum subarray, found in one pass). Good
+ * bases in a lowQ tail are trimmed unless they outweigh the lowQ bases
+ * next to them. BWA -q applies the same criterion to the 3' end only.
+ * On ties, the longest segment is kept.
+ * */
+static int Qtrim_mott(Fq_read *seq, int minQ, int zeroQ, int minL) {
+  const char *qual = seq -> line4;
+  int L = (seq->L)-1;
+  int thr = zeroQ + minQ;
+  int t_start = 0, t_end = -1;
+  int i, start = 0, sum = 0, best = 0;
+  for (i = 0; i < seq -> L; i++) {
+    sum += qual[i] - thr;
+    if (sum < 0) {
+      sum = 0;
+      start = i + 1;
+    } else if (sum >= best) {
+      best = sum;
+      t_start = start;
+      t_end = i;
+    }
+  }
+  // Discard sequence: no base with quality >= minQ
+  if (t_end < 0) return 0;
   // Accept sequence as is
   if ((t_end - t_start) == L) {
      return 1;
   }
+  // Discard sequence
+  if ((t_end - t_start) < minL - 1) {
+     return 0;
+  }
   // Trim the sequence
-  (seq -> L) = t_end - t_start + 1;
-  memmove(seq -> line4, seq -> line4 + t_start, seq -> L);
-  memmove(seq -> line2, seq -> line2 + t_start, seq -> L);
-  seq -> line4[seq -> L] = '\0';
-  seq -> line2[seq -> L] = '\0';
-  char add[TRIM_STRING];
-  int init;
-  if ((init = strindex(seq->line3, "TRIM")) == -1) {
-     snprintf(add, TRIM_STRING, " TRIMQ:%d:%d", t_start, t_end);
-  } else {
-     init += 6;  // length of TRIMN: or TRIMQ: or TRIMA: or TRIMX:
-     int told_start, told_end;
-     sscanf(&(seq -> line3[init]), "%d:%d", &told_start, &told_end);
-     t_start += told_start;
-     t_end += told_start;
-     seq -> line3[init - 6] = '\0';
-     snprintf(add, TRIM_STRING, " TRIMX:%d:%d", t_start, t_end);
-  }
-  if (strlen(add) + strlen(seq -> line3) > READ_MAXLEN) {
-    fprintf(stderr, "Cannot append  %s to %s.\n", add, seq -> line3);
-    fprintf(stderr, "sequence exceeds the predifined limit.\n");
-    fprintf(stderr, "Set READ_MAXLEN to a larger value in cmake\n");
-    fprintf(stderr, "File: %s, line: %d\n", __FILE__, __LINE__);
-    fprintf(stderr, "Exiting program.\n");
-    exit(EXIT_FAILURE);
-  }
-  strncat(seq -> line3, add, TRIM_STRING);
+  trim_read(seq, t_start, t_end, t_end - t_start + 1, 'Q');
   return 2;
 }
 
@@ -375,38 +312,56 @@ static int Qtrim_endsfrac(Fq_read *seq, int minQ, int zeroQ, int minL, int nlowQ
  *
  * */
 int Qtrim_global(Fq_read *seq, int left, int right, char type) {
-  int t_start = left; 
-  int t_end = seq ->L - right;
-  (seq -> L) -= (left+right);
-  memmove(seq -> line4, seq -> line4 + left, seq -> L);
-  memmove(seq -> line2, seq -> line2 + left, seq -> L);
-  seq -> line4[seq -> L] = '\0';
-  seq -> line2[seq -> L] = '\0';
-  char add[TRIM_STRING];
-  int init;
-  if ((init = strindex(seq->line3, "TRIM")) == -1) {
-     snprintf(add, TRIM_STRING, " TRIM%c:%d:%d", type, t_start, t_end);
-  } else {
-     init += 6;  // length of TRIMN: or TRIMQ: or TRIMA: or TRIMX:
-     int told_start, told_end;
-     sscanf(&(seq -> line3[init]), "%d:%d", &told_start, &told_end);
-     t_start += told_start;
-     t_end += told_start;
-     seq -> line3[init - 6] = '\0';
-     snprintf(add, TRIM_STRING, " TRIMX:%d:%d", t_start, t_end);
-  }
-  if (strlen(add) + strlen(seq -> line3) > READ_MAXLEN) {
-    fprintf(stderr, "Cannot append  %s to %s.\n", add, seq -> line3);
-    fprintf(stderr, "sequence exceeds the predifined limit.\n");
-    fprintf(stderr, "Set READ_MAXLEN to a larger value in cmake\n");
-    fprintf(stderr, "File: %s, line: %d\n", __FILE__, __LINE__);
-    fprintf(stderr, "Exiting program.\n");
-    exit(EXIT_FAILURE);
-  }
-  strncat(seq -> line3, add, TRIM_STRING);
+  trim_read(seq, left, seq -> L - right, seq -> L - left - right, type);
   return 2;
 }
 
+/**
+ * @brief scores the seeds found by seed_windows in a block of read
+ *        windows, from the last window to the first one, until one of
+ *        them scores above the threshold
+ * @param seq pointer to <b>Fq_read</b>
+ * @param ptr_adap pointer to <b>Ad_seq</b>
+ * @param mask seeds of the adapter, at read position pos0 + 2*j
+ * @param mask_sh seeds of the shifted adapter, at read position
+ *        pos0 + 2*j + 1, scored before the ones of mask
+ * @param pos0 read position of the first window
+ * @param score score of the last seed scored (unchanged if none is)
+ * @param pos read position of the seed scoring above the threshold
+ * @return true if a seed scores above the threshold
+ * @see seed_windows
+ *
+ * */
+static bool score_windows(Fq_read *seq, Ad_seq *ptr_adap, uint64_t mask,
+                          uint64_t mask_sh, int pos0, double *score,
+                          int *pos) {
+  int j;
+  uint64_t bit;
+  while (mask | mask_sh) {
+    j = 63 - __builtin_clzll(mask | mask_sh);
+    bit = (uint64_t)1 << j;
+    if (mask_sh & bit) {
+      *score = obtain_score(seq, pos0 + 2*j + 1, ptr_adap, 0, par_TF.zeroQ,
+                            par_TF.ad.threshold);
+      if (*score > par_TF.ad.threshold) {
+        *pos = pos0 + 2*j + 1;
+        return true;
+      }
+    }
+    if (mask & bit) {
+      *score = obtain_score(seq, pos0 + 2*j, ptr_adap, 0, par_TF.zeroQ,
+                            par_TF.ad.threshold);
+      if (*score > par_TF.ad.threshold) {
+        *pos = pos0 + 2*j;
+        return true;
+      }
+    }
+    mask &= ~bit;
+    mask_sh &= ~bit;
+  }
+  return false;
+}
+
 /**
  * @brief alignment search between a fq read, and an adapter sequence,
  *        with a seed of 8 nucleotides.
@@ -454,14 +409,14 @@ static int align_uint32(Fq_read *seq, Ad_seq *ptr_adap, bool all) {
     cmp32 = (adsh ^ read32);
     n = __builtin_popcount(cmp32 >> 4);
     if (n <= 2*mismatches) {
-      score = obtain_score(seq, pos, ptr_adap, 0, par_TF.zeroQ);
+      score = obtain_score(seq, pos, ptr_adap, 0, par_TF.zeroQ, threshold);
       if (score > threshold) break;
     }
     pos--;
     cmp32 = (ad ^ read32);
     n = __builtin_popcount(cmp32);
     if (n <= 2*mismatches) {
-      score =  obtain_score(seq, pos, ptr_adap, 0, par_TF.zeroQ);
+      score =  obtain_score(seq, pos, ptr_adap, 0, par_TF.zeroQ, threshold);
       if (score > threshold) break;
     }
     pos--;
@@ -485,14 +440,14 @@ static int align_uint32(Fq_read *seq, Ad_seq *ptr_adap, bool all) {
     cmp32 = (ad ^ read32);
     n = __builtin_popcount(cmp32);
     if (n <= 2*mismatches) {
-       score = obtain_score(seq, 0, ptr_adap, pos, par_TF.zeroQ);
+       score = obtain_score(seq, 0, ptr_adap, pos, par_TF.zeroQ, threshold);
        if (score > threshold) break;
     }
     pos--;
     cmp32 = (adsh ^ read32);
     n = __builtin_popcount(cmp32>>2);
     if (n <= 2*mismatches) {
-       score = obtain_score(seq, 0, ptr_adap, pos, par_TF.zeroQ);
+       score = obtain_score(seq, 0, ptr_adap, pos, par_TF.zeroQ, threshold);
        if (score > threshold) break;
     }
     pos--;
@@ -508,6 +463,9 @@ static int align_uint32(Fq_read *seq, Ad_seq *ptr_adap, bool all) {
  *        with a seed of 8 nucleotides.
  * @param seq pointer to <b>Fq_read</b>
  * @param ptr_adap pointer to   <b>Ad_seq</b>
+ * @param cand positions of the 16-nucleotides long seeds found by
+ *        seed_adapter, NULL to look for them here
+ * @param ncand number of elements of cand
  * @return -1 error, 0 discarded, 1 accepted as is, 2 accepted and trimmed
  * @note Global input parameters from par_TF are used
  * @see Adapter
@@ -574,32 +532,59 @@ static int align_uint32(Fq_read *seq, Ad_seq *ptr_adap, bool all) {
  * @endcode
  *
  * */
-static int align_uint64(Fq_read *seq, Ad_seq *ptr_adap) {
+static int align_uint64(Fq_read *seq, Ad_seq *ptr_adap, int *cand,
+                        int ncand) {
   int j;
-  int n;
+  int n, hi, lo;
   int pos, Nwindows;
   double score = 0;
   double threshold = par_TF.ad.threshold;
   int mismatches = par_TF.ad.mismatches;
   int minL = par_TF.minL;
   uint64_t ad, adsh, read64 = 0, cmp64 = 0;
+  uint64_t mask, mask_sh;
   memcpy(&ad, ptr_adap->pack, sizeof(uint64_t));
   memcpy(&adsh, ptr_adap->pack_sh, sizeof(uint64_t));
   Nwindows = seq -> Lhalf - sizeof(uint64_t) + 1;
   pos = seq->L - 2*sizeof(uint64_t) + (seq->L%2) + 1;
-  for (j=0; j < Nwindows ; j++) {
+  if (cand != NULL) {
+    // seeds of the loop below, already found by seed_adapter
+    for (j = 0; j < ncand; j++) {
+      score = obtain_score(seq, cand[j], ptr_adap, 0, par_TF.zeroQ, threshold);
+      if (score > threshold) break;
+    }
+    pos = (j < ncand) ? cand[j] : pos - 2*max(Nwindows, 0);
+    if (Nwindows > 0) {
+      memcpy(&read64, seq->pack, sizeof(uint64_t));
+    }
+    Nwindows = 0;
+  }
+  if (Nwindows >= AD_MINSIMD) {
+    // blocks of 64 read windows, from the last one to the first one
+    pos -= 2*Nwindows;
+    for (hi = Nwindows; hi > 0; hi = lo) {
+      lo = max(hi - 64, 0);
+      mask = seed_windows(seq->pack + lo, hi - lo, ad, adsh, 2*mismatches,
+                          &mask_sh);
+      if (score_windows(seq, ptr_adap, mask, mask_sh, 2*lo, &score, &pos)) {
+        break;
+      }
+    }
+    memcpy(&read64, seq->pack, sizeof(uint64_t));
+  }
+  for (j=0; j < Nwindows && Nwindows < AD_MINSIMD; j++) {
     memcpy(&read64, seq->pack + Nwindows-1-j, sizeof(uint64_t) );
     cmp64 = (adsh ^ read64);
     n = __builtin_popcountl(cmp64 >> 4);
     if (n <= 2*mismatches) {
-      score = obtain_score(seq, pos, ptr_adap, 0, par_TF.zeroQ);
+      score = obtain_score(seq, pos, ptr_adap, 0, par_TF.zeroQ, threshold);
       if (score > threshold) break;
     }
     pos--;
     cmp64 = (ad ^ read64);
     n = __builtin_popcountl(cmp64);
     if (n <= 2*mismatches) {
-      score =  obtain_score(seq, pos, ptr_adap, 0, par_TF.zeroQ);
+      score =  obtain_score(seq, pos, ptr_adap, 0, par_TF.zeroQ, threshold);
       if (score > threshold) break;
     }
     pos--;
@@ -617,14 +602,14 @@ static int align_uint64(Fq_read *seq, Ad_seq *ptr_adap) {
     cmp64 = (ad ^ read64);
     n = __builtin_popcount(cmp64);
     if (n <= 2*mismatches) {
-       score = obtain_score(seq, 0, ptr_adap, pos, par_TF.zeroQ);
+       score = obtain_score(seq, 0, ptr_adap, pos, par_TF.zeroQ, threshold);
        if (score > threshold) break;
     }
     pos--;
     cmp64 = (adsh ^ read64);
     n = __builtin_popcount(cmp64 >> 4);
     if (n <= 2*mismatches) {
-       score = obtain_score(seq, 0, ptr_adap, pos, par_TF.zeroQ);
+       score = obtain_score(seq, 0, ptr_adap, pos, par_TF.zeroQ, threshold);
        if (score > threshold) break;
     }
     pos--;
@@ -635,6 +620,31 @@ static int align_uint64(Fq_read *seq, Ad_seq *ptr_adap) {
   return align_uint32(seq, ptr_adap, false);
 }
 
+/**
+ * @brief alignment search between a fq read and an adapter sequence,
+ *        allowing for indels (par_TF.ad.mode MYERS)
+ * @param seq pointer to <b>Fq_read</b>
+ * @param ptr_adap pointer to <b>Ad_seq</b>
+ * @param ptr_ed pointer to <b>Ad_edit</b>, filled by edit_columns
+ * @param l lane of the adapter in ptr_ed
+ * @return 0 discarded, 1 accepted as is, 2 accepted and trimmed
+ * @see edit_adapter
+ *
+ * par_TF.ad.mismatches is the maximum number of edits per AD_EDITLEN
+ * adapter bases, and the score has to be larger than
+ * par_TF.ad.threshold, as in align_uint64.
+ * */
+static int align_edit(Fq_read *seq, Ad_seq *ptr_adap, Ad_edit *ptr_ed,
+                      int l) {
+  double score;
+  int pos = edit_adapter(seq, ptr_adap, ptr_ed, l, par_TF.ad.mismatches,
+                         par_TF.ad.threshold, par_TF.zeroQ, &score);
+  if (pos < 0 || score <= par_TF.ad.threshold) {
+    return 1;
+  }
+  return((pos < par_TF.minL) ? 0 : Qtrim_global(seq, 0, seq->L+1-pos, 'A'));
+}
+
 /**
  * @brief trims sequence based on presence of N nucleotides
  *
@@ -643,22 +653,54 @@ static int align_uint64(Fq_read *seq, Ad_seq *ptr_adap) {
  *    if (seed found) -> calculate score
  *       if score > threshold -> aligner found, trim / discard and exit.
  *    else -> search for seeds 8 nucleotides long
+ *
+ *  With an adapter index, the 16 nucleotides long seeds of all adapters
+ *  are found in one pass over the read (seed_adapter), and only those
+ *  are scored, adapter after adapter.
+ *
+ *  With par_TF.ad.mode MYERS, every adapter is aligned allowing for
+ *  indels instead (align_edit).
  * @param seq pointer to <b>Fq_read</b>
  * @param adap_list array of  <b>Ad_seq</b>
+ * @param ptr_idx pointer to <b>Ad_index</b> of adap_list, or NULL
  * @return -1 error, 0 discarded, 1 accepted as is, 2 accepted and trimmed
  * @note Global input parameters from par_TF are also used
  *
  * */
-int trim_adapter(Fq_read *seq, Ad_seq *adap_list) {
+int trim_adapter(Fq_read *seq, Ad_seq *adap_list, Ad_index *ptr_idx) {
   int i;
   int Nad = par_TF.ad.Nad;
   double threshold = par_TF.ad.threshold;
+  int cand_ad[AD_MAXCAND], cand_pos[AD_MAXCAND];
+  int ncand = -1, k = 0, n = 0;
+  int ret = 0;
+  if (par_TF.ad.mode == MYERS) {
+    Ad_edit ed;
+    for (i = 0; i < Nad; i += AD_MYERSLANES) {
+      n = min(Nad - i, AD_MYERSLANES);
+      edit_columns(seq, adap_list + i, n, par_TF.ad.mismatches, &ed);
+      for (k = 0; k < n; k++) {
+        if (adap_list[i + k].L >= MIN_NMATCHES &&
+            LOG_4*adap_list[i + k].L > threshold &&
+            (ret = align_edit(seq, adap_list + i + k, &ed, k)) != 1) {
+           return ret;
+        }
+      }
+    }
+    return 1;
+  }
   seq->Lhalf = process_seq(seq->pack, (unsigned char *)seq->line2,
                            seq->L, 0, 0);
-  int ret = 0;
+  if (ptr_idx != NULL) {
+    ncand = seed_adapter(ptr_idx, seq, cand_ad, cand_pos);
+  }
   for (i = 0; i < Nad; i++) {
     if (adap_list[i].L >= 16) {
-      if ((ret = align_uint64(seq, adap_list + i))  != 1) {
+      for (n = 0; k + n < ncand && cand_ad[k + n] == i; n++) {}
+      ret = align_uint64(seq, adap_list + i,
+                         (ncand >= 0) ? cand_pos + k : NULL, n);
+      k += n;
+      if (ret != 1) {
          return ret;
       }
     } else if ((adap_list[i].L < 16) && (adap_list[i].L >= 8) &&
@@ -714,6 +756,13 @@ int trim_sequenceN(Fq_read *seq ) {
  *                Otherwise, it is rejected, (0).
  * - GLOBAL(4): it trims globally globleft nucleotides from the left and
  *              globright from the right, (returns 2).
+ * - WINDOW(6): trims the ends up to the first windows of par_TF.qwindow
+ *              bases with mean quality >= minQ and accepts it if it is
+ *              longer than minL (2 if trimming, 1 if no trimming), rejects
+ *              it otherwise (0).
+ * - MOTT(7): keeps the segment with the largest sum of quality - minQ
+ *            and accepts it if it is longer than minL (2 if trimming, 1
+ *            if no trimming), rejects it otherwise (0).
  *
  * */
 int trim_sequenceQ(Fq_read *seq) {
@@ -724,7 +773,34 @@ int trim_sequenceQ(Fq_read *seq) {
          (par_TF.trimQ == ENDSFRAC) ?
                 Qtrim_endsfrac(seq, par_TF.minQ, par_TF.zeroQ, par_TF.minL, par_TF.nlowQ):
          (par_TF.trimQ == GLOBAL) ?
-                Qtrim_global(seq, par_TF.globleft, par_TF.globright, 'Q'): -1;
+                Qtrim_global(seq, par_TF.globleft, par_TF.globright, 'Q'):
+         (par_TF.trimQ == WINDOW) ?
+                Qtrim_window(seq, par_TF.minQ, par_TF.zeroQ, par_TF.minL,
+                             par_TF.qwindow):
+         (par_TF.trimQ == MOTT) ?
+                Qtrim_mott(seq, par_TF.minQ, par_TF.zeroQ, par_TF.minL): -1;
+}
+
+/**
+ * @brief smallest number of hits that make a read contaminated
+ * @param N number of kmers (Lmers) of the read
+ * @param score user selected threshold
+ * @returns smallest h such that (double)h/N > score, N + 1 if none
+ *
+ * The reads are discarded if (hits/N > score), the comparison is kept
+ * as is, so that the early exits take exactly the same decisions.
+ * */
+static int min_hits(int N, double score) {
+  if (N <= 0) {
+    return (0.0/N > score) ? 0 : 1;
+  }
+  if (score*N >= N + 1) {
+    return N + 1;
+  }
+  int h = (score > 0) ? (int)(score*N) : 0;
+  while (h > 0 && (double)(h - 1)/N > score) h--;
+  while (h <= N && !((double)h/N > score)) h++;
+  return h;
 }
 
 /**
@@ -733,48 +809,108 @@ int trim_sequenceQ(Fq_read *seq) {
  *        selected threshold, it returns true. Otherwise, it returns false.
  * @param tree_ptr pointer to Tree structure
  * @param seq fastq read
+ * @param probes Lmer lookups, updated: [0] done, [1] skipped by early exit
  * @returns true if read was found, false otherwise
  *
+ * The Lmers are looked up until the outcome is settled (check_path_min),
+ * and the reverse complement is only checked if the read is not found.
  * */
-bool is_read_inTree(Tree *tree_ptr, Fq_read *seq) {
+bool is_read_inTree(Tree *tree_ptr, Fq_read *seq, uint64_t *probes) {
   char read[seq->L];
-  memcpy(read, seq -> line2, seq -> L+1);
+  int N = seq -> L - min((int)tree_ptr -> L, seq -> L) + 1;
+  int need = min_hits(N, par_TF.score);
+  int nfw = 0, nrc = 0;
+  memcpy(read, seq -> line2, seq -> L);
   Lmer_sLmer(read, seq -> L);
-  if (check_path(tree_ptr, read, seq -> L) > par_TF.score) {
-     return true;
-  } else {
+  bool found = check_path_min(tree_ptr, read, seq -> L, need, &nfw);
+  if (!found) {
      rev_comp(read, seq -> L);
-     return (check_path(tree_ptr, read, seq -> L) > par_TF.score);
+     found = check_path_min(tree_ptr, read, seq -> L, need, &nrc);
+     probes[1] += N - nrc;
   }
+  probes[0] += nfw + nrc;
+  probes[1] += N - nfw;
+  return found;
 }
 
 /**
- * @brief checks if a read is in Bloom filter. It computes the score for the
- *        read and returns true if it exceeds the user selected threshold.
- *        Returns false othersise.
+ * @brief checks if the reads of a block are in a Bloom filter. It computes
+ *        the score for every read and sets found to true if it exceeds the
+ *        user selected threshold, false otherwise.
  * @param ptr_bf pointer to Bfilter
+ * @param ptr_bb pointer to Bfbatch, with room for nseqs queries
+ * @param ptr_bfkmer pointer to Bfkmer structure, used to hash the kmers
+ * @param seqs fastq reads
+ * @param nseqs number of reads
+ * @param found output: found[i] is true if seqs[i] was found
+ * @param probes kmer lookups, updated: [0] done, [1] skipped
+ *
+ * The kmers of all reads are hashed first and then looked up together
+ * (contains_batch), prefetching the filter, until the outcome of every
+ * read is settled. For minimizer filters (window > 1), the score is the
+ * fraction of the minimizers of the read found in the filter.
+ * */
+void reads_inBloom(Bfilter *ptr_bf, Bfbatch *ptr_bb, Bfkmer *ptr_bfkmer,
+                   Fq_read **seqs, int nseqs, bool *found, uint64_t *probes) {
+  int i;
+  reset_Bfbatch(ptr_bb);
+  for (i = 0; i < nseqs; i++) {
+    int maxN = seqs[i] -> L - ptr_bf -> kmersize + 1;
+    if (maxN <= 0) {
+      fprintf(stderr, "WARNING: read was shorter than kmer-size: %d\n",
+             ptr_bf -> kmersize);
+    }
+    int q = add_query(ptr_bf, ptr_bb, ptr_bfkmer, seqs[i] -> line2,
+                      seqs[i] -> L, min_hits(maxN, par_TF.score));
+    if (ptr_bf -> window > 1) {
+      // the score is the fraction of the minimizers of the read found
+      ptr_bb -> need[q] = min_hits(ptr_bb -> left[q], par_TF.score);
+    }
+  }
+  contains_batch(ptr_bf, ptr_bb);
+  for (i = 0; i < nseqs; i++) {
+    int maxN = seqs[i] -> L - ptr_bf -> kmersize + 1;
+    found[i] = (ptr_bb -> hits[i] >= ptr_bb -> need[i]);
+    probes[0] += ptr_bb -> probes[i];
+    probes[1] += (ptr_bf -> window > 1) ? (uint64_t)ptr_bb -> left[i] :
+                 (uint64_t)(max(maxN, 0) - ptr_bb -> probes[i]);
+  }
+}
+
+/**
+ * @brief checks if a read is in a kmer set. It computes the score for the
+ *        read (fraction of its kmers found in the set) and returns true if
+ *        it exceeds the user selected threshold. Returns false otherwise.
+ * @param ptr_ks pointer to Kmerset
  * @param seq fastq read
- * @param ptr_bfkmer pointer to Procs_kmer structure (will store global)
+ * @param ptr_bfkmer pointer to Bfkmer structure, used to roll the kmers in
+ * @param probes kmer lookups, updated: [0] done, [1] skipped by early exit
  * @returns true if read was found, false otherwise
  *
+ * The kmers are canonical, so the reverse complement is checked at once.
+ * As in is_read_inTree, the kmers are only looked up until the outcome
+ * is settled.
  * */
-bool is_read_inBloom(Bfilter *ptr_bf, Fq_read *seq, Bfkmer *ptr_bfkmer) {
-  unsigned char read[seq->L];
-  memcpy(read, seq -> line2, seq -> L);
+bool is_read_inKmerset(Kmerset *ptr_ks, Fq_read *seq, Bfkmer *ptr_bfkmer,
+                       uint64_t *probes) {
   int position;
-  int maxN = seq -> L - ptr_bf->kmersize + 1;
+  int maxN = seq -> L - ptr_ks -> kmersize + 1;
   if (maxN <= 0) {
     fprintf(stderr, "WARNING: read was shorter than kmer-size: %d\n",
-           ptr_bf -> kmersize);
-  }
-  double score = 0;
-  for (position = 0; position <  maxN; position++) {
-    if (compact_kmer(read, position, ptr_bfkmer)) {
-       multiHash(ptr_bfkmer);
-       if (contains(ptr_bf, ptr_bfkmer)) {
-          score += 1.0;
-       }
+           ptr_ks -> kmersize);
+  }
+  int need = min_hits(maxN, par_TF.score);
+  int hits = 0, nkmers = 0;
+  ptr_bfkmer -> nvalid = 0;
+  for (position = 0; position < seq -> L && hits < need &&
+                     hits + maxN - nkmers >= need; position++) {
+    if (roll_kmer(ptr_bfkmer, (unsigned char)(seq -> line2[position])) &&
+        contains_kmer(ptr_ks, ptr_bfkmer)) {
+       hits++;
     }
+    if (position >= ptr_ks -> kmersize - 1) nkmers++;
   }
-  return (score/maxN > par_TF.score);
+  probes[0] += nkmers;
+  probes[1] += max(maxN, 0) - nkmers;
+  return (hits >= need);
 }
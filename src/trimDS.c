@@ -32,10 +32,12 @@
 #include "trimDS.h"
 #include "Lmer.h"
 #include "trim.h"
+#include "adapters.h"
 #include "struct_trimFilter.h"
 
 extern uint8_t fw_1B[256];  /**< global variable. Lookup table. */
 extern uint8_t bw_1B[256];  /**< global variable. Lookup table. */
+extern int32_t Qpenalty[256];  /**< global variable. Lookup table. */
 extern Iparam_trimFilter par_TF; /**< global variable. Input parameters.*/
 
 /**
@@ -72,10 +74,12 @@ static void pack_reads(DS_adap *ptr_DSad, Fq_read *r1, Fq_read *r2) {
   r2->L_ad = ptr_DSad->L2;
   r1->L_ext = r1->L + ptr_DSad->L1;
   r2->L_ext = r2->L + ptr_DSad->L2;
-  strncpy(r1->extended, ptr_DSad->ad1, ptr_DSad->L1+1);
-  strncpy(r2->extended, ptr_DSad->ad2, ptr_DSad->L2+1);
-  strncat(r1->extended, r1->line2, r1->L+1);
-  strncat(r2->extended, r2->line2, r2->L+1);
+  memcpy(r1->extended, ptr_DSad->ad1, ptr_DSad->L1);
+  memcpy(r2->extended, ptr_DSad->ad2, ptr_DSad->L2);
+  memcpy(r1->extended + r1->L_ad, r1->line2, r1->L);
+  memcpy(r2->extended + r2->L_ad, r2->line2, r2->L);
+  r1->extended[r1->L_ext] = '\0';
+  r2->extended[r2->L_ext] = '\0';
   r1 -> L_pack =  process_seq(r1->pack, (unsigned char *)r1->extended,
                              r1->L_ext, false, false);
   r2 -> L_pack = process_seq(r2->pack, (unsigned char *)r2->extended,
@@ -106,51 +110,60 @@ static int QtrimDS(Fq_read *r1, Fq_read *r2, int L) {
  *        quality value. If there is a mismatch in a region where both
  *        read 1 and read 2 have qualities associated to the nucleotide under
  *        consideration, then the maximum of the quality values is subtracted.
+ *        As in obtain_score, the score is added up in 1/AD_SCALE units,
+ *        32 bases are compared at a time, and the scoring stops when the
+ *        bases left cannot make up MIN_NMATCHES matches or a score above
+ *        par_TF.ad.threshold.
  * @param r1 pointer to Fq_read for read 1
  * @param pos1 position to start comparing in read 1, starting from 5' end of
  *        the extended sequence (adapter 1 + read 1)
  * @param r2 pointer to Fq_read for read 2
  * @param pos2 position to start comparing in read 2, starting from 3' end of
  *        the extended sequence (adapter 2 + read 2)
- * @return score associated to the comparison of the two strings
+ * @return score associated to the comparison of the two strings, -1 if
+ *         less than MIN_NMATCHES bases match or the scoring stopped
  *
  * */
 static double obtain_scoreDS(Fq_read *r1, int pos1, Fq_read *r2, int pos2, int zeroQ) {
   int Nbases = min(r1 -> L_ext - pos1, r2 -> L_ext - pos2);
-  int i, p1, p2;
-  double score = 0.0;
+  int i, k, n, left, p1, p2;
+  int score = 0;
   int Nmatches = 0;
-  //printf("%s  %s \n", r1->line4, r2->line4);
-  for (i=0; i < Nbases; i++) {
-    p1 = pos1 + i;
-    p2 = r2->L_ext - 1 - i - pos2;
-    if (fw_1B[(uint8_t)(r1->extended[p1] )] ==
-        bw_1B[(uint8_t)(r2->extended)[p2]]) {
-        score += LOG_4;
-        Nmatches++;
-    } else {
-      p1-=r1 -> L_ad;
-      p2-=r2 -> L_ad;
+  bool cut = (par_TF.ad.threshold >= -1.0);
+  double lim = par_TF.ad.threshold*AD_SCALE - 1;
+  uint32_t mask, mis;
+  if (Nbases < MIN_NMATCHES) return -1.0;
+  for (i = 0; i < Nbases; i += n) {
+    n = min(Nbases - i, 32);
+    mask = match_bases(r1 -> extended + pos1 + i,
+                       r2 -> extended + r2 -> L_ext - 1 - pos2 - i, n);
+    left = Nbases - i - n;
+    Nmatches += __builtin_popcount(mask);
+    if (Nmatches + left < MIN_NMATCHES) return -1.0;
+    score += AD_LOG4*__builtin_popcount(mask);
+    for (mis = ~mask & (uint32_t)((((uint64_t)1) << n) - 1); mis;
+         mis &= mis - 1) {
+      k = i + __builtin_ctz(mis);
+      p1 = pos1 + k - r1 -> L_ad;
+      p2 = r2 -> L_ext - 1 - k - pos2 - r2 -> L_ad;
       if( (p1 > r1 -> L) || (p2 > r2 -> L )) {
          fprintf(stderr, "ERROR.Report this bug.\n");
          fprintf(stderr, "Exiting program.\n");
          fprintf(stderr, "File: %s, line: %d\n", __FILE__, __LINE__);
       } else if (p1 > 0 || p2 > 0) {
          if (p1 < 0 ) {
-            score -= (r2->line4[p2] - zeroQ)/10.0;
+            score -= Qpenalty[(uint8_t)(r2->line4[p2] - zeroQ)];
          } else if (p2 < 0)  {
-            score -= (r1->line4[p1] - zeroQ)/10.0;
+            score -= Qpenalty[(uint8_t)(r1->line4[p1] - zeroQ)];
          } else {
-            score -= max((r1->line4[p1] - zeroQ)/10.0,
-                  (r2->line4[p2] - zeroQ)/10.0);
+            score -= max(Qpenalty[(uint8_t)(r1->line4[p1] - zeroQ)],
+                         Qpenalty[(uint8_t)(r2->line4[p2] - zeroQ)]);
          }
       }
+      if (cut && score + (double)AD_LOG4*left <= lim) return -1.0;
     }
   }
-// if(score > par_TF.ad.threshold)
-//  printf("This is the score: %f, Nbases %d, log4*Nbases %f pos1 %d pos2 %d\n",
-//             score, Nbases, LOG_4*Nbases, pos1-r1->L_ad, r2->L-pos2- 1);
-  return ((Nmatches < MIN_NMATCHES) ? -1.0 : score);
+  return (double)score/AD_SCALE;
 }
 
 /**
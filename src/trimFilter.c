@@ -41,11 +41,202 @@
 #include "io_trimFilter.h"
 #include "tree.h"
 #include "bloom.h"
+#include "kmerset.h"
 #include "trim.h"
+#include "pipeline.h"
 
 uint64_t alloc_mem = 0;  /**< global variable. Memory allocated in the heap.*/
 Iparam_trimFilter par_TF;  /**< global variable: Input parameters trimFilter.*/
 
+/**
+ * @brief data needed by a thread to filter reads: the adapters and the
+ *        index are shared (read only), the reads and kmer are private.
+ * */
+typedef struct _worker_TF {
+  Ad_seq *adap_list;  /**< packed adapters */
+  Ad_index *ptr_adidx;  /**< seed index of the adapters (can be NULL) */
+  Tree *ptr_tree;  /**< tree index (method TREE) */
+  Bfilter *ptr_bf;  /**< Bloom filter (method BLOOM) */
+  Kmerset *ptr_ks;  /**< kmer set (method KMERSET) */
+  Bfkmer *ptr_bfkmer;  /**< kmer scratch structure (methods BLOOM, KMERSET) */
+  Bfbatch *ptr_bb;  /**< kmers of a block of reads (method BLOOM) */
+  Fq_read *seq;  /**< NREADS_BLOCK fastq reads being filtered */
+} Worker_TF;
+
+/**
+ * @brief output files and global stats, used by the writer thread
+ * */
+typedef struct _writer_TF {
+  FILE **fout;  /**< output files: ADAP, CONT, LOWQ, NNNN, GOOD */
+  Stats_TF *stat_TF;  /**< stats of the whole fastq file */
+} Writer_TF;
+
+/**
+ * @brief removes the adapters of a read and updates the stats
+ * @param w pointer to Worker_TF
+ * @param seq fastq read
+ * @param stat_TF stats to be updated
+ * @return ADAP if the read was discarded, GOOD otherwise
+ *
+ * */
+static int filter_adapter(Worker_TF *w, Fq_read *seq, Stats_TF *stat_TF) {
+  if (par_TF.is_adapter) {
+    int trim = trim_adapter(seq, w -> adap_list, w -> ptr_adidx);
+    if (!trim) {
+      stat_TF -> discarded[ADAP]++;
+      return ADAP;
+    } else if (trim == 2) {
+      stat_TF -> trimmed[ADAP]++;
+    }
+  }
+  return GOOD;
+}
+
+/**
+ * @brief looks for contaminations in the reads of a block that were not
+ *        discarded yet, and updates the stats
+ * @param w pointer to Worker_TF containing the reads
+ * @param n number of reads in w -> seq
+ * @param filter filter of every read: set to CONT if it is a contamination
+ * @param stat_TF stats to be updated
+ *
+ * With method BLOOM the reads are looked up together (reads_inBloom).
+ * */
+static void filter_cont(Worker_TF *w, int n, int *filter, Stats_TF *stat_TF) {
+  Fq_read *seqs[NREADS_BLOCK];
+  bool found[NREADS_BLOCK];
+  int idx[NREADS_BLOCK];
+  int i, m = 0;
+  for (i = 0; i < n; i++) {
+    if (filter[i] == GOOD) {
+      idx[m] = i;
+      seqs[m++] = w -> seq + i;
+    }
+  }
+  if (par_TF.method == BLOOM) {
+    reads_inBloom(w -> ptr_bf, w -> ptr_bb, w -> ptr_bfkmer, seqs, m, found,
+                  stat_TF -> probes);
+  }
+  for (i = 0; i < m; i++) {
+    if (par_TF.method == TREE) {
+      found[i] = is_read_inTree(w -> ptr_tree, seqs[i], stat_TF -> probes);
+    } else if (par_TF.method == KMERSET) {
+      found[i] = is_read_inKmerset(w -> ptr_ks, seqs[i], w -> ptr_bfkmer,
+                                   stat_TF -> probes);
+    }
+    if (found[i]) {
+      stat_TF -> discarded[CONT]++;
+      filter[idx[i]] = CONT;
+    }
+  }
+}
+
+/**
+ * @brief runs the rest of the filter chain (lowQ, N's) on a read and
+ *        updates the stats
+ * @param seq fastq read
+ * @param stat_TF stats to be updated
+ * @return LOWQ or NNNN if the read was discarded, GOOD otherwise
+ *
+ * */
+static int filter_read(Fq_read *seq, Stats_TF *stat_TF) {
+  int trim;
+  if (par_TF.trimQ) {
+    trim = trim_sequenceQ(seq);
+    if (!trim) {
+      stat_TF -> discarded[LOWQ]++;
+      return LOWQ;
+    } else if (trim == 2) {
+      stat_TF -> trimmed[LOWQ]++;
+    }
+  }
+  if (par_TF.trimN) {
+    trim = trim_sequenceN(seq);
+    if (!trim) {
+      stat_TF -> discarded[NNNN]++;
+      return NNNN;
+    } else if (trim == 2) {
+      stat_TF -> trimmed[NNNN]++;
+    }
+  }
+  stat_TF -> good++;
+  return GOOD;
+}
+
+/**
+ * @brief worker thread: parses and filters the fq entries of a batch
+ * @param ptr_batch pointer to Batch_TF
+ * @param ptr_worker pointer to the Worker_TF owned by the thread
+ *
+ * The entries are filtered in blocks of NREADS_BLOCK reads: adapters,
+ * contaminations (all reads of the block at once) and then lowQ and N's.
+ * */
+static void work_TF(void *ptr_batch, void *ptr_worker) {
+  Batch_TF *batch = (Batch_TF *)ptr_batch;
+  Worker_TF *w = (Worker_TF *)ptr_worker;
+  struct iovec iov[FQ_NIOV];  // segments of one fq read
+  int filter[NREADS_BLOCK];
+  int i, j, k, n, c1 = 0;
+  int nlines = batch -> nlines;
+  memset(&(batch -> stats), 0, sizeof(Stats_TF));
+  for (i = 0; i <= NFILTERS; i++) {
+    batch -> out[i].count = 0;
+  }
+  for (i = 0; i < batch -> nentries; i += n) {
+    n = min(NREADS_BLOCK, batch -> nentries - i);
+    for (j = 0; j < n; j++) {
+      Fq_read *seq = w -> seq + j;
+      for (k = 0; k < 4; k++) {
+        int c2 = batch -> ends[4*(i + j) + k];
+        get_fqread(seq, batch -> entries, c1, c2, nlines + k, par_TF.L, 0);
+        c1 = c2 + 1;
+      }
+      check_zeroQ(seq, par_TF.zeroQ, nlines/4);
+      batch -> stats.nreads++;
+      filter[j] = filter_adapter(w, seq, &(batch -> stats));
+      nlines += 4;
+    }
+    if (par_TF.method) {
+      filter_cont(w, n, filter, &(batch -> stats));
+    }
+    for (j = 0; j < n; j++) {
+      if (filter[j] == GOOD) {
+        filter[j] = filter_read(w -> seq + j, &(batch -> stats));
+      }
+      int niov = iovec_seq(w -> seq + j, iov);
+      buffer_appendv(&(batch -> out[filter[j]]), iov, niov);
+    }
+  }
+}
+
+/**
+ * @brief writer thread: writes the output of a batch and adds its stats
+ * @param ptr_batch pointer to Batch_TF, already filtered
+ * @param ptr_writer pointer to Writer_TF
+ *
+ * */
+static void write_TF(void *ptr_batch, void *ptr_writer) {
+  Batch_TF *batch = (Batch_TF *)ptr_batch;
+  Writer_TF *wr = (Writer_TF *)ptr_writer;
+  Stats_TF *stat_TF = wr -> stat_TF;
+  int i;
+  for (i = 0; i <= NFILTERS; i++) {
+    buffer_flush(&(batch -> out[i]), wr -> fout[i]);
+  }
+  for (i = 0; i < NFILTERS; i++) {
+    stat_TF -> trimmed[i] += batch -> stats.trimmed[i];
+    stat_TF -> discarded[i] += batch -> stats.discarded[i];
+  }
+  stat_TF -> good += batch -> stats.good;
+  stat_TF -> probes[0] += batch -> stats.probes[0];
+  stat_TF -> probes[1] += batch -> stats.probes[1];
+  if ((stat_TF -> nreads + batch -> stats.nreads)/1000000 >
+       stat_TF -> nreads/1000000)
+     fprintf(stderr, "  %10d reads have been read.\n",
+             (stat_TF -> nreads + batch -> stats.nreads)/1000000*1000000);
+  stat_TF -> nreads += batch -> stats.nreads;
+}
+
 /**
  * @brief trimFilter main function
  *
@@ -89,20 +280,16 @@ int main(int argc, char *argv[]) {
   FILE *f_NNNN = NULL;
   FILE *f_adap = NULL;
 
-  int newlen;
-  int offset = 0;
-  char *buffer = malloc(sizeof(char)*(B_LEN + 1));
   Stats_TF stat_TF;
   memset(&stat_TF, 0, sizeof(Stats_TF));
-  int j = 0, nlines = 0, c1 = 0, c2 = -1;
-  char char_seq[4*READ_MAXLEN];  // string containing one fq read
-  int Nchar;  // length of char_seq
+  int i, nlines = 0;
 
   clock_t start, end;
   double cpu_time_used;
   time_t rawtime;
   struct tm * timeinfo;
   Ad_seq *adap_list = NULL;
+  Ad_index *ptr_adidx = NULL;
 
   // Start the clock
   start = clock();
@@ -118,7 +305,10 @@ int main(int argc, char *argv[]) {
   stat_TF.filters[NNNN] = par_TF.trimN;
 
   // Allocating memory for the fastq structure
-  Fq_read* seq = malloc(sizeof(Fq_read));
+  Fq_read* seq = malloc(NREADS_BLOCK*sizeof(Fq_read));
+
+  // The .gz outputs are compressed by as many threads as filter the reads
+  set_compress_threads(par_TF.nthreads);
 
   // Loading the adapters file if the option is activated
   if (par_TF.is_adapter) {
@@ -129,6 +319,10 @@ int main(int argc, char *argv[]) {
     read_fasta(par_TF.ad.ad_fa, ptr_fa_ad);
     adap_list = pack_adapter(ptr_fa_ad);
     par_TF.ad.Nad = ptr_fa_ad -> nentries;
+    if (par_TF.ad.mode == HAMMING) {
+      ptr_adidx = index_adapter(adap_list, par_TF.ad.Nad,
+                                par_TF.ad.mismatches);
+    }
     free_fasta(ptr_fa_ad);
     // Alocate memory for the packed sequence
     fprintf(stderr, "- Adapters removal is activated!\n");
@@ -136,14 +330,15 @@ int main(int argc, char *argv[]) {
   // Loading the index file to look for contaminations
   Tree *ptr_tree = NULL;
   Bfilter *ptr_bf = NULL;
+  Kmerset *ptr_ks = NULL;
   if (par_TF.method) {
     f_cont = fopen_gen(fq_cont, "w");  // open fq_cont file for writing
     if (par_TF.is_fa && par_TF.method == TREE) {
-       Fa_data *ptr_fa = malloc(sizeof(Fa_data));
-       fprintf(stderr, "* DOING: Reading fasta file %s ...\n",
+       uint64_t nbases = 0;
+       fprintf(stderr, "* DOING: Sweeping fasta file %s ...\n",
                        par_TF.Ifa);
-       read_fasta(par_TF.Ifa, ptr_fa);
-       if (size_fasta(ptr_fa) > MAX_FASZ_TREE) {
+       nkmers_fa(par_TF.Ifa, par_TF.kmersize, &nbases);
+       if (nbases > MAX_FASZ_TREE) {
          fprintf(stderr, "Fasta file is larger than %d.\b", (int)MAX_FASZ_TREE);
          fprintf(stderr, "This is too large for constructing a tree.\n");
          fprintf(stderr, "Try a Suffix Array or a bloomfilter instead.\n");
@@ -153,10 +348,10 @@ int main(int argc, char *argv[]) {
        }
        // Constructing tree
        fprintf(stderr, "* DOING: Constructing tree ... \n");
-       ptr_tree = tree_from_fasta(ptr_fa, par_TF.kmersize);
-       // Free fasta file
-       fprintf(stderr, "* DOING: Deallocating fasta file structure...\n");
-       free_fasta(ptr_fa);
+       ptr_tree = tree_from_fasta(par_TF.Ifa, par_TF.kmersize,
+                                  par_TF.nthreads);
+       fprintf(stderr, "* DOING: Flattening tree ... \n");
+       flatten_tree(ptr_tree);
     } else if (par_TF.is_idx && par_TF.method == TREE) {
        // Reading tree from file
        fprintf(stderr, "* DOING: Reading tree structure from %s ... \n",
@@ -164,12 +359,24 @@ int main(int argc, char *argv[]) {
        ptr_tree = read_tree(par_TF.Iidx);
     } else if (par_TF.is_idx && par_TF.method == BLOOM) {
         ptr_bf  = read_Bfilter(par_TF.Iidx, par_TF.Iinfo);   // handle filenames
-        par_TF.ptr_bfkmer = init_Bfkmer(ptr_bf -> kmersize, ptr_bf -> hashNum);
+        par_TF.ptr_bfkmer = init_Bfkmer(ptr_bf -> kmersize,
+                                        ptr_bf -> nhashValues);
         init_LUTs();
         init_map();
         fprintf(stderr, "Method for contaminations detection: BLOOM\n");
         fprintf(stderr, "* DOING: Reading Bloom filter  from %s\n",
               par_TF.Iidx);
+    } else if (par_TF.method == KMERSET) {
+        if (par_TF.is_fa) {
+          fprintf(stderr, "* DOING: Constructing kmer set from %s ... \n",
+                  par_TF.Ifa);
+          ptr_ks = create_Kmerset(par_TF.Ifa, par_TF.kmersize);
+        } else {
+          ptr_ks = read_Kmerset(par_TF.Iidx);
+        }
+        par_TF.ptr_bfkmer = init_Bfkmer(ptr_ks -> kmersize, 1);
+        init_LUTs();
+        fprintf(stderr, "Method for contaminations detection: KMERSET\n");
     } else {
         fprintf(stderr, "OPTION_ERROR: something went wrong with the");
         fprintf(stderr, "contaminations options\n");
@@ -193,89 +400,107 @@ int main(int argc, char *argv[]) {
   // Open the output files for writing GOOD reads
   f_good = fopen_gen(fq_good, "w");
 
-  // Loop over the fastq file
-  while ( (newlen = fread(buffer+offset, 1, B_LEN-offset, fq_in)) > 0 ) {
-    newlen += offset;
-    buffer[newlen++] =  '\0';
-    for (j = 0; buffer[j] != '\0'; j++) {
-       if (buffer[j] == '\n') {
-           c2 = j;
-           offset = newlen - j+1;
-           get_fqread(seq, buffer, c1, c2, nlines, par_TF.L, 0);
-           if ((nlines % 4) == 3) {
-	      check_zeroQ(seq, par_TF.zeroQ, stat_TF.nreads);
-              stat_TF.nreads++;
-              bool discarded = false;
-              int trim;
-              if (stat_TF.filters[ADAP] && !discarded) {
-                trim = trim_adapter(seq, adap_list);
-                discarded = (!trim);
-                if (discarded) {
-                   Nchar = string_seq(seq, char_seq);
-                   buffer_output(f_adap, char_seq, Nchar, ADAP);
-                   stat_TF.discarded[ADAP]++;
-                } else if (trim == 2) {
-                   stat_TF.trimmed[ADAP]++;
-                }
-              }
-              if (stat_TF.filters[CONT] && !discarded) {
-                if (par_TF.method == TREE) {
-                  discarded = is_read_inTree(ptr_tree, seq);
-                } else if (par_TF.method == BLOOM) {
-                  discarded = is_read_inBloom(ptr_bf, seq, par_TF.ptr_bfkmer);
-                } 
-                if (discarded) {
-                  Nchar = string_seq(seq, char_seq);
-                  buffer_output(f_cont, char_seq, Nchar, CONT);
-                  stat_TF.discarded[CONT]++;
-                }
-              }
-              if (stat_TF.filters[LOWQ] && !discarded) {
-                trim = trim_sequenceQ(seq);
-                discarded = (!trim);
-                if (discarded) {
-                   Nchar = string_seq(seq, char_seq);
-                   buffer_output(f_lowq, char_seq, Nchar, LOWQ);
-                   stat_TF.discarded[LOWQ]++;
-                } else if (trim == 2) {
-                   stat_TF.trimmed[LOWQ]++;
-                }
-              }
-              if (stat_TF.filters[NNNN] && !discarded) {
-                trim = trim_sequenceN(seq);
-                discarded = (!trim);
-                if (discarded) {
-                   Nchar = string_seq(seq, char_seq);
-                   buffer_output(f_NNNN, char_seq, Nchar, NNNN);
-                   stat_TF.discarded[NNNN]++;
-                } else if (trim == 2) {
-                   stat_TF.trimmed[NNNN]++;
-                }
-              }
-              if (!discarded) {
-                 Nchar = string_seq(seq, char_seq);
-                 buffer_output(f_good, char_seq, Nchar, GOOD);
-                 stat_TF.good++;
-              }
-              if (stat_TF.nreads % 1000000 == 0)
-                 fprintf(stderr, "  %10d reads have been read.\n",
-                         stat_TF.nreads);
-           }  // end if (nlines%4 == 3)
-           c1 = c2 + 1;
-           nlines++;
-       }  // end  if \n
-    }  // end  buffer loop
-    offset = newlen - c1 -1;
-    if (offset > -1)
-      memcpy(buffer, buffer+c1, offset);
-    c2 = -1;
-    c1 = 0;
-  }  // end while
+  // Filters indexed by ADAP, CONT, LOWQ, NNNN, GOOD
+  FILE *fout[NFILTERS+1] = {f_adap, f_cont, f_lowq, f_NNNN, f_good};
+  Bfbatch *ptr_bb = NULL;
+  if (ptr_bf != NULL) {
+    ptr_bb = init_Bfbatch(ptr_bf, NREADS_BLOCK, NREADS_BLOCK*par_TF.L);
+  }
+  Worker_TF w = {adap_list, ptr_adidx, ptr_tree, ptr_bf, ptr_ks, par_TF.ptr_bfkmer,
+                 ptr_bb, seq};
+
+  Writer_TF wr = {fout, &stat_TF};
+  Fq_reader *ptr_rd = init_Fq_reader(fq_in);
+  if (par_TF.nthreads == 1) {
+    // Loop over the fastq file: the entries are filtered in place, in the
+    // buffer of the reader, and written by the calling thread
+    Batch_TF batch;
+    memset(&batch, 0, sizeof(Batch_TF));
+    do {
+      batch.nlines = ptr_rd -> nlines;
+      batch.nentries = view_entries(ptr_rd, &(batch.entries), &(batch.ends),
+                                    NREADS_BATCH);
+      if (batch.nentries) {
+        work_TF(&batch, &w);
+        write_TF(&batch, &wr);
+      }
+    } while (batch.nentries);
+    for (i = 0; i <= NFILTERS; i++) {
+      free_Obuffer(&(batch.out[i]));
+    }
+  } else {
+    // Every worker gets its own read and kmer structures, batches of
+    // complete fq entries are filtered in parallel and written in order
+    int nthreads = par_TF.nthreads;
+    int nslots = NBATCH_THREAD*nthreads;
+    Worker_TF *workers = malloc(nthreads*sizeof(Worker_TF));
+    void **worker_arg = malloc(nthreads*sizeof(void *));
+    Batch_TF *batches = calloc(nslots, sizeof(Batch_TF));
+    void **slot = malloc(nslots*sizeof(void *));
+    for (i = 0; i < nthreads; i++) {
+      workers[i] = w;
+      workers[i].seq = malloc(NREADS_BLOCK*sizeof(Fq_read));
+      if (ptr_bf != NULL) {
+        workers[i].ptr_bfkmer = init_Bfkmer(ptr_bf -> kmersize,
+                                            ptr_bf -> nhashValues);
+        workers[i].ptr_bb = init_Bfbatch(ptr_bf, NREADS_BLOCK,
+                                         NREADS_BLOCK*par_TF.L);
+      } else if (ptr_ks != NULL) {
+        workers[i].ptr_bfkmer = init_Bfkmer(ptr_ks -> kmersize, 1);
+      }
+      worker_arg[i] = workers + i;
+    }
+    for (i = 0; i < nslots; i++) {
+      slot[i] = batches + i;
+    }
+    fprintf(stderr, "- Filtering with %d threads.\n", nthreads);
+    Pipeline *ptr_pl = init_pipeline(nthreads, slot, nslots, work_TF,
+                                     worker_arg, write_TF, &wr);
+    int nentries;
+    do {
+      Batch_TF *batch = pipeline_next(ptr_pl);
+      batch -> in.count = 0;
+      batch -> in_ends.count = 0;
+      batch -> nlines = ptr_rd -> nlines;
+      nentries = read_entries(ptr_rd, &(batch -> in), &(batch -> in_ends),
+                              NREADS_BATCH);
+      if (nentries) {
+        batch -> entries = batch -> in.buf;
+        batch -> ends = batch -> in_ends.end;
+        batch -> nentries = nentries;
+        pipeline_push(ptr_pl);
+      }
+    } while (nentries == NREADS_BATCH);
+    free_pipeline(ptr_pl);
+    for (i = 0; i < nthreads; i++) {
+      free(workers[i].seq);
+      if (workers[i].ptr_bfkmer != par_TF.ptr_bfkmer) {
+        free_Bfkmer(workers[i].ptr_bfkmer);
+        free(workers[i].ptr_bfkmer);
+      }
+      if (workers[i].ptr_bb != ptr_bb) {
+        free_Bfbatch(workers[i].ptr_bb);
+      }
+    }
+    for (i = 0; i < nslots; i++) {
+      int k;
+      free_Obuffer(&(batches[i].in));
+      free_Ebuffer(&(batches[i].in_ends));
+      for (k = 0; k <= NFILTERS; k++) {
+        free_Obuffer(&(batches[i].out[k]));
+      }
+    }
+    free(workers);
+    free(worker_arg);
+    free(batches);
+    free(slot);
+  }
+  nlines = ptr_rd -> nlines + ptr_rd -> nl;
+  free_Fq_reader(ptr_rd);
   fprintf(stderr, "- Number of lines in fq_file %d\n", nlines);
-  // Printing the rest of the buffer outputs and closing file
+  // Closing files
   fprintf(stderr, "- Finished reading fq file.\n");
   fprintf(stderr, "- Closing files.\n");
-  buffer_output(f_good, NULL, 0, GOOD);
   fclose(f_good);
   fclose(fq_in);
   fprintf(stderr, "- Number of reads: %d\n", stat_TF.nreads);
@@ -283,27 +508,26 @@ int main(int argc, char *argv[]) {
         stat_TF.good, fq_good);
 
   if (stat_TF.filters[ADAP]) {
-    buffer_output(f_adap, NULL, 0, ADAP);
     fclose(f_adap);
     fprintf(stderr, "- Discarded due to adapters: %d, stored in %s\n",
           stat_TF.discarded[ADAP], fq_adap);
     fprintf(stderr, "- Trimmed due to adapters: %d\n", stat_TF.trimmed[ADAP]);
   }
   if (stat_TF.filters[CONT]) {
-    buffer_output(f_cont, NULL, 0, CONT);
     fclose(f_cont);
     fprintf(stderr, "- Discarded due to cont: %d, stored in %s\n",
           stat_TF.discarded[CONT], fq_cont);
+    fprintf(stderr, "- Contamination lookups: %" PRIu64 ", skipped by "
+          "early exits: %" PRIu64 "\n", stat_TF.probes[0],
+          stat_TF.probes[1]);
   }
   if (stat_TF.filters[LOWQ]) {
-    buffer_output(f_lowq, NULL, 0, LOWQ);
     fclose(f_lowq);
     fprintf(stderr, "- Discarded due to lowQ: %d, stored in %s\n",
           stat_TF.discarded[LOWQ], fq_lowq);
     fprintf(stderr, "- Trimmed due to lowQ: %d\n", stat_TF.trimmed[LOWQ]);
   }
   if (stat_TF.filters[NNNN]) {
-    buffer_output(f_NNNN, NULL, 0, NNNN);
     fclose(f_NNNN);
     fprintf(stderr, "- Discarded due to N's: %d, stored in %s\n",
           stat_TF.discarded[NNNN], fq_NNNN);
@@ -314,11 +538,18 @@ int main(int argc, char *argv[]) {
   write_summary_TF(stat_TF, summary);
 
   free(seq);
+  free_Ad_index(ptr_adidx);
+  if (ptr_bb != NULL) {
+     free_Bfbatch(ptr_bb);
+  }
   if (ptr_tree != NULL) {
      fprintf(stderr, "- Deallocating tree\n");
      free_all_nodes(ptr_tree);
   }
-  free(buffer);
+  if (ptr_ks != NULL) {
+     fprintf(stderr, "- Deallocating kmer set\n");
+     free_Kmerset(ptr_ks);
+  }
   free_parTF(&par_TF);
   // Obtaining elapsed time
   end = clock();
@@ -40,15 +40,266 @@
 #include "trim.h"
 #include "tree.h"
 #include "bloom.h"
+#include "kmerset.h"
 #include "Lmer.h"
 #include "adapters.h"
 #include "fq_read.h"
 #include "io_trimFilterDS.h"
 #include "init_trimFilterDS.h"
+#include "pipeline.h"
 
 uint64_t alloc_mem = 0;    /**< global variable. Memory allocated in the heap.*/
 Iparam_trimFilter par_TF;  /**< global variable: Input parameters of makeTree.*/
 
+/**
+ * @brief data needed by a thread to filter read pairs: the adapters and
+ *        the index are shared (read only), the reads and kmer are private.
+ * */
+typedef struct _worker_TFDS {
+  DS_adap *adap_list;  /**< adapter pairs */
+  Tree *ptr_tree;  /**< tree index (method TREE) */
+  Bfilter *ptr_bf;  /**< Bloom filter (method BLOOM) */
+  Kmerset *ptr_ks;  /**< kmer set (method KMERSET) */
+  Bfkmer *ptr_bfkmer;  /**< kmer scratch structure (methods BLOOM, KMERSET) */
+  Bfbatch *ptr_bb;  /**< kmers of a block of reads (method BLOOM) */
+  Fq_read *seq1;  /**< NREADS_BLOCK reads 1 being filtered */
+  Fq_read *seq2;  /**< NREADS_BLOCK reads 2 being filtered */
+} Worker_TFDS;
+
+/**
+ * @brief output files and global stats, used by the writer thread
+ * */
+typedef struct _writer_TFDS {
+  FILE **fout;  /**< output files: ADAP, ..., GOOD, ADAP2, ..., GOOD2 */
+  Stats_TFDS *stat_TFDS;  /**< stats of the whole fastq files */
+} Writer_TFDS;
+
+/**
+ * @brief removes the adapters of a read pair and updates the stats
+ * @param w pointer to Worker_TFDS
+ * @param seq1 read 1
+ * @param seq2 read 2
+ * @param stat_TFDS stats to be updated
+ * @return ADAP if the pair was discarded, GOOD otherwise
+ *
+ * */
+static int filter_adapter(Worker_TFDS *w, Fq_read *seq1, Fq_read *seq2,
+                          Stats_TFDS *stat_TFDS) {
+  bool discarded = false;
+  int trim = 0;
+  int i_ad;
+  if (par_TF.is_adapter) {
+    for (i_ad=0; i_ad < par_TF.ad.Nad; i_ad++) {
+      trim = trim_adapterDS(&(w -> adap_list[i_ad]), seq1, seq2, par_TF.zeroQ);
+      discarded = (!trim);
+      if (trim != 1) break;
+    }
+    if (discarded) {
+      stat_TFDS -> discarded[ADAP]++;
+      return ADAP;
+    } else if (trim == 2) {
+      stat_TFDS -> trimmed1[ADAP]++;
+      stat_TFDS -> trimmed2[ADAP]++;
+    }
+  }
+  return GOOD;
+}
+
+/**
+ * @brief looks for contaminations in the read pairs of a block that were
+ *        not discarded yet, and updates the stats
+ * @param w pointer to Worker_TFDS containing the read pairs
+ * @param n number of pairs in w -> seq1, w -> seq2
+ * @param filter filter of every pair: set to CONT if it is a contamination
+ * @param stat_TFDS stats to be updated
+ *
+ * A pair is a contamination if one of its reads is, read 2 is only checked
+ * if read 1 is not. With method BLOOM the reads 1 of the block are looked
+ * up together (reads_inBloom), and then the remaining reads 2.
+ * */
+static void filter_cont(Worker_TFDS *w, int n, int *filter,
+                        Stats_TFDS *stat_TFDS) {
+  Fq_read *seqs[NREADS_BLOCK];
+  bool found[NREADS_BLOCK];
+  int idx[NREADS_BLOCK];
+  uint64_t *probes = stat_TFDS -> probes;
+  int i, m = 0, m2 = 0;
+  for (i = 0; i < n; i++) {
+    if (filter[i] == GOOD) {
+      idx[m] = i;
+      seqs[m++] = w -> seq1 + i;
+    }
+  }
+  if (par_TF.method == BLOOM) {
+    reads_inBloom(w -> ptr_bf, w -> ptr_bb, w -> ptr_bfkmer, seqs, m, found,
+                  probes);
+    for (i = 0; i < m; i++) {
+      if (found[i]) {
+        filter[idx[i]] = CONT;
+      } else {
+        idx[m2] = idx[i];
+        seqs[m2++] = w -> seq2 + idx[i];
+      }
+    }
+    reads_inBloom(w -> ptr_bf, w -> ptr_bb, w -> ptr_bfkmer, seqs, m2, found,
+                  probes);
+    for (i = 0; i < m2; i++) {
+      if (found[i]) filter[idx[i]] = CONT;
+    }
+  }
+  for (i = 0; i < m; i++) {
+    Fq_read *seq1 = w -> seq1 + idx[i], *seq2 = w -> seq2 + idx[i];
+    if (par_TF.method == TREE) {
+      if (is_read_inTree(w -> ptr_tree, seq1, probes) ||
+          is_read_inTree(w -> ptr_tree, seq2, probes)) {
+        filter[idx[i]] = CONT;
+      }
+    } else if (par_TF.method == KMERSET) {
+      if (is_read_inKmerset(w -> ptr_ks, seq1, w -> ptr_bfkmer, probes) ||
+          is_read_inKmerset(w -> ptr_ks, seq2, w -> ptr_bfkmer, probes)) {
+        filter[idx[i]] = CONT;
+      }
+    }
+  }
+  for (i = 0; i < n; i++) {
+    if (filter[i] == CONT) stat_TFDS -> discarded[CONT]++;
+  }
+}
+
+/**
+ * @brief runs the rest of the filter chain (lowQ, N's) on a read pair and
+ *        updates the stats
+ * @param seq1 read 1
+ * @param seq2 read 2
+ * @param stat_TFDS stats to be updated
+ * @return LOWQ or NNNN if the pair was discarded, GOOD otherwise. Read 2
+ *         goes to the returned value + NFILTERS + 1.
+ *
+ * */
+static int filter_pair(Fq_read *seq1, Fq_read *seq2, Stats_TFDS *stat_TFDS) {
+  int trim = 0, trim2 = 0;
+  if (par_TF.trimQ) {
+    trim = trim_sequenceQ(seq1);
+    trim2 = trim_sequenceQ(seq2);
+    if ((!trim) || (!trim2)) {
+      stat_TFDS -> discarded[LOWQ]++;
+      return LOWQ;
+    } else if (trim == 2) {
+      stat_TFDS -> trimmed1[LOWQ]++;
+    } else if (trim2 == 2) {
+      stat_TFDS -> trimmed2[LOWQ]++;
+    }
+  }
+  if (par_TF.trimN) {
+    trim = trim_sequenceN(seq1);
+    trim2 = trim_sequenceN(seq2);
+    if ((!trim) || (!trim2)) {
+      stat_TFDS -> discarded[NNNN]++;
+      return NNNN;
+    } else if (trim == 2) {
+      stat_TFDS -> trimmed1[NNNN]++;
+    } else if (trim2 == 2) {
+      stat_TFDS -> trimmed2[NNNN]++;
+    }
+  }
+  stat_TFDS -> good++;
+  return GOOD;
+}
+
+/**
+ * @brief parses the fq entry of buffer whose lines end at ends[0..3]
+ * @param start position of the first line
+ * */
+static void get_fqentry(Fq_read *seq, char *buffer, int start, int *ends,
+                        int nline) {
+  int i;
+  for (i = 0; i < 4; i++) {
+    get_fqread(seq, buffer, start, ends[i], nline + i, par_TF.L, 0);
+    start = ends[i] + 1;
+  }
+}
+
+/**
+ * @brief worker thread: parses and filters the read pairs of a batch
+ * @param ptr_batch pointer to Batch_TFDS
+ * @param ptr_worker pointer to the Worker_TFDS owned by the thread
+ *
+ * The pairs are filtered in blocks of NREADS_BLOCK: adapters,
+ * contaminations (all pairs of the block at once) and then lowQ and N's.
+ * */
+static void work_TFDS(void *ptr_batch, void *ptr_worker) {
+  Batch_TFDS *batch = (Batch_TFDS *)ptr_batch;
+  Worker_TFDS *w = (Worker_TFDS *)ptr_worker;
+  struct iovec iov[FQ_NIOV];  // segments of one fq read
+  int filter[NREADS_BLOCK];
+  int i, j, n, niov, start = 0;
+  int nlines = batch -> nlines;
+  memset(&(batch -> stats), 0, sizeof(Stats_TFDS));
+  for (i = 0; i < NFILES_DS; i++) {
+    batch -> out[i].count = 0;
+  }
+  for (i = 0; i < batch -> npairs; i += n) {
+    n = min(NREADS_BLOCK, batch -> npairs - i);
+    for (j = 0; j < n; j++) {
+      int k = i + j;
+      Fq_read *seq1 = w -> seq1 + j, *seq2 = w -> seq2 + j;
+      if (k > 0) start = batch -> ends1[4*k - 1] + 1;
+      get_fqentry(seq1, batch -> entries1, start, batch -> ends1 + 4*k,
+                  nlines);
+      if (k > 0) start = batch -> ends2[4*k - 1] + 1;
+      get_fqentry(seq2, batch -> entries2, start, batch -> ends2 + 4*k,
+                  nlines);
+      check_zeroQ(seq1, par_TF.zeroQ, nlines/4);
+      check_zeroQ(seq2, par_TF.zeroQ, nlines/4);
+      batch -> stats.nreads++;
+      filter[j] = filter_adapter(w, seq1, seq2, &(batch -> stats));
+      nlines += 4;
+    }
+    if (par_TF.method) {
+      filter_cont(w, n, filter, &(batch -> stats));
+    }
+    for (j = 0; j < n; j++) {
+      if (filter[j] == GOOD) {
+        filter[j] = filter_pair(w -> seq1 + j, w -> seq2 + j,
+                                &(batch -> stats));
+      }
+      niov = iovec_seq(w -> seq1 + j, iov);
+      buffer_appendv(&(batch -> out[filter[j]]), iov, niov);
+      niov = iovec_seq(w -> seq2 + j, iov);
+      buffer_appendv(&(batch -> out[filter[j] + NFILTERS + 1]), iov, niov);
+    }
+  }
+}
+
+/**
+ * @brief writer thread: writes the output of a batch and adds its stats
+ * @param ptr_batch pointer to Batch_TFDS, already filtered
+ * @param ptr_writer pointer to Writer_TFDS
+ *
+ * */
+static void write_TFDS(void *ptr_batch, void *ptr_writer) {
+  Batch_TFDS *batch = (Batch_TFDS *)ptr_batch;
+  Writer_TFDS *wr = (Writer_TFDS *)ptr_writer;
+  Stats_TFDS *stat_TFDS = wr -> stat_TFDS;
+  int i;
+  for (i = 0; i < NFILES_DS; i++) {
+    buffer_flush(&(batch -> out[i]), wr -> fout[i]);
+  }
+  for (i = 0; i < NFILTERS; i++) {
+    stat_TFDS -> trimmed1[i] += batch -> stats.trimmed1[i];
+    stat_TFDS -> trimmed2[i] += batch -> stats.trimmed2[i];
+    stat_TFDS -> discarded[i] += batch -> stats.discarded[i];
+  }
+  stat_TFDS -> good += batch -> stats.good;
+  stat_TFDS -> probes[0] += batch -> stats.probes[0];
+  stat_TFDS -> probes[1] += batch -> stats.probes[1];
+  if ((stat_TFDS -> nreads + batch -> stats.nreads)/1000000 >
+       stat_TFDS -> nreads/1000000)
+     fprintf(stderr, "  %10d reads have been read.\n",
+             (stat_TFDS -> nreads + batch -> stats.nreads)/1000000*1000000);
+  stat_TFDS -> nreads += batch -> stats.nreads;
+}
+
 
 /**
  * @brief contains trimfilterDS main function. See README_trimFilterDS.md
@@ -111,11 +362,6 @@ int main(int argc, char *argv[]) {
 
   Stats_TFDS stat_TFDS;
   memset(&stat_TFDS, 0, sizeof(Stats_TFDS));
-  //char char_seq1[4*READ_MAXLEN];  // string containing one fq read
-  //char char_seq2[4*READ_MAXLEN];  // string containing one fq read
-  char *char_seq1 = calloc(4*READ_MAXLEN, sizeof(char));  // string containing one fq read
-  char *char_seq2 = calloc(4*READ_MAXLEN, sizeof(char));  // string containing one fq read
-  int Nchar1, Nchar2;  // length of char_seq
 
   clock_t start, end;
   double cpu_time_used;
@@ -137,8 +383,11 @@ int main(int argc, char *argv[]) {
   stat_TFDS.filters[NNNN] = par_TF.trimN;
 
   // Allocating memory for the fastq structure,
-  Fq_read  *seq1 = malloc(sizeof(Fq_read));
-  Fq_read  *seq2 = malloc(sizeof(Fq_read));
+  Fq_read  *seq1 = malloc(NREADS_BLOCK*sizeof(Fq_read));
+  Fq_read  *seq2 = malloc(NREADS_BLOCK*sizeof(Fq_read));
+
+  // The .gz outputs are compressed by as many threads as filter the reads
+  set_compress_threads(par_TF.nthreads);
 
   // Loading the adapters file if the option is activated
   if (par_TF.is_adapter) {
@@ -163,14 +412,15 @@ int main(int argc, char *argv[]) {
   }  // endif par_TF.is adapter
   Tree *ptr_tree = NULL;
   Bfilter *ptr_bf = NULL;
+  Kmerset *ptr_ks = NULL;
   if (par_TF.method) {
     f_cont1 = fopen_gen(fq_cont1, "w");  // open fq_cont file for writing
     f_cont2 = fopen_gen(fq_cont2, "w");  // open fq_cont file for writing
     if (par_TF.is_fa && par_TF.method == TREE) {
-       Fa_data *ptr_fa = malloc(sizeof(Fa_data));
-       fprintf(stderr, "* DOING: Reading fasta file %s ...\n", par_TF.Ifa);
-       read_fasta(par_TF.Ifa, ptr_fa);
-       if (size_fasta(ptr_fa) > MAX_FASZ_TREE) {
+       uint64_t nbases = 0;
+       fprintf(stderr, "* DOING: Sweeping fasta file %s ...\n", par_TF.Ifa);
+       nkmers_fa(par_TF.Ifa, par_TF.kmersize, &nbases);
+       if (nbases > MAX_FASZ_TREE) {
          fprintf(stderr, "Fasta file is larger than %d.\b", (int)MAX_FASZ_TREE);
          fprintf(stderr, "This is too large for constructing a tree.\n");
          fprintf(stderr, "Try a Suffix Array or a bloomfilter instead.\n");
@@ -180,10 +430,10 @@ int main(int argc, char *argv[]) {
        }
        // Constructing tree
        fprintf(stderr, "* DOING: Constructing tree ... \n");
-       ptr_tree = tree_from_fasta(ptr_fa, par_TF.kmersize);
-       // Free fasta file
-       fprintf(stderr, "* DOING: Deallocating fasta file structure...\n");
-       free_fasta(ptr_fa);
+       ptr_tree = tree_from_fasta(par_TF.Ifa, par_TF.kmersize,
+                                  par_TF.nthreads);
+       fprintf(stderr, "* DOING: Flattening tree ... \n");
+       flatten_tree(ptr_tree);
     } else if (par_TF.is_idx && par_TF.method == TREE) {
        // Reading tree from file
        fprintf(stderr, "* DOING: Reading tree structure from %s ... \n",
@@ -191,12 +441,24 @@ int main(int argc, char *argv[]) {
        ptr_tree = read_tree(par_TF.Iidx);
     } else if (par_TF.is_idx && par_TF.method == BLOOM) {
         ptr_bf  = read_Bfilter(par_TF.Iidx, par_TF.Iinfo);   // handle filenames
-        par_TF.ptr_bfkmer = init_Bfkmer(ptr_bf -> kmersize, ptr_bf -> hashNum);
+        par_TF.ptr_bfkmer = init_Bfkmer(ptr_bf -> kmersize,
+                                        ptr_bf -> nhashValues);
         init_LUTs();
         init_map();
         fprintf(stderr, "Method for contaminations detection: BLOOM\n");
         fprintf(stderr, "* DOING: Reading Bloom filter  from %s\n",
               par_TF.Iidx);
+    } else if (par_TF.method == KMERSET) {
+        if (par_TF.is_fa) {
+          fprintf(stderr, "* DOING: Constructing kmer set from %s ... \n",
+                  par_TF.Ifa);
+          ptr_ks = create_Kmerset(par_TF.Ifa, par_TF.kmersize);
+        } else {
+          ptr_ks = read_Kmerset(par_TF.Iidx);
+        }
+        par_TF.ptr_bfkmer = init_Bfkmer(ptr_ks -> kmersize, 1);
+        init_LUTs();
+        fprintf(stderr, "Method for contaminations detection: KMERSET\n");
     } else {
         fprintf(stderr, "OPTION_ERROR: something went wrong with the");
         fprintf(stderr, "contaminations options\n");
@@ -224,146 +486,125 @@ int main(int argc, char *argv[]) {
   f_good1 = fopen_gen(fq_good1, "w");
   f_good2 = fopen_gen(fq_good2, "w");
 
-  int newl1 = 0, newl2 = 0;
-  int offset1 = 0, offset2 = 0;
-  int l1_i = 0, l1_f = 0, l2_i = 0, l2_f = 0;
-  int j1 = 0, j2 = 0;
-  int i_ad = 0;
-  int nl1 = 0, nl2 = 0;
-  int stop1 = 0, stop2 = 0;
-  char *buffer1 = malloc(sizeof(char)*(B_LEN + 1));
-  char *buffer2 = malloc(sizeof(char)*(B_LEN + 1));
-  do {
-     newl1 = fread(buffer1+offset1, 1, B_LEN-offset1, fq_in1);
-     newl2 = fread(buffer2+offset2, 1, B_LEN-offset2, fq_in2);
-     newl1 += offset1;
-     newl2 += offset2;
-     buffer1[newl1] = '\0';
-     buffer2[newl2] = '\0';
-     j1 = 0; j2 = 0;
-     while ((j1 <= newl1 && j2 <= newl2) && (newl1 ||  newl2)) {
-        if ((buffer1[j1] == '\n') && (j1 < newl1)) {
-          l1_f = j1;
-          get_fqread(seq1, buffer1, l1_i, l1_f, nl1, par_TF.L, 0);
-          if ((nl1++ % 4 == 3)) {
-             stop1 = 1;
-             j1++;
-          }
-          l1_i = l1_f + 1;
-        }
-        if ((buffer2[j2] == '\n') && (j2 < newl2)) {
-          l2_f = j2;
-          get_fqread(seq2, buffer2, l2_i, l2_f, nl2, par_TF.L, 0);
-          if ((nl2++ % 4 == 3)) {
-             stop2 = 1;
-             j2++;
-          }
-          l2_i = l2_f + 1;
-        }
-        if (stop1 && !stop2) {
-           j2++;
-        } else if (!stop1 && stop2) {
-           j1++;
-        } else if (!stop1 && !stop2) {
-           j1++;
-           j2++;
-        } else if (stop1 && stop2) {  // Do the stuff!!
- 	   check_zeroQ(seq1, par_TF.zeroQ, stat_TFDS.nreads);
- 	   check_zeroQ(seq2, par_TF.zeroQ, stat_TFDS.nreads);
-           stat_TFDS.nreads++;
-           bool discarded = false;
-           int trim = 0, trim2 = 0;
-           if (stat_TFDS.filters[ADAP] && !discarded) {
-              for (i_ad=0; i_ad < par_TF.ad.Nad; i_ad++) {
-                trim = trim_adapterDS(&adap_list[i_ad], seq1, seq2, par_TF.zeroQ);
-                discarded = (!trim);
-                if (trim != 1) break;
-              }
-              if (discarded) {
-                 Nchar1 = string_seq(seq1, char_seq1);
-                 Nchar2 = string_seq(seq2, char_seq2);
-                 buffer_outputDS(f_adap1, char_seq1, Nchar1, ADAP);
-                 buffer_outputDS(f_adap2, char_seq2, Nchar2, ADAP2);
-                 stat_TFDS.discarded[ADAP]++;
-              } else if (trim == 2) {
-                 stat_TFDS.trimmed1[ADAP]++;
-                 stat_TFDS.trimmed2[ADAP]++;
-              }
-           }
-           if (stat_TFDS.filters[CONT] && !discarded) {
-             if (par_TF.method == TREE) {
-               discarded = (is_read_inTree(ptr_tree, seq1) ||
-                             is_read_inTree(ptr_tree, seq2));
-             } else if (par_TF.method == BLOOM) {
-               discarded =(is_read_inBloom(ptr_bf, seq1, par_TF.ptr_bfkmer) ||
-                          is_read_inBloom(ptr_bf, seq2, par_TF.ptr_bfkmer));
-             }
-             if (discarded) {
-               Nchar1 = string_seq(seq1, char_seq1);
-               Nchar2 = string_seq(seq2, char_seq2);
-               buffer_outputDS(f_cont1, char_seq1, Nchar1, CONT);
-               buffer_outputDS(f_cont2, char_seq2, Nchar2, CONT2);
-               stat_TFDS.discarded[CONT]++;
-             }
-           }
-           if (stat_TFDS.filters[LOWQ] && !discarded) {
-             trim = trim_sequenceQ(seq1);
-             trim2 = trim_sequenceQ(seq2);
-             discarded = (!trim) || (!trim2);
-             if (discarded) {
-                Nchar1 = string_seq(seq1, char_seq1);
-                buffer_outputDS(f_lowq1, char_seq1, Nchar1, LOWQ);
-                Nchar2 = string_seq(seq2, char_seq2);
-                buffer_outputDS(f_lowq2, char_seq2, Nchar2, LOWQ2);
-                stat_TFDS.discarded[LOWQ]++;
-             } else if (trim == 2) {
-                stat_TFDS.trimmed1[LOWQ]++;
-             } else if (trim2 == 2) {
-                stat_TFDS.trimmed2[LOWQ]++;
-             }
-           }
-           if (stat_TFDS.filters[NNNN] && !discarded) {
-             trim = trim_sequenceN(seq1);
-             trim2 = trim_sequenceN(seq2);
-             discarded = (!trim) || (!trim2);
-             if (discarded) {
-                Nchar1 = string_seq(seq1, char_seq1);
-                buffer_outputDS(f_NNNN1, char_seq1, Nchar1, NNNN);
-                Nchar2 = string_seq(seq2, char_seq2);
-                buffer_outputDS(f_NNNN1, char_seq2, Nchar2, NNNN2);
-                stat_TFDS.discarded[NNNN]++;
-             } else if (trim == 2) {
-                stat_TFDS.trimmed1[NNNN]++;
-             } else if (trim2 == 2) {
-                stat_TFDS.trimmed2[NNNN]++;
-             }
-           }
-           if (!discarded) {
-              Nchar1 = string_seq(seq1, char_seq1);
-              Nchar2 = string_seq(seq2, char_seq2);
-              buffer_outputDS(f_good1, char_seq1, Nchar1, GOOD);
-              buffer_outputDS(f_good2, char_seq2, Nchar2, GOOD2);
-              stat_TFDS.good++;
-           }
-           if (stat_TFDS.nreads % 1000000 == 0)
-              fprintf(stderr, "  %10d reads have been read.\n",
-                      stat_TFDS.nreads);
-           // reset stop
-           stop1 = 0;
-           stop2 = 0;
-        }
-     }  // end buffer loop
-     offset1 = newl1 - l1_i;
-     if (offset1 > -1)
-       memmove(buffer1, buffer1 + l1_i, offset1);
-     l1_f = -1;
-     l1_i = 0;
-     offset2 = newl2 - l2_i;
-     if (offset2 > -1)
-       memmove(buffer2, buffer2 + l2_i, offset2);
-     l2_f = -1;
-     l2_i = 0;
-  }  while ((newl1 > offset1) ||  (newl2 > offset2));  // end read buffer
+  // Filters indexed by ADAP, CONT, LOWQ, NNNN, GOOD, ADAP2, ..., GOOD2
+  FILE *fout[NFILES_DS] = {f_adap1, f_cont1, f_lowq1, f_NNNN1, f_good1,
+                           f_adap2, f_cont2, f_lowq2, f_NNNN2, f_good2};
+  Bfbatch *ptr_bb = NULL;
+  if (ptr_bf != NULL) {
+    ptr_bb = init_Bfbatch(ptr_bf, NREADS_BLOCK, NREADS_BLOCK*par_TF.L);
+  }
+  Worker_TFDS w = {adap_list, ptr_tree, ptr_bf, ptr_ks, par_TF.ptr_bfkmer,
+                   ptr_bb, seq1, seq2};
+  Writer_TFDS wr = {fout, &stat_TFDS};
+  Fq_reader *ptr_rd1 = init_Fq_reader(fq_in1);
+  Fq_reader *ptr_rd2 = init_Fq_reader(fq_in2);
+  int i, n1, n2, nl1, nl2;
+  if (par_TF.nthreads == 1) {
+    // Lock-step loop over both files: the pairs are filtered in place, in
+    // the buffers of the readers, and written by the calling thread
+    Batch_TFDS batch;
+    memset(&batch, 0, sizeof(Batch_TFDS));
+    do {
+      batch.nlines = ptr_rd1 -> nlines;
+      n1 = view_entries(ptr_rd1, &(batch.entries1), &(batch.ends1),
+                        NREADS_BATCH);
+      n2 = view_entries(ptr_rd2, &(batch.entries2), &(batch.ends2), n1);
+      // Give back the entries of file 1 whose mates are not read yet
+      if (n2 < n1) unview_entries(ptr_rd1, n1 - n2);
+      batch.npairs = n2;
+      if (n2 > 0) {
+        work_TFDS(&batch, &w);
+        write_TFDS(&batch, &wr);
+      }
+    } while (n2 > 0);
+    for (i = 0; i < NFILES_DS; i++) {
+      free_Obuffer(&(batch.out[i]));
+    }
+  } else {
+    // Every worker gets its own reads and kmer structures, batches of
+    // read pairs are filtered in parallel and written in order
+    int nthreads = par_TF.nthreads;
+    int nslots = NBATCH_THREAD*nthreads;
+    Worker_TFDS *workers = malloc(nthreads*sizeof(Worker_TFDS));
+    void **worker_arg = malloc(nthreads*sizeof(void *));
+    Batch_TFDS *batches = calloc(nslots, sizeof(Batch_TFDS));
+    void **slot = malloc(nslots*sizeof(void *));
+    for (i = 0; i < nthreads; i++) {
+      workers[i] = w;
+      workers[i].seq1 = malloc(NREADS_BLOCK*sizeof(Fq_read));
+      workers[i].seq2 = malloc(NREADS_BLOCK*sizeof(Fq_read));
+      if (ptr_bf != NULL) {
+        workers[i].ptr_bfkmer = init_Bfkmer(ptr_bf -> kmersize,
+                                            ptr_bf -> nhashValues);
+        workers[i].ptr_bb = init_Bfbatch(ptr_bf, NREADS_BLOCK,
+                                         NREADS_BLOCK*par_TF.L);
+      } else if (ptr_ks != NULL) {
+        workers[i].ptr_bfkmer = init_Bfkmer(ptr_ks -> kmersize, 1);
+      }
+      worker_arg[i] = workers + i;
+    }
+    for (i = 0; i < nslots; i++) {
+      slot[i] = batches + i;
+    }
+    fprintf(stderr, "- Filtering with %d threads.\n", nthreads);
+    Pipeline *ptr_pl = init_pipeline(nthreads, slot, nslots, work_TFDS,
+                                     worker_arg, write_TFDS, &wr);
+    do {
+      // Lock-step: the same number of entries from both files
+      Batch_TFDS *batch = pipeline_next(ptr_pl);
+      batch -> in1.count = 0;
+      batch -> in2.count = 0;
+      batch -> in1_ends.count = 0;
+      batch -> in2_ends.count = 0;
+      batch -> nlines = ptr_rd1 -> nlines;
+      n1 = read_entries(ptr_rd1, &(batch -> in1), &(batch -> in1_ends),
+                        NREADS_BATCH);
+      n2 = read_entries(ptr_rd2, &(batch -> in2), &(batch -> in2_ends), n1);
+      if (n2 > 0) {
+        batch -> entries1 = batch -> in1.buf;
+        batch -> entries2 = batch -> in2.buf;
+        batch -> ends1 = batch -> in1_ends.end;
+        batch -> ends2 = batch -> in2_ends.end;
+        batch -> npairs = n2;
+        pipeline_push(ptr_pl);
+      }
+    } while (n2 == NREADS_BATCH);
+    free_pipeline(ptr_pl);
+    for (i = 0; i < nthreads; i++) {
+      free(workers[i].seq1);
+      free(workers[i].seq2);
+      if (workers[i].ptr_bfkmer != par_TF.ptr_bfkmer) {
+        free_Bfkmer(workers[i].ptr_bfkmer);
+        free(workers[i].ptr_bfkmer);
+      }
+      if (workers[i].ptr_bb != ptr_bb) {
+        free_Bfbatch(workers[i].ptr_bb);
+      }
+    }
+    for (i = 0; i < nslots; i++) {
+      int k;
+      free_Obuffer(&(batches[i].in1));
+      free_Obuffer(&(batches[i].in2));
+      free_Ebuffer(&(batches[i].in1_ends));
+      free_Ebuffer(&(batches[i].in2_ends));
+      for (k = 0; k < NFILES_DS; k++) {
+        free_Obuffer(&(batches[i].out[k]));
+      }
+    }
+    free(workers);
+    free(worker_arg);
+    free(batches);
+    free(slot);
+  }
+  // Count the lines left if one of the files is longer than the other
+  Obuffer rest = {NULL, 0, 0};
+  while (read_entries(ptr_rd1, &rest, NULL, NREADS_BATCH)) rest.count = 0;
+  while (read_entries(ptr_rd2, &rest, NULL, NREADS_BATCH)) rest.count = 0;
+  free_Obuffer(&rest);
+  nl1 = ptr_rd1 -> nlines + ptr_rd1 -> nl;
+  nl2 = ptr_rd2 -> nlines + ptr_rd2 -> nl;
+  free_Fq_reader(ptr_rd1);
+  free_Fq_reader(ptr_rd2);
 
   // Check that the number of lines of both input files is the same
   if (nl1 != nl2) {
@@ -372,15 +613,12 @@ int main(int argc, char *argv[]) {
     fprintf(stderr, "%s contains %d lines \n", par_TF.Ifq2, nl2);
     fprintf(stderr, "Exiting program\n");
     fprintf(stderr, "File: %s, line: %d\n", __FILE__, __LINE__);
-    printf("stop1 %d, stop2 %d \n", stop1, stop2);
     exit(EXIT_FAILURE);
   }
   fprintf(stderr, "- Number of lines in fq_files %d\n", nl1);
-  // Printing the rest of the buffer outputs and closing file
+  // Closing files
   fprintf(stderr, "- Finished reading fq file.\n");
   fprintf(stderr, "- Closing files.\n");
-  buffer_outputDS(f_good1, NULL, 0, GOOD);
-  buffer_outputDS(f_good2, NULL, 0, GOOD2);
   fclose(f_good1);
   fclose(f_good2);
   fclose(fq_in1);
@@ -391,9 +629,7 @@ int main(int argc, char *argv[]) {
 
   // Writing remaining buffers
   if (stat_TFDS.filters[ADAP]) {
-    buffer_outputDS(f_adap1, NULL, 0, ADAP);
     fclose(f_adap1);
-    buffer_outputDS(f_adap2, NULL, 0, ADAP2);
     fclose(f_adap2);
     fprintf(stderr, "- Discarded due to adapters: %d, stored in %s, %s\n",
           stat_TFDS.discarded[ADAP], fq_adap1, fq_adap2);
@@ -403,17 +639,16 @@ int main(int argc, char *argv[]) {
           stat_TFDS.trimmed2[ADAP]);
   }
   if (stat_TFDS.filters[CONT]) {
-    buffer_outputDS(f_cont1, NULL, 0, CONT);
     fclose(f_cont1);
-    buffer_outputDS(f_cont2, NULL, 0, CONT2);
     fclose(f_cont2);
     fprintf(stderr, "- Discarded due to cont: %d, stored in %s, %s\n",
           stat_TFDS.discarded[CONT], fq_cont1, fq_cont2);
+    fprintf(stderr, "- Contamination lookups: %" PRIu64 ", skipped by "
+          "early exits: %" PRIu64 "\n", stat_TFDS.probes[0],
+          stat_TFDS.probes[1]);
   }
   if (stat_TFDS.filters[LOWQ]) {
-    buffer_outputDS(f_lowq1, NULL, 0, LOWQ);
     fclose(f_lowq1);
-    buffer_outputDS(f_lowq2, NULL, 0, LOWQ2);
     fclose(f_lowq2);
     fprintf(stderr, "- Discarded due to lowQ: %d, stored in %s, %s\n",
           stat_TFDS.discarded[LOWQ], fq_lowq1, fq_lowq2);
@@ -423,9 +658,7 @@ int main(int argc, char *argv[]) {
           stat_TFDS.trimmed2[LOWQ]);
   }
   if (stat_TFDS.filters[NNNN]) {
-    buffer_outputDS(f_NNNN1, NULL, 0, NNNN);
     fclose(f_NNNN1);
-    buffer_outputDS(f_NNNN2, NULL, 0, NNNN2);
     fclose(f_NNNN2);
     fprintf(stderr, "- Discarded due to N's: %d, stored in %s, %s\n",
           stat_TFDS.discarded[NNNN], fq_NNNN1, fq_NNNN2);
@@ -440,12 +673,17 @@ int main(int argc, char *argv[]) {
 
   free(seq1);
   free(seq2);
+  if (ptr_bb != NULL) {
+     free_Bfbatch(ptr_bb);
+  }
   if (ptr_tree != NULL) {
      fprintf(stderr, "- Deallocating tree\n");
      free_all_nodes(ptr_tree);
   }
-  free(buffer1);
-  free(buffer2);
+  if (ptr_ks != NULL) {
+     fprintf(stderr, "- Deallocating kmer set\n");
+     free_Kmerset(ptr_ks);
+  }
   free_parTF(&par_TF);
   // Obtaining elapsed time
   end = clock();
@@ -0,0 +1,25 @@
+#---------------------------------------------------------------
+# Runs a program and compares the files it writes with the
+# expected ones (ctest).
+#   -DCMD=<program;arguments>  command, run in WORKDIR
+#   -DWORKDIR=<dir>            output folder, created if missing
+#   -DOUTPUTS=<files>          files written by CMD (relative to WORKDIR)
+#   -DEXPECTED=<files>         expected contents of OUTPUTS, same order
+#---------------------------------------------------------------
+file(MAKE_DIRECTORY ${WORKDIR})
+execute_process(COMMAND ${CMD} WORKING_DIRECTORY ${WORKDIR}
+                RESULT_VARIABLE status OUTPUT_QUIET ERROR_QUIET)
+if (NOT status EQUAL 0)
+   message(FATAL_ERROR "${CMD} exited with status ${status}")
+endif()
+list(LENGTH OUTPUTS n)
+math(EXPR last "${n} - 1")
+foreach(i RANGE ${last})
+   list(GET OUTPUTS ${i} out)
+   list(GET EXPECTED ${i} exp)
+   execute_process(COMMAND ${CMAKE_COMMAND} -E compare_files
+                   ${WORKDIR}/${out} ${exp} RESULT_VARIABLE differ)
+   if (NOT differ EQUAL 0)
+      message(FATAL_ERROR "${WORKDIR}/${out} differs from ${exp}")
+   endif()
+endforeach()